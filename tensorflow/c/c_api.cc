@@ -269,11 +269,6 @@ void TF_ExtendGraph(TF_Session* s, const void* proto, size_t proto_len,
   status->status = s->session->Extend(g);
 }
 
-static void DeleteArray(void* data, size_t size, void* arg) {
-  DCHECK_EQ(data, arg);
-  delete[] reinterpret_cast<char*>(arg);
-}
-
 }  // end extern "C"
 
 namespace tensorflow {
@@ -350,8 +345,10 @@ TF_Tensor* TF_Tensor_EncodeStrings(const Tensor& src) {
             tensorflow::core::VarintLength(s.size()) + s.size();
   }
 
-  // Encode all strings.
-  char* base = new char[size];
+  // Encode all strings, in a buffer aligned like those of TF_AllocateTensor()
+  // so that TF_NewTensor() does not copy it.
+  char* base = static_cast<char*>(allocate_tensor("TF_Tensor_EncodeStrings",
+                                                   size));
   char* data_start = base + sizeof(tensorflow::uint64) * srcarray.size();
   char* dst = data_start;  // Where next string is encoded.
   tensorflow::uint64* offsets = reinterpret_cast<tensorflow::uint64*>(base);
@@ -374,7 +371,7 @@ TF_Tensor* TF_Tensor_EncodeStrings(const Tensor& src) {
                 "64-bit int types should match in size");
   return TF_NewTensor(TF_STRING,
                       reinterpret_cast<const int64_t*>(dimvec.data()),
-                      dimvec.size(), base, size, DeleteArray, base);
+                      dimvec.size(), base, size, deallocate_buffer, nullptr);
 }
 
 class TensorCApi {
@@ -418,32 +415,72 @@ static void TF_Run_Setup(int noutputs, TF_Tensor** c_outputs,
   }
 }
 
-static bool TF_Run_Inputs(
+// Converts c_inputs[] to input_pairs[], without taking ownership of them.
+static bool TF_Run_BorrowedInputs(
     TF_Tensor* const* c_inputs,
     std::vector<std::pair<tensorflow::string, Tensor>>* input_pairs,
     TF_Status* status) {
   const int ninputs = input_pairs->size();
-  bool ok = true;
   for (int i = 0; i < ninputs; ++i) {
     TF_Tensor* src = c_inputs[i];
-    if (ok) {
-      if (c_inputs[i]->dtype != TF_STRING) {
-        (*input_pairs)[i].second = tensorflow::TensorCApi::MakeTensor(
-            src->dtype, src->shape, src->buffer);
-      } else {
-        // TF_STRING tensors require copying since Tensor class expects
-        // a sequence of string objects.
-        ok = tensorflow::TF_Tensor_DecodeStrings(src, &(*input_pairs)[i].second,
-                                                 status);
-        // Must keep looping through all c_inputs even if there is an error
-        // so that TF_DeleteTensor() is called unconditionally on all c_inputs.
+    if (src->dtype != TF_STRING) {
+      // The Tensor holds its own reference to the buffer.
+      (*input_pairs)[i].second = tensorflow::TensorCApi::MakeTensor(
+          src->dtype, src->shape, src->buffer);
+    } else {
+      // TF_STRING tensors require copying since Tensor class expects
+      // a sequence of string objects.
+      if (!tensorflow::TF_Tensor_DecodeStrings(src, &(*input_pairs)[i].second,
+                                               status)) {
+        return false;
       }
     }
-    TF_DeleteTensor(src);
+  }
+  return true;
+}
+
+static bool TF_Run_Inputs(
+    TF_Tensor* const* c_inputs,
+    std::vector<std::pair<tensorflow::string, Tensor>>* input_pairs,
+    TF_Status* status) {
+  const bool ok = TF_Run_BorrowedInputs(c_inputs, input_pairs, status);
+  // TF_DeleteTensor() is called unconditionally on all c_inputs.
+  for (size_t i = 0; i < input_pairs->size(); ++i) {
+    TF_DeleteTensor(c_inputs[i]);
   }
   return ok;
 }
 
+// Checks that c_outputs[i], if not NULL, can hold outputs[i].
+static bool TF_Run_CheckPreallocatedOutputs(const std::vector<Tensor>& outputs,
+                                            TF_Tensor* const* c_outputs,
+                                            TF_Status* status) {
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    const TF_Tensor* dst = c_outputs[i];
+    if (dst == nullptr) continue;
+    const Tensor& src = outputs[i];
+    if (src.dtype() == tensorflow::DT_STRING) {
+      status->status = tensorflow::errors::InvalidArgument(
+          "Output ", i, " is a TF_STRING tensor, which can not be written "
+          "into a preallocated tensor");
+      return false;
+    }
+    if (static_cast<tensorflow::DataType>(dst->dtype) != src.dtype() ||
+        dst->shape != src.shape() ||
+        TF_TensorByteSize(dst) != src.TotalBytes()) {
+      status->status = tensorflow::errors::InvalidArgument(
+          "Output ", i, " is a ", tensorflow::DataTypeString(src.dtype()),
+          " tensor of shape ", src.shape().DebugString(),
+          ", but the preallocated tensor is a ",
+          tensorflow::DataTypeString(
+              static_cast<tensorflow::DataType>(dst->dtype)),
+          " tensor of shape ", dst->shape.DebugString());
+      return false;
+    }
+  }
+  return true;
+}
+
 static void TF_Run_Helper(
     Session* session, const char* handle, const TF_Buffer* run_options,
     // Input tensors
@@ -496,10 +533,20 @@ static void TF_Run_Helper(
     status->status = result;
     return;
   }
+  if (!TF_Run_CheckPreallocatedOutputs(outputs, c_outputs, status)) {
+    return;
+  }
 
   // Store results in c_outputs[]
   for (int i = 0; i < noutputs; ++i) {
     const Tensor& src = outputs[i];
+    if (c_outputs[i] != nullptr) {
+      // Written into the caller's tensor, unless it already holds it.
+      void* dst = TF_TensorData(c_outputs[i]);
+      const tensorflow::StringPiece data = src.tensor_data();
+      if (dst != data.data()) memcpy(dst, data.data(), data.size());
+      continue;
+    }
     if (!src.IsInitialized() || src.NumElements() == 0) {
       c_outputs[i] = tensorflow::EmptyTensor(
           static_cast<TF_DataType>(src.dtype()), src.shape());
@@ -1317,6 +1364,43 @@ void TF_SessionRun(TF_SessionWithGraph* session, const TF_Buffer* run_options,
                 status);
 }
 
+void TF_SessionRunWithBorrowedTensors(
+    TF_SessionWithGraph* session, const TF_Buffer* run_options,
+    const TF_Port* inputs, TF_Tensor* const* input_values, int ninputs,
+    const TF_Port* outputs, TF_Tensor** output_values, int noutputs,
+    const TF_Operation* const* target_opers, int ntargets,
+    TF_Buffer* run_metadata, TF_Status* status) {
+  status->status = Status::OK();
+  if (!ExtendSessionGraphHelper(session, status)) {
+    return;
+  }
+
+  // Convert from TF_Port and TF_Tensor to a string and Tensor. The Tensors
+  // share the buffers of input_values[].
+  std::vector<std::pair<tensorflow::string, Tensor>> input_pairs(ninputs);
+  if (!TF_Run_BorrowedInputs(input_values, &input_pairs, status)) return;
+  for (int i = 0; i < ninputs; ++i) {
+    input_pairs[i].first = PortName(inputs[i]);
+  }
+
+  // Convert from TF_Port to string names.
+  std::vector<tensorflow::string> output_names(noutputs);
+  for (int i = 0; i < noutputs; ++i) {
+    output_names[i] = PortName(outputs[i]);
+  }
+
+  // Convert from TF_Operation* to string names.
+  std::vector<tensorflow::string> target_names(ntargets);
+  for (int i = 0; i < ntargets; ++i) {
+    target_names[i] = target_opers[i]->node.name();
+  }
+
+  // Actually run. The non-NULL output_values[] are written into.
+  TF_Run_Helper(session->session, nullptr, run_options, input_pairs,
+                output_names, output_values, target_names, run_metadata,
+                status);
+}
+
 void TF_SessionPRunSetup(TF_SessionWithGraph* session, const TF_Port* inputs,
                          int ninputs, const TF_Port* outputs, int noutputs,
                          const TF_Operation* const* target_opers, int ntargets,
@@ -569,6 +569,44 @@ extern void TF_SessionRun(TF_SessionWithGraph* session,
                           // Output status
                           TF_Status*);
 
+// Like TF_SessionRun(), but lets callers that run the same graph many
+// times reuse their tensors rather than create and copy new ones:
+//
+//    - `input_values` remain the property of the caller, who may delete
+//      them as soon as this returns. Their data is not copied (unless
+//      they are TF_STRING tensors): the implementation keeps a reference
+//      to their buffers while it uses them, so the deallocator passed to
+//      TF_NewTensor() is only called once both the caller and the
+//      implementation are done with them. That may be after this
+//      returns: ops that keep their inputs, such as QueueEnqueue or
+//      GetSessionHandle, keep sharing the buffer of an input they are
+//      fed. The caller must not change the data of an
+//      input while the graph may still hold it, since that would change
+//      the elements already kept as well.
+//    - If `output_values[i]` is not NULL on entry, it must be a tensor
+//      with the type and shape of the i-th output, whose data is written
+//      into it: it remains the property of the caller. TF_STRING outputs
+//      can not be written into a tensor. Otherwise, as in TF_SessionRun(),
+//      a new tensor that shares the buffer of the output is placed in
+//      `output_values[i]`, and becomes the property of the caller.
+//
+// On failure, the outputs that were NULL on entry are NULL, and the data
+// of the others is unspecified.
+extern void TF_SessionRunWithBorrowedTensors(
+    TF_SessionWithGraph* session,
+    // RunOptions
+    const TF_Buffer* run_options,
+    // Input tensors
+    const TF_Port* inputs, TF_Tensor* const* input_values, int ninputs,
+    // Output tensors
+    const TF_Port* outputs, TF_Tensor** output_values, int noutputs,
+    // Target operations
+    const TF_Operation* const* target_opers, int ntargets,
+    // RunMetadata
+    TF_Buffer* run_metadata,
+    // Output status
+    TF_Status*);
+
 // See TF_PRunSetup() below.
 extern void TF_SessionPRunSetup(TF_SessionWithGraph*,
                                 // Input names
@@ -692,6 +692,72 @@ TEST(CAPI, SessionWithGraph) {
   TF_DeleteStatus(s);
 }
 
+TEST(CAPI, SessionRunWithBorrowedTensors) {
+  TF_Status* s = TF_NewStatus();
+  TF_Graph* graph = TF_NewGraph();
+  TF_Operation* feed = Placeholder(graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Operation* two = ScalarConst(2, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_Operation* add = Add(feed, two, graph, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_SessionOptions* opts = TF_NewSessionOptions();
+  TF_SessionWithGraph* session = TF_NewSessionWithGraph(graph, opts, s);
+  TF_DeleteSessionOptions(opts);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+
+  TF_Port input{feed, 0};
+  TF_Port output{add, 0};
+  TF_Tensor* input_value = Int32Tensor(3);
+  TF_Tensor* output_value = TF_AllocateTensor(TF_INT32, nullptr, 0,
+                                              sizeof(tensorflow::int32));
+  tensorflow::int32* input_contents =
+      static_cast<tensorflow::int32*>(TF_TensorData(input_value));
+  tensorflow::int32* output_contents =
+      static_cast<tensorflow::int32*>(TF_TensorData(output_value));
+
+  // The same tensors are used by several runs.
+  for (int i = 0; i < 3; ++i) {
+    *input_contents = i;
+    TF_SessionRunWithBorrowedTensors(session, nullptr, &input, &input_value, 1,
+                                     &output, &output_value, 1, nullptr, 0,
+                                     nullptr, s);
+    ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+    EXPECT_EQ(output_contents, TF_TensorData(output_value));
+    EXPECT_EQ(i + 2, *output_contents);
+  }
+
+  // Without a preallocated output, a new tensor is returned.
+  TF_Tensor* new_output_value = nullptr;
+  TF_SessionRunWithBorrowedTensors(session, nullptr, &input, &input_value, 1,
+                                   &output, &new_output_value, 1, nullptr, 0,
+                                   nullptr, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  ASSERT_TRUE(new_output_value != nullptr);
+  EXPECT_EQ(2 + 2,
+            *static_cast<tensorflow::int32*>(TF_TensorData(new_output_value)));
+  TF_DeleteTensor(new_output_value);
+
+  // A preallocated output of the wrong shape fails the run.
+  const int64_t dims[] = {2};
+  TF_Tensor* wrong_output_value =
+      TF_AllocateTensor(TF_INT32, dims, 1, 2 * sizeof(tensorflow::int32));
+  TF_SessionRunWithBorrowedTensors(session, nullptr, &input, &input_value, 1,
+                                   &output, &wrong_output_value, 1, nullptr, 0,
+                                   nullptr, s);
+  EXPECT_EQ(TF_INVALID_ARGUMENT, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteTensor(wrong_output_value);
+
+  TF_DeleteTensor(input_value);
+  TF_DeleteTensor(output_value);
+  TF_CloseSessionWithGraph(session, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteSessionWithGraph(session, s);
+  ASSERT_EQ(TF_OK, TF_GetCode(s)) << TF_Message(s);
+  TF_DeleteGraph(graph);
+  TF_DeleteStatus(s);
+}
+
 // TODO(josh11b): Test:
 // * TF_SetDevice(desc, "/job:worker");
 // * control inputs / outputs
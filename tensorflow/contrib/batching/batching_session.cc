@@ -0,0 +1,476 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#define EIGEN_USE_THREADS
+
+#include "tensorflow/contrib/batching/batching_session.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <limits>
+
+#include "tensorflow/core/common_runtime/eigen_thread_pool.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/concat_lib.h"
+#include "tensorflow/core/kernels/split_lib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace batching {
+
+namespace {
+
+bool IsBatchableType(DataType dtype) {
+  switch (dtype) {
+#define CASE(T) case DataTypeToEnum<T>::value:
+    TF_CALL_ALL_TYPES(CASE)
+#undef CASE
+    return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the shape of "shape" with dimension 0 of size "size".
+TensorShape WithBatchSize(const TensorShape& shape, int64 size) {
+  TensorShape result = shape;
+  result.set_dim(0, size);
+  return result;
+}
+
+const Tensor* FindInput(const std::vector<std::pair<string, Tensor>>& inputs,
+                        const string& name) {
+  for (const auto& input : inputs) {
+    if (input.first == name) return &input.second;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+// A Run() call waiting for its batch to run.
+struct BatchingSession::Call {
+  const std::vector<std::pair<string, Tensor>>* inputs;
+  const std::vector<string>* output_names;
+  const std::vector<string>* target_nodes;
+  std::vector<Tensor>* outputs;
+  int64 size;
+  uint64 enqueue_micros;
+
+  Status status;
+  Notification done;
+};
+
+// The devices that concat_lib and split_lib run on.
+struct BatchingSession::CopyDevice {
+  explicit CopyDevice(Env* env)
+      // concat_lib uses at most 4 threads.
+      : num_threads(std::min(4, port::NumSchedulableCPUs())),
+        threads(env, "batching_copy", num_threads),
+        eigen_threads(&threads),
+        eigen_device(&eigen_threads, num_threads),
+        device(env) {
+    worker_threads.num_threads = num_threads;
+    worker_threads.workers = &threads;
+    device.set_tensorflow_cpu_worker_threads(&worker_threads);
+    device.set_eigen_cpu_device(&eigen_device);
+  }
+
+  const int num_threads;
+  thread::ThreadPool threads;
+  EigenThreadPoolWrapper eigen_threads;
+  Eigen::ThreadPoolDevice eigen_device;
+  DeviceBase::CpuWorkerThreads worker_threads;
+  DeviceBase device;
+};
+
+struct BatchingSession::Batch {
+  std::vector<Call*> calls;
+  int64 size = 0;
+  uint64 deadline_micros = 0;
+
+  // Returns true if the feeds of "call" can be concatenated with those
+  // of the batch, i.e. they only differ in dimension 0.
+  bool IsCompatible(const Call& call) const {
+    const Call& first = *calls[0];
+    for (const auto& input : *call.inputs) {
+      const Tensor* other = FindInput(*first.inputs, input.first);
+      if (other == nullptr || other->dtype() != input.second.dtype() ||
+          other->dims() != input.second.dims()) {
+        return false;
+      }
+      for (int d = 1; d < other->dims(); ++d) {
+        if (other->dim_size(d) != input.second.dim_size(d)) return false;
+      }
+    }
+    return true;
+  }
+};
+
+BatchingSession::BatchingSession(const BatchingSessionOptions& options,
+                                 std::unique_ptr<Session> wrapped)
+    : options_(options),
+      wrapped_(std::move(wrapped)),
+      env_(Env::Default()),
+      copy_device_(new CopyDevice(env_)) {
+  CHECK_GT(options_.max_batch_size, 0);
+  CHECK_GT(options_.num_batch_threads, 0);
+  batch_threads_.reset(new thread::ThreadPool(env_, "batching",
+                                              options_.num_batch_threads));
+  for (int i = 0; i < options_.num_batch_threads; ++i) {
+    batch_threads_->Schedule([this]() { ProcessBatches(); });
+  }
+}
+
+BatchingSession::~BatchingSession() {
+  {
+    mutex_lock l(mu_);
+    for (auto& it : open_batches_) {
+      if (it.second != nullptr) CloseBatch(it.first);
+    }
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  // Runs the remaining batches, and joins the batch threads.
+  batch_threads_.reset();
+}
+
+Status BatchingSession::Create(const GraphDef& graph) {
+  return wrapped_->Create(graph);
+}
+
+Status BatchingSession::Extend(const GraphDef& graph) {
+  return wrapped_->Extend(graph);
+}
+
+bool BatchingSession::IsBatchable(
+    const std::vector<std::pair<string, Tensor>>& inputs, int64* size) const {
+  if (inputs.empty()) return false;
+  *size = -1;
+  for (const auto& input : inputs) {
+    const Tensor& t = input.second;
+    if (t.dims() == 0 || t.dim_size(0) == 0 || !IsBatchableType(t.dtype())) {
+      return false;
+    }
+    if (*size == -1) {
+      *size = t.dim_size(0);
+    } else if (*size != t.dim_size(0)) {
+      return false;
+    }
+  }
+  return *size <= options_.max_batch_size;
+}
+
+Status BatchingSession::Run(
+    const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_names,
+    const std::vector<string>& target_nodes, std::vector<Tensor>* outputs) {
+  int64 size;
+  if (!IsBatchable(inputs, &size)) {
+    return wrapped_->Run(inputs, output_names, target_nodes, outputs);
+  }
+
+  // Calls are batched together if they have the same feeds, fetches in
+  // the same order, and targets.
+  std::vector<string> input_names;
+  for (const auto& input : inputs) input_names.push_back(input.first);
+  std::sort(input_names.begin(), input_names.end());
+  std::vector<string> sorted_targets = target_nodes;
+  std::sort(sorted_targets.begin(), sorted_targets.end());
+  const string key = strings::StrCat(
+      str_util::Join(input_names, ","), "->",
+      str_util::Join(output_names, ","), "/",
+      str_util::Join(sorted_targets, ","));
+
+  Call call;
+  call.inputs = &inputs;
+  call.output_names = &output_names;
+  call.target_nodes = &target_nodes;
+  call.outputs = outputs;
+  call.size = size;
+  call.enqueue_micros = env_->NowMicros();
+  {
+    mutex_lock l(mu_);
+    if (closed_) {
+      return errors::Cancelled("Session has been closed.");
+    }
+    if (num_enqueued_calls_ >= options_.max_enqueued_calls) {
+      return errors::Unavailable("The batching queue is full, with ",
+                                 num_enqueued_calls_, " calls");
+    }
+    ++num_enqueued_calls_;
+    std::unique_ptr<Batch>& batch = open_batches_[key];
+    if (batch != nullptr && (batch->size + size > options_.max_batch_size ||
+                             !batch->IsCompatible(call))) {
+      CloseBatch(key);
+    }
+    if (batch == nullptr) {
+      batch.reset(new Batch);
+      batch->deadline_micros =
+          call.enqueue_micros + options_.batch_timeout_micros;
+    }
+    batch->calls.push_back(&call);
+    batch->size += size;
+    if (batch->size == options_.max_batch_size) {
+      CloseBatch(key);
+    }
+  }
+  // Either a batch is ready, or a new deadline may need to be waited for.
+  cv_.notify_one();
+  call.done.WaitForNotification();
+  return call.status;
+}
+
+Status BatchingSession::Run(
+    const RunOptions& run_options,
+    const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_names,
+    const std::vector<string>& target_nodes, std::vector<Tensor>* outputs,
+    RunMetadata* run_metadata) {
+  // The options and metadata are those of a single call.
+  return wrapped_->Run(run_options, inputs, output_names, target_nodes,
+                       outputs, run_metadata);
+}
+
+Status BatchingSession::PRunSetup(const std::vector<string>& input_names,
+                                  const std::vector<string>& output_names,
+                                  const std::vector<string>& target_nodes,
+                                  string* handle) {
+  return wrapped_->PRunSetup(input_names, output_names, target_nodes, handle);
+}
+
+Status BatchingSession::PRun(
+    const string& handle, const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_names, std::vector<Tensor>* outputs) {
+  return wrapped_->PRun(handle, inputs, output_names, outputs);
+}
+
+Status BatchingSession::Close() {
+  {
+    mutex_lock l(mu_);
+    closed_ = true;
+    // Runs the waiting calls without waiting for more.
+    for (auto& it : open_batches_) {
+      if (it.second != nullptr) CloseBatch(it.first);
+    }
+  }
+  cv_.notify_all();
+  return wrapped_->Close();
+}
+
+void BatchingSession::GetStats(BatchingSessionStats* stats) {
+  mutex_lock l(stats_mu_);
+  batch_size_.EncodeToProto(&stats->batch_size, false);
+  queue_latency_micros_.EncodeToProto(&stats->queue_latency_micros, false);
+}
+
+void BatchingSession::CloseBatch(const string& key) {
+  ready_.push_back(std::move(open_batches_[key]));
+}
+
+void BatchingSession::ProcessBatches() {
+  while (true) {
+    std::unique_ptr<Batch> batch;
+    {
+      mutex_lock l(mu_);
+      while (ready_.empty()) {
+        if (shutdown_) return;
+        // Closes the batches that timed out, and waits for the next
+        // deadline otherwise.
+        const uint64 now = env_->NowMicros();
+        uint64 next_deadline = std::numeric_limits<uint64>::max();
+        for (auto& it : open_batches_) {
+          if (it.second == nullptr) continue;
+          if (it.second->deadline_micros <= now) {
+            CloseBatch(it.first);
+          } else {
+            next_deadline = std::min(next_deadline, it.second->deadline_micros);
+          }
+        }
+        if (!ready_.empty()) break;
+        if (next_deadline == std::numeric_limits<uint64>::max()) {
+          cv_.wait(l);
+        } else {
+          cv_.wait_for(l, std::chrono::microseconds(next_deadline - now));
+        }
+      }
+      batch = std::move(ready_.front());
+      ready_.pop_front();
+      num_enqueued_calls_ -= batch->calls.size();
+    }
+    ProcessBatch(batch.get());
+  }
+}
+
+void BatchingSession::ProcessBatch(Batch* batch) {
+  const uint64 start_micros = env_->NowMicros();
+  {
+    mutex_lock l(stats_mu_);
+    batch_size_.Add(batch->size);
+    for (const Call* call : batch->calls) {
+      queue_latency_micros_.Add(start_micros - call->enqueue_micros);
+    }
+  }
+  if (batch->calls.size() == 1) {
+    Call* call = batch->calls[0];
+    call->status = wrapped_->Run(*call->inputs, *call->output_names,
+                                 *call->target_nodes, call->outputs);
+  } else {
+    const Status s = RunBatch(batch);
+    if (!s.ok()) {
+      for (Call* call : batch->calls) call->status = s;
+    }
+  }
+  for (Call* call : batch->calls) {
+    call->done.Notify();
+  }
+}
+
+Status BatchingSession::RunBatch(Batch* batch) {
+  const Call& first = *batch->calls[0];
+  std::vector<std::pair<string, Tensor>> inputs;
+  std::vector<Tensor> tensors;
+  for (const auto& input : *first.inputs) {
+    tensors.clear();
+    for (const Call* call : batch->calls) {
+      tensors.push_back(*FindInput(*call->inputs, input.first));
+    }
+    Tensor batched;
+    TF_RETURN_IF_ERROR(ConcatTensors(tensors, &batched));
+    inputs.emplace_back(input.first, batched);
+  }
+
+  std::vector<Tensor> outputs;
+  TF_RETURN_IF_ERROR(wrapped_->Run(inputs, *first.output_names,
+                                   *first.target_nodes, &outputs));
+
+  std::vector<int64> sizes;
+  for (const Call* call : batch->calls) {
+    sizes.push_back(call->size);
+    call->outputs->clear();
+    call->outputs->resize(outputs.size());
+  }
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    TF_RETURN_IF_ERROR(SplitTensor(outputs[i], sizes, &tensors));
+    for (size_t j = 0; j < batch->calls.size(); ++j) {
+      (*batch->calls[j]->outputs)[i] = tensors[j];
+    }
+  }
+  return Status::OK();
+}
+
+Status BatchingSession::ConcatTensors(const std::vector<Tensor>& tensors,
+                                      Tensor* batched) {
+  int64 size = 0;
+  for (const Tensor& t : tensors) size += t.dim_size(0);
+  const DataType dtype = tensors[0].dtype();
+  *batched = Tensor(dtype, WithBatchSize(tensors[0].shape(), size));
+  if (batched->NumElements() == 0) return Status::OK();
+
+  // Concatenating along dimension 0 is concatenating the tensors
+  // flattened to single rows.
+  switch (dtype) {
+#define CASE(T)                                                               \
+  case DataTypeToEnum<T>::value: {                                            \
+    std::vector<std::unique_ptr<typename TTypes<T, 2>::ConstMatrix>> inputs; \
+    for (const Tensor& t : tensors) {                                         \
+      inputs.emplace_back(new typename TTypes<T, 2>::ConstMatrix(             \
+          t.shaped<T, 2>({1, t.NumElements()})));                             \
+    }                                                                         \
+    auto output = batched->shaped<T, 2>({1, batched->NumElements()});         \
+    ConcatCPU<T>(&copy_device_->device, inputs, &output);                   \
+    break;                                                                    \
+  }
+    TF_CALL_ALL_TYPES(CASE)
+#undef CASE
+    default:
+      return errors::Unimplemented("Cannot batch tensors of type ",
+                                   DataTypeString(dtype));
+  }
+  return Status::OK();
+}
+
+Status BatchingSession::SplitTensor(const Tensor& batched,
+                                    const std::vector<int64>& sizes,
+                                    std::vector<Tensor>* tensors) {
+  int64 size = 0;
+  for (int64 s : sizes) size += s;
+  if (batched.dims() == 0 || batched.dim_size(0) != size) {
+    return errors::FailedPrecondition(
+        "Cannot split a fetched tensor of shape ",
+        batched.shape().DebugString(), " into the results of a batch of size ",
+        size, ": its dimension 0 must be the batch dimension");
+  }
+  if (!IsBatchableType(batched.dtype())) {
+    return errors::Unimplemented("Cannot split tensors of type ",
+                                 DataTypeString(batched.dtype()));
+  }
+  tensors->clear();
+  for (int64 s : sizes) {
+    tensors->emplace_back(batched.dtype(), WithBatchSize(batched.shape(), s));
+  }
+  if (batched.NumElements() == 0) return Status::OK();
+
+  // Splitting along dimension 0 is splitting the middle dimension of a
+  // {1, size, elements per row} tensor.
+  const int64 row_size = batched.NumElements() / size;
+  switch (batched.dtype()) {
+#define CASE(T)                                                           \
+  case DataTypeToEnum<T>::value: {                                        \
+    auto input = batched.shaped<T, 3>({1, size, row_size});               \
+    Eigen::DSizes<Eigen::DenseIndex, 3> indices(0, 0, 0);                 \
+    for (size_t i = 0; i < sizes.size(); ++i) {                           \
+      Eigen::DSizes<Eigen::DenseIndex, 3> slice_sizes(1, sizes[i],        \
+                                                      row_size);          \
+      functor::Split<Eigen::ThreadPoolDevice, T>()(                       \
+          copy_device_->eigen_device, (*tensors)[i].shaped<T, 3>(          \
+                                   {1, sizes[i], row_size}),              \
+          input, indices, slice_sizes);                                   \
+      indices[1] += sizes[i];                                             \
+    }                                                                     \
+    break;                                                                \
+  }
+    TF_CALL_ALL_TYPES(CASE)
+#undef CASE
+    default:
+      break;
+  }
+  return Status::OK();
+}
+
+Status CreateBatchingSession(
+    const BatchingSessionOptions& options, std::unique_ptr<Session> session,
+    std::unique_ptr<BatchingSession>* batching_session) {
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be positive, got ",
+                                   options.max_batch_size);
+  }
+  if (options.num_batch_threads <= 0) {
+    return errors::InvalidArgument("num_batch_threads must be positive, got ",
+                                   options.num_batch_threads);
+  }
+  batching_session->reset(new BatchingSession(options, std::move(session)));
+  return Status::OK();
+}
+
+}  // namespace batching
+}  // namespace tensorflow
@@ -0,0 +1,176 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A Session that coalesces concurrent Run() calls into batches, for
+// serving models whose inputs and outputs have a batch dimension.
+
+#ifndef THIRD_PARTY_TENSORFLOW_CONTRIB_BATCHING_BATCHING_SESSION_H_
+#define THIRD_PARTY_TENSORFLOW_CONTRIB_BATCHING_BATCHING_SESSION_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/summary.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/histogram/histogram.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace batching {
+
+struct BatchingSessionOptions {
+  // The maximum size of a batch, i.e. the maximum sum of the sizes of
+  // dimension 0 of the inputs of the Run() calls in a batch. Calls with
+  // larger inputs run on their own.
+  int max_batch_size = 32;
+
+  // How long a batch waits for calls to fill it, from the arrival of its
+  // first call. A batch runs as soon as it is full or times out.
+  int64 batch_timeout_micros = 1000;
+
+  // The number of batches that can run concurrently.
+  int num_batch_threads = 1;
+
+  // The maximum number of Run() calls waiting for their batch to run.
+  // Further calls fail with UNAVAILABLE, so that clients can back off
+  // rather than let the latency grow without bound.
+  int max_enqueued_calls = 1000;
+};
+
+// Distributions collected since the session was created.
+struct BatchingSessionStats {
+  // The size of each batch that was run.
+  HistogramProto batch_size;
+
+  // For each batched call, the time from its arrival to the start of
+  // its batch, in microseconds.
+  HistogramProto queue_latency_micros;
+};
+
+// Wraps a Session to run concurrent Run() calls with the same feed and
+// fetch names, and compatible feeds, as a single call.
+//
+// The feeds of a batch are concatenated along dimension 0, the wrapped
+// session is run once, and each fetched tensor is split along dimension
+// 0 into the results of the calls, in proportion to the sizes of their
+// feeds. All the feeds of a call must therefore have the same size in
+// dimension 0, and all the fetches must have the size of the batch in
+// dimension 0: the calls of a batch fail together otherwise. Calls
+// whose feeds have no batch dimension, or that pass RunOptions, are
+// run directly by the wrapped session.
+class BatchingSession : public Session {
+ public:
+  BatchingSession(const BatchingSessionOptions& options,
+                  std::unique_ptr<Session> wrapped);
+  ~BatchingSession() override;
+
+  ::tensorflow::Status Create(const GraphDef& graph) override;
+  ::tensorflow::Status Extend(const GraphDef& graph) override;
+  ::tensorflow::Status Run(const std::vector<std::pair<string, Tensor>>& inputs,
+                           const std::vector<string>& output_names,
+                           const std::vector<string>& target_nodes,
+                           std::vector<Tensor>* outputs) override;
+  ::tensorflow::Status Run(const RunOptions& run_options,
+                           const std::vector<std::pair<string, Tensor>>& inputs,
+                           const std::vector<string>& output_names,
+                           const std::vector<string>& target_nodes,
+                           std::vector<Tensor>* outputs,
+                           RunMetadata* run_metadata) override;
+  ::tensorflow::Status PRunSetup(const std::vector<string>& input_names,
+                                 const std::vector<string>& output_names,
+                                 const std::vector<string>& target_nodes,
+                                 string* handle) override;
+  ::tensorflow::Status PRun(
+      const string& handle,
+      const std::vector<std::pair<string, Tensor>>& inputs,
+      const std::vector<string>& output_names,
+      std::vector<Tensor>* outputs) override;
+  ::tensorflow::Status Close() override;
+
+  void GetStats(BatchingSessionStats* stats);
+
+ private:
+  struct Call;
+  struct Batch;
+  struct CopyDevice;
+
+  // Returns true if "inputs" can be batched, and their size in "*size".
+  bool IsBatchable(const std::vector<std::pair<string, Tensor>>& inputs,
+                   int64* size) const;
+
+  // Moves the open batch of "key" to ready_.
+  void CloseBatch(const string& key) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // The loop of each batch thread.
+  void ProcessBatches();
+  void ProcessBatch(Batch* batch);
+  ::tensorflow::Status RunBatch(Batch* batch);
+
+  ::tensorflow::Status ConcatTensors(const std::vector<Tensor>& tensors,
+                                     Tensor* batched);
+  ::tensorflow::Status SplitTensor(const Tensor& batched,
+                                   const std::vector<int64>& sizes,
+                                   std::vector<Tensor>* tensors);
+
+  const BatchingSessionOptions options_;
+  std::unique_ptr<Session> wrapped_;
+  Env* const env_;
+
+  mutex mu_;
+  condition_variable cv_;
+  // The batch that calls join, for each combination of feed and fetch
+  // names. Null once it has been closed.
+  std::unordered_map<string, std::unique_ptr<Batch>> open_batches_
+      GUARDED_BY(mu_);
+  // The batches that are waiting for a batch thread.
+  std::deque<std::unique_ptr<Batch>> ready_ GUARDED_BY(mu_);
+  int num_enqueued_calls_ GUARDED_BY(mu_) = 0;
+  bool closed_ GUARDED_BY(mu_) = false;
+  bool shutdown_ GUARDED_BY(mu_) = false;
+
+  mutex stats_mu_;
+  histogram::Histogram batch_size_ GUARDED_BY(stats_mu_);
+  histogram::Histogram queue_latency_micros_ GUARDED_BY(stats_mu_);
+
+  // The threads used to concatenate and split tensors.
+  std::unique_ptr<CopyDevice> copy_device_;
+
+  // Declared last, so that the batch threads are joined before the rest
+  // of the session is destroyed.
+  std::unique_ptr<thread::ThreadPool> batch_threads_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchingSession);
+};
+
+// Creates a BatchingSession that wraps "session" in "*batching_session".
+Status CreateBatchingSession(const BatchingSessionOptions& options,
+                             std::unique_ptr<Session> session,
+                             std::unique_ptr<BatchingSession>* batching_session);
+
+}  // namespace batching
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_CONTRIB_BATCHING_BATCHING_SESSION_H_
@@ -0,0 +1,249 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/batching/batching_session.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace batching {
+namespace {
+
+// Computes "y" = 2 * "x" and "z" = "x" + 1 for float feeds "x" of any
+// shape, and "scalar" = 0, and records the size of each run.
+class FakeSession : public Session {
+ public:
+  explicit FakeSession(std::vector<int64>* run_sizes, mutex* mu)
+      : run_sizes_(run_sizes), mu_(mu) {}
+
+  Status Create(const GraphDef& graph) override { return Status::OK(); }
+  Status Extend(const GraphDef& graph) override { return Status::OK(); }
+  Status Close() override { return Status::OK(); }
+
+  Status Run(const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_names,
+             const std::vector<string>& target_nodes,
+             std::vector<Tensor>* outputs) override {
+    if (inputs.size() != 1 || inputs[0].first != "x") {
+      return errors::InvalidArgument("Expected a single feed x");
+    }
+    const Tensor& x = inputs[0].second;
+    {
+      mutex_lock l(*mu_);
+      run_sizes_->push_back(x.dims() > 0 ? x.dim_size(0) : 0);
+    }
+    outputs->clear();
+    for (const string& name : output_names) {
+      if (name == "scalar") {
+        outputs->push_back(test::AsScalar<float>(0));
+        continue;
+      }
+      Tensor out(DT_FLOAT, x.shape());
+      for (int64 i = 0; i < x.NumElements(); ++i) {
+        out.flat<float>()(i) =
+            name == "y" ? 2 * x.flat<float>()(i) : x.flat<float>()(i) + 1;
+      }
+      outputs->push_back(out);
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::vector<int64>* const run_sizes_;
+  mutex* const mu_;
+};
+
+class BatchingSessionTest : public ::testing::Test {
+ protected:
+  void Init(int max_batch_size, int64 batch_timeout_micros) {
+    BatchingSessionOptions options;
+    options.max_batch_size = max_batch_size;
+    options.batch_timeout_micros = batch_timeout_micros;
+    TF_ASSERT_OK(CreateBatchingSession(
+        options, std::unique_ptr<Session>(new FakeSession(&run_sizes_, &mu_)),
+        &session_));
+  }
+
+  // Feeds x = [[value, value]] * rows and fetches "fetch".
+  Status RunRows(float value, int rows, const string& fetch,
+                 std::vector<Tensor>* outputs) {
+    Tensor x(DT_FLOAT, TensorShape({rows, 2}));
+    x.flat<float>().setConstant(value);
+    return session_->Run({{"x", x}}, {fetch}, {}, outputs);
+  }
+
+  std::vector<int64> RunSizes() {
+    mutex_lock l(mu_);
+    return run_sizes_;
+  }
+
+  mutex mu_;
+  std::vector<int64> run_sizes_;
+  std::unique_ptr<BatchingSession> session_;
+};
+
+TEST_F(BatchingSessionTest, BatchesConcurrentCalls) {
+  // The batch only runs once it is full.
+  Init(4, 60 * 1000 * 1000);
+  std::vector<Tensor> outputs[4];
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 4);
+    for (int i = 0; i < 4; ++i) {
+      pool.Schedule([this, i, &outputs]() {
+        TF_EXPECT_OK(RunRows(i, 1, "y", &outputs[i]));
+      });
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(1, outputs[i].size());
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({2.0f * i, 2.0f * i}, {1, 2}), outputs[i][0]);
+  }
+  EXPECT_EQ(std::vector<int64>({4}), RunSizes());
+
+  BatchingSessionStats stats;
+  session_->GetStats(&stats);
+  EXPECT_EQ(1, stats.batch_size.num());
+  EXPECT_EQ(4, stats.batch_size.max());
+  EXPECT_EQ(4, stats.queue_latency_micros.num());
+}
+
+TEST_F(BatchingSessionTest, SplitsByCallSize) {
+  Init(5, 60 * 1000 * 1000);
+  std::vector<Tensor> outputs[2];
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2);
+    for (int i = 0; i < 2; ++i) {
+      pool.Schedule([this, i, &outputs]() {
+        TF_EXPECT_OK(RunRows(i, 2 + i, "z", &outputs[i]));
+      });
+    }
+  }
+  ASSERT_EQ(1, outputs[0].size());
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({1, 1, 1, 1}, {2, 2}), outputs[0][0]);
+  ASSERT_EQ(1, outputs[1].size());
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({2, 2, 2, 2, 2, 2}, {3, 2}), outputs[1][0]);
+  EXPECT_EQ(std::vector<int64>({5}), RunSizes());
+}
+
+TEST_F(BatchingSessionTest, LargeTensors) {
+  // Large enough for concat_lib and split_lib to use several threads.
+  Init(200, 60 * 1000 * 1000);
+  std::vector<Tensor> outputs[2];
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2);
+    for (int i = 0; i < 2; ++i) {
+      pool.Schedule([this, i, &outputs]() {
+        Tensor x(DT_FLOAT, TensorShape({100, 1000}));
+        x.flat<float>().setConstant(i);
+        TF_EXPECT_OK(session_->Run({{"x", x}}, {"y"}, {}, &outputs[i]));
+      });
+    }
+  }
+  for (int i = 0; i < 2; ++i) {
+    Tensor expected(DT_FLOAT, TensorShape({100, 1000}));
+    expected.flat<float>().setConstant(2 * i);
+    test::ExpectTensorEqual<float>(expected, outputs[i][0]);
+  }
+  EXPECT_EQ(std::vector<int64>({200}), RunSizes());
+}
+
+TEST_F(BatchingSessionTest, TimeoutRunsPartialBatch) {
+  Init(8, 1000);
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(RunRows(3, 3, "y", &outputs));
+  ASSERT_EQ(1, outputs.size());
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({6, 6, 6, 6, 6, 6}, {3, 2}), outputs[0]);
+  EXPECT_EQ(std::vector<int64>({3}), RunSizes());
+}
+
+TEST_F(BatchingSessionTest, DifferentFetchesAreNotBatched) {
+  Init(2, 100 * 1000);
+  std::vector<Tensor> outputs[2];
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2);
+    for (int i = 0; i < 2; ++i) {
+      pool.Schedule([this, i, &outputs]() {
+        TF_EXPECT_OK(RunRows(1, 1, i == 0 ? "y" : "z", &outputs[i]));
+      });
+    }
+  }
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({2, 2}, {1, 2}),
+                                 outputs[0][0]);
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({2, 2}, {1, 2}),
+                                 outputs[1][0]);
+  EXPECT_EQ(std::vector<int64>({1, 1}), RunSizes());
+}
+
+TEST_F(BatchingSessionTest, UnbatchableCallsRunDirectly) {
+  Init(2, 60 * 1000 * 1000);
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session_->Run({{"x", test::AsScalar<float>(3)}}, {"y"}, {},
+                             &outputs));
+  test::ExpectTensorEqual<float>(test::AsScalar<float>(6), outputs[0]);
+  // Larger than a batch.
+  TF_ASSERT_OK(RunRows(1, 3, "y", &outputs));
+  EXPECT_EQ(3, outputs[0].dim_size(0));
+
+  BatchingSessionStats stats;
+  session_->GetStats(&stats);
+  EXPECT_EQ(0, stats.batch_size.num());
+}
+
+TEST_F(BatchingSessionTest, UnbatchedFetchFailsTheBatch) {
+  Init(2, 60 * 1000 * 1000);
+  Status status[2];
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2);
+    for (int i = 0; i < 2; ++i) {
+      pool.Schedule([this, i, &status]() {
+        std::vector<Tensor> outputs;
+        status[i] = RunRows(i, 1, "scalar", &outputs);
+      });
+    }
+  }
+  EXPECT_EQ(error::FAILED_PRECONDITION, status[0].code());
+  EXPECT_EQ(error::FAILED_PRECONDITION, status[1].code());
+}
+
+TEST_F(BatchingSessionTest, CloseRunsWaitingCalls) {
+  Init(2, 60 * 1000 * 1000);
+  std::vector<Tensor> outputs;
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 1);
+    pool.Schedule(
+        [this, &outputs]() { TF_EXPECT_OK(RunRows(1, 1, "y", &outputs)); });
+    // Gives the call time to join its batch, which would otherwise only
+    // run after the timeout.
+    Env::Default()->SleepForMicroseconds(100 * 1000);
+    TF_ASSERT_OK(session_->Close());
+  }
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_EQ(std::vector<int64>({1}), RunSizes());
+  EXPECT_EQ(error::CANCELLED, RunRows(1, 1, "y", &outputs).code());
+}
+
+}  // namespace
+}  // namespace batching
+}  // namespace tensorflow
@@ -21,7 +21,7 @@ limitations under the License.
 
 namespace tensorflow {
 
-AllocatorRetry::AllocatorRetry() : env_(Env::Default()) {}
+AllocatorRetry::AllocatorRetry() : env_(Env::Default()), num_retrying_(0) {}
 
 void* AllocatorRetry::AllocateRaw(
     std::function<void*(size_t alignment, size_t num_bytes,
@@ -35,6 +35,9 @@ void* AllocatorRetry::AllocateRaw(
   uint64 deadline_micros = 0;
   bool first = true;
   void* ptr = nullptr;
+  // Registered before the first attempt, so that a deallocation that
+  // the attempt misses is notified.
+  ++num_retrying_;
   while (ptr == nullptr) {
     ptr = alloc_func(alignment, num_bytes, false);
     if (ptr == nullptr) {
@@ -48,10 +51,12 @@ void* AllocatorRetry::AllocateRaw(
         WaitForMilliseconds(&l, &memory_returned_,
                             (deadline_micros - now) / 1000);
       } else {
-        return alloc_func(alignment, num_bytes, true);
+        ptr = alloc_func(alignment, num_bytes, true);
+        break;
       }
     }
   }
+  --num_retrying_;
   return ptr;
 }
 
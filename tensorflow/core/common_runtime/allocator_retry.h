@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_ALLOCATOR_RETRY_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_ALLOCATOR_RETRY_H_
 
+#include <atomic>
+
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
@@ -47,10 +49,15 @@ class AllocatorRetry {
   Env* env_;
   mutex mu_;
   condition_variable memory_returned_;
+
+  // The number of callers of AllocateRaw() retrying, so that
+  // NotifyDealloc() only takes "mu_" when somebody may be waiting.
+  std::atomic<int> num_retrying_;
 };
 
 // Implementation details below
 inline void AllocatorRetry::NotifyDealloc() {
+  if (num_retrying_.load() == 0) return;
   mutex_lock l(mu_);
   memory_returned_.notify_all();
 }
@@ -113,7 +113,11 @@ bool BFCAllocator::Extend(size_t rounded_bytes) {
     bytes = RoundedBytes(bytes * kBackpedalFactor);
     while (mem_addr == nullptr && bytes > rounded_bytes) {
       mem_addr = suballocator_->Alloc(32, bytes);
-      bytes = RoundedBytes(bytes * kBackpedalFactor);
+      if (mem_addr == nullptr) {
+        // Rounding up can cancel the reduction of small sizes.
+        bytes = std::min(RoundedBytes(bytes * kBackpedalFactor),
+                         bytes - kMinAllocationSize);
+      }
     }
   }
 
@@ -235,7 +239,8 @@ size_t BFCAllocator::RoundedBytes(size_t bytes) {
 
 void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
                                         size_t num_bytes,
-                                        bool dump_log_on_failure) {
+                                        bool dump_log_on_failure,
+                                        size_t* allocated_bytes) {
   if (num_bytes == 0) {
     LOG(ERROR) << "tried to allocate 0 bytes";
     return nullptr;
@@ -249,14 +254,14 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
   BinNum bin_num = BinNumForSize(rounded_bytes);
 
   mutex_lock l(lock_);
-  void* ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
+  void* ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, allocated_bytes);
   if (ptr != nullptr) {
     return ptr;
   }
 
   // Try to extend
   if (Extend(rounded_bytes)) {
-    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, allocated_bytes);
     if (ptr != nullptr) {
       return ptr;
     }
@@ -276,7 +281,7 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
 }
 
 void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
-                                 size_t num_bytes) {
+                                 size_t num_bytes, size_t* allocated_bytes) {
   // First identify the first bin that could satisfy rounded_bytes.
   for (; bin_num < kNumBins; bin_num++) {
     // Start searching from the first bin for the smallest chunk that fits
@@ -317,6 +322,10 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         stats_.max_alloc_size =
             std::max<std::size_t>(stats_.max_alloc_size, chunk->size);
 
+        if (allocated_bytes != nullptr) {
+          *allocated_bytes = chunk->size;
+        }
+
         VLOG(4) << "Returning: " << chunk->ptr;
         if (VLOG_IS_ON(4)) {
           LOG(INFO) << "A: " << RenderOccupancy();
@@ -369,10 +378,10 @@ void BFCAllocator::DeallocateRaw(void* ptr) {
   retry_helper_.NotifyDealloc();
 }
 
-void BFCAllocator::DeallocateRawInternal(void* ptr) {
+size_t BFCAllocator::DeallocateRawInternal(void* ptr) {
   if (ptr == nullptr) {
     LOG(ERROR) << "tried to deallocate nullptr";
-    return;
+    return 0;
   }
   mutex_lock l(lock_);
 
@@ -380,12 +389,15 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
 
+  const size_t freed_bytes = ChunkFromHandle(h)->size;
+
   // Consider coalescing it.
   FreeAndMaybeCoalesce(h);
 
   if (VLOG_IS_ON(4)) {
     LOG(INFO) << "F: " << RenderOccupancy();
   }
+  return freed_bytes;
 }
 
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
@@ -72,9 +72,15 @@ class BFCAllocator : public VisitableAllocator {
  private:
   struct Bin;
 
+  friend class ShardedBFCAllocator;
+
+  // If "allocated_bytes" is not nullptr, sets it to the size of the
+  // chunk returned.
   void* AllocateRawInternal(size_t alignment, size_t num_bytes,
-                            bool dump_log_on_failure);
-  void DeallocateRawInternal(void* ptr);
+                            bool dump_log_on_failure,
+                            size_t* allocated_bytes = nullptr);
+  // Returns the size of the chunk freed.
+  size_t DeallocateRawInternal(void* ptr);
 
   // A ChunkHandle is an index into the chunks_ vector in BFCAllocator
   // kInvalidChunkHandle means an invalid chunk
@@ -306,8 +312,8 @@ class BFCAllocator : public VisitableAllocator {
 
   // Returns a pointer to an underlying allocated chunk of size
   // 'rounded_bytes'.
-  void* FindChunkPtr(BinNum bin_num, size_t rounded_bytes, size_t num_bytes)
-      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void* FindChunkPtr(BinNum bin_num, size_t rounded_bytes, size_t num_bytes,
+                     size_t* allocated_bytes) EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
   // Splits the chunk specified by 'h' into two chunks, one at least
   // of size 'num_bytes'.
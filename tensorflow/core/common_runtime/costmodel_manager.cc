@@ -42,6 +42,15 @@ CostModel* CostModelManager::FindOrCreateCostModel(const Graph* graph) {
   return cost_model;
 }
 
+void CostModelManager::RemoveCostModelForGraph(const Graph* graph) {
+  mutex_lock l(mu_);
+  auto it = cost_models_.find(graph);
+  if (it != cost_models_.end()) {
+    delete it->second;
+    cost_models_.erase(it);
+  }
+}
+
 Status CostModelManager::AddToCostGraphDef(const Graph* graph,
                                            CostGraphDef* cost_graph) {
   mutex_lock l(mu_);
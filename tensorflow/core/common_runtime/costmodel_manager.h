@@ -41,6 +41,10 @@ class CostModelManager {
 
   CostModel* FindOrCreateCostModel(const Graph* graph);
 
+  // Deletes the cost model of "graph", if any. Must be called before
+  // "graph" is destroyed, so that no other graph gets its cost model.
+  void RemoveCostModelForGraph(const Graph* graph);
+
   Status AddToCostGraphDef(const Graph* graph, CostGraphDef* cost_graph);
 
  private:
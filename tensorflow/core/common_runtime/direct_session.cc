@@ -66,6 +66,21 @@ auto* direct_session_runs = monitoring::Counter<0>::New(
     "/tensorflow/core/direct_session_runs",
     "The number of times DirectSession::Run() has been called.");
 
+auto* executor_cache_hits = monitoring::Counter<0>::New(
+    "/tensorflow/core/direct_session_executor_cache_hits",
+    "The number of times DirectSession found the executors of a run "
+    "signature in its cache.");
+
+auto* executor_cache_misses = monitoring::Counter<0>::New(
+    "/tensorflow/core/direct_session_executor_cache_misses",
+    "The number of times DirectSession created the executors of a run "
+    "signature.");
+
+auto* executor_cache_evictions = monitoring::Counter<0>::New(
+    "/tensorflow/core/direct_session_executor_cache_evictions",
+    "The number of times DirectSession evicted the executors of a run "
+    "signature from its cache.");
+
 int32 NumInterOpThreadsFromSessionOptions(const SessionOptions& options) {
   const int32 t = options.config.inter_op_parallelism_threads();
   if (t != 0) return t;
@@ -149,6 +164,8 @@ DirectSession::DirectSession(const SessionOptions& options,
                              const DeviceMgr* device_mgr)
     : options_(options),
       device_mgr_(device_mgr),
+      executors_(new ExecutorCache<ExecutorsAndKeys>(
+          options.config.executor_cache_capacity())),
       cancellation_manager_(new CancellationManager()),
       operation_timeout_in_ms_(options_.config.operation_timeout_in_ms()) {
   if (options_.config.session_inter_op_thread_pool_size() > 0) {
@@ -197,9 +214,7 @@ DirectSession::~DirectSession() {
   for (auto& it : partial_runs_) {
     it.second.reset(nullptr);
   }
-  for (auto& it : executors_) {
-    it.second.reset(nullptr);
-  }
+  executors_.reset(nullptr);
   for (auto d : device_mgr_->ListDevices()) {
     d->op_segment()->RemoveHold(session_handle_);
   }
@@ -228,12 +243,36 @@ void DirectSession::MaybeInitializeExecutionState(const GraphDef& graph) {
 }
 
 Status DirectSession::Create(const GraphDef& graph) {
-  mutex_lock l(graph_def_lock_);
-  if (graph_created_) {
-    return errors::AlreadyExists(
-        "A Graph has already been created for this session.");
+  {
+    mutex_lock l(graph_def_lock_);
+    if (graph_created_) {
+      return errors::AlreadyExists(
+          "A Graph has already been created for this session.");
+    }
+    TF_RETURN_IF_ERROR(ExtendLocked(graph));
   }
-  return ExtendLocked(graph);
+  for (const RunSignature& signature : options_.config.warmup_signatures()) {
+    TF_RETURN_IF_ERROR(WarmUp(signature));
+  }
+  return Status::OK();
+}
+
+Status DirectSession::WarmUp(const RunSignature& signature) {
+  if (!graph_created_) {
+    return errors::InvalidArgument(
+        "Session was not created with a graph before WarmUp()!");
+  }
+  const std::vector<string> input_names(signature.feed().begin(),
+                                        signature.feed().end());
+  const std::vector<string> output_names(signature.fetch().begin(),
+                                         signature.fetch().end());
+  const std::vector<string> target_nodes(signature.target().begin(),
+                                         signature.target().end());
+  std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
+  RunStateArgs run_state_args;
+  return GetOrCreateExecutors(thread_pools_[0], input_names, output_names,
+                              target_nodes, &executors_and_keys,
+                              &run_state_args);
 }
 
 Status DirectSession::Extend(const GraphDef& graph) {
@@ -268,12 +307,9 @@ Status DirectSession::Run(const RunOptions& run_options,
                           std::vector<Tensor>* outputs,
                           RunMetadata* run_metadata) {
   direct_session_runs->GetCell()->IncrementBy(1);
-  {
-    mutex_lock l(graph_def_lock_);
-    if (!graph_created_) {
-      return errors::InvalidArgument(
-          "Session was not created with a graph before Run()!");
-    }
+  if (!graph_created_) {
+    return errors::InvalidArgument(
+        "Session was not created with a graph before Run()!");
   }
 
   // Extract the inputs names for this run of the session.
@@ -291,7 +327,7 @@ Status DirectSession::Run(const RunOptions& run_options,
   thread::ThreadPool* pool = thread_pools_[run_options.inter_op_thread_pool()];
 
   // Check if we already have an executor for these arguments.
-  ExecutorsAndKeys* executors_and_keys;
+  std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
   RunStateArgs run_state_args;
 
   // EXPERIMENTAL: Options that allow the client to insert nodes into partition
@@ -309,7 +345,8 @@ Status DirectSession::Run(const RunOptions& run_options,
   run_state.rendez = new IntraProcessRendezvous(device_mgr_.get());
 
   // Send inputs.
-  TF_RETURN_IF_ERROR(SendInputs(inputs, executors_and_keys, run_state.rendez));
+  TF_RETURN_IF_ERROR(
+      SendInputs(inputs, executors_and_keys.get(), run_state.rendez));
 
   // Start parallel Executors.
   const int num_executors = executors_and_keys->items.size();
@@ -376,17 +413,15 @@ Status DirectSession::Run(const RunOptions& run_options,
   }
 
   // Receive outputs.
-  TF_RETURN_IF_ERROR(
-      RecvOutputs(output_names, executors_and_keys, &run_state, outputs));
+  TF_RETURN_IF_ERROR(RecvOutputs(output_names, executors_and_keys.get(),
+                                 &run_state, outputs));
 
   // Save the output tensors of this run we choose to keep.
   TF_RETURN_IF_ERROR(
       run_state.tensor_store.SaveTensors(output_names, &session_state_));
 
   // Build and return the cost model as instructed.
-  mutex_lock l(executor_lock_);
-  ++executors_and_keys->step_count;
-  if (executors_and_keys->step_count == build_cost_model) {
+  if (++executors_and_keys->step_count == build_cost_model) {
     CostGraphDef* cost_graph = run_metadata->mutable_cost_graph();
     for (const auto& item : executors_and_keys->items) {
       TF_RETURN_IF_ERROR(
@@ -412,19 +447,16 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
                                 const std::vector<string>& output_names,
                                 const std::vector<string>& target_nodes,
                                 string* handle) {
-  {
-    mutex_lock l(graph_def_lock_);
-    if (!graph_created_) {
-      return errors::InvalidArgument(
-          "Session was not created with a graph before PRunSetup()!");
-    }
+  if (!graph_created_) {
+    return errors::InvalidArgument(
+        "Session was not created with a graph before PRunSetup()!");
   }
 
   // RunOptions is not available in PRunSetup, so use thread pool 0.
   thread::ThreadPool* pool = thread_pools_[0];
 
   // Check if we already have an executor for these arguments.
-  ExecutorsAndKeys* executors_and_keys;
+  std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
   RunStateArgs run_state_args;
   run_state_args.is_partial_run = true;
   Status s = GetOrCreateExecutors(pool, input_names, output_names, target_nodes,
@@ -434,6 +466,7 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
   // Create the run state and save it for future PRun calls.
   RunState* run_state = new RunState(input_names, output_names);
   run_state->rendez = new IntraProcessRendezvous(device_mgr_.get());
+  run_state->executors_and_keys = executors_and_keys;
   {
     mutex_lock l(executor_lock_);
     if (!partial_runs_
@@ -487,26 +520,18 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
 Status DirectSession::PRun(const string& handle, const NamedTensorList& inputs,
                            const std::vector<string>& output_names,
                            std::vector<Tensor>* outputs) {
-  std::vector<string> parts = str_util::Split(handle, ';');
-  const string& key = parts[0];
   // Get the executors for this partial run.
-  ExecutorsAndKeys* executors_and_keys;
+  const ExecutorsAndKeys* executors_and_keys;
   RunState* run_state;
   {
     mutex_lock l(executor_lock_);  // could use reader lock
-    auto exc_it = executors_.find(key);
-    if (exc_it == executors_.end()) {
-      return errors::InvalidArgument(
-          "Must run 'setup' before performing partial runs!");
-    }
-    executors_and_keys = exc_it->second.get();
-
     auto prun_it = partial_runs_.find(handle);
     if (prun_it == partial_runs_.end()) {
       return errors::InvalidArgument(
           "Must run 'setup' before performing partial runs!");
     }
     run_state = prun_it->second.get();
+    executors_and_keys = run_state->executors_and_keys.get();
 
     // Make sure that this is a new set of feeds that are still pending.
     for (const auto& input : inputs) {
@@ -710,7 +735,8 @@ Status DirectSession::CheckFetch(const NamedTensorList& feeds,
 Status DirectSession::GetOrCreateExecutors(
     thread::ThreadPool* pool, gtl::ArraySlice<string> inputs,
     gtl::ArraySlice<string> outputs, gtl::ArraySlice<string> target_nodes,
-    ExecutorsAndKeys** executors_and_keys, RunStateArgs* run_state_args) {
+    std::shared_ptr<ExecutorsAndKeys>* executors_and_keys,
+    RunStateArgs* run_state_args) {
   // Sort the inputs and outputs, so we don't create separate
   // executors when a user passes in the same inputs/outputs in
   // different orders.
@@ -730,30 +756,25 @@ Status DirectSession::GetOrCreateExecutors(
                                      run_state_args->is_partial_run);
 
   // Set the handle.
-  {
-    mutex_lock l(mu_);
-    run_state_args->handle = strings::StrCat(key, ";", name_counter_++);
-  }
+  run_state_args->handle = strings::StrCat(key, ";", name_counter_++);
 
   // See if we already have the executors for this run.
-  {
-    mutex_lock l(executor_lock_);  // could use reader lock
-    auto it = executors_.find(key);
-    if (it != executors_.end()) {
-      *executors_and_keys = it->second.get();
-      return Status::OK();
-    }
+  *executors_and_keys = executors_->Lookup(key);
+  if (*executors_and_keys != nullptr) {
+    executor_cache_hits->GetCell()->IncrementBy(1);
+    return Status::OK();
   }
+  executor_cache_misses->GetCell()->IncrementBy(1);
 
   BuildGraphOptions options;
   options.feed_endpoints = inputs_sorted;
   options.fetch_endpoints = outputs_sorted;
   options.target_nodes = tn_sorted;
 
-  std::unique_ptr<ExecutorsAndKeys> ek(new ExecutorsAndKeys);
+  std::shared_ptr<ExecutorsAndKeys> ek(new ExecutorsAndKeys);
+  ek->cost_model_manager = &cost_model_manager_;
 
-  // The executor_lock_ is intentionally released while executor is
-  // being created.
+  // No lock is held while the executors are being created.
   std::unordered_map<string, std::unique_ptr<Graph>> graphs;
   TF_RETURN_IF_ERROR(
       CreateGraphs(options, &graphs, &ek->flib_def, run_state_args));
@@ -820,6 +841,14 @@ Status DirectSession::GetOrCreateExecutors(
       }
     };
     params.node_outputs_cb = node_outputs_callback_;
+    const ExecutorOptions& executor_opts =
+        options_.config.graph_options().executor_options();
+    params.use_work_stealing =
+        (executor_opts.scheduler() == ExecutorOptions::WORK_STEALING);
+    params.max_workers = executor_opts.max_workers();
+    params.use_static_plan = executor_opts.use_static_plan();
+    params.use_step_arena = executor_opts.use_step_arena();
+    params.step_arena_max_bytes = executor_opts.step_arena_max_bytes();
 
     partition_graph = iter->second.release();
     optimizer.Optimize(lib, options_.env, device, &partition_graph);
@@ -856,13 +885,15 @@ Status DirectSession::GetOrCreateExecutors(
         output, device_set_.client_device()->attributes(), FrameAndIter(0, 0));
   }
 
-  // Reacquire the lock, try to insert into the map.
-  mutex_lock l(executor_lock_);
-
   // Another thread may have created the entry before us, in which case we will
   // reuse the already created one.
-  auto insert_result = executors_.emplace(key, std::move(ek));
-  *executors_and_keys = insert_result.first->second.get();
+  int num_evicted;
+  *executors_and_keys = executors_->Insert(key, std::move(ek), &num_evicted);
+  if (num_evicted > 0) {
+    VLOG(1) << "Evicted the executors of " << num_evicted
+            << " run signatures to cache those of " << key;
+    executor_cache_evictions->GetCell()->IncrementBy(num_evicted);
+  }
 
   return Status::OK();
 }
@@ -934,7 +965,6 @@ Status DirectSession::CreateGraphs(
     return node->assigned_device_name();
   };
   popts.new_name = [this](const string& prefix) {
-    mutex_lock l(mu_);
     return strings::StrCat(prefix, "/_", name_counter_++);
   };
   popts.get_incarnation = [](const string& name) {
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/device_set.h"
 #include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/executor_cache.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
 #include "tensorflow/core/common_runtime/simple_graph_execution_state.h"
 #include "tensorflow/core/debug/debug_graph_utils.h"
@@ -40,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
@@ -85,6 +87,17 @@ class DirectSession : public Session {
 
   ::tensorflow::Status Close() override;
 
+  // Creates the executors that Run() uses for 'signature', if they are
+  // not cached yet, without running them. The signatures in
+  // ConfigProto.warmup_signatures are warmed up by Create().
+  ::tensorflow::Status WarmUp(const RunSignature& signature);
+
+  // Returns the statistics of the cache of the executors created for
+  // each run signature.
+  ExecutorCacheStats GetExecutorCacheStats() {
+    return executors_->GetStats();
+  }
+
   void ExportCostModels(CostModelManager::CostModelMap* cost_models) {
     cost_model_manager_.ExportCostModels(cost_models);
   }
@@ -109,11 +122,21 @@ class DirectSession : public Session {
   // 'input_keys' are the rendezvous keys for the feeds and 'output_keys'
   // are rendezvous keys for the fetches.
   // 'flib_def' is the function library used by graphs in 'items'.
+  // 'cost_model_manager' holds the cost models of the graphs in 'items',
+  // which are removed with them.
   // TODO(phawkins): currently partitions always share the same function
   // library. Consider giving each partition its own function library to enable
   // per-partition rewrites.
   struct ExecutorsAndKeys {
-    int64 step_count = 0;
+    ~ExecutorsAndKeys() {
+      if (cost_model_manager == nullptr) return;
+      for (const PerPartitionExecutorsAndLib& item : items) {
+        cost_model_manager->RemoveCostModelForGraph(item.graph);
+      }
+    }
+
+    std::atomic<int64> step_count{0};
+    CostModelManager* cost_model_manager = nullptr;
     std::unique_ptr<Graph> graph;
     NameNodeMap name_to_node;
     std::unique_ptr<FunctionLibraryDefinition> flib_def;
@@ -136,6 +159,9 @@ class DirectSession : public Session {
     std::unordered_set<string> pending_outputs;
     TensorStore tensor_store;
     ResourceMgr step_resource_manager;
+    // Keeps the executors of a partial run alive, even if they are
+    // evicted from executors_ in the meantime.
+    std::shared_ptr<ExecutorsAndKeys> executors_and_keys;
 
     RunState(const std::vector<string>& input_names,
              const std::vector<string>& output_names);
@@ -156,11 +182,13 @@ class DirectSession : public Session {
       EXCLUSIVE_LOCKS_REQUIRED(graph_def_lock_);
 
   // Retrieves an already existing set of executors to run 'inputs' and
-  // 'outputs', or creates and caches them for future use.
+  // 'outputs', or creates and caches them for future use. Does not lock
+  // if they already exist.
   ::tensorflow::Status GetOrCreateExecutors(
       thread::ThreadPool* pool, gtl::ArraySlice<string> inputs,
       gtl::ArraySlice<string> outputs, gtl::ArraySlice<string> target_nodes,
-      ExecutorsAndKeys** executors_and_keys, RunStateArgs* run_state_args);
+      std::shared_ptr<ExecutorsAndKeys>* executors_and_keys,
+      RunStateArgs* run_state_args);
 
   // Creates several graphs given the existing graph_def_ and the
   // input feeds and fetches, given 'devices'. The graphs share a common
@@ -206,7 +234,8 @@ class DirectSession : public Session {
   DeviceSet device_set_;
 
   string session_handle_;
-  bool graph_created_ GUARDED_BY(graph_def_lock_) = false;
+  // Only set under graph_def_lock_, but read without it by Run().
+  std::atomic<bool> graph_created_{false};
 
   mutex graph_def_lock_;
   GraphDef graph_def_ GUARDED_BY(graph_def_lock_);
@@ -218,13 +247,13 @@ class DirectSession : public Session {
   // Schedules 'c' for execution on pool.
   void SchedClosure(thread::ThreadPool* pool, std::function<void()> c);
 
-  mutex executor_lock_;  // protects executors_
-  // Holds mappings from signature to the executors that process
-  // it. The reason for a level of indirection around mapped_type is
-  // to guarantee address stability.
-  std::unordered_map<string, std::unique_ptr<ExecutorsAndKeys>> executors_
-      GUARDED_BY(executor_lock_);
+  // Holds mappings from signature to the executors that process it,
+  // for at most ConfigProto.executor_cache_capacity signatures. The
+  // executors are shared with the steps that run them, which keep them
+  // alive if they are evicted.
+  std::unique_ptr<ExecutorCache<ExecutorsAndKeys>> executors_;
 
+  mutex executor_lock_;  // protects partial_runs_
   // Holds mappings from handle to partial run state.
   std::unordered_map<string, std::unique_ptr<RunState>> partial_runs_
       GUARDED_BY(executor_lock_);
@@ -252,7 +281,7 @@ class DirectSession : public Session {
   std::unique_ptr<FunctionLibraryDefinition> flib_def_;
 
   // For generating unique names.
-  int64 name_counter_ GUARDED_BY(mu_) = 0;
+  std::atomic<int64> name_counter_{0};
 
   // For generating step ids that are unique across all sessions.
   static std::atomic_int_fast64_t step_id_counter_;
@@ -105,6 +105,139 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork) {
   EXPECT_FLOAT_EQ(5.0, mat(0, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetworkWithNUMAAffinity) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.set_use_numa_affinity(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  std::vector<std::pair<string, Tensor>> inputs;
+
+  std::vector<string> output_names = {y_ + ":0"};
+  std::vector<string> target_nodes = {y_neg_};
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run(inputs, output_names, target_nodes, &outputs));
+
+  ASSERT_EQ(1, outputs.size());
+  auto mat = outputs[0].matrix<float>();
+  ASSERT_TRUE(outputs[0].IsInitialized());
+  EXPECT_FLOAT_EQ(5.0, mat(0, 0));
+}
+
+TEST_F(DirectSessionMinusAXTest, ExecutorCacheEvictsLeastRecentlyUsed) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.set_executor_cache_capacity(2);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  DirectSession* direct_session = static_cast<DirectSession*>(session.get());
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {}, &outputs));
+  TF_ASSERT_OK(session->Run({}, {y_neg_ + ":0"}, {}, &outputs));
+  TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {}, &outputs));
+  // Evicts the executors of y_neg_, which ran less recently than y_.
+  TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {y_neg_}, &outputs));
+  TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {}, &outputs));
+  ExecutorCacheStats stats = direct_session->GetExecutorCacheStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(2, stats.size);
+
+  TF_ASSERT_OK(session->Run({}, {y_neg_ + ":0"}, {}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_FLOAT_EQ(-5.0, outputs[0].matrix<float>()(0, 0));
+  stats = direct_session->GetExecutorCacheStats();
+  EXPECT_EQ(4, stats.misses);
+  EXPECT_EQ(2, stats.evictions);
+}
+
+TEST_F(DirectSessionMinusAXTest, PartialRunSurvivesEviction) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.set_executor_cache_capacity(1);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  string handle;
+  TF_ASSERT_OK(session->PRunSetup({x_ + ":0"}, {y_ + ":0"}, {}, &handle));
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {y_neg_ + ":0"}, {}, &outputs));
+
+  Tensor t(DT_FLOAT, TensorShape({2, 1}));
+  test::FillValues<float>(&t, {1, 2});
+  TF_ASSERT_OK(session->PRun(handle, {{x_ + ":0", t}}, {y_ + ":0"}, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  EXPECT_FLOAT_EQ(7.0, outputs[0].matrix<float>()(0, 0));
+}
+
+TEST_F(DirectSessionMinusAXTest, EvictionRemovesCostModels) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.set_executor_cache_capacity(1);
+  options.config.mutable_graph_options()->set_build_cost_model(1);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  DirectSession* direct_session = static_cast<DirectSession*>(session.get());
+
+  // Each run evicts the executors of the other signature, whose graphs
+  // are destroyed, and must take their cost models with them.
+  for (int i = 0; i < 6; ++i) {
+    const string& fetch = (i % 2 == 0) ? y_ : y_neg_;
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(session->Run(RunOptions(), {}, {fetch + ":0"}, {}, &outputs,
+                              &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(i % 2 == 0 ? 5.0 : -5.0, outputs[0].matrix<float>()(0, 0));
+    EXPECT_GT(run_metadata.cost_graph().node_size(), 0);
+
+    CostModelManager::CostModelMap cost_models;
+    direct_session->ExportCostModels(&cost_models);
+    EXPECT_LE(cost_models.size(), 2);
+  }
+  EXPECT_EQ(5, direct_session->GetExecutorCacheStats().evictions);
+}
+
+TEST_F(DirectSessionMinusAXTest, WarmupSignatures) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  RunSignature* signature = options.config.add_warmup_signatures();
+  signature->add_fetch(y_ + ":0");
+  signature->add_target(y_neg_);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+  DirectSession* direct_session = static_cast<DirectSession*>(session.get());
+  EXPECT_EQ(1, direct_session->GetExecutorCacheStats().size);
+
+  RunSignature other;
+  other.add_fetch(y_neg_ + ":0");
+  TF_ASSERT_OK(direct_session->WarmUp(other));
+  EXPECT_EQ(2, direct_session->GetExecutorCacheStats().size);
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({}, {y_ + ":0"}, {y_neg_}, &outputs));
+  TF_ASSERT_OK(session->Run({}, {y_neg_ + ":0"}, {}, &outputs));
+  ExecutorCacheStats stats = direct_session->GetExecutorCacheStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+
+  RunSignature bad;
+  bad.add_fetch("unknown:0");
+  EXPECT_FALSE(direct_session->WarmUp(bad).ok());
+}
+
 TEST_F(DirectSessionMinusAXTest, TestFeed) {
   Initialize({1, 2, 3, 4});
   std::unique_ptr<Session> session(CreateSession());
@@ -23,7 +23,9 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/allocator.h"
@@ -40,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/edgeset.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
@@ -50,12 +53,14 @@ limitations under the License.
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/device_name_utils.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
 
 namespace tensorflow {
@@ -64,10 +69,39 @@ namespace {
 // 1-D, 0 element tensor.
 static const Tensor* const kEmptyTensor = new Tensor;
 
+// The worker id passed by threads that are not work-stealing workers of
+// a step, e.g. the caller of RunAsync or the callback of an async kernel.
+const int kNoWorker = -1;
+
 bool IsInitializationOp(const Node* node) {
   return node->op_def().allows_uninitialized_input();
 }
 
+// Returns true if "node" may keep its inputs beyond the step, e.g. in a
+// variable, a queue or a rendezvous, or hand them back to the caller.
+bool MayRetainInputs(const Node* node) {
+  if (node->op_def().is_stateful() || IsTransferNode(node) ||
+      node->type_string() == "_Retval") {
+    return true;
+  }
+  for (DataType dt : node->input_types()) {
+    if (IsRefType(dt)) return true;
+  }
+  return false;
+}
+
+// Returns true if the outputs and temporaries of "node" can be
+// allocated from the step arena. This is a heuristic: nodes can still
+// forward an arena buffer to one that retains it, which only delays
+// freeing the arena block holding it.
+bool CanUseStepArena(const Node* node) {
+  if (MayRetainInputs(node)) return false;
+  for (const Edge* e : node->out_edges()) {
+    if (!e->IsControlEdge() && MayRetainInputs(e->dst())) return false;
+  }
+  return true;
+}
+
 // Sets the timeline_label field of *node_stats, using data from *node.
 // Returns true iff the node is a transfer node.
 // TODO(tucker): merge with the DetailText function in session.cc
@@ -150,6 +184,15 @@ void SetOutput(NodeExecStats* nt, int slot, const Tensor* v) {
   v->FillDescription(no->mutable_tensor_description());
 }
 
+// Returns the number of bytes needed to transfer "t" between tasks.
+int64 TransferBytes(const Tensor& t) {
+  if (t.dtype() != DT_STRING) return t.TotalBytes();
+  auto strings = t.flat<string>();
+  int64 bytes = 0;
+  for (int64 i = 0; i < strings.size(); ++i) bytes += strings(i).size();
+  return bytes;
+}
+
 void SetMemory(NodeExecStats* nt, OpKernelContext* ctx) {
   for (const auto& allocator_pair : ctx->wrapped_allocators()) {
     AllocatorMemoryUsed* memory = nt->add_memory();
@@ -178,6 +221,18 @@ void SetReferencedTensors(NodeExecStats* nt,
 
 }  // namespace nodestats
 
+// Returns true iff "node" is a Recv whose tensor is sent by another task.
+bool IsRemoteRecv(const Node* node) {
+  if (!IsRecv(node)) return false;
+  string send_device;
+  string recv_device;
+  if (!GetNodeAttr(node->def(), "send_device", &send_device).ok() ||
+      !GetNodeAttr(node->def(), "recv_device", &recv_device).ok()) {
+    return false;
+  }
+  return !DeviceNameUtils::IsSameAddressSpace(send_device, recv_device);
+}
+
 struct NodeItem {
   // A graph node.
   const Node* node = nullptr;
@@ -188,6 +243,7 @@ struct NodeItem {
   bool kernel_is_expensive = false;  // True iff kernel->IsExpensive()
   bool kernel_is_async = false;      // True iff kernel->AsAsync() != nullptr
   bool is_merge = false;             // True iff IsMerge(node)
+  bool is_remote_recv = false;       // True iff IsRemoteRecv(node)
 
   // Cached values of node->num_inputs() and node->num_outputs(), to
   // avoid levels of indirection.
@@ -202,6 +258,20 @@ struct NodeItem {
   // positional attribute for the 0th output of this node.
   int output_attr_start = 0;
 
+  // Only set if the executor runs a static plan. ExecutorImpl::plan_order_
+  // [plan_pos] is this node, and its segment ends at plan_segment_end.
+  // plan_counter indexes the plan's pending counts if some of the
+  // node's inputs come from other segments, and is -1 otherwise.
+  int plan_pos = -1;
+  int plan_segment_end = -1;
+  int plan_counter = -1;
+
+  // True iff the node's outputs and temporaries come from the step arena.
+  bool uses_step_arena = false;
+
+  // True iff some of the node's outputs have a memory plan.
+  bool has_planned_outputs = false;
+
   DataType input_type(int i) const {
     DCHECK_LT(i, num_inputs);
     return (i < 4) ? inlined_input_type[i] : node->input_type(i);
@@ -233,6 +303,7 @@ class ExecutorImpl : public Executor {
     }
     delete[] nodes_;
     delete graph_;
+    if (planned_memory_ != nullptr) planned_memory_->Unref();
   }
 
   Status Initialize();
@@ -258,6 +329,14 @@ class ExecutorImpl : public Executor {
 
   static void InitializePending(const Graph* graph, PendingCounts* counts);
 
+  // Linearizes the graph into the segments of a static plan, if the
+  // graph has no control flow. See LocalExecutorParams::use_static_plan.
+  void BuildStaticPlan();
+
+  // Sets up planned_memory_ from the memory plan recorded in the nodes
+  // by PlanMemory(), if any.
+  Status InitializeMemoryPlan();
+
   // Owned.
   LocalExecutorParams params_;
   const Graph* graph_;
@@ -268,6 +347,13 @@ class ExecutorImpl : public Executor {
   // A cached value of params_
   bool device_record_tensor_accesses_ = false;
 
+  // True iff steps allocate intermediate tensors from a step arena. Only
+  // supported on CPU devices.
+  bool uses_step_arena_ = false;
+
+  // The slabs for the outputs with a memory plan, if any. Owned.
+  PlannedMemoryPool* planned_memory_ = nullptr;
+
   // Root nodes (with no in edges) that should form the initial ready queue
   std::vector<const Node*> root_nodes_;
 
@@ -279,6 +365,19 @@ class ExecutorImpl : public Executor {
 
   std::vector<AllocatorAttributes> output_attrs_;
 
+  // The static plan, if any. The nodes of each segment are stored
+  // contiguously in topological order in plan_order_, and segment i
+  // starts at plan_order_[plan_segment_starts_[i]]. A segment runs on
+  // one thread at a time; only edges between segments are counted, in
+  // plan_initial_pending_[nodes_[id].plan_counter], which includes one
+  // for the segment itself reaching the node.
+  bool has_static_plan_ = false;
+  std::vector<int> plan_order_;
+  std::vector<int> plan_segment_starts_;
+  std::vector<int> plan_initial_pending_;
+  // True iff some node may see a dead input, i.e. there are Recv nodes.
+  bool plan_has_recvs_ = false;
+
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
 
@@ -297,6 +396,8 @@ Status ExecutorImpl::Initialize() {
   // that O(# steps * # nodes per step) times.
   device_record_tensor_accesses_ =
       params_.device->RequiresRecordingAccessedTensors();
+  uses_step_arena_ =
+      params_.use_step_arena && params_.device->device_type() == DEVICE_CPU;
 
   // Preprocess every node in the graph to create an instance of op
   // kernel for each node;
@@ -338,6 +439,8 @@ Status ExecutorImpl::Initialize() {
     item->kernel_is_expensive = item->kernel->IsExpensive();
     item->kernel_is_async = (item->kernel->AsAsync() != nullptr);
     item->is_merge = IsMerge(n);
+    item->is_remote_recv = IsRemoteRecv(n);
+    item->uses_step_arena = uses_step_arena_ && CanUseStepArena(n);
 
     // Initialize static information about the frames in the graph.
     if (IsEnter(n)) {
@@ -348,9 +451,130 @@ Status ExecutorImpl::Initialize() {
     }
   }
   if (!s.ok()) return s;
+  if (params_.use_static_plan) BuildStaticPlan();
+  s = InitializeMemoryPlan();
+  if (!s.ok()) return s;
   return SetAllocAttrs();
 }
 
+Status ExecutorImpl::InitializeMemoryPlan() {
+  // The plan lays out host memory.
+  if (params_.device->device_type() != DEVICE_CPU) return Status::OK();
+  std::vector<int> output_regions(total_output_tensors_, -1);
+  std::unordered_map<int64, int> region_of_offset;
+  std::vector<int64> region_offsets;
+  std::vector<int64> region_sizes;
+  for (const Node* n : graph_->nodes()) {
+    if (n->def().attr().count(kMemoryPlanOffsetsAttr) == 0) continue;
+    std::vector<int64> offsets;
+    std::vector<int64> sizes;
+    TF_RETURN_IF_ERROR(GetNodeAttr(n->def(), kMemoryPlanOffsetsAttr, &offsets));
+    TF_RETURN_IF_ERROR(GetNodeAttr(n->def(), kMemoryPlanSizesAttr, &sizes));
+    if (offsets.size() != n->num_outputs() || sizes.size() != offsets.size()) {
+      return errors::InvalidArgument("Invalid memory plan for node ",
+                                     n->name());
+    }
+    NodeItem* item = &nodes_[n->id()];
+    for (int i = 0; i < offsets.size(); ++i) {
+      if (offsets[i] < 0) continue;
+      auto it = region_of_offset.find(offsets[i]);
+      if (it == region_of_offset.end()) {
+        it = region_of_offset.insert({offsets[i], region_offsets.size()}).first;
+        region_offsets.push_back(offsets[i]);
+        region_sizes.push_back(sizes[i]);
+      }
+      output_regions[item->output_attr_start + i] = it->second;
+      item->has_planned_outputs = true;
+    }
+  }
+  if (!region_offsets.empty()) {
+    planned_memory_ = new PlannedMemoryPool(
+        params_.device->GetAllocator(AllocatorAttributes()), region_offsets,
+        region_sizes, output_regions);
+  }
+  return Status::OK();
+}
+
+void ExecutorImpl::BuildStaticPlan() {
+  for (const Node* n : graph_->nodes()) {
+    if (IsControlFlow(n)) {
+      VLOG(1) << "Not using a static plan for a graph with control flow node "
+              << n->name();
+      return;
+    }
+    if (IsRecv(n)) plan_has_recvs_ = true;
+  }
+
+  // Inexpensive nodes count as one unit, expensive ones as this many.
+  static const int64 kExpensiveNodeCost = 100;
+
+  // Assign each node, in topological order, to the segment of one of its
+  // inputs. Extending a chain (the input is the last node of its segment)
+  // takes precedence, then the segment with the largest estimated cost,
+  // which keeps the critical path on one thread. An expensive node that
+  // cannot extend a chain starts a new segment so that it can run in
+  // parallel with its siblings; inexpensive ones are not worth the
+  // hand-off to another thread.
+  std::vector<Node*> order;
+  GetReversePostOrder(*graph_, &order);
+  std::vector<int> segment_of(graph_->num_node_ids(), -1);
+  std::vector<std::vector<const Node*>> segments;
+  std::vector<int64> segment_costs;
+  for (const Node* n : order) {
+    const NodeItem& item = nodes_[n->id()];
+    int best = -1;
+    bool best_extends_chain = false;
+    for (const Edge* e : n->in_edges()) {
+      const int segment = segment_of[e->src()->id()];
+      DCHECK_GE(segment, 0);
+      const bool extends_chain = (segments[segment].back() == e->src());
+      if (best < 0 || (extends_chain && !best_extends_chain) ||
+          (extends_chain == best_extends_chain &&
+           segment_costs[segment] > segment_costs[best])) {
+        best = segment;
+        best_extends_chain = extends_chain;
+      }
+    }
+    if (best >= 0 && !best_extends_chain && item.kernel_is_expensive) {
+      best = -1;
+    }
+    if (best < 0) {
+      best = segments.size();
+      segments.emplace_back();
+      segment_costs.push_back(0);
+    }
+    segments[best].push_back(n);
+    segment_costs[best] += item.kernel_is_expensive ? kExpensiveNodeCost : 1;
+    segment_of[n->id()] = best;
+  }
+
+  for (const auto& segment : segments) {
+    plan_segment_starts_.push_back(plan_order_.size());
+    const int end = plan_order_.size() + segment.size();
+    for (const Node* n : segment) {
+      NodeItem* item = &nodes_[n->id()];
+      item->plan_pos = plan_order_.size();
+      item->plan_segment_end = end;
+      plan_order_.push_back(n->id());
+    }
+  }
+  for (const Node* n : graph_->nodes()) {
+    int num_external_inputs = 0;
+    for (const Edge* e : n->in_edges()) {
+      if (segment_of[e->src()->id()] != segment_of[n->id()]) {
+        ++num_external_inputs;
+      }
+    }
+    if (num_external_inputs > 0) {
+      nodes_[n->id()].plan_counter = plan_initial_pending_.size();
+      plan_initial_pending_.push_back(num_external_inputs + 1);
+    }
+  }
+  has_static_plan_ = true;
+  VLOG(1) << "Static plan for " << plan_order_.size() << " nodes in "
+          << segments.size() << " segments";
+}
+
 Status ExecutorImpl::SetAllocAttrs() {
   Status s;
   Device* device = params_.device;
@@ -727,6 +951,80 @@ class ExecutorState {
     int front_index_;
   };
 
+  // The ready queues of the work-stealing scheduler: one per worker, plus
+  // a shared one at index "num_workers" for nodes made ready by threads
+  // that are not workers of the step. A worker pushes and pops at the
+  // back of its own queue, so a consumer tends to run on the thread that
+  // produced its inputs. Thieves take the oldest node from the front.
+  class WorkerQueues {
+   public:
+    explicit WorkerQueues(int num_workers) : queues_(num_workers + 1) {}
+
+    void Push(int q, const TaggedNode& node, int64 scheduled_usec) {
+      Queue* queue = &queues_[q];
+      mutex_lock l(queue->mu);
+      queue->nodes.emplace_back(node, scheduled_usec);
+    }
+
+    // Pops the most recently pushed node of queue "q".
+    bool Pop(int q, TaggedNode* node, int64* scheduled_usec) {
+      Queue* queue = &queues_[q];
+      mutex_lock l(queue->mu);
+      if (queue->front == queue->nodes.size()) return false;
+      *node = queue->nodes.back().first;
+      *scheduled_usec = queue->nodes.back().second;
+      queue->nodes.pop_back();
+      queue->MaybeReset();
+      return true;
+    }
+
+    // Takes the oldest node of the first non-empty queue other than
+    // "thief", starting with the one after it.
+    bool Steal(int thief, TaggedNode* node, int64* scheduled_usec) {
+      const int num_queues = queues_.size();
+      for (int i = 1; i < num_queues; ++i) {
+        Queue* queue = &queues_[(thief + i) % num_queues];
+        mutex_lock l(queue->mu);
+        if (queue->front < queue->nodes.size()) {
+          *node = queue->nodes[queue->front].first;
+          *scheduled_usec = queue->nodes[queue->front].second;
+          queue->front++;
+          queue->MaybeReset();
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool Empty() {
+      for (Queue& queue : queues_) {
+        mutex_lock l(queue.mu);
+        if (queue.front < queue.nodes.size()) return false;
+      }
+      return true;
+    }
+
+   private:
+    struct Queue {
+      mutex mu;
+      // The queued nodes are nodes[front, nodes.size()).
+      std::vector<std::pair<TaggedNode, int64>> nodes;
+      size_t front = 0;
+
+      // Same compaction policy as TaggedNodeReadyQueue::pop_front().
+      void MaybeReset() {
+        if (front == nodes.size()) {
+          nodes.clear();
+          front = 0;
+        } else if (front > 16384) {
+          nodes.erase(nodes.begin(), nodes.begin() + front);
+          front = 0;
+        }
+      }
+    };
+    std::vector<Queue> queues_;
+  };
+
   struct AsyncState;
 
   typedef gtl::InlinedVector<TaggedNode, 8> TaggedNodeSeq;
@@ -767,6 +1065,38 @@ class ExecutorState {
 
   std::atomic_int_fast32_t num_outstanding_ops_;
 
+  // The allocator for the intermediate tensors of the step, if
+  // impl_->uses_step_arena_. Released when the step is done.
+  StepArenaAllocator* step_arena_ = nullptr;
+
+  // The slab for the outputs with a memory plan, if any. Released when
+  // the step is done.
+  PlannedMemoryPool::Slab* planned_slab_ = nullptr;
+
+  // The per-step state of the static plan, used iff
+  // impl_->has_static_plan_ is true. plan_inputs_ replaces the
+  // input_tensors of the root frame's iteration 0, and plan_dead_ is
+  // only allocated if the graph has Recv nodes.
+  std::unique_ptr<Entry[]> plan_inputs_;
+  std::unique_ptr<std::atomic_int_fast32_t[]> plan_pending_;
+  std::unique_ptr<std::atomic<bool>[]> plan_dead_;
+  std::atomic_int_fast32_t num_outstanding_segments_;
+  // Set once a node fails; the remaining nodes are then skipped.
+  std::atomic<bool> plan_aborted_;
+
+  // The work-stealing scheduler state, used iff
+  // impl_->params_.use_work_stealing is true.
+  std::unique_ptr<WorkerQueues> worker_queues_;
+  int max_workers_ = 0;
+  // One reference for each running worker, one for each non-worker
+  // thread that is pushing ready nodes, and one that is released when
+  // the last node of the step completes. Whoever releases the last
+  // reference runs the completion of the step.
+  std::atomic_int_fast32_t num_finish_refs_;
+  mutex workers_mu_;
+  // The worker ids that have no worker running.
+  std::vector<int> idle_worker_ids_ GUARDED_BY(workers_mu_);
+
   mutex mu_;
   Status status_ GUARDED_BY(mu_);
 
@@ -829,8 +1159,31 @@ class ExecutorState {
                     int64 iter, const EntryVector& outputs,
                     TaggedNodeSeq* ready) EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  // Process a ready node in current thread.
-  void Process(TaggedNode node, int64 scheduled_usec);
+  // Fills in the parameters passed to OpKernel::Compute that are the
+  // same for all nodes of the step.
+  void InitParams(OpKernelContext::Params* params);
+
+  // Process a ready node in current thread. "worker_id" is the
+  // work-stealing worker running it, or kNoWorker.
+  void Process(TaggedNode node, int64 scheduled_usec, int worker_id);
+
+  // Starts running the executor's static plan.
+  void StartPlan();
+
+  // Runs the segment of the static plan that contains position "pos" of
+  // plan_order_, starting at "pos". "arrived" is true if the node there
+  // has already counted the segment reaching it in plan_pending_.
+  void RunPlan(int pos, bool arrived);
+
+  // After "item" in the static plan is done, passes "outputs" to its
+  // consumers and appends to "resumed" the plan positions of nodes in
+  // other segments that became ready.
+  void PropagatePlanOutputs(const NodeItem& item, const EntryVector& outputs,
+                            bool is_dead, std::vector<int>* resumed);
+
+  // Saves "stats" of "node", which takes ownership of them, and records
+  // the failure "s" of the node, if any.
+  void RecordNodeDone(const Status& s, const Node* node, NodeExecStats* stats);
 
   // Before invoking item->kernel, fills in its "inputs".
   Status PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -850,12 +1203,25 @@ class ExecutorState {
   // "node" just finishes. Takes ownership of "stats". Returns true if
   // execution has completed.
   bool NodeDone(const Status& s, const Node* node, const TaggedNodeSeq& ready,
-                NodeExecStats* stats, TaggedNodeReadyQueue* inline_ready);
+                NodeExecStats* stats, TaggedNodeReadyQueue* inline_ready,
+                int worker_id);
 
   // Schedule all the expensive nodes in 'ready', and put all the inexpensive
   // nodes in 'ready' into 'inline_ready'.
   void ScheduleReady(const TaggedNodeSeq& ready,
-                     TaggedNodeReadyQueue* inline_ready);
+                     TaggedNodeReadyQueue* inline_ready, int worker_id);
+
+  // Hands 'tagged_node' to another thread: to the runner, or with work
+  // stealing to the queue of worker 'worker_id'.
+  void Dispatch(const TaggedNode& tagged_node, int64 scheduled_usec,
+                int worker_id);
+
+  // Starts a new work-stealing worker if fewer than max_workers_ run.
+  void MaybeAddWorker();
+
+  // The loop of a work-stealing worker: runs nodes from its own queue,
+  // then steals from the others, and exits once all queues are empty.
+  void RunWorker(int worker_id);
 
   // Provide debugging output about an outstanding node in the executor.
   void DumpCompletedNodeState(const int node_id, const Entry* input_vector);
@@ -898,7 +1264,28 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       impl_(impl),
       cancellation_manager_(args.cancellation_manager),
       runner_(args.runner),
-      num_outstanding_ops_(0) {
+      num_outstanding_ops_(0),
+      num_outstanding_segments_(0),
+      plan_aborted_(false),
+      num_finish_refs_(1) {
+  if (impl->planned_memory_ != nullptr) {
+    planned_slab_ = impl->planned_memory_->Get();
+  }
+  if (impl->uses_step_arena_) {
+    step_arena_ = new StepArenaAllocator(
+        impl->params_.device->GetAllocator(AllocatorAttributes()),
+        StepArenaAllocator::kDefaultBlockSize,
+        impl->params_.step_arena_max_bytes);
+  }
+  if (impl->params_.use_work_stealing && !impl->has_static_plan_) {
+    max_workers_ = impl->params_.max_workers > 0 ? impl->params_.max_workers
+                                                 : port::NumSchedulableCPUs();
+    worker_queues_.reset(new WorkerQueues(max_workers_));
+    for (int i = max_workers_ - 1; i >= 0; --i) {
+      idle_worker_ids_.push_back(i);
+    }
+  }
+
   // We start the entire execution in iteration 0 of the root frame
   // so let us create the root frame and the state for iteration 0.
   // Initialize the frame.
@@ -912,9 +1299,12 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
 
   if (vlog_) VLOG(2) << "Create frame: " << root_frame_->frame_name;
 
-  // Initialize the iteration.
-  IterationState* iter_state = new IterationState(impl);
-  root_frame_->iterations[0] = iter_state;
+  // Initialize the iteration. A static plan keeps its own input entries
+  // and has no use for pending counts.
+  if (!impl->has_static_plan_) {
+    IterationState* iter_state = new IterationState(impl);
+    root_frame_->iterations[0] = iter_state;
+  }
 
   // Initialize the executor state.
   outstanding_frames_.insert({root_frame_->frame_name, root_frame_});
@@ -930,6 +1320,10 @@ ExecutorState::~ExecutorState() {
   }
 
   delete slice_reader_cache_;
+
+  // Frees the step arena as soon as no tensor allocated from it is alive.
+  if (step_arena_ != nullptr) step_arena_->Release();
+  if (planned_slab_ != nullptr) planned_slab_->Release();
 }
 
 void ExecutorImpl::InitializePending(const Graph* graph,
@@ -971,6 +1365,12 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
     return;
   }
 
+  if (impl_->has_static_plan_) {
+    done_cb_ = done;
+    StartPlan();
+    return;
+  }
+
   // Initialize the ready queue.
   for (const Node* n : impl_->root_nodes_) {
     DCHECK_EQ(n->in_edges().size(), 0);
@@ -983,7 +1383,7 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
     root_frame_->iterations[0]->outstanding_ops = ready.size();
     done_cb_ = done;
     // Schedule to run all the ready ops in thread pool.
-    ScheduleReady(ready, nullptr);
+    ScheduleReady(ready, nullptr, kNoWorker);
   }
 }
 
@@ -1006,7 +1406,8 @@ struct ExecutorState::AsyncState {
         // ParamsButClearingEigenGPUDevice does equivalent of
         //   params.eigen_gpu_device = nullptr;
         ctx(ParamsButClearingEigenGPUDevice(&params), item.num_outputs),
-        stats(_stats) {
+        stats(_stats),
+        plan_refs(2) {
     params.inputs = &saved_inputs;
     params.input_device_contexts = &saved_input_device_contexts;
     params.input_alloc_attrs = &saved_input_alloc_attrs;
@@ -1022,6 +1423,11 @@ struct ExecutorState::AsyncState {
   OpKernelContext ctx;
   NodeExecStats* stats;
 
+  // With a static plan, both the thread that launched the kernel and its
+  // done callback release one of these; the second one to do so carries
+  // on with the rest of the segment.
+  std::atomic_int_fast32_t plan_refs;
+
  private:
   OpKernelContext::Params* ParamsButClearingEigenGPUDevice(
       OpKernelContext::Params* p) {
@@ -1032,7 +1438,28 @@ struct ExecutorState::AsyncState {
   }
 };
 
-void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
+void ExecutorState::InitParams(OpKernelContext::Params* params) {
+  params->step_id = step_id_;
+  Device* device = impl_->params_.device;
+  params->device = device;
+  // track allocations if and only if we are collecting statistics
+  params->track_allocations = (stats_collector_ != nullptr);
+  params->log_memory = log_memory_;
+  params->record_tensor_accesses = impl_->device_record_tensor_accesses_;
+  params->rendezvous = rendezvous_;
+  params->session_state = session_state_;
+  params->tensor_store = tensor_store_;
+  params->cancellation_manager = cancellation_manager_;
+  params->call_frame = call_frame_;
+  params->function_library = impl_->params_.function_library;
+  params->resource_manager = device->resource_manager();
+  params->step_resource_manager = step_resource_manager_;
+  params->slice_reader_cache = slice_reader_cache_;
+  params->runner = &runner_;
+}
+
+void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec,
+                            int worker_id) {
   const NodeItem* nodes = impl_->nodes_;
   TaggedNodeSeq ready;
   TaggedNodeReadyQueue inline_ready;
@@ -1043,26 +1470,11 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
   AllocatorAttributeVec input_alloc_attrs;
 
   OpKernelContext::Params params;
-  params.step_id = step_id_;
+  InitParams(&params);
   Device* device = impl_->params_.device;
-  params.device = device;
-  // track allocations if and only if we are collecting statistics
-  params.track_allocations = (stats_collector_ != nullptr);
-  params.log_memory = log_memory_;
-  params.record_tensor_accesses = impl_->device_record_tensor_accesses_;
-  params.rendezvous = rendezvous_;
-  params.session_state = session_state_;
-  params.tensor_store = tensor_store_;
-  params.cancellation_manager = cancellation_manager_;
-  params.call_frame = call_frame_;
-  params.function_library = impl_->params_.function_library;
-  params.resource_manager = device->resource_manager();
-  params.step_resource_manager = step_resource_manager_;
-  params.slice_reader_cache = slice_reader_cache_;
   params.inputs = &inputs;
   params.input_device_contexts = &input_device_contexts;
   params.input_alloc_attrs = &input_alloc_attrs;
-  params.runner = &runner_;
 
   Status s;
   NodeExecStats* stats = nullptr;
@@ -1091,6 +1503,11 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
     if (node->id() < device_context_map_.size()) {
       params.op_device_context = device_context_map_[node->id()];
     }
+    params.step_allocator = item.uses_step_arena ? step_arena_ : nullptr;
+    params.output_allocator_array =
+        item.has_planned_outputs
+            ? planned_slab_->output_allocators() + item.output_attr_start
+            : nullptr;
 
     if (stats_collector_) {
       stats = new NodeExecStats;
@@ -1135,7 +1552,8 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
           iter_state->mark_completed(id);
         }
         // Continue to process the nodes in 'inline_ready'.
-        completed = NodeDone(s, item.node, ready, stats, &inline_ready);
+        completed =
+            NodeDone(s, item.node, ready, stats, &inline_ready, worker_id);
         continue;
       }
 
@@ -1197,7 +1615,8 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
             device->ConsumeListOfAccessedTensors(state->ctx.op_device_context(),
                                                  accessed);
           }
-          bool completed = NodeDone(s, state->item.node, ready, stats, nullptr);
+          bool completed =
+              NodeDone(s, state->item.node, ready, stats, nullptr, kNoWorker);
           delete state;
           if (completed) Finish();
         };
@@ -1257,7 +1676,8 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_usec) {
         scheduled_usec = nodestats::NowInUsec();
       }
       // Postprocess.
-      completed = NodeDone(s, item.node, ready, stats, &inline_ready);
+      completed =
+          NodeDone(s, item.node, ready, stats, &inline_ready, worker_id);
     }
   }  // while !inline_ready.empty()
 
@@ -1397,6 +1817,11 @@ Status ExecutorState::ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
       if (dtype == item.output_type(i)) {
         if (stats_collector_ && val.tensor->IsInitialized()) {
           nodestats::SetOutput(stats, i, val.tensor);
+          if (item.is_remote_recv) {
+            stats_collector_->AddRemoteRecvBytes(
+                impl_->params_.device->name(),
+                nodestats::TransferBytes(*val.tensor));
+          }
         }
         if (val.is_ref()) {
           out->has_value = true;
@@ -1608,7 +2033,27 @@ void ExecutorState::AddLoopInv(FrameState* frame, const Node* node,
 
 bool ExecutorState::NodeDone(const Status& s, const Node* node,
                              const TaggedNodeSeq& ready, NodeExecStats* stats,
-                             TaggedNodeReadyQueue* inline_ready) {
+                             TaggedNodeReadyQueue* inline_ready,
+                             int worker_id) {
+  RecordNodeDone(s, node, stats);
+
+  bool completed = false;
+  int ready_size = ready.size();
+  if (ready_size == 0 || !s.ok()) {
+    completed = (num_outstanding_ops_.fetch_sub(1) == 1);
+  } else if (ready_size > 1) {
+    num_outstanding_ops_.fetch_add(ready_size - 1, std::memory_order_relaxed);
+  }
+
+  // Schedule the ready nodes in 'ready'.
+  if (s.ok()) {
+    ScheduleReady(ready, inline_ready, worker_id);
+  }
+  return completed;
+}
+
+void ExecutorState::RecordNodeDone(const Status& s, const Node* node,
+                                   NodeExecStats* stats) {
   if (stats_collector_) {
     nodestats::SetAllEnd(stats);
     stats_collector_->UpdateCostModelNode(stats, impl_->graph_, node);
@@ -1637,26 +2082,20 @@ bool ExecutorState::NodeDone(const Status& s, const Node* node,
     captured_rendezvous->StartAbort(s);
     captured_rendezvous->Unref();
   }
-
-  bool completed = false;
-  int ready_size = ready.size();
-  if (ready_size == 0 || !s.ok()) {
-    completed = (num_outstanding_ops_.fetch_sub(1) == 1);
-  } else if (ready_size > 1) {
-    num_outstanding_ops_.fetch_add(ready_size - 1, std::memory_order_relaxed);
-  }
-
-  // Schedule the ready nodes in 'ready'.
-  if (s.ok()) {
-    ScheduleReady(ready, inline_ready);
-  }
-  return completed;
 }
 
 void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
-                                  TaggedNodeReadyQueue* inline_ready) {
+                                  TaggedNodeReadyQueue* inline_ready,
+                                  int worker_id) {
   if (ready.empty()) return;
 
+  // With work stealing, the nodes pushed by a thread that is not a
+  // worker of this step may be stolen and run to completion before the
+  // pushes are done, so hold a reference that keeps the step alive.
+  const bool external_push =
+      (worker_queues_ != nullptr && worker_id == kNoWorker);
+  if (external_push) num_finish_refs_.fetch_add(1);
+
   int64 scheduled_usec = 0;
   if (stats_collector_) {
     scheduled_usec = nodestats::NowInUsec();
@@ -1664,36 +2103,341 @@ void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
   if (inline_ready == nullptr) {
     // Schedule to run all the ready ops in thread pool.
     for (auto& tagged_node : ready) {
-      runner_(std::bind(&ME::Process, this, tagged_node, scheduled_usec));
+      Dispatch(tagged_node, scheduled_usec, worker_id);
+    }
+  } else {
+    const NodeItem* nodes = impl_->nodes_;
+    const TaggedNode* curr_expensive_node = nullptr;
+    for (auto& tagged_node : ready) {
+      const NodeItem& item = nodes[tagged_node.node->id()];
+      if (tagged_node.is_dead || !item.kernel_is_expensive) {
+        // Inline this inexpensive node.
+        inline_ready->push_back(tagged_node);
+      } else {
+        if (curr_expensive_node) {
+          // Dispatch to another thread since there is plenty of work to
+          // do for this thread.
+          Dispatch(*curr_expensive_node, scheduled_usec, worker_id);
+        }
+        curr_expensive_node = &tagged_node;
+      }
     }
+    if (curr_expensive_node) {
+      if (inline_ready->empty()) {
+        // Tail recursion optimization
+        inline_ready->push_back(*curr_expensive_node);
+      } else {
+        // There are inline nodes to run already. We dispatch this expensive
+        // node to other thread.
+        Dispatch(*curr_expensive_node, scheduled_usec, worker_id);
+      }
+    }
+  }
+
+  if (external_push) Finish();
+}
+
+void ExecutorState::Dispatch(const TaggedNode& tagged_node,
+                             int64 scheduled_usec, int worker_id) {
+  if (worker_queues_ == nullptr) {
+    runner_(std::bind(&ME::Process, this, tagged_node, scheduled_usec,
+                      kNoWorker));
     return;
   }
+  worker_queues_->Push(worker_id == kNoWorker ? max_workers_ : worker_id,
+                       tagged_node, scheduled_usec);
+  MaybeAddWorker();
+}
+
+void ExecutorState::MaybeAddWorker() {
+  int worker_id;
+  {
+    mutex_lock l(workers_mu_);
+    if (idle_worker_ids_.empty()) return;
+    worker_id = idle_worker_ids_.back();
+    idle_worker_ids_.pop_back();
+  }
+  // The caller holds a reference, so the step cannot finish before the
+  // new worker takes its own.
+  num_finish_refs_.fetch_add(1);
+  runner_(std::bind(&ME::RunWorker, this, worker_id));
+}
+
+void ExecutorState::RunWorker(int worker_id) {
+  TaggedNode tagged_node(nullptr, nullptr, -1, false);
+  int64 scheduled_usec = 0;
+  while (true) {
+    if (worker_queues_->Pop(worker_id, &tagged_node, &scheduled_usec) ||
+        worker_queues_->Steal(worker_id, &tagged_node, &scheduled_usec)) {
+      Process(tagged_node, scheduled_usec, worker_id);
+      continue;
+    }
+    // Give up the worker slot. A node pushed after the scans above may
+    // have found no idle slot to start a worker with, so look once more
+    // and take a slot back if there is still work to do.
+    {
+      mutex_lock l(workers_mu_);
+      idle_worker_ids_.push_back(worker_id);
+    }
+    if (worker_queues_->Empty()) break;
+    {
+      mutex_lock l(workers_mu_);
+      // If no slot is idle, every worker is running and will see the
+      // work before it exits.
+      if (idle_worker_ids_.empty()) break;
+      worker_id = idle_worker_ids_.back();
+      idle_worker_ids_.pop_back();
+    }
+  }
+  Finish();
+}
+
+void ExecutorState::StartPlan() {
+  const ExecutorImpl* impl = impl_;
+  plan_inputs_.reset(new Entry[impl->total_input_tensors_]);
+  const int num_counters = impl->plan_initial_pending_.size();
+  plan_pending_.reset(new std::atomic_int_fast32_t[num_counters]);
+  for (int i = 0; i < num_counters; ++i) {
+    plan_pending_[i] = impl->plan_initial_pending_[i];
+  }
+  if (impl->plan_has_recvs_) {
+    const int num_nodes = impl->graph_->num_node_ids();
+    plan_dead_.reset(new std::atomic<bool>[num_nodes]);
+    for (int i = 0; i < num_nodes; ++i) {
+      plan_dead_[i] = false;
+    }
+  }
+  num_outstanding_segments_ = impl->plan_segment_starts_.size();
+
+  // Start the segments whose first node has all its inputs. The others
+  // are resumed by the producer of the last input of their first node.
+  std::vector<int> ready;
+  for (int pos : impl->plan_segment_starts_) {
+    const int counter = impl->nodes_[impl->plan_order_[pos]].plan_counter;
+    if (counter < 0 || plan_pending_[counter].fetch_sub(1) == 1) {
+      ready.push_back(pos);
+    }
+  }
+  for (int pos : ready) {
+    runner_(std::bind(&ME::RunPlan, this, pos, true));
+  }
+}
+
+void ExecutorState::RunPlan(int pos, bool arrived) {
   const NodeItem* nodes = impl_->nodes_;
-  const TaggedNode* curr_expensive_node = nullptr;
-  for (auto& tagged_node : ready) {
-    const NodeItem& item = nodes[tagged_node.node->id()];
-    if (tagged_node.is_dead || !item.kernel_is_expensive) {
-      // Inline this inexpensive node.
-      inline_ready->push_back(tagged_node);
+  const std::vector<int>& order = impl_->plan_order_;
+
+  // Parameters passed to OpKernel::Compute.
+  TensorValueVec inputs;
+  DeviceContextVec input_device_contexts;
+  AllocatorAttributeVec input_alloc_attrs;
+
+  OpKernelContext::Params params;
+  InitParams(&params);
+  Device* device = impl_->params_.device;
+  params.inputs = &inputs;
+  params.input_device_contexts = &input_device_contexts;
+  params.input_alloc_attrs = &input_alloc_attrs;
+  params.frame_iter = FrameAndIter(0, 0);
+
+  EntryVector outputs;
+  std::vector<int> resumed;
+  int end = nodes[order[pos]].plan_segment_end;
+  while (pos < end) {
+    const NodeItem& item = nodes[order[pos]];
+    const Node* node = item.node;
+    if (!arrived && item.plan_counter >= 0 &&
+        plan_pending_[item.plan_counter].fetch_sub(1) != 1) {
+      // Inputs from other segments are outstanding. The producer of the
+      // last one resumes this segment here.
+      return;
+    }
+    arrived = false;
+
+    Entry* first_input = plan_inputs_.get() + item.input_start;
+    // A node is dead if a data input is dead or a control input comes
+    // from a dead node. Without Recv nodes nothing can be dead.
+    bool is_dead = false;
+    if (plan_dead_ != nullptr) {
+      is_dead = plan_dead_[node->id()].load(std::memory_order_relaxed);
+      for (int i = 0; i < item.num_inputs && !is_dead; ++i) {
+        is_dead = !first_input[i].has_value;
+      }
+      is_dead = is_dead && !IsControlTrigger(node);
+    }
+
+    if (node->id() < device_context_map_.size()) {
+      params.op_device_context = device_context_map_[node->id()];
+    }
+    params.step_allocator = item.uses_step_arena ? step_arena_ : nullptr;
+    params.output_allocator_array =
+        item.has_planned_outputs
+            ? planned_slab_->output_allocators() + item.output_attr_start
+            : nullptr;
+
+    NodeExecStats* stats = nullptr;
+    if (stats_collector_) {
+      stats = new NodeExecStats;
+      stats->set_node_name(node->name());
+      nodestats::SetScheduled(stats, nodestats::NowInUsec());
+      nodestats::SetAllStart(stats);
+    }
+
+    if (vlog_) {
+      VLOG(1) << "Process node: " << node->id() << " step " << params.step_id
+              << " " << SummarizeNodeDef(node->def());
+    }
+
+    Status s;
+    outputs.clear();
+    TensorReferenceVector accessed_tensors;
+    DeviceContext* device_context = nullptr;
+    if (plan_aborted_.load(std::memory_order_relaxed) ||
+        (is_dead && !IsTransferNode(node))) {
+      outputs.resize(item.num_outputs);
     } else {
-      if (curr_expensive_node) {
-        // Dispatch to another thread since there is plenty of work to
-        // do for this thread.
-        runner_(std::bind(&ME::Process, this, *curr_expensive_node,
-                          scheduled_usec));
+      bool is_input_dead = false;
+      s = PrepareInputs(item, first_input, &inputs, &input_device_contexts,
+                        &input_alloc_attrs, &is_input_dead);
+      if (!s.ok()) {
+        outputs.resize(item.num_outputs);
+      } else if (item.kernel_is_async) {
+        params.op_kernel = item.kernel;
+        params.is_input_dead = is_input_dead;
+        params.output_attr_array = gtl::vector_as_array(&impl_->output_attrs_) +
+                                   item.output_attr_start;
+        AsyncOpKernel* async = item.kernel->AsAsync();
+        AsyncState* state =
+            new AsyncState(params, TaggedNode(node, root_frame_, 0, is_dead),
+                           item, first_input, stats);
+        auto done = [this, state, is_dead]() {
+          const NodeItem& item = state->item;
+          NodeExecStats* stats = state->stats;  // Shorthand
+          if (stats_collector_) nodestats::SetOpEnd(stats);
+          EntryVector outputs;
+          Status s = ProcessOutputs(item, &state->ctx, &outputs, stats);
+          if (stats_collector_) nodestats::SetMemory(stats, &state->ctx);
+          for (int i = 0; i < item.num_inputs; ++i) {
+            (state->first_input + i)->ClearVal();
+          }
+          if (s.ok() && impl_->device_record_tensor_accesses_) {
+            TensorReferenceVector accessed;
+            state->ctx.retrieve_accessed_tensors(&accessed);
+            if (stats_collector_)
+              nodestats::SetReferencedTensors(stats, accessed);
+            impl_->params_.device->ConsumeListOfAccessedTensors(
+                state->ctx.op_device_context(), accessed);
+          }
+          if (!s.ok()) plan_aborted_ = true;
+          RecordNodeDone(s, item.node, stats);
+          std::vector<int> resumed;
+          PropagatePlanOutputs(item, outputs, is_dead, &resumed);
+          for (int r : resumed) {
+            runner_(std::bind(&ME::RunPlan, this, r, true));
+          }
+          if (state->plan_refs.fetch_sub(1) != 1) {
+            // The kernel completed synchronously: the launching thread
+            // carries on with the segment.
+            return;
+          }
+          const int next = item.plan_pos + 1;
+          const int end = item.plan_segment_end;
+          delete state;
+          if (next < end) {
+            runner_(std::bind(&ME::RunPlan, this, next, false));
+          } else if (num_outstanding_segments_.fetch_sub(1) == 1) {
+            Finish();
+          }
+        };
+        if (stats_collector_) nodestats::SetOpStart(stats);
+        device->ComputeAsync(async, &state->ctx, done);
+        if (state->plan_refs.fetch_sub(1) != 1) {
+          // The done callback carries on with the segment.
+          return;
+        }
+        delete state;
+        ++pos;
+        continue;
+      } else {
+        params.op_kernel = item.kernel;
+        params.is_input_dead = is_input_dead;
+        params.output_attr_array = gtl::vector_as_array(&impl_->output_attrs_) +
+                                   item.output_attr_start;
+        OpKernelContext ctx(&params, item.num_outputs);
+        if (stats_collector_) nodestats::SetOpStart(stats);
+        device->Compute(CHECK_NOTNULL(item.kernel), &ctx);
+        // See Process() on blocking the Sink node until the device is done.
+        if (node->IsSink() && ctx.status().ok()) {
+          ctx.SetStatus(device->Sync());
+        }
+        if (stats_collector_) nodestats::SetOpEnd(stats);
+
+        s = ProcessOutputs(item, &ctx, &outputs, stats);
+        if (s.ok() && impl_->device_record_tensor_accesses_) {
+          ctx.retrieve_accessed_tensors(&accessed_tensors);
+          device_context = ctx.op_device_context();
+        }
+        if (stats_collector_) nodestats::SetMemory(stats, &ctx);
       }
-      curr_expensive_node = &tagged_node;
+    }
+
+    // Clears inputs.
+    for (int i = 0; i < item.num_inputs; ++i) {
+      (first_input + i)->ClearVal();
+    }
+    if (!accessed_tensors.empty()) {
+      if (stats_collector_)
+        nodestats::SetReferencedTensors(stats, accessed_tensors);
+      device->ConsumeListOfAccessedTensors(device_context, accessed_tensors);
+    }
+    // Record a failure before any consumer can see the missing outputs.
+    if (!s.ok()) plan_aborted_ = true;
+    RecordNodeDone(s, node, stats);
+    PropagatePlanOutputs(item, outputs, is_dead, &resumed);
+    outputs.clear();
+    ++pos;
+
+    if (!resumed.empty()) {
+      // Hand the resumed segments to other threads, except that this
+      // thread carries on with one of them if its own segment is done.
+      const bool segment_done = (pos == end);
+      const int num_to_dispatch = resumed.size() - (segment_done ? 1 : 0);
+      for (int i = 0; i < num_to_dispatch; ++i) {
+        runner_(std::bind(&ME::RunPlan, this, resumed[i], true));
+      }
+      if (segment_done) {
+        pos = resumed.back();
+        end = nodes[order[pos]].plan_segment_end;
+        arrived = true;
+        // The resumed segment is still outstanding, so this cannot be
+        // the last one.
+        num_outstanding_segments_.fetch_sub(1);
+      }
+      resumed.clear();
     }
   }
-  if (curr_expensive_node) {
-    if (inline_ready->empty()) {
-      // Tail recursion optimization
-      inline_ready->push_back(*curr_expensive_node);
-    } else {
-      // There are inline nodes to run already. We dispatch this expensive
-      // node to other thread.
-      runner_(
-          std::bind(&ME::Process, this, *curr_expensive_node, scheduled_usec));
+  if (num_outstanding_segments_.fetch_sub(1) == 1) Finish();
+}
+
+void ExecutorState::PropagatePlanOutputs(const NodeItem& item,
+                                         const EntryVector& outputs,
+                                         bool is_dead,
+                                         std::vector<int>* resumed) {
+  const NodeItem* nodes = impl_->nodes_;
+  for (const Edge* e : item.node->out_edges()) {
+    const int dst_id = e->dst()->id();
+    const NodeItem& dst_item = nodes[dst_id];
+    if (!e->IsControlEdge()) {
+      plan_inputs_[dst_item.input_start + e->dst_input()] =
+          outputs[e->src_output()];
+    }
+    if (is_dead) {
+      plan_dead_[dst_id].store(true, std::memory_order_relaxed);
+    }
+    // Only edges between segments are counted.
+    if (dst_item.plan_segment_end != item.plan_segment_end &&
+        plan_pending_[dst_item.plan_counter].fetch_sub(1) == 1) {
+      resumed->push_back(dst_item.plan_pos);
     }
   }
 }
@@ -1814,6 +2558,7 @@ void ExecutorState::DumpState() {
       LOG(WARNING) << frame.first;
       FrameState* frame_state = frame.second;
       for (IterationState* iteration : frame_state->iterations) {
+        if (iteration == nullptr) continue;
         LOG(WARNING) << "  Iteration:";
         DumpIterationState(iteration);
       }
@@ -1823,6 +2568,11 @@ void ExecutorState::DumpState() {
 }
 
 void ExecutorState::Finish() {
+  // With work stealing, workers may still be scanning the queues when the
+  // last node completes; the last reference released finishes the step.
+  if (worker_queues_ != nullptr && num_finish_refs_.fetch_sub(1) != 1) {
+    return;
+  }
   mu_.lock();
   auto status = status_;
   auto done_cb = std::move(done_cb_);
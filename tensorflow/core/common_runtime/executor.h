@@ -138,6 +138,33 @@ struct LocalExecutorParams {
   std::function<void(OpKernel*)> delete_kernel;
 
   Executor::Args::NodeOutputsCallback node_outputs_cb;
+
+  // If true, ready nodes that are not run inline are kept in per-worker
+  // deques that idle workers steal from, instead of each of them being
+  // dispatched to Args::runner as a separate closure. See
+  // ExecutorOptions::WORK_STEALING.
+  bool use_work_stealing = false;
+
+  // The maximum number of workers a step keeps in flight when
+  // "use_work_stealing" is true. 0 means the number of schedulable CPUs.
+  int max_workers = 0;
+
+  // If true and the graph has no control flow, the executor partitions
+  // the graph once into chains of nodes ("segments") that each run on a
+  // single thread in a fixed order, and only synchronizes on the edges
+  // between segments. See ExecutorOptions::use_static_plan.
+  bool use_static_plan = false;
+
+  // If true and the device is a CPU device, the outputs and temporaries
+  // of nodes whose outputs are not retained beyond the step (by stateful
+  // ops, transfers or ref inputs) are carved out of per-step memory
+  // blocks, which are freed when the step is done. See
+  // ExecutorOptions::use_step_arena.
+  bool use_step_arena = false;
+
+  // The maximum number of bytes a step allocates from the step arena
+  // before falling back to the device allocator. 0 means no limit.
+  int64 step_arena_max_bytes = 0;
 };
 ::tensorflow::Status NewLocalExecutor(const LocalExecutorParams& params,
                                       const Graph* graph, Executor** executor);
@@ -0,0 +1,232 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_EXECUTOR_CACHE_H_
+#define TENSORFLOW_COMMON_RUNTIME_EXECUTOR_CACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+struct ExecutorCacheStats {
+  int64 hits = 0;
+  int64 misses = 0;
+  int64 evictions = 0;
+  int64 size = 0;
+};
+
+// A cache of the executors of a session (of type T), keyed by the
+// signature of the steps they run, that holds at most "capacity"
+// entries and evicts the least recently used ones beyond that.
+//
+// Lookup() does not lock: it reads an immutable snapshot of the cache,
+// which Insert() replaces. The snapshots and entries replaced are freed
+// by epochs: once the Lookup() calls of the epoch in which they were
+// replaced are done, even if other ones are running. Entries are
+// shared_ptrs, so that an entry that is evicted while a step uses it
+// lives until the step is done.
+template <typename T>
+class ExecutorCache {
+ public:
+  // A "capacity" of 0 means that the cache is unbounded.
+  explicit ExecutorCache(int64 capacity)
+      : capacity_(capacity), snapshot_(new Snapshot) {
+    readers_[0].store(0);
+    readers_[1].store(0);
+  }
+  ~ExecutorCache();
+
+  // Returns the entry of "key", or nullptr if there is none.
+  std::shared_ptr<T> Lookup(const string& key);
+
+  // Inserts "value" for "key", and returns the entry of "key", which is
+  // the existing one if another thread inserted it first. Stores in
+  // "*num_evicted", if not null, the number of entries evicted to make
+  // room for it.
+  std::shared_ptr<T> Insert(const string& key, std::shared_ptr<T> value,
+                            int* num_evicted = nullptr);
+
+  ExecutorCacheStats GetStats();
+
+ private:
+  struct Entry {
+    Entry(std::shared_ptr<T> v, uint64 t) : value(std::move(v)), last_use(t) {}
+    const std::shared_ptr<T> value;
+    std::atomic<uint64> last_use;
+  };
+  typedef std::unordered_map<string, Entry*> Snapshot;
+
+  // Snapshots and entries that were replaced.
+  struct Retired {
+    std::vector<std::unique_ptr<const Snapshot>> snapshots;
+    std::vector<std::unique_ptr<Entry>> entries;
+
+    bool empty() const { return snapshots.empty() && entries.empty(); }
+    void clear() {
+      snapshots.clear();
+      entries.clear();
+    }
+  };
+
+  // Frees what was replaced before the last change of epoch, once the
+  // Lookup() calls of the previous epoch are done, and starts a new epoch
+  // for what was replaced since.
+  void MaybeFreeRetired() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64 capacity_;
+
+  // The current snapshot, the current epoch (0 or 1), and the number of
+  // Lookup() calls of each epoch, which may be reading the snapshot that
+  // was current during that epoch, or a later one.
+  std::atomic<const Snapshot*> snapshot_;
+  std::atomic<int> epoch_{0};
+  std::atomic<int64> readers_[2];
+
+  // A logical clock, for the last use of each entry.
+  std::atomic<uint64> clock_{0};
+
+  std::atomic<int64> hits_{0};
+  std::atomic<int64> misses_{0};
+  std::atomic<int64> evictions_{0};
+
+  mutex mu_;
+  std::unordered_map<string, std::unique_ptr<Entry>> entries_ GUARDED_BY(mu_);
+  // Replaced during the current epoch, and during the previous one.
+  Retired retiring_ GUARDED_BY(mu_);
+  Retired draining_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ExecutorCache);
+};
+
+// Implementation details follow. Clients should ignore.
+
+template <typename T>
+ExecutorCache<T>::~ExecutorCache() {
+  delete snapshot_.load();
+}
+
+template <typename T>
+std::shared_ptr<T> ExecutorCache<T>::Lookup(const string& key) {
+  std::shared_ptr<T> value;
+  // Registers as a reader of the current epoch. If the epoch changed in
+  // the meantime, MaybeFreeRetired() may not wait for this reader, which
+  // must register again.
+  int epoch = epoch_.load();
+  readers_[epoch].fetch_add(1);
+  while (epoch_.load() != epoch) {
+    readers_[epoch].fetch_sub(1);
+    epoch = epoch_.load();
+    readers_[epoch].fetch_add(1);
+  }
+  const Snapshot* snapshot = snapshot_.load();
+  auto it = snapshot->find(key);
+  if (it != snapshot->end()) {
+    value = it->second->value;
+    it->second->last_use.store(clock_.fetch_add(1, std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+  }
+  readers_[epoch].fetch_sub(1);
+  if (value != nullptr) {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return value;
+}
+
+template <typename T>
+std::shared_ptr<T> ExecutorCache<T>::Insert(const string& key,
+                                            std::shared_ptr<T> value,
+                                            int* num_evicted) {
+  if (num_evicted != nullptr) *num_evicted = 0;
+  mutex_lock l(mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    return it->second->value;
+  }
+  if (capacity_ > 0) {
+    // Evicts the entries with the oldest last use. The scan is cheap
+    // next to creating the executors being inserted.
+    while (static_cast<int64>(entries_.size()) >= capacity_) {
+      auto lru = entries_.begin();
+      for (auto e = entries_.begin(); e != entries_.end(); ++e) {
+        if (e->second->last_use.load(std::memory_order_relaxed) <
+            lru->second->last_use.load(std::memory_order_relaxed)) {
+          lru = e;
+        }
+      }
+      retiring_.entries.push_back(std::move(lru->second));
+      entries_.erase(lru);
+      evictions_.fetch_add(1, std::memory_order_relaxed);
+      if (num_evicted != nullptr) ++*num_evicted;
+    }
+  }
+  entries_.emplace(key, std::unique_ptr<Entry>(new Entry(
+                            value, clock_.fetch_add(1,
+                                                    std::memory_order_relaxed))));
+
+  Snapshot* snapshot = new Snapshot;
+  snapshot->reserve(entries_.size());
+  for (const auto& e : entries_) {
+    snapshot->emplace(e.first, e.second.get());
+  }
+  retiring_.snapshots.emplace_back(snapshot_.exchange(snapshot));
+  MaybeFreeRetired();
+  return value;
+}
+
+template <typename T>
+void ExecutorCache<T>::MaybeFreeRetired() {
+  // A reader that saw a replaced snapshot registered in the epoch in
+  // which it was replaced, or an earlier one. Readers of an epoch that
+  // register after it ended see the snapshot current at that time.
+  const int epoch = epoch_.load();
+  if (!draining_.empty()) {
+    if (readers_[1 - epoch].load() != 0) return;
+    draining_.clear();
+  }
+  if (retiring_.empty()) return;
+  // The readers of the previous epoch are done, so that its counter can
+  // be reused by the next one.
+  std::swap(draining_, retiring_);
+  epoch_.store(1 - epoch);
+  if (readers_[epoch].load() == 0) draining_.clear();
+}
+
+template <typename T>
+ExecutorCacheStats ExecutorCache<T>::GetStats() {
+  ExecutorCacheStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  mutex_lock l(mu_);
+  stats.size = entries_.size();
+  MaybeFreeRetired();
+  return stats;
+}
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_EXECUTOR_CACHE_H_
@@ -0,0 +1,182 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/executor_cache.h"
+
+#include <atomic>
+#include <memory>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+std::shared_ptr<int> Value(int v) { return std::make_shared<int>(v); }
+
+TEST(ExecutorCacheTest, LookupAndInsert) {
+  ExecutorCache<int> cache(0);
+  EXPECT_EQ(nullptr, cache.Lookup("a"));
+  EXPECT_EQ(1, *cache.Insert("a", Value(1)));
+  EXPECT_EQ(1, *cache.Lookup("a"));
+
+  // The first insertion wins.
+  EXPECT_EQ(1, *cache.Insert("a", Value(2)));
+  EXPECT_EQ(1, *cache.Lookup("a"));
+
+  ExecutorCacheStats stats = cache.GetStats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(0, stats.evictions);
+  EXPECT_EQ(1, stats.size);
+}
+
+TEST(ExecutorCacheTest, Unbounded) {
+  ExecutorCache<int> cache(0);
+  for (int i = 0; i < 100; ++i) {
+    int num_evicted;
+    cache.Insert(strings::StrCat(i), Value(i), &num_evicted);
+    EXPECT_EQ(0, num_evicted);
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, *cache.Lookup(strings::StrCat(i)));
+  }
+  EXPECT_EQ(100, cache.GetStats().size);
+}
+
+TEST(ExecutorCacheTest, EvictsLeastRecentlyUsed) {
+  ExecutorCache<int> cache(2);
+  cache.Insert("a", Value(1));
+  cache.Insert("b", Value(2));
+  // "a" becomes more recently used than "b".
+  EXPECT_NE(nullptr, cache.Lookup("a"));
+
+  int num_evicted;
+  cache.Insert("c", Value(3), &num_evicted);
+  EXPECT_EQ(1, num_evicted);
+  EXPECT_NE(nullptr, cache.Lookup("a"));
+  EXPECT_EQ(nullptr, cache.Lookup("b"));
+  EXPECT_NE(nullptr, cache.Lookup("c"));
+
+  cache.Insert("b", Value(2), &num_evicted);
+  EXPECT_EQ(1, num_evicted);
+  EXPECT_EQ(nullptr, cache.Lookup("a"));
+
+  ExecutorCacheStats stats = cache.GetStats();
+  EXPECT_EQ(2, stats.evictions);
+  EXPECT_EQ(2, stats.size);
+}
+
+TEST(ExecutorCacheTest, EvictedValuesOutliveTheirUsers) {
+  ExecutorCache<int> cache(1);
+  std::shared_ptr<int> a = cache.Insert("a", Value(1));
+  cache.Insert("b", Value(2));
+  EXPECT_EQ(nullptr, cache.Lookup("a"));
+  EXPECT_EQ(1, *a);
+  EXPECT_EQ(1, a.use_count());
+}
+
+TEST(ExecutorCacheTest, ConcurrentLookupsAndInserts) {
+  const int kNumKeys = 16;
+  ExecutorCache<int> cache(kNumKeys / 2);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 8);
+    for (int t = 0; t < 8; ++t) {
+      pool.Schedule([&cache, t]() {
+        for (int i = 0; i < 1000; ++i) {
+          const int k = (i * 7 + t) % kNumKeys;
+          const string key = strings::StrCat(k);
+          std::shared_ptr<int> value = cache.Lookup(key);
+          if (value == nullptr) {
+            value = cache.Insert(key, Value(k));
+          }
+          EXPECT_EQ(k, *value);
+        }
+      });
+    }
+  }
+  ExecutorCacheStats stats = cache.GetStats();
+  EXPECT_EQ(8 * 1000, stats.hits + stats.misses);
+  EXPECT_GE(kNumKeys / 2, stats.size);
+}
+
+TEST(ExecutorCacheTest, FreesEvictedEntriesDuringLookups) {
+  const int kNumInserts = 100;
+  const int kNumReaders = 4;
+  std::atomic<int> num_freed(0);
+  auto counted_value = [&num_freed](int v) {
+    return std::shared_ptr<int>(new int(v), [&num_freed](int* p) {
+      ++num_freed;
+      delete p;
+    });
+  };
+
+  ExecutorCache<int> cache(1);
+  std::atomic<bool> stop(false);
+  thread::ThreadPool pool(Env::Default(), "test", kNumReaders);
+  for (int t = 0; t < kNumReaders; ++t) {
+    pool.Schedule([&cache, &stop]() {
+      while (!stop.load()) {
+        cache.Lookup("0");
+      }
+    });
+  }
+  // The readers keep looking up, so the count of lookups in progress is
+  // rarely zero, but every evicted entry must still be freed.
+  for (int i = 0; i < kNumInserts; ++i) {
+    cache.Insert(strings::StrCat(i), counted_value(i));
+  }
+  for (int i = 0; i < 100000 && num_freed.load() < kNumInserts - 1; ++i) {
+    cache.GetStats();
+    Env::Default()->SleepForMicroseconds(10);
+  }
+  EXPECT_EQ(kNumInserts - 1, num_freed.load());
+  stop.store(true);
+}
+
+static void BM_LookupHit(int iters, int num_threads) {
+  testing::StopTiming();
+  ExecutorCache<int> cache(0);
+  for (int i = 0; i < 64; ++i) {
+    cache.Insert(strings::StrCat("signature_", i), Value(i));
+  }
+  BlockingCounter done(num_threads);
+  std::atomic<int64> hits(0);
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  testing::StartTiming();
+  for (int t = 0; t < num_threads; ++t) {
+    pool.Schedule([&cache, &done, &hits, iters, t]() {
+      const string key = strings::StrCat("signature_", t);
+      int64 n = 0;
+      for (int i = 0; i < iters; ++i) {
+        n += (cache.Lookup(key) != nullptr);
+      }
+      hits += n;
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  testing::StopTiming();
+  CHECK_EQ(static_cast<int64>(iters) * num_threads, hits.load());
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads);
+}
+BENCHMARK(BM_LookupHit)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,16 +15,19 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/gpu/process_state.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/gpu/gpu_bfc_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_debug_allocator.h"
 #include "tensorflow/core/common_runtime/gpu/gpu_init.h"
 #include "tensorflow/core/common_runtime/gpu/pool_allocator.h"
+#include "tensorflow/core/common_runtime/sharded_bfc_allocator.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/tracking_allocator.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/stream_executor.h"
@@ -189,7 +192,16 @@ Allocator* ProcessState::GetCUDAHostAllocator(int numa_node) {
     CHECK(se);
     Allocator* allocator = nullptr;
     static constexpr bool kCudaHostMemoryUseBFC = true;
-    if (kCudaHostMemoryUseBFC) {
+    // Host memory is allocated concurrently by many inter-op threads, so
+    // the BFC allocator is split into shards with separate locks.
+    static constexpr int kCudaHostMemoryMaxShards = 8;
+    const int num_shards =
+        std::min(port::NumSchedulableCPUs(), kCudaHostMemoryMaxShards);
+    if (kCudaHostMemoryUseBFC && num_shards > 1) {
+      allocator = new ShardedBFCAllocator(
+          new CUDAHostAllocator(se), 1LL << 36 /*64GB max*/,
+          true /*allow_growth*/, "cuda_host_bfc" /*name*/, num_shards);
+    } else if (kCudaHostMemoryUseBFC) {
       allocator =
           new BFCAllocator(new CUDAHostAllocator(se), 1LL << 36 /*64GB max*/,
                            true /*allow_growth*/, "cuda_host_bfc" /*name*/);
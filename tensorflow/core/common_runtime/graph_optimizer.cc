@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/constant_folding.h"
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/optimizer_cse.h"
 
@@ -88,6 +89,25 @@ void GraphOptimizer::Optimize(FunctionLibraryRuntime* runtime, Env* env,
   delete g;
   *graph = copy;
   DumpGraph("ReCopy", *graph);
+
+  if (opts_.do_memory_planning() && device != nullptr &&
+      device->device_type() == DEVICE_CPU) {
+    // Memory planning does not change the graph structure, so it runs
+    // once, after all the other passes.
+    const int kMaxPlannedNodes = 10000;
+    MemoryPlanStats stats;
+    Status s = PlanMemory(*graph, kMaxPlannedNodes, &stats);
+    if (!s.ok()) {
+      LOG(WARNING) << "Memory planning failed: " << s;
+    } else if (stats.num_planned_tensors > 0) {
+      VLOG(1) << "Planned the memory of " << stats.num_planned_tensors
+              << " tensors on " << device->name() << ": "
+              << stats.planned_bytes << " bytes planned vs. "
+              << stats.naive_peak_bytes << " bytes naive peak ("
+              << stats.total_bytes << " bytes in total)";
+      DumpGraph("MemoryPlanning", *graph);
+    }
+  }
 }
 
 }  // end namespace tensorflow
@@ -72,6 +72,14 @@ Benchmark::Benchmark(const string& device, Graph* g,
   params.delete_kernel = [](OpKernel* kernel) {
     DeleteNonCachedKernel(kernel);
   };
+  const ExecutorOptions& executor_opts =
+      options->config.graph_options().executor_options();
+  params.use_work_stealing =
+      (executor_opts.scheduler() == ExecutorOptions::WORK_STEALING);
+  params.max_workers = executor_opts.max_workers();
+  params.use_static_plan = executor_opts.use_static_plan();
+  params.use_step_arena = executor_opts.use_step_arena();
+  params.step_arena_max_bytes = executor_opts.step_arena_max_bytes();
 
   if (init) {
     Executor* init_exec;
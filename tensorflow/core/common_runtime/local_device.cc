@@ -16,11 +16,17 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/common_runtime/local_device.h"
+
+#include <algorithm>
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/common_runtime/eigen_thread_pool.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -28,40 +34,90 @@ namespace tensorflow {
 
 namespace {
 
-DeviceBase::CpuWorkerThreads eigen_worker_threads;
-Eigen::ThreadPoolInterface* eigen_thread_pool = nullptr;
-Eigen::ThreadPoolDevice* eigen_device = nullptr;
+// A fixed sized threadpool for numerical computations and the Eigen
+// device that runs on it.
+struct EigenThreadPoolInfo {
+  DeviceBase::CpuWorkerThreads eigen_worker_threads;
+  Eigen::ThreadPoolInterface* eigen_thread_pool = nullptr;
+  Eigen::ThreadPoolDevice* eigen_device = nullptr;
+};
 
-static bool InitModule(const SessionOptions& options) {
+EigenThreadPoolInfo* NewEigenThreadPoolInfo(const SessionOptions& options,
+                                            int numa_node) {
   int32 intra_op_parallelism_threads =
       options.config.intra_op_parallelism_threads();
-  if (intra_op_parallelism_threads == 0) {
-    intra_op_parallelism_threads = port::NumSchedulableCPUs();
+  ThreadOptions thread_options;
+  string name = "Eigen";
+  if (numa_node == port::kNUMANoAffinity) {
+    if (intra_op_parallelism_threads == 0) {
+      intra_op_parallelism_threads = port::NumSchedulableCPUs();
+    }
+  } else {
+    // The threads of the process are split among the nodes.
+    if (intra_op_parallelism_threads == 0) {
+      std::vector<int> cpus;
+      port::NUMANodeCPUs(numa_node, &cpus);
+      intra_op_parallelism_threads = cpus.size();
+    } else {
+      intra_op_parallelism_threads /= port::NUMANumNodes();
+    }
+    intra_op_parallelism_threads = std::max(intra_op_parallelism_threads, 1);
+    thread_options.numa_node = numa_node;
+    name = strings::StrCat("numa_", numa_node, "_Eigen");
   }
   VLOG(1) << "Local device intra op parallelism threads: "
-          << intra_op_parallelism_threads;
-  eigen_worker_threads.num_threads = intra_op_parallelism_threads;
-  eigen_worker_threads.workers = new thread::ThreadPool(
-      options.env, "Eigen", intra_op_parallelism_threads);
-  eigen_thread_pool = new EigenThreadPoolWrapper(eigen_worker_threads.workers);
-  eigen_device = new Eigen::ThreadPoolDevice(eigen_thread_pool,
-                                             eigen_worker_threads.num_threads);
-  return true;
+          << intra_op_parallelism_threads << " NUMA node: " << numa_node;
+  EigenThreadPoolInfo* info = new EigenThreadPoolInfo;
+  info->eigen_worker_threads.num_threads = intra_op_parallelism_threads;
+  info->eigen_worker_threads.workers = new thread::ThreadPool(
+      options.env, thread_options, name, intra_op_parallelism_threads);
+  info->eigen_thread_pool =
+      new EigenThreadPoolWrapper(info->eigen_worker_threads.workers);
+  info->eigen_device = new Eigen::ThreadPoolDevice(
+      info->eigen_thread_pool, info->eigen_worker_threads.num_threads);
+  return info;
+}
+
+// Returns the process-wide EigenThreadPoolInfo of "numa_node", creating
+// it from "options" on first use.
+EigenThreadPoolInfo* GetEigenThreadPoolInfo(const SessionOptions& options,
+                                            int numa_node) {
+  static mutex mu;
+  static EigenThreadPoolInfo* global_info = nullptr;
+  static std::vector<EigenThreadPoolInfo*>* numa_infos =
+      new std::vector<EigenThreadPoolInfo*>;
+  mutex_lock l(mu);
+  if (numa_node == port::kNUMANoAffinity) {
+    if (global_info == nullptr) {
+      global_info = NewEigenThreadPoolInfo(options, numa_node);
+    }
+    return global_info;
+  }
+  CHECK_GE(numa_node, 0);
+  if (numa_infos->size() <= static_cast<size_t>(numa_node)) {
+    numa_infos->resize(numa_node + 1, nullptr);
+  }
+  EigenThreadPoolInfo*& info = (*numa_infos)[numa_node];
+  if (info == nullptr) {
+    info = NewEigenThreadPoolInfo(options, numa_node);
+  }
+  return info;
 }
+
 }  // end namespace
 
 // LocalDevice ----------------------------------------------------------------
 
 LocalDevice::LocalDevice(const SessionOptions& options,
                          const DeviceAttributes& attributes,
-                         Allocator* device_allocator)
+                         Allocator* device_allocator, int numa_node)
     : Device(options.env, attributes, device_allocator) {
-  // All ThreadPoolDevices in the process will use this single fixed
-  // sized threadpool for numerical computations.
-  static bool init = InitModule(options);
-  CHECK(init);  // Avoids compiler warning that init is unused.
-  set_tensorflow_cpu_worker_threads(&eigen_worker_threads);
-  set_eigen_cpu_device(eigen_device);
+  // All ThreadPoolDevices in the process (of the same NUMA node, if
+  // any) will use this single fixed sized threadpool for numerical
+  // computations.
+  EigenThreadPoolInfo* info = GetEigenThreadPoolInfo(options, numa_node);
+  set_tensorflow_cpu_worker_threads(&info->eigen_worker_threads);
+  set_eigen_cpu_device(info->eigen_device);
 }
 
 }  // namespace tensorflow
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/macros.h"
 
 namespace tensorflow {
@@ -28,10 +29,14 @@ struct SessionOptions;
 // initializes a shared Eigen compute device used by both.  This
 // should eventually be removed once we refactor ThreadPoolDevice and
 // GPUDevice into more 'process-wide' abstractions.
+//
+// Devices created with a "numa_node" instead share a compute device
+// whose threads are bound to the CPUs of that NUMA node.
 class LocalDevice : public Device {
  public:
   LocalDevice(const SessionOptions& options, const DeviceAttributes& attributes,
-              Allocator* device_allocator);
+              Allocator* device_allocator,
+              int numa_node = port::kNUMANoAffinity);
   ~LocalDevice() override {}
 
  private:
@@ -0,0 +1,349 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/shape_inferer.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+const char* const kMemoryPlanOffsetsAttr = "_memory_plan_offsets";
+const char* const kMemoryPlanSizesAttr = "_memory_plan_sizes";
+
+namespace {
+
+// Regions start at multiples of this many bytes.
+const int64 kRegionAlignment = 64;
+
+// Returns true if "node" may keep its inputs beyond the step.
+bool MayRetainInputs(const Node* node) {
+  if (node->op_def().is_stateful() || IsTransferNode(node) ||
+      node->type_string() == "_Retval") {
+    return true;
+  }
+  for (DataType dt : node->input_types()) {
+    if (IsRefType(dt)) return true;
+  }
+  return false;
+}
+
+// Returns true if the outputs of "node" are worth planning. Nodes
+// without inputs (constants, variables, ...) and identities usually
+// hand out existing buffers instead of allocating their outputs.
+bool MayPlanOutputs(const Node* node) {
+  return node->IsOp() && node->num_inputs() > 0 && !IsIdentity(node) &&
+         !MayRetainInputs(node);
+}
+
+// Returns the size in bytes of output "i" of "node", as inferred by "c",
+// or -1 if it is not known or the output cannot live in a slab.
+int64 OutputBytes(const Node* node, int i,
+                  shape_inference::InferenceContext* c) {
+  const DataType dt = node->output_type(i);
+  if (IsRefType(dt) || !DataTypeCanUseMemcpy(dt)) return -1;
+  shape_inference::ShapeHandle shape = c->output(i);
+  if (!c->FullyDefined(shape)) return -1;
+  int64 bytes = DataTypeSize(dt);
+  for (int d = 0; d < c->Rank(shape); ++d) {
+    bytes *= c->Value(c->Dim(shape, d));
+  }
+  return bytes;
+}
+
+int64 RoundUp(int64 bytes) {
+  return (bytes + kRegionAlignment - 1) / kRegionAlignment * kRegionAlignment;
+}
+
+struct PlannedTensor {
+  const Node* node;
+  int output;
+  int64 bytes;
+  std::vector<const Node*> consumers;
+  int region = -1;
+};
+
+}  // namespace
+
+Status PlanMemory(Graph* graph, int max_nodes, MemoryPlanStats* stats) {
+  *stats = MemoryPlanStats();
+  if (graph->num_node_ids() > max_nodes) {
+    VLOG(1) << "Not planning the memory of a graph with "
+            << graph->num_node_ids() << " nodes";
+    return Status::OK();
+  }
+  for (const Node* n : graph->nodes()) {
+    if (IsControlFlow(n)) {
+      VLOG(1) << "Not planning the memory of a graph with control flow";
+      return Status::OK();
+    }
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(*graph, &order);
+
+  // Infer the shapes. A node whose shape function fails, or that has no
+  // shape function, leaves the outputs of its descendants unknown.
+  ShapeInferer inferer;
+  std::vector<PlannedTensor> tensors;
+  for (const Node* n : order) {
+    if (!n->IsOp()) continue;
+    Status s = inferer.AddNode(n);
+    if (!s.ok()) {
+      VLOG(2) << "No shapes for " << n->name() << ": " << s;
+      continue;
+    }
+    if (!MayPlanOutputs(n)) continue;
+    shape_inference::InferenceContext* c = inferer.GetContext(n);
+    for (int i = 0; i < n->num_outputs(); ++i) {
+      const int64 bytes = OutputBytes(n, i, c);
+      if (bytes <= 0) continue;
+      PlannedTensor t;
+      t.node = n;
+      t.output = i;
+      t.bytes = bytes;
+      bool retained = false;
+      for (const Edge* e : n->out_edges()) {
+        if (e->IsControlEdge() || e->src_output() != i) continue;
+        retained = retained || MayRetainInputs(e->dst());
+        t.consumers.push_back(e->dst());
+      }
+      if (!retained) tensors.push_back(t);
+    }
+  }
+  if (tensors.empty()) return Status::OK();
+
+  // ancestors[id] has bit j set iff node j is an ancestor of node id.
+  const int num_ids = graph->num_node_ids();
+  const int num_words = (num_ids + 63) / 64;
+  std::vector<std::vector<uint64>> ancestors(num_ids);
+  for (const Node* n : order) {
+    std::vector<uint64>& bits = ancestors[n->id()];
+    bits.resize(num_words, 0);
+    for (const Edge* e : n->in_edges()) {
+      const int src = e->src()->id();
+      const std::vector<uint64>& src_bits = ancestors[src];
+      for (int w = 0; w < num_words; ++w) bits[w] |= src_bits[w];
+      bits[src / 64] |= uint64{1} << (src % 64);
+    }
+  }
+  auto is_ancestor = [&ancestors](const Node* a, const Node* b) {
+    return (ancestors[b->id()][a->id() / 64] >> (a->id() % 64)) & 1;
+  };
+
+  // Assign each tensor, in topological order, to a region whose last
+  // tensor is certainly freed before the tensor is allocated: the best
+  // fitting one, or else the largest one, which is grown.
+  std::vector<int64> region_sizes;
+  std::vector<const PlannedTensor*> region_last;
+  for (PlannedTensor& t : tensors) {
+    int best = -1;
+    for (int r = 0; r < region_sizes.size(); ++r) {
+      const PlannedTensor* last = region_last[r];
+      bool released = is_ancestor(last->node, t.node);
+      for (const Node* c : last->consumers) {
+        released = released && is_ancestor(c, t.node);
+      }
+      if (!released) continue;
+      if (best < 0) {
+        best = r;
+        continue;
+      }
+      const bool fits = region_sizes[r] >= t.bytes;
+      const bool best_fits = region_sizes[best] >= t.bytes;
+      if ((fits && (!best_fits || region_sizes[r] < region_sizes[best])) ||
+          (!fits && !best_fits && region_sizes[r] > region_sizes[best])) {
+        best = r;
+      }
+    }
+    if (best < 0) {
+      best = region_sizes.size();
+      region_sizes.push_back(0);
+      region_last.push_back(nullptr);
+    }
+    region_sizes[best] = std::max(region_sizes[best], RoundUp(t.bytes));
+    region_last[best] = &t;
+    t.region = best;
+  }
+
+  std::vector<int64> region_offsets(region_sizes.size());
+  int64 slab_bytes = 0;
+  for (int r = 0; r < region_sizes.size(); ++r) {
+    region_offsets[r] = slab_bytes;
+    slab_bytes += region_sizes[r];
+  }
+
+  // Record the plan in the nodes.
+  std::unordered_map<const Node*, std::vector<int64>> offsets;
+  std::unordered_map<const Node*, std::vector<int64>> sizes;
+  for (const PlannedTensor& t : tensors) {
+    std::vector<int64>* node_offsets = &offsets[t.node];
+    std::vector<int64>* node_sizes = &sizes[t.node];
+    node_offsets->resize(t.node->num_outputs(), -1);
+    node_sizes->resize(t.node->num_outputs(), 0);
+    (*node_offsets)[t.output] = region_offsets[t.region];
+    (*node_sizes)[t.output] = region_sizes[t.region];
+  }
+  for (Node* n : graph->nodes()) {
+    auto it = offsets.find(n);
+    if (it == offsets.end()) continue;
+    n->AddAttr(kMemoryPlanOffsetsAttr, it->second);
+    n->AddAttr(kMemoryPlanSizesAttr, sizes[n]);
+  }
+
+  // Compute the peak without reuse, freeing every tensor after its last
+  // consumer in topological order.
+  std::vector<int> position(num_ids);
+  for (int i = 0; i < order.size(); ++i) position[order[i]->id()] = i;
+  std::vector<int64> freed_at(order.size(), 0);
+  std::vector<int64> allocated_at(order.size(), 0);
+  for (const PlannedTensor& t : tensors) {
+    int last = position[t.node->id()];
+    for (const Node* c : t.consumers) last = std::max(last, position[c->id()]);
+    allocated_at[position[t.node->id()]] += t.bytes;
+    freed_at[last] += t.bytes;
+    stats->total_bytes += t.bytes;
+  }
+  int64 live = 0;
+  for (int i = 0; i < order.size(); ++i) {
+    live += allocated_at[i];
+    stats->naive_peak_bytes = std::max(stats->naive_peak_bytes, live);
+    live -= freed_at[i];
+  }
+  stats->num_planned_tensors = tensors.size();
+  stats->planned_bytes = slab_bytes;
+  return Status::OK();
+}
+
+class PlannedMemoryPool::Slab::RegionAllocator : public Allocator {
+ public:
+  RegionAllocator(Slab* slab, Allocator* base, char* data, int64 size)
+      : slab_(slab), base_(base), data_(data), size_(size), in_use_(false) {}
+
+  string Name() override { return "planned_region"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    if (num_bytes <= size_ &&
+        reinterpret_cast<uintptr_t>(data_) % alignment == 0 &&
+        !in_use_.exchange(true, std::memory_order_acquire)) {
+      slab_->Ref();
+      return data_;
+    }
+    return base_->AllocateRaw(alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    if (ptr == data_) {
+      in_use_.store(false, std::memory_order_release);
+      slab_->Unref();
+    } else {
+      base_->DeallocateRaw(ptr);
+    }
+  }
+
+ private:
+  Slab* const slab_;
+  Allocator* const base_;  // Not owned.
+  char* const data_;
+  const size_t size_;
+  std::atomic<bool> in_use_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RegionAllocator);
+};
+
+PlannedMemoryPool::PlannedMemoryPool(Allocator* base,
+                                     const std::vector<int64>& region_offsets,
+                                     const std::vector<int64>& region_sizes,
+                                     const std::vector<int>& output_regions)
+    : base_(base),
+      region_offsets_(region_offsets),
+      region_sizes_(region_sizes),
+      output_regions_(output_regions) {
+  for (int r = 0; r < region_offsets_.size(); ++r) {
+    slab_bytes_ = std::max(slab_bytes_, region_offsets_[r] + region_sizes_[r]);
+  }
+}
+
+PlannedMemoryPool::~PlannedMemoryPool() {
+  for (Slab* slab : free_slabs_) {
+    delete slab;
+  }
+}
+
+PlannedMemoryPool::Slab* PlannedMemoryPool::Get() {
+  Slab* slab = nullptr;
+  {
+    mutex_lock l(mu_);
+    if (!free_slabs_.empty()) {
+      slab = free_slabs_.back();
+      free_slabs_.pop_back();
+    }
+  }
+  if (slab == nullptr) slab = new Slab(this);
+  slab->refs_ = 1;
+  // Released by the slab once it is back in the pool.
+  Ref();
+  return slab;
+}
+
+void PlannedMemoryPool::Put(Slab* slab) {
+  {
+    mutex_lock l(mu_);
+    free_slabs_.push_back(slab);
+  }
+  Unref();
+}
+
+PlannedMemoryPool::Slab::Slab(PlannedMemoryPool* pool)
+    : pool_(pool), refs_(0) {
+  Allocator* base = pool->base_;
+  data_ = static_cast<char*>(
+      base->AllocateRaw(kRegionAlignment, pool->slab_bytes_));
+  if (data_ == nullptr) {
+    LOG(WARNING) << "Failed to allocate a slab of " << pool->slab_bytes_
+                 << " bytes for the memory plan";
+  } else {
+    for (int r = 0; r < pool->region_offsets_.size(); ++r) {
+      regions_.push_back(new RegionAllocator(this, base,
+                                             data_ + pool->region_offsets_[r],
+                                             pool->region_sizes_[r]));
+    }
+  }
+  output_allocators_.resize(pool->output_regions_.size(), nullptr);
+  if (data_ != nullptr) {
+    for (int i = 0; i < pool->output_regions_.size(); ++i) {
+      const int r = pool->output_regions_[i];
+      if (r >= 0) output_allocators_[i] = regions_[r];
+    }
+  }
+}
+
+PlannedMemoryPool::Slab::~Slab() {
+  for (RegionAllocator* region : regions_) {
+    delete region;
+  }
+  if (data_ != nullptr) pool_->base_->DeallocateRaw(data_);
+}
+
+void PlannedMemoryPool::Slab::Unref() {
+  if (refs_.fetch_sub(1) == 1) pool_->Put(this);
+}
+
+}  // namespace tensorflow
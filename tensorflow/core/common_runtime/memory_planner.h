@@ -0,0 +1,145 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_MEMORY_PLANNER_H_
+#define TENSORFLOW_COMMON_RUNTIME_MEMORY_PLANNER_H_
+
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// The node attributes in which PlanMemory() records the plan. Both are
+// lists with one element per output of the node: the offset of the
+// output's region in the slab, or -1 if the output is not planned, and
+// the size of that region in bytes.
+extern const char* const kMemoryPlanOffsetsAttr;
+extern const char* const kMemoryPlanSizesAttr;
+
+struct MemoryPlanStats {
+  // The number of outputs assigned a region of the slab.
+  int64 num_planned_tensors = 0;
+
+  // The total size of the planned outputs.
+  int64 total_bytes = 0;
+
+  // The peak size of the live planned outputs when the graph runs
+  // sequentially in topological order and every output is freed after
+  // its last consumer, i.e. the peak with one allocation per tensor.
+  int64 naive_peak_bytes = 0;
+
+  // The size of the slab holding all the planned outputs.
+  int64 planned_bytes = 0;
+};
+
+// Plans the memory of the outputs of the nodes of "graph" whose shape is
+// fully known after shape inference, so that each step can allocate
+// them from a single slab and outputs whose lifetimes do not overlap
+// share a region of it.
+//
+// Two outputs only share a region if the producer and consumers of the
+// first are ancestors of the producer of the second in the graph, so
+// that the first is freed before the second is allocated under any
+// schedule. Outputs that may be retained beyond the step (consumed by
+// stateful, transfer or ref-input nodes) are not planned, and neither
+// are graphs with control flow or more than "max_nodes" nodes.
+//
+// The plan is recorded in the kMemoryPlan*Attr attributes of the nodes,
+// which the executor reads when it is created.
+Status PlanMemory(Graph* graph, int max_nodes, MemoryPlanStats* stats);
+
+// A pool of slabs laid out according to a memory plan, for the steps of
+// one executor. Each region of a slab is exposed as an Allocator that
+// hands out the region if it is large enough and not in use, and falls
+// back to the base allocator otherwise, so a plan that turns out to be
+// wrong at run time (e.g. because a kernel forwarded its input to its
+// output) only costs its benefit.
+class PlannedMemoryPool : public core::RefCounted {
+ public:
+  class Slab;
+
+  // "output_regions[i]" is the index in "region_offsets" and
+  // "region_sizes" of the region for the executor's i-th output, or -1.
+  // Does not take ownership of "base", which must outlive the pool.
+  PlannedMemoryPool(Allocator* base, const std::vector<int64>& region_offsets,
+                    const std::vector<int64>& region_sizes,
+                    const std::vector<int>& output_regions);
+
+  // Returns a slab with all its regions free. The caller must call
+  // Slab::Release() when the step is done.
+  Slab* Get();
+
+  class Slab {
+   public:
+    // The allocators for the executor's outputs, indexed like
+    // "output_regions" and nullptr for outputs without a region.
+    Allocator* const* output_allocators() const {
+      return output_allocators_.data();
+    }
+
+    // Returns the slab to the pool as soon as none of its regions is in
+    // use.
+    void Release() { Unref(); }
+
+   private:
+    friend class PlannedMemoryPool;
+    class RegionAllocator;
+
+    explicit Slab(PlannedMemoryPool* pool);
+    ~Slab();
+
+    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void Unref();
+
+    PlannedMemoryPool* const pool_;
+    char* data_ = nullptr;
+    std::vector<RegionAllocator*> regions_;
+    std::vector<Allocator*> output_allocators_;
+
+    // One for the step using the slab, plus one for each region in use.
+    std::atomic<int64> refs_;
+
+    TF_DISALLOW_COPY_AND_ASSIGN(Slab);
+  };
+
+ private:
+  ~PlannedMemoryPool() override;
+
+  void Put(Slab* slab);
+
+  Allocator* const base_;  // Not owned.
+  const std::vector<int64> region_offsets_;
+  const std::vector<int64> region_sizes_;
+  const std::vector<int> output_regions_;
+  int64 slab_bytes_ = 0;
+
+  mutex mu_;
+  std::vector<Slab*> free_slabs_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedMemoryPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_MEMORY_PLANNER_H_
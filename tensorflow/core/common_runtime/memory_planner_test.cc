@@ -0,0 +1,200 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class MemoryPlannerTest : public ::testing::Test {
+ protected:
+  MemoryPlannerTest() : g_(new Graph(OpRegistry::Global())) {}
+
+  Node* Constant(const TensorShape& shape) {
+    Tensor t(DT_FLOAT, shape);
+    t.flat<float>().setZero();
+    return test::graph::Constant(g_.get(), t);
+  }
+
+  // Returns the planned offsets of the outputs of "n", or an empty
+  // vector if the node has none.
+  std::vector<int64> Offsets(const Node* n) {
+    std::vector<int64> offsets;
+    if (n->def().attr().count(kMemoryPlanOffsetsAttr) > 0) {
+      TF_CHECK_OK(GetNodeAttr(n->def(), kMemoryPlanOffsetsAttr, &offsets));
+    }
+    return offsets;
+  }
+
+  std::unique_ptr<Graph> g_;
+};
+
+TEST_F(MemoryPlannerTest, Chain) {
+  // c -> a0 -> a1 -> a2 -> a3 -> a4, each ai = a(i-1) + c.
+  Node* c = Constant(TensorShape({4, 4}));
+  std::vector<Node*> adds;
+  Node* prev = c;
+  for (int i = 0; i < 5; ++i) {
+    prev = test::graph::Add(g_.get(), prev, c);
+    adds.push_back(prev);
+  }
+  MemoryPlanStats stats;
+  TF_ASSERT_OK(PlanMemory(g_.get(), 1000, &stats));
+
+  // Constants are not planned.
+  EXPECT_TRUE(Offsets(c).empty());
+  // Every other output reuses the same region.
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(1, Offsets(adds[i]).size());
+  }
+  EXPECT_EQ(Offsets(adds[0]), Offsets(adds[2]));
+  EXPECT_EQ(Offsets(adds[0]), Offsets(adds[4]));
+  EXPECT_EQ(Offsets(adds[1]), Offsets(adds[3]));
+  EXPECT_NE(Offsets(adds[0]), Offsets(adds[1]));
+
+  EXPECT_EQ(5, stats.num_planned_tensors);
+  EXPECT_EQ(5 * 64, stats.total_bytes);
+  EXPECT_EQ(2 * 64, stats.naive_peak_bytes);
+  EXPECT_EQ(2 * 64, stats.planned_bytes);
+}
+
+TEST_F(MemoryPlannerTest, ParallelBranchesDoNotShare) {
+  // Two independent branches may run concurrently, so none of their
+  // outputs can share a region.
+  Node* c = Constant(TensorShape({16}));
+  Node* a0 = test::graph::Add(g_.get(), c, c);
+  Node* a1 = test::graph::Add(g_.get(), a0, c);
+  Node* b0 = test::graph::Add(g_.get(), c, c);
+  Node* b1 = test::graph::Add(g_.get(), b0, c);
+  test::graph::Add(g_.get(), a1, b1);
+  MemoryPlanStats stats;
+  TF_ASSERT_OK(PlanMemory(g_.get(), 1000, &stats));
+
+  for (Node* a : {a0, a1}) {
+    for (Node* b : {b0, b1}) {
+      EXPECT_NE(Offsets(a), Offsets(b));
+    }
+  }
+  EXPECT_EQ(5, stats.num_planned_tensors);
+  EXPECT_LT(stats.planned_bytes, stats.total_bytes);
+}
+
+TEST_F(MemoryPlannerTest, LargerTensorGrowsRegion) {
+  Node* small = Constant(TensorShape({64}));
+  Node* large = Constant(TensorShape({64, 64}));
+  Node* a0 = test::graph::Add(g_.get(), small, small);
+  Node* a1 = test::graph::Add(g_.get(), a0, small);
+  Node* a2 = test::graph::Add(g_.get(), a1, small);
+  // Broadcasts to the shape of "large", and reuses the region of a1.
+  Node* b = test::graph::Add(g_.get(), a2, large);
+  Node* c = test::graph::Add(g_.get(), b, large);
+  MemoryPlanStats stats;
+  TF_ASSERT_OK(PlanMemory(g_.get(), 1000, &stats));
+  EXPECT_EQ(Offsets(a1), Offsets(b));
+  EXPECT_EQ(Offsets(a0), Offsets(c));
+  EXPECT_EQ(2 * 64 * 64 * 4, stats.planned_bytes);
+}
+
+TEST_F(MemoryPlannerTest, RetainedOutputsAreNotPlanned) {
+  Node* c = Constant(TensorShape({16}));
+  Node* a = test::graph::Add(g_.get(), c, c);
+  Node* var = test::graph::Var(g_.get(), DT_FLOAT, TensorShape({16}));
+  test::graph::Assign(g_.get(), var, a);
+  Node* b = test::graph::Add(g_.get(), c, c);
+  test::graph::Send(g_.get(), b, "b", "/job:a/replica:0/task:0/cpu:0", 1,
+                    "/job:a/replica:0/task:0/cpu:0");
+  MemoryPlanStats stats;
+  TF_ASSERT_OK(PlanMemory(g_.get(), 1000, &stats));
+  EXPECT_TRUE(Offsets(a).empty());
+  EXPECT_TRUE(Offsets(b).empty());
+  EXPECT_EQ(0, stats.num_planned_tensors);
+}
+
+TEST_F(MemoryPlannerTest, UnknownShapesAreNotPlanned) {
+  Node* in = test::graph::Recv(g_.get(), "a", "float",
+                               "/job:a/replica:0/task:0/cpu:0", 1,
+                               "/job:a/replica:0/task:0/cpu:0");
+  Node* a = test::graph::Add(g_.get(), in, in);
+  test::graph::Add(g_.get(), a, in);
+  MemoryPlanStats stats;
+  TF_ASSERT_OK(PlanMemory(g_.get(), 1000, &stats));
+  EXPECT_TRUE(Offsets(a).empty());
+  EXPECT_EQ(0, stats.num_planned_tensors);
+}
+
+TEST_F(MemoryPlannerTest, TooManyNodes) {
+  Node* c = Constant(TensorShape({16}));
+  Node* a = test::graph::Add(g_.get(), c, c);
+  test::graph::Add(g_.get(), a, c);
+  MemoryPlanStats stats;
+  TF_ASSERT_OK(PlanMemory(g_.get(), 3, &stats));
+  EXPECT_TRUE(Offsets(a).empty());
+}
+
+TEST(PlannedMemoryPoolTest, Regions) {
+  PlannedMemoryPool* pool =
+      new PlannedMemoryPool(cpu_allocator(), {0, 64}, {64, 128}, {0, -1, 1, 0});
+  PlannedMemoryPool::Slab* slab = pool->Get();
+  Allocator* const* allocators = slab->output_allocators();
+  EXPECT_EQ(nullptr, allocators[1]);
+  EXPECT_EQ(allocators[0], allocators[3]);
+
+  void* p0 = allocators[0]->AllocateRaw(Allocator::kAllocatorAlignment, 64);
+  // Region 0 is in use, so output 3 gets memory from the base allocator.
+  void* p3 = allocators[3]->AllocateRaw(Allocator::kAllocatorAlignment, 16);
+  // Too large for region 1.
+  void* big = allocators[2]->AllocateRaw(Allocator::kAllocatorAlignment, 256);
+  void* p2 = allocators[2]->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  EXPECT_EQ(static_cast<char*>(p0) + 64, static_cast<char*>(p2));
+  EXPECT_NE(p0, p3);
+  allocators[3]->DeallocateRaw(p3);
+  allocators[2]->DeallocateRaw(big);
+  allocators[2]->DeallocateRaw(p2);
+
+  // The slab is only reused once region 0 is free again.
+  slab->Release();
+  PlannedMemoryPool::Slab* other = pool->Get();
+  EXPECT_NE(slab, other);
+  allocators[0]->DeallocateRaw(p0);
+  other->Release();
+  PlannedMemoryPool::Slab* reused = pool->Get();
+  EXPECT_TRUE(reused == slab || reused == other);
+  reused->Release();
+  pool->Unref();
+}
+
+TEST(PlannedMemoryPoolTest, TensorOutlivesPool) {
+  PlannedMemoryPool* pool =
+      new PlannedMemoryPool(cpu_allocator(), {0}, {64}, {0});
+  PlannedMemoryPool::Slab* slab = pool->Get();
+  Tensor t(slab->output_allocators()[0], DT_FLOAT, TensorShape({4}));
+  test::FillValues<float>(&t, {1, 2, 3, 4});
+  slab->Release();
+  pool->Unref();
+  // The slab and the pool are deleted with the tensor.
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({1, 2, 3, 4}), t);
+}
+
+}  // namespace
+}  // namespace tensorflow
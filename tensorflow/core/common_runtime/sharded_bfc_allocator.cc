@@ -0,0 +1,242 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/sharded_bfc_allocator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+// Passes allocations through to the sub-allocator of the
+// ShardedBFCAllocator, within the budget shared by all the shards.
+class ShardedBFCAllocator::ShardSubAllocator : public SubAllocator {
+ public:
+  explicit ShardSubAllocator(ShardedBFCAllocator* parent) : parent_(parent) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes) override {
+    const int64 bytes = static_cast<int64>(num_bytes);
+    if (parent_->region_bytes_.fetch_add(bytes) + bytes >
+        parent_->memory_limit_) {
+      parent_->region_bytes_ -= bytes;
+      return nullptr;
+    }
+    void* ptr = parent_->sub_allocator_->Alloc(alignment, num_bytes);
+    if (ptr == nullptr) parent_->region_bytes_ -= bytes;
+    return ptr;
+  }
+
+  void Free(void* ptr, size_t num_bytes) override {
+    parent_->sub_allocator_->Free(ptr, num_bytes);
+    parent_->region_bytes_ -= static_cast<int64>(num_bytes);
+  }
+
+ private:
+  ShardedBFCAllocator* const parent_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ShardSubAllocator);
+};
+
+ShardedBFCAllocator::ShardedBFCAllocator(SubAllocator* sub_allocator,
+                                         size_t total_memory,
+                                         bool allow_growth, const string& name,
+                                         int num_shards)
+    : name_(name),
+      sub_allocator_(sub_allocator),
+      region_bytes_(0),
+      memory_limit_(static_cast<int64>(total_memory)),
+      regions_(nullptr),
+      bytes_in_use_(0),
+      max_bytes_in_use_(0) {
+  CHECK_GT(num_shards, 0);
+  {
+    mutex_lock l(regions_mu_);
+    region_versions_.emplace_back(new RegionVector);
+    regions_ = region_versions_.back().get();
+  }
+  // Without growth, each shard starts with its share of the memory in
+  // a single region, which is all it can use.
+  const size_t shard_memory =
+      allow_growth ? total_memory : total_memory / num_shards;
+  for (int i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(new BFCAllocator(new ShardSubAllocator(this),
+                                          shard_memory, allow_growth,
+                                          strings::StrCat(name, "_", i)));
+    shards_.back()->AddAllocVisitor([this, i](void* ptr, size_t num_bytes) {
+      AddRegion(i, ptr, num_bytes);
+    });
+  }
+}
+
+ShardedBFCAllocator::~ShardedBFCAllocator() {
+  // The shards return their regions to "sub_allocator_".
+  shards_.clear();
+}
+
+int ShardedBFCAllocator::ThreadShard() const {
+  static std::atomic<int> next_thread_index(0);
+  static thread_local int thread_index = next_thread_index++;
+  return thread_index % shards_.size();
+}
+
+void ShardedBFCAllocator::AddRegion(int shard, void* ptr, size_t num_bytes) {
+  Region region;
+  region.begin = static_cast<const char*>(ptr);
+  region.end = region.begin + num_bytes;
+  region.shard = shard;
+  mutex_lock l(regions_mu_);
+  RegionVector* regions = new RegionVector(*regions_.load());
+  auto it = std::upper_bound(regions->begin(), regions->end(), region,
+                             [](const Region& a, const Region& b) {
+                               return a.begin < b.begin;
+                             });
+  regions->insert(it, region);
+  region_versions_.emplace_back(regions);
+  regions_.store(regions, std::memory_order_release);
+}
+
+int ShardedBFCAllocator::ShardFor(const void* ptr) const {
+  const RegionVector* regions = regions_.load(std::memory_order_acquire);
+  const char* p = static_cast<const char*>(ptr);
+  auto it = std::upper_bound(
+      regions->begin(), regions->end(), p,
+      [](const char* p, const Region& region) { return p < region.end; });
+  CHECK(it != regions->end() && it->begin <= p)
+      << "Could not find the shard for " << ptr;
+  return it->shard;
+}
+
+void ShardedBFCAllocator::UpdateBytesInUse(int64 delta) {
+  const int64 bytes_in_use = bytes_in_use_.fetch_add(delta) + delta;
+  if (delta <= 0) return;
+  int64 max_bytes_in_use = max_bytes_in_use_.load();
+  while (bytes_in_use > max_bytes_in_use &&
+         !max_bytes_in_use_.compare_exchange_weak(max_bytes_in_use,
+                                                  bytes_in_use)) {
+  }
+}
+
+void* ShardedBFCAllocator::TryAllocate(size_t alignment, size_t num_bytes,
+                                       bool dump_log_on_failure) {
+  const int n = shards_.size();
+  const int start = ThreadShard();
+  for (int i = 0; i < n; ++i) {
+    const int s = (start + i) % n;
+    size_t allocated_bytes = 0;
+    void* ptr = shards_[s]->AllocateRawInternal(
+        alignment, num_bytes, dump_log_on_failure && s == start,
+        &allocated_bytes);
+    if (ptr != nullptr) {
+      UpdateBytesInUse(allocated_bytes);
+      return ptr;
+    }
+  }
+  return nullptr;
+}
+
+void* ShardedBFCAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  if (num_bytes == 0) {
+    LOG(ERROR) << "tried to allocate 0 bytes";
+    return nullptr;
+  }
+  // Fast path: Try once to allocate without getting the retry_helper_ involved
+  void* r = TryAllocate(alignment, num_bytes, false);
+  if (r != nullptr) {
+    return r;
+  } else {
+    static const int64 kMaxMillisToWait = 10000;  // 10 seconds
+    return retry_helper_.AllocateRaw(
+        [this](size_t a, size_t nb, bool v) { return TryAllocate(a, nb, v); },
+        kMaxMillisToWait, alignment, num_bytes);
+  }
+}
+
+void* ShardedBFCAllocator::AllocateRaw(
+    size_t alignment, size_t num_bytes,
+    const AllocationAttributes& allocation_attr) {
+  if (allocation_attr.no_retry_on_failure) {
+    if (num_bytes == 0) {
+      LOG(ERROR) << "tried to allocate 0 bytes";
+      return nullptr;
+    }
+    void* result = TryAllocate(alignment, num_bytes, false);
+    if (result == nullptr) {
+      // The counter incrementing is not thread-safe, as in BFCAllocator.
+      static int log_counter = 0;
+      if (log_counter < 10) {
+        log_counter++;
+        LOG(WARNING)
+            << "Ran out of memory trying to allocate "
+            << strings::HumanReadableNumBytes(num_bytes)
+            << ". The caller indicates that this is not a failure, but"
+            << " may mean that there could be performance gains if more"
+            << " memory is available.";
+      }
+    }
+    return result;
+  } else {
+    return AllocateRaw(alignment, num_bytes);
+  }
+}
+
+void ShardedBFCAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) {
+    LOG(ERROR) << "tried to deallocate nullptr";
+    return;
+  }
+  const size_t freed_bytes =
+      shards_[ShardFor(ptr)]->DeallocateRawInternal(ptr);
+  UpdateBytesInUse(-static_cast<int64>(freed_bytes));
+  retry_helper_.NotifyDealloc();
+}
+
+void ShardedBFCAllocator::AddAllocVisitor(Visitor visitor) {
+  for (auto& shard : shards_) {
+    shard->AddAllocVisitor(visitor);
+  }
+}
+
+size_t ShardedBFCAllocator::RequestedSize(void* ptr) {
+  return shards_[ShardFor(ptr)]->RequestedSize(ptr);
+}
+
+size_t ShardedBFCAllocator::AllocatedSize(void* ptr) {
+  return shards_[ShardFor(ptr)]->AllocatedSize(ptr);
+}
+
+int64 ShardedBFCAllocator::AllocationId(void* ptr) {
+  // The shards number their allocations independently.
+  const int s = ShardFor(ptr);
+  const int64 id = shards_[s]->AllocationId(ptr);
+  return id < 0 ? id : id * shards_.size() + s;
+}
+
+void ShardedBFCAllocator::GetStats(AllocatorStats* stats) {
+  stats->Clear();
+  for (auto& shard : shards_) {
+    AllocatorStats shard_stats;
+    shard->GetStats(&shard_stats);
+    stats->num_allocs += shard_stats.num_allocs;
+    stats->max_alloc_size =
+        std::max(stats->max_alloc_size, shard_stats.max_alloc_size);
+  }
+  stats->bytes_in_use = bytes_in_use_.load();
+  stats->max_bytes_in_use = max_bytes_in_use_.load();
+  stats->bytes_limit = memory_limit_;
+}
+
+}  // namespace tensorflow
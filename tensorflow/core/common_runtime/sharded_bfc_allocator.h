@@ -0,0 +1,130 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_SHARDED_BFC_ALLOCATOR_H_
+#define TENSORFLOW_COMMON_RUNTIME_SHARDED_BFC_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/allocator_retry.h"
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+#include "tensorflow/core/common_runtime/visitable_allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A BFCAllocator split into "num_shards" independent BFCAllocators, each
+// with its own lock, bins and memory regions, for memory that many
+// threads allocate concurrently (e.g. host memory).
+//
+// Each thread allocates from a shard it is assigned to on its first
+// allocation, and falls back to the other shards when that one is out of
+// memory. Memory is returned to the shard that owns it, which is found
+// without locking from the address. The shards share the "total_memory"
+// budget, and their allocation ids, stats and visitors are combined so
+// that the allocator behaves like a single BFCAllocator.
+class ShardedBFCAllocator : public VisitableAllocator {
+ public:
+  // Takes ownership of sub_allocator.
+  ShardedBFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
+                      bool allow_growth, const string& name, int num_shards);
+  ~ShardedBFCAllocator() override;
+
+  string Name() override { return name_; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void* AllocateRaw(size_t alignment, size_t num_bytes,
+                    const AllocationAttributes& allocation_attr) override;
+  void DeallocateRaw(void* ptr) override;
+
+  void AddAllocVisitor(Visitor visitor) override;
+
+  // Does nothing, because memory is never freed.
+  void AddFreeVisitor(Visitor visitor) override {}
+
+  bool TracksAllocationSizes() override { return true; }
+
+  size_t RequestedSize(void* ptr) override;
+
+  size_t AllocatedSize(void* ptr) override;
+
+  int64 AllocationId(void* ptr) override;
+
+  void GetStats(AllocatorStats* stats) override;
+
+  int num_shards() const { return shards_.size(); }
+
+ private:
+  class ShardSubAllocator;
+
+  // A memory region of a shard.
+  struct Region {
+    const char* begin;
+    const char* end;
+    int shard;
+  };
+  typedef std::vector<Region> RegionVector;
+
+  // Returns the index of the shard of the calling thread. Threads are
+  // assigned shards round robin.
+  int ThreadShard() const;
+
+  // Tries to allocate from each shard, starting from that of the calling
+  // thread, without waiting for memory to be freed.
+  void* TryAllocate(size_t alignment, size_t num_bytes,
+                    bool dump_log_on_failure);
+
+  // Returns the index of the shard that owns "ptr".
+  int ShardFor(const void* ptr) const;
+
+  void AddRegion(int shard, void* ptr, size_t num_bytes);
+
+  void UpdateBytesInUse(int64 delta);
+
+  const string name_;
+  std::unique_ptr<SubAllocator> sub_allocator_;
+  std::vector<std::unique_ptr<BFCAllocator>> shards_;
+
+  // The total size of the regions of all the shards.
+  std::atomic<int64> region_bytes_;
+  const int64 memory_limit_;
+
+  // The regions of all the shards, sorted by address. The vector is
+  // replaced, not modified, when a region is added, so that it can be
+  // read without locking.
+  std::atomic<const RegionVector*> regions_;
+  mutex regions_mu_;
+  // All the versions of "regions_", which are kept until destruction
+  // because readers may still be using them.
+  std::vector<std::unique_ptr<RegionVector>> region_versions_
+      GUARDED_BY(regions_mu_);
+
+  // The combined bytes in use, and its peak.
+  std::atomic<int64> bytes_in_use_;
+  std::atomic<int64> max_bytes_in_use_;
+
+  AllocatorRetry retry_helper_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ShardedBFCAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_SHARDED_BFC_ALLOCATOR_H_
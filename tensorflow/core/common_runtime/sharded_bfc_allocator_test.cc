@@ -0,0 +1,197 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/sharded_bfc_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <vector>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class HostSubAllocator : public SubAllocator {
+ public:
+  void* Alloc(size_t alignment, size_t num_bytes) override {
+    return port::aligned_malloc(num_bytes, alignment);
+  }
+  void Free(void* ptr, size_t num_bytes) override { port::aligned_free(ptr); }
+};
+
+static void CheckStats(Allocator* a, int64 num_allocs, int64 bytes_in_use,
+                       int64 max_bytes_in_use, int64 max_alloc_size) {
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, bytes_in_use);
+  EXPECT_EQ(stats.max_bytes_in_use, max_bytes_in_use);
+  EXPECT_EQ(stats.num_allocs, num_allocs);
+  EXPECT_EQ(stats.max_alloc_size, max_alloc_size);
+}
+
+TEST(ShardedBFCAllocatorTest, NoDups) {
+  ShardedBFCAllocator a(new HostSubAllocator, 1 << 30, true, "test", 4);
+  CheckStats(&a, 0, 0, 0, 0);
+
+  std::vector<void*> ptrs;
+  for (int s = 1; s < 1024; s++) {
+    void* raw = a.AllocateRaw(1, s);
+    ptrs.push_back(raw);
+  }
+  CheckStats(&a, 1023, 654336, 654336, 1024);
+
+  std::sort(ptrs.begin(), ptrs.end());
+  std::set<int64> ids;
+  for (size_t i = 1; i < ptrs.size(); i++) {
+    ASSERT_NE(ptrs[i], ptrs[i - 1]);
+    size_t req_size = a.RequestedSize(ptrs[i - 1]);
+    ASSERT_GT(req_size, 0);
+    ASSERT_LE(req_size, a.AllocatedSize(ptrs[i - 1]));
+    ASSERT_GE(static_cast<char*>(ptrs[i]) - static_cast<char*>(ptrs[i - 1]),
+              req_size);
+    EXPECT_TRUE(ids.insert(a.AllocationId(ptrs[i])).second);
+  }
+
+  for (size_t i = 0; i < ptrs.size(); i++) {
+    a.DeallocateRaw(ptrs[i]);
+  }
+  CheckStats(&a, 1023, 0, 654336, 1024);
+}
+
+TEST(ShardedBFCAllocatorTest, ThreadsSpreadOverShards) {
+  ShardedBFCAllocator a(new HostSubAllocator, 1 << 30, true, "test", 4);
+  std::atomic<int64> region_bytes(0);
+  a.AddAllocVisitor([&region_bytes](void* ptr, size_t num_bytes) {
+    region_bytes += num_bytes;
+  });
+  EXPECT_EQ(0, region_bytes);
+  BlockingCounter counter(4);
+  {
+    // Each thread gets its own shard, which allocates its own region.
+    thread::ThreadPool pool(Env::Default(), "test", 4);
+    for (int i = 0; i < 4; ++i) {
+      pool.Schedule([&a, &counter]() {
+        a.DeallocateRaw(a.AllocateRaw(1, 1024));
+        counter.DecrementCount();
+        counter.Wait();
+      });
+    }
+  }
+  EXPECT_EQ(4 << 20, region_bytes);
+}
+
+TEST(ShardedBFCAllocatorTest, SharedMemoryLimit) {
+  ShardedBFCAllocator a(new HostSubAllocator, 1 << 20, true, "test", 4);
+  AllocationAttributes attr;
+  attr.no_retry_on_failure = true;
+  // The whole budget goes to the first region, and can only be
+  // allocated once.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 16; ++i) {
+    void* p = a.AllocateRaw(1, 64 << 10, attr);
+    ASSERT_NE(nullptr, p);
+    ptrs.push_back(p);
+  }
+  EXPECT_EQ(nullptr, a.AllocateRaw(1, 1024, attr));
+  for (void* p : ptrs) {
+    a.DeallocateRaw(p);
+  }
+  EXPECT_NE(nullptr, ptrs[0] = a.AllocateRaw(1, 1024, attr));
+  a.DeallocateRaw(ptrs[0]);
+}
+
+TEST(ShardedBFCAllocatorTest, CrossThreadDeallocation) {
+  ShardedBFCAllocator a(new HostSubAllocator, 1 << 30, true, "test", 4);
+  const int kThreads = 8;
+  const int kAllocs = 1000;
+  std::vector<std::vector<void*>> ptrs(kThreads);
+  BlockingCounter allocated(kThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kThreads);
+    for (int i = 0; i < kThreads; ++i) {
+      pool.Schedule([&a, &ptrs, &allocated, i]() {
+        for (int j = 0; j < kAllocs; ++j) {
+          void* p = a.AllocateRaw(1, 16 + (i * 7 + j) % 4096);
+          memset(p, i, 16);
+          ptrs[i].push_back(p);
+        }
+        allocated.DecrementCount();
+        allocated.Wait();
+        // Frees the allocations of another thread.
+        for (void* p : ptrs[(i + 1) % kThreads]) {
+          CHECK_EQ((i + 1) % kThreads, static_cast<char*>(p)[15]);
+          a.DeallocateRaw(p);
+        }
+      });
+    }
+  }
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(kThreads * kAllocs, stats.num_allocs);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_GT(stats.max_bytes_in_use, 0);
+}
+
+static void BM_Allocation(int iters, int num_threads, int num_shards) {
+  testing::StopTiming();
+  BlockingCounter counter(num_threads);
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  const int per_thread = iters / num_threads + 1;
+  testing::ItemsProcessed(static_cast<int64>(per_thread) * num_threads);
+  std::unique_ptr<VisitableAllocator> a;
+  if (num_shards == 0) {
+    a.reset(new BFCAllocator(new HostSubAllocator, 1LL << 32, true, "bfc"));
+  } else {
+    a.reset(new ShardedBFCAllocator(new HostSubAllocator, 1LL << 32, true,
+                                    "sharded_bfc", num_shards));
+  }
+  testing::StartTiming();
+  for (int i = 0; i < num_threads; ++i) {
+    pool.Schedule([&a, per_thread, &counter]() {
+      std::vector<void*> live;
+      for (int j = 0; j < per_thread; ++j) {
+        live.push_back(a->AllocateRaw(1, 256 + (j % 64) * 256));
+        if (live.size() == 8) {
+          for (void* p : live) a->DeallocateRaw(p);
+          live.clear();
+        }
+      }
+      for (void* p : live) a->DeallocateRaw(p);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  testing::StopTiming();
+}
+
+static void BM_BFCAllocator(int iters, int num_threads) {
+  BM_Allocation(iters, num_threads, 0);
+}
+BENCHMARK(BM_BFCAllocator)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_ShardedBFCAllocator(int iters, int num_threads) {
+  BM_Allocation(iters, num_threads, 8);
+}
+BENCHMARK(BM_ShardedBFCAllocator)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,162 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+struct StepArenaAllocator::Block {
+  char* data = nullptr;
+  char* limit = nullptr;
+
+  // One reference while the block is the one allocations are carved
+  // out of, plus one for each live allocation in the block.
+  std::atomic<int64> refs{1};
+};
+
+namespace {
+
+// Stored immediately before every pointer returned by AllocateRaw.
+// "block" is nullptr if the memory came from the base allocator, in
+// which case "base_ptr" is the pointer to return to it.
+struct Header {
+  void* block;
+  void* base_ptr;
+};
+
+size_t HeaderAlignment(size_t alignment) {
+  size_t a = std::max(alignment, Allocator::kAllocatorAlignment);
+  while (a < sizeof(Header)) a <<= 1;
+  return a;
+}
+
+char* AlignUp(char* p, size_t alignment) {
+  const uintptr_t v = reinterpret_cast<uintptr_t>(p);
+  return reinterpret_cast<char*>((v + alignment - 1) & ~(alignment - 1));
+}
+
+Header* GetHeader(void* ptr) { return static_cast<Header*>(ptr) - 1; }
+
+}  // namespace
+
+StepArenaAllocator::StepArenaAllocator(Allocator* base, size_t block_size,
+                                       int64 max_bytes)
+    : base_(base), block_size_(block_size), max_bytes_(max_bytes), refs_(1) {}
+
+StepArenaAllocator::~StepArenaAllocator() { DCHECK(current_ == nullptr); }
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  alignment = HeaderAlignment(alignment);
+  if (num_bytes + alignment > block_size_ / 4) {
+    return AllocateFromBase(alignment, num_bytes);
+  }
+  Block* retired = nullptr;
+  char* ptr = nullptr;
+  {
+    mutex_lock l(mu_);
+    DCHECK(!released_);
+    if (current_ != nullptr) {
+      ptr = AlignUp(next_ + sizeof(Header), alignment);
+      if (ptr + num_bytes > current_->limit) {
+        retired = current_;
+        current_ = nullptr;
+        ptr = nullptr;
+      }
+    }
+    if (current_ == nullptr &&
+        (max_bytes_ == 0 ||
+         bytes_in_blocks_ + static_cast<int64>(block_size_) <= max_bytes_)) {
+      char* data = static_cast<char*>(
+          base_->AllocateRaw(Allocator::kAllocatorAlignment, block_size_));
+      if (data != nullptr) {
+        current_ = new Block;
+        current_->data = data;
+        current_->limit = data + block_size_;
+        bytes_in_blocks_ += block_size_;
+        refs_.fetch_add(1, std::memory_order_relaxed);
+        ptr = AlignUp(data + sizeof(Header), alignment);
+      }
+    }
+    if (ptr != nullptr) {
+      current_->refs.fetch_add(1, std::memory_order_relaxed);
+      next_ = ptr + num_bytes;
+      Header* header = GetHeader(ptr);
+      header->block = current_;
+      header->base_ptr = nullptr;
+    }
+  }
+  if (retired != nullptr) UnrefBlock(retired);
+  if (ptr == nullptr) return AllocateFromBase(alignment, num_bytes);
+  return ptr;
+}
+
+void* StepArenaAllocator::AllocateFromBase(size_t alignment, size_t num_bytes) {
+  // The header takes up the "alignment" bytes in front of the tensor.
+  char* base_ptr =
+      static_cast<char*>(base_->AllocateRaw(alignment, num_bytes + alignment));
+  if (base_ptr == nullptr) return nullptr;
+  refs_.fetch_add(1, std::memory_order_relaxed);
+  char* ptr = base_ptr + alignment;
+  Header* header = GetHeader(ptr);
+  header->block = nullptr;
+  header->base_ptr = base_ptr;
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  Header* header = GetHeader(ptr);
+  if (header->block == nullptr) {
+    base_->DeallocateRaw(header->base_ptr);
+    Unref();
+  } else {
+    UnrefBlock(static_cast<Block*>(header->block));
+  }
+}
+
+void StepArenaAllocator::Release() {
+  Block* block;
+  {
+    mutex_lock l(mu_);
+    DCHECK(!released_);
+    released_ = true;
+    block = current_;
+    current_ = nullptr;
+  }
+  if (block != nullptr) UnrefBlock(block);
+  Unref();
+}
+
+int64 StepArenaAllocator::bytes_in_blocks() {
+  mutex_lock l(mu_);
+  return bytes_in_blocks_;
+}
+
+void StepArenaAllocator::UnrefBlock(Block* block) {
+  if (block->refs.fetch_sub(1) == 1) {
+    base_->DeallocateRaw(block->data);
+    delete block;
+    Unref();
+  }
+}
+
+void StepArenaAllocator::Unref() {
+  if (refs_.fetch_sub(1) == 1) delete this;
+}
+
+}  // namespace tensorflow
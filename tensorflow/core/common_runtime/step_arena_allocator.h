@@ -0,0 +1,93 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <string>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// An allocator for the tensors of a single step that carves them out of
+// large blocks obtained from a base allocator, so that allocating a
+// tensor is a pointer bump instead of a call to the base allocator.
+// Memory is not reused within the step: a block is returned to the base
+// allocator once the step has ended (Release() was called) and all the
+// tensors carved out of it have been deallocated. A tensor that outlives
+// the step therefore keeps only its own block alive.
+//
+// Allocations larger than a quarter of a block, and all allocations
+// after "max_bytes" worth of blocks have been obtained, are passed
+// through to the base allocator.
+//
+// The allocator deletes itself once it has been released and all its
+// allocations have been deallocated.
+class StepArenaAllocator : public Allocator {
+ public:
+  // The default size of the blocks obtained from the base allocator.
+  static const size_t kDefaultBlockSize = 1 << 20;
+
+  // Does not take ownership of "base", which must outlive this allocator.
+  // "max_bytes" 0 means no limit.
+  StepArenaAllocator(Allocator* base, size_t block_size, int64 max_bytes);
+
+  string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+
+  // Marks the end of the step. The allocator must not be used to
+  // allocate memory afterwards.
+  void Release();
+
+  // The number of bytes in the blocks obtained from the base allocator
+  // so far.
+  int64 bytes_in_blocks();
+
+ private:
+  struct Block;
+
+  ~StepArenaAllocator() override;
+
+  void* AllocateFromBase(size_t alignment, size_t num_bytes);
+  void UnrefBlock(Block* block);
+  void Unref();
+
+  Allocator* const base_;  // Not owned.
+  const size_t block_size_;
+  const int64 max_bytes_;
+
+  // One reference for the step, plus one for each block and each
+  // allocation passed through to the base allocator that is live.
+  std::atomic<int64> refs_;
+
+  mutex mu_;
+  Block* current_ GUARDED_BY(mu_) = nullptr;
+  char* next_ GUARDED_BY(mu_) = nullptr;
+  int64 bytes_in_blocks_ GUARDED_BY(mu_) = 0;
+  bool released_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
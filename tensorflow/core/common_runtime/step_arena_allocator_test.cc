@@ -0,0 +1,226 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the live allocations made by the allocator under test.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    mutex_lock l(mu_);
+    ++num_allocations_;
+    ++num_live_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    {
+      mutex_lock l(mu_);
+      --num_live_;
+    }
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() {
+    mutex_lock l(mu_);
+    return num_allocations_;
+  }
+  int num_live() {
+    mutex_lock l(mu_);
+    return num_live_;
+  }
+
+ private:
+  mutex mu_;
+  int num_allocations_ GUARDED_BY(mu_) = 0;
+  int num_live_ GUARDED_BY(mu_) = 0;
+};
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+TEST(StepArenaAllocatorTest, SmallAllocationsShareBlocks) {
+  CountingAllocator base;
+  StepArenaAllocator* a = new StepArenaAllocator(&base, 4096, 0);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 16; ++i) {
+    void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 40);
+    ASSERT_NE(nullptr, p);
+    EXPECT_TRUE(IsAligned(p, Allocator::kAllocatorAlignment));
+    memset(p, i, 40);
+    ptrs.push_back(p);
+  }
+  EXPECT_EQ(1, base.num_allocations());
+  EXPECT_EQ(4096, a->bytes_in_blocks());
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(i, static_cast<char*>(ptrs[i])[39]);
+    a->DeallocateRaw(ptrs[i]);
+  }
+  // The block is kept until the end of the step.
+  EXPECT_EQ(1, base.num_live());
+  a->Release();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(StepArenaAllocatorTest, LargeAlignment) {
+  CountingAllocator base;
+  StepArenaAllocator* a = new StepArenaAllocator(&base, 4096, 0);
+  void* p1 = a->AllocateRaw(4, 3);
+  void* p2 = a->AllocateRaw(256, 100);
+  EXPECT_TRUE(IsAligned(p2, 256));
+  void* p3 = a->AllocateRaw(256, 4000);  // From the base allocator.
+  EXPECT_TRUE(IsAligned(p3, 256));
+  a->DeallocateRaw(p1);
+  a->DeallocateRaw(p2);
+  a->DeallocateRaw(p3);
+  a->Release();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(StepArenaAllocatorTest, AllocationsOutliveStep) {
+  CountingAllocator base;
+  StepArenaAllocator* a = new StepArenaAllocator(&base, 4096, 0);
+  void* small = a->AllocateRaw(Allocator::kAllocatorAlignment, 900);
+  void* large = a->AllocateRaw(Allocator::kAllocatorAlignment, 2000);
+  // Fills the first block, so that "next" starts a new one.
+  std::vector<void*> fill;
+  for (int i = 0; i < 3; ++i) {
+    fill.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 900));
+  }
+  void* next = a->AllocateRaw(Allocator::kAllocatorAlignment, 900);
+  for (void* p : fill) {
+    a->DeallocateRaw(p);
+  }
+  EXPECT_EQ(8192, a->bytes_in_blocks());
+  a->Release();
+  // Each of the remaining allocations keeps its own memory alive.
+  EXPECT_EQ(3, base.num_live());
+  a->DeallocateRaw(small);
+  EXPECT_EQ(2, base.num_live());
+  a->DeallocateRaw(next);
+  EXPECT_EQ(1, base.num_live());
+  a->DeallocateRaw(large);
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(StepArenaAllocatorTest, MaxBytes) {
+  CountingAllocator base;
+  StepArenaAllocator* a = new StepArenaAllocator(&base, 4096, 4096);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 32; ++i) {
+    ptrs.push_back(a->AllocateRaw(Allocator::kAllocatorAlignment, 200));
+  }
+  EXPECT_EQ(4096, a->bytes_in_blocks());
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  a->Release();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(StepArenaAllocatorTest, Tensors) {
+  CountingAllocator base;
+  StepArenaAllocator* a = new StepArenaAllocator(&base, 1 << 16, 0);
+  Tensor t(a, DT_FLOAT, TensorShape({4, 8}));
+  t.flat<float>().setConstant(1.0f);
+  Tensor strings(a, DT_STRING, TensorShape({4}));
+  strings.flat<string>()(3) = "a string that is too long to be inlined";
+  a->Release();
+  // Both tensors outlive the step.
+  EXPECT_EQ(1, base.num_live());
+  EXPECT_EQ(1.0f, t.flat<float>()(31));
+  t = Tensor();
+  strings = Tensor();
+  EXPECT_EQ(0, base.num_live());
+}
+
+TEST(StepArenaAllocatorTest, Concurrent) {
+  CountingAllocator base;
+  StepArenaAllocator* a = new StepArenaAllocator(&base, 4096, 0);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 8);
+    for (int i = 0; i < 8; ++i) {
+      pool.Schedule([a, i]() {
+        std::vector<void*> ptrs;
+        for (int j = 0; j < 1000; ++j) {
+          void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 16 + j % 64);
+          memset(p, i, 16);
+          ptrs.push_back(p);
+          if (j % 3 == 0) {
+            a->DeallocateRaw(ptrs.back());
+            ptrs.pop_back();
+          }
+        }
+        for (void* p : ptrs) {
+          CHECK_EQ(i, static_cast<char*>(p)[15]);
+          a->DeallocateRaw(p);
+        }
+      });
+    }
+  }
+  a->Release();
+  EXPECT_EQ(0, base.num_live());
+}
+
+static void BM_Allocation(int iters, int num_threads, bool use_arena) {
+  testing::StopTiming();
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  const int per_thread = iters / num_threads + 1;
+  testing::ItemsProcessed(static_cast<int64>(per_thread) * num_threads);
+  StepArenaAllocator* arena = new StepArenaAllocator(
+      cpu_allocator(), StepArenaAllocator::kDefaultBlockSize, 0);
+  Allocator* a = use_arena ? arena : cpu_allocator();
+  BlockingCounter counter(num_threads);
+  testing::StartTiming();
+  for (int i = 0; i < num_threads; ++i) {
+    pool.Schedule([a, per_thread, &counter]() {
+      for (int j = 0; j < per_thread; ++j) {
+        a->DeallocateRaw(
+            a->AllocateRaw(Allocator::kAllocatorAlignment, 64 + j % 1024));
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  testing::StopTiming();
+  arena->Release();
+}
+
+static void BM_CPUAllocator(int iters, int num_threads) {
+  BM_Allocation(iters, num_threads, false);
+}
+BENCHMARK(BM_CPUAllocator)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_StepArenaAllocator(int iters, int num_threads) {
+  BM_Allocation(iters, num_threads, true);
+}
+BENCHMARK(BM_StepArenaAllocator)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
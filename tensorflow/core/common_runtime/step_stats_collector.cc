@@ -53,25 +53,34 @@ void StepStatsCollector::Save(const string& device, NodeExecStats* nt) {
       delete nt;
       return;
     }
-    DeviceStepStats* dss = nullptr;
-    // Slow linear scan, but it should only be called
-    // by a Worker in a context with < ~10 devices.
-    // TODO(tucker): consider adding a std::unordered_map.
-    for (auto& ds : *step_stats_->mutable_dev_stats()) {
-      if (ds.device() == device) {
-        dss = &ds;
-        break;
-      }
-    }
-    if (dss == nullptr) {
-      dss = step_stats_->add_dev_stats();
-      dss->set_device(device);
-    }
-    nt->Swap(dss->add_node_stats());
+    nt->Swap(FindOrAddDeviceStats(device)->add_node_stats());
   }
   delete nt;
 }
 
+void StepStatsCollector::AddRemoteRecvBytes(const string& device,
+                                            int64 bytes) {
+  mutex_lock l(mu_);
+  if (!step_stats_) return;
+  DeviceStepStats* dss = FindOrAddDeviceStats(device);
+  dss->set_remote_recv_bytes(dss->remote_recv_bytes() + bytes);
+}
+
+DeviceStepStats* StepStatsCollector::FindOrAddDeviceStats(
+    const string& device) {
+  // Slow linear scan, but it should only be called
+  // by a Worker in a context with < ~10 devices.
+  // TODO(tucker): consider adding a std::unordered_map.
+  for (auto& ds : *step_stats_->mutable_dev_stats()) {
+    if (ds.device() == device) {
+      return &ds;
+    }
+  }
+  DeviceStepStats* dss = step_stats_->add_dev_stats();
+  dss->set_device(device);
+  return dss;
+}
+
 void StepStatsCollector::Swap(StepStats* ss) {
   mutex_lock l(mu_);
   CHECK(step_stats_);
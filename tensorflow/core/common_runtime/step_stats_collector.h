@@ -24,6 +24,7 @@ limitations under the License.
 namespace tensorflow {
 
 class CostModel;
+class DeviceStepStats;
 class Graph;
 class Node;
 class NodeExecStats;
@@ -39,9 +40,16 @@ class StepStatsCollector {
 
   void Save(const string& device, NodeExecStats* nt);
 
+  // Adds "bytes" to the number of tensor bytes that "device" received
+  // from other tasks during the step.
+  void AddRemoteRecvBytes(const string& device, int64 bytes);
+
   void Swap(StepStats* ss);
 
  private:
+  DeviceStepStats* FindOrAddDeviceStats(const string& device)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   mutex mu_;
   StepStats* step_stats_ GUARDED_BY(mu_);
   CostModelManager* cost_model_manager_ GUARDED_BY(mu_);
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/graph/types.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/public/session_options.h"
@@ -32,10 +33,14 @@ namespace tensorflow {
 ThreadPoolDevice::ThreadPoolDevice(const SessionOptions& options,
                                    const string& name, Bytes memory_limit,
                                    BusAdjacency bus_adjacency,
-                                   Allocator* allocator)
-    : LocalDevice(options, Device::BuildDeviceAttributes(
-                               name, DEVICE_CPU, memory_limit, bus_adjacency),
-                  allocator),
+                                   Allocator* allocator, int numa_node)
+    : LocalDevice(options,
+                  Device::BuildDeviceAttributes(
+                      name, DEVICE_CPU, memory_limit, bus_adjacency,
+                      numa_node == port::kNUMANoAffinity
+                          ? ""
+                          : strings::StrCat("numa_node: ", numa_node)),
+                  allocator, numa_node),
       allocator_(allocator) {}
 
 ThreadPoolDevice::~ThreadPoolDevice() {}
@@ -24,9 +24,13 @@ namespace tensorflow {
 // CPU device implementation.
 class ThreadPoolDevice : public LocalDevice {
  public:
+  // If "numa_node" is given, the kernels of the device run on threads
+  // bound to the CPUs of that NUMA node, and "allocator" should allocate
+  // from the memory of that node.
   ThreadPoolDevice(const SessionOptions& options, const string& name,
                    Bytes memory_limit, BusAdjacency bus_adjacency,
-                   Allocator* allocator);
+                   Allocator* allocator,
+                   int numa_node = port::kNUMANoAffinity);
   ~ThreadPoolDevice() override;
 
   void Compute(OpKernel* op_kernel, OpKernelContext* context) override;
@@ -17,28 +17,80 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/threadpool_device.h"
 
 #include <vector>
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
 
+namespace {
+
+// Allocates the regions of a BFCAllocator from the memory of a NUMA node.
+class NUMASubAllocator : public SubAllocator {
+ public:
+  explicit NUMASubAllocator(int numa_node) : numa_node_(numa_node) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes) override {
+    return port::NUMAMalloc(numa_node_, num_bytes, alignment);
+  }
+  void Free(void* ptr, size_t num_bytes) override {
+    port::NUMAFree(ptr, num_bytes);
+  }
+
+ private:
+  const int numa_node_;
+};
+
+// Returns the process-wide allocator of the memory of "numa_node".
+Allocator* NUMACPUAllocator(int numa_node) {
+  // The allocators grow on demand, so the limit is that of the host
+  // rather than theirs.
+  static const size_t kMaxBytes = 1ULL << 40;
+  static mutex mu;
+  static std::vector<Allocator*>* allocators = new std::vector<Allocator*>;
+  mutex_lock l(mu);
+  if (allocators->size() <= static_cast<size_t>(numa_node)) {
+    allocators->resize(numa_node + 1, nullptr);
+  }
+  Allocator*& a = (*allocators)[numa_node];
+  if (a == nullptr) {
+    a = new BFCAllocator(new NUMASubAllocator(numa_node), kMaxBytes, true,
+                         strings::StrCat("numa_", numa_node, "_cpu"));
+  }
+  return a;
+}
+
+}  // namespace
+
 // TODO(zhifengc/tucker): Figure out the bytes of available RAM.
 class ThreadPoolDeviceFactory : public DeviceFactory {
  public:
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<Device*>* devices) override {
-    // TODO(zhifengc/tucker): Figure out the number of available CPUs
-    // and/or NUMA configuration.
-    int n = 1;
+    // TODO(zhifengc/tucker): Figure out the number of available CPUs.
+    const bool use_numa = options.config.use_numa_affinity();
+    const int num_numa_nodes = use_numa ? port::NUMANumNodes() : 1;
+    int n = num_numa_nodes;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
       n = iter->second;
     }
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/cpu:", i);
-      devices->push_back(new ThreadPoolDevice(options, name, Bytes(256 << 20),
-                                              BUS_ANY, cpu_allocator()));
+      if (use_numa) {
+        const int numa_node = i % num_numa_nodes;
+        devices->push_back(new ThreadPoolDevice(
+            options, name, Bytes(256 << 20), BUS_ANY,
+            NUMACPUAllocator(numa_node), numa_node));
+      } else {
+        devices->push_back(new ThreadPoolDevice(
+            options, name, Bytes(256 << 20), BUS_ANY, cpu_allocator()));
+      }
     }
 
     return Status::OK();
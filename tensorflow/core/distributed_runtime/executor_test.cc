@@ -19,11 +19,13 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/executor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/graph/graph_constructor.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
@@ -67,6 +69,10 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
+    params.use_work_stealing = use_work_stealing_;
+    params.max_workers = max_workers_;
+    params.use_static_plan = use_static_plan_;
+    params.use_step_arena = use_step_arena_;
     delete exec_;
     TF_CHECK_OK(NewLocalExecutor(params, graph, &exec_));
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
@@ -82,6 +88,10 @@ class ExecutorTest : public ::testing::Test {
   }
 
   thread::ThreadPool* thread_pool_ = nullptr;
+  bool use_work_stealing_ = false;
+  int max_workers_ = 0;
+  bool use_static_plan_ = false;
+  bool use_step_arena_ = false;
   Device* device_ = nullptr;
   Executor* exec_ = nullptr;
   StepStatsCollector step_stats_collector_;
@@ -242,6 +252,103 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  use_work_stealing_ = true;
+  max_workers_ = 4;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildTree(4096, g);
+  Create(g);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
+TEST_F(ExecutorTest, RandomTreeStaticPlan) {
+  use_static_plan_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildTree(4096, g);
+  Create(g);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
+TEST_F(ExecutorTest, RandomTreeStepArena) {
+  use_step_arena_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildTree(4096, g);
+  Create(g);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0), false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  EXPECT_EQ(4096.0, V(out));
+}
+
+// Builds a chain of "n" additions of a 2x2 constant whose result is sent
+// as "b", with the memory of the intermediate sums planned.
+void BuildPlannedChain(int n, Graph* g) {
+  Tensor one(DT_FLOAT, TensorShape({2, 2}));
+  one.flat<float>().setConstant(1.0);
+  auto c = test::graph::Constant(g, one);
+  auto sum = c;
+  for (int i = 0; i < n; ++i) {
+    sum = test::graph::Add(g, sum, c);
+  }
+  test::graph::Send(g, sum, "b", BOB, kIncarnation, ALICE);
+  MemoryPlanStats stats;
+  TF_CHECK_OK(PlanMemory(g, 10000, &stats));
+  CHECK_EQ(n - 1, stats.num_planned_tensors);
+}
+
+TEST_F(ExecutorTest, MemoryPlan) {
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildPlannedChain(16, g);
+  Create(g);
+  // Runs several steps, which reuse the slab of the first one.
+  for (int step = 0; step < 3; ++step) {
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out;
+    bool is_dead = false;
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({17, 17, 17, 17}, {2, 2}), out);
+  }
+}
+
+TEST_F(ExecutorTest, MemoryPlanStaticPlan) {
+  use_static_plan_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildPlannedChain(16, g);
+  Create(g);
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out;
+  bool is_dead = false;
+  Rendezvous::Args args;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out, &is_dead));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({17, 17, 17, 17}, {2, 2}), out);
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -277,6 +384,62 @@ TEST_F(ExecutorTest, ConcurrentAddAssign) {
     rendez->Unref();
   }
 }
+
+TEST_F(ExecutorTest, ConcurrentAddAssignWorkStealing) {
+  use_work_stealing_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildConcurrentAddAssign(g);
+  Create(g);
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(Run(rendez));
+    Rendezvous::Args args;
+    Tensor out;
+    bool is_dead;
+    TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"), args, &out,
+                              &is_dead));
+    EXPECT_LE(V(out), 1025.0);
+    rendez->Unref();
+  }
+}
+
+TEST_F(ExecutorTest, ConcurrentAddAssignStepArena) {
+  // The Adds feed Assigns, so their outputs are not allocated from the
+  // step arena and the variable never refers to freed memory.
+  use_step_arena_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildConcurrentAddAssign(g);
+  Create(g);
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(Run(rendez));
+    Rendezvous::Args args;
+    Tensor out;
+    bool is_dead;
+    TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"), args, &out,
+                              &is_dead));
+    EXPECT_LE(V(out), 1025.0);
+    rendez->Unref();
+  }
+}
+
+TEST_F(ExecutorTest, ConcurrentAddAssignStaticPlan) {
+  use_static_plan_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildConcurrentAddAssign(g);
+  Create(g);
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    TF_ASSERT_OK(Run(rendez));
+    Rendezvous::Args args;
+    Tensor out;
+    bool is_dead;
+    TF_ASSERT_OK(rendez->Recv(Key(ALICE, kIncarnation, BOB, "out"), args, &out,
+                              &is_dead));
+    EXPECT_LE(V(out), 1025.0);
+    rendez->Unref();
+  }
+}
 #endif
 
 TEST_F(ExecutorTest, SimpleSwitchLive) {
@@ -316,6 +479,47 @@ TEST_F(ExecutorTest, SimpleSwitchDead) {
   EXPECT_TRUE(is_dead);
 }
 
+TEST_F(ExecutorTest, SimpleSwitchDeadStaticPlan) {
+  // Graphs with control flow do not use the static plan.
+  use_static_plan_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Constant(g, VB(true));
+  auto tmp = test::graph::Switch(g, in0, in1);
+  test::graph::Send(g, tmp, "c", BOB, 1, ALICE);
+  Create(g);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));  // in0 = 1.0
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_TRUE(is_dead);
+}
+
+TEST_F(ExecutorTest, DeadRecvStaticPlan) {
+  use_static_plan_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Recv(g, "b", "float", ALICE, 1, BOB);
+  auto tmp = test::graph::Add(g, in0, in1);
+  test::graph::Send(g, tmp, "c", BOB, 1, ALICE);
+  Create(g);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "b"), args, V(2.0),
+                             true));  // "b" is dead.
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_TRUE(is_dead);
+}
+
 TEST_F(ExecutorTest, Abort) {
   // e = a + b + c + d
   Graph* g = new Graph(OpRegistry::Global());
@@ -394,6 +598,28 @@ TEST_F(ExecutorTest, RecvInvalidDtype) {
   rendez->Unref();
 }
 
+TEST_F(ExecutorTest, RecvInvalidDtypeStaticPlan) {
+  use_static_plan_ = true;
+  Graph* g = new Graph(OpRegistry::Global());
+  auto one = test::graph::Recv(g, "one", "float", ALICE, 1, BOB);
+  auto var = test::graph::Var(g, DT_FLOAT, TensorShape({1}));
+  auto init = test::graph::Assign(g, var, one);
+  auto* two = test::graph::Send(g, var, "two", BOB, 1, ALICE);
+  g->AddControlEdge(init, two);  // Ensures run after init.
+  Create(g);
+  Rendezvous* rendez = NewLocalRendezvous();
+  // Send a double instead of float.
+  TF_ASSERT_OK(rendez->Send(Key(ALICE, 1, BOB, "one"), Rendezvous::Args(),
+                            VD(1.0), false));
+  // Fails due to invalid dtype, and the failure aborts the Send.
+  EXPECT_TRUE(errors::IsInternal(Run(rendez)));
+  Tensor output;
+  bool is_dead;
+  EXPECT_TRUE(errors::IsInternal(rendez->Recv(
+      Key(BOB, 1, ALICE, "two"), Rendezvous::Args(), &output, &is_dead)));
+  rendez->Unref();
+}
+
 TEST_F(ExecutorTest, RecvInvalidRefDtype) {
   Graph* g = new Graph(OpRegistry::Global());
   // A var that always produces as invalid dtype.
@@ -409,4 +635,70 @@ TEST_F(ExecutorTest, RecvInvalidRefDtype) {
   rendez->Unref();
 }
 
+// Builds "width" independent chains of "depth" scalar additions each.
+static void BuildChains(int width, int depth, Graph* g) {
+  auto one = test::graph::Constant(g, V(1.0));
+  for (int i = 0; i < width; ++i) {
+    Node* n = one;
+    for (int j = 0; j < depth; ++j) {
+      n = test::graph::Add(g, n, one);
+    }
+  }
+}
+
+static void BM_executor(int iters, int width, int depth,
+                        const ExecutorOptions& executor_options) {
+  Graph* g = new Graph(OpRegistry::Global());
+  BuildChains(width, depth, g);
+  SessionOptions options;
+  *options.config.mutable_graph_options()->mutable_executor_options() =
+      executor_options;
+  testing::ItemsProcessed(static_cast<int64>(iters) * width * depth);
+  test::Benchmark("cpu", g, &options).Run(iters);
+}
+
+static void BM_executor_Default(int iters, int width, int depth) {
+  ExecutorOptions executor_options;
+  executor_options.set_scheduler(ExecutorOptions::DEFAULT);
+  BM_executor(iters, width, depth, executor_options);
+}
+BENCHMARK(BM_executor_Default)
+    ->ArgPair(16, 1024)
+    ->ArgPair(32, 8192)
+    ->ArgPair(1024, 16)
+    ->ArgPair(8192, 32);
+
+static void BM_executor_WorkStealing(int iters, int width, int depth) {
+  ExecutorOptions executor_options;
+  executor_options.set_scheduler(ExecutorOptions::WORK_STEALING);
+  BM_executor(iters, width, depth, executor_options);
+}
+BENCHMARK(BM_executor_WorkStealing)
+    ->ArgPair(16, 1024)
+    ->ArgPair(32, 8192)
+    ->ArgPair(1024, 16)
+    ->ArgPair(8192, 32);
+
+static void BM_executor_StepArena(int iters, int width, int depth) {
+  ExecutorOptions executor_options;
+  executor_options.set_use_step_arena(true);
+  BM_executor(iters, width, depth, executor_options);
+}
+BENCHMARK(BM_executor_StepArena)
+    ->ArgPair(16, 1024)
+    ->ArgPair(32, 8192)
+    ->ArgPair(1024, 16)
+    ->ArgPair(8192, 32);
+
+static void BM_executor_StaticPlan(int iters, int width, int depth) {
+  ExecutorOptions executor_options;
+  executor_options.set_use_static_plan(true);
+  BM_executor(iters, width, depth, executor_options);
+}
+BENCHMARK(BM_executor_StaticPlan)
+    ->ArgPair(16, 1024)
+    ->ArgPair(32, 8192)
+    ->ArgPair(1024, 16)
+    ->ArgPair(8192, 32);
+
 }  // namespace tensorflow
@@ -136,6 +136,13 @@ Status GraphMgr::InitItem(const string& session, const GraphDef& gdef,
   }
 
   LocalExecutorParams params;
+  const ExecutorOptions& executor_opts = graph_options.executor_options();
+  params.use_work_stealing =
+      (executor_opts.scheduler() == ExecutorOptions::WORK_STEALING);
+  params.max_workers = executor_opts.max_workers();
+  params.use_static_plan = executor_opts.use_static_plan();
+  params.use_step_arena = executor_opts.use_step_arena();
+  params.step_arena_max_bytes = executor_opts.step_arena_max_bytes();
 
   Status s;
   item->units.reserve(partitions.size());
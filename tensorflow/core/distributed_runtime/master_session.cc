@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/master_session.h"
 
+#include <deque>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -34,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/random/random.h"
@@ -59,6 +62,8 @@ struct PerStepState {
   std::vector<StepStats> step_stats;  // per partition
 };
 
+class RunManyGraphs;
+
 // A session encapsulates a graph computation (resource allocation,
 // placement, execution, etc.).
 class MasterSession : public MasterSessionInterface {
@@ -223,10 +228,26 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
                        const RunStepRequest& req, RunStepResponse* resp,
                        CancellationManager* cm);
 
+  // Runs the steps "step_ids" of all partitions with the same feeds,
+  // keeping at most "max_steps_in_flight" of them executing at once,
+  // and returns the fetches of the final step. The steps are cleaned up
+  // on the workers in batches as they complete.
+  Status RunPartitionsPipelined(const MasterEnv* env,
+                                const std::vector<int64>& step_ids,
+                                int max_steps_in_flight, PerStepState* pss,
+                                CallOptions* opts, const RunStepRequest& req,
+                                RunStepResponse* resp,
+                                CancellationManager* cm);
+
   // Calls workers to cleanup states for the step "step_id".  Calls
   // `done` when all cleanup RPCs have completed.
   void CleanupPartitionsAsync(int64 step_id, StatusCallback done);
 
+  // Like above, but cleans up all of "step_ids" (which must not be
+  // empty) with one RPC per worker.
+  void CleanupPartitionsAsync(gtl::ArraySlice<int64> step_ids,
+                              StatusCallback done);
+
   // TODO(mrry): Runtime statistics collection.
 
  private:
@@ -290,6 +311,27 @@ class MasterSession::ReffedClientGraph : public core::RefCounted {
   // destructor and does not wait for the rpc completion.
   void DeregisterPartitions();
 
+  // Maps feed names to the tensors provided by the client.
+  typedef std::unordered_map<StringPiece, const TensorProto*,
+                             StringPiece::Hasher>
+      FeedIndex;
+
+  // Builds "*feeds" from the feeds of "req".
+  static Status BuildFeedIndex(const RunStepRequest& req, FeedIndex* feeds);
+
+  // Fills in "calls" with one RunGraph request per partition for step
+  // "step_id". The outputs are requested only if "fetch_outputs".
+  Status PrepareRunGraphCalls(const FeedIndex& feeds, int64 step_id,
+                              bool fetch_outputs, RunManyGraphs* calls);
+
+  // Issues the RunGraph requests in "calls" to the workers.
+  void IssueRunGraphCalls(RunManyGraphs* calls);
+
+  // Copies the fetched tensors and step stats of the completed "calls"
+  // into "resp" and "pss".
+  Status CollectFetches(RunManyGraphs* calls, PerStepState* pss,
+                        RunStepResponse* resp);
+
   TF_DISALLOW_COPY_AND_ASSIGN(ReffedClientGraph);
 };
 
@@ -325,6 +367,27 @@ static string SplitByWorker(const Node* node) {
   return task;
 }
 
+// Configures "popts" to encode the tensors sent between tasks as
+// requested by "transfer_opts". Every edge cut by SplitByWorker crosses
+// a task boundary.
+static void SetTransferCodecs(const TransferOptions& transfer_opts,
+                              PartitionOptions* popts) {
+  if (transfer_opts.float_encoding() != TransferOptions::FLOAT32) {
+    const DataType wire_dtype =
+        transfer_opts.float_encoding() == TransferOptions::BFLOAT16
+            ? DT_BFLOAT16
+            : DT_HALF;
+    popts->should_cast = [wire_dtype](const Edge* edge) {
+      if (edge->IsControlEdge()) return DT_FLOAT;
+      const DataType dtype = edge->dst()->input_type(edge->dst_input());
+      return dtype == DT_FLOAT ? wire_dtype : dtype;
+    };
+  }
+  if (transfer_opts.compress()) {
+    popts->should_compress = [](const Edge* edge) { return true; };
+  }
+}
+
 void MasterSession::ReffedClientGraph::TrackFeedsAndFetches(
     Part* part, const PartitionOptions& popts) {
   for (int i = 0; i < part->gdef.node_size(); ++i) {
@@ -422,6 +485,12 @@ Status MasterSession::ReffedClientGraph::DoRegisterPartitions(
   return s;
 }
 
+// Returns a new random step id. Keeps the highest 8 bits 0x01: we
+// reserve some bits of the step_id for future use.
+static int64 NewStepId() {
+  return (random::New64() & ((1uLL << 56) - 1)) | (1uLL << 56);
+}
+
 static bool CopyIfNeeded(TensorProto* in, TensorProto* out) {
   if (in->tensor_content().empty()) {
     // If the tensor is not encoded in tensor_content or contains 0
@@ -503,31 +572,24 @@ class RunManyGraphs {
   TF_DISALLOW_COPY_AND_ASSIGN(RunManyGraphs);
 };
 
-Status MasterSession::ReffedClientGraph::RunPartitions(
-    const MasterEnv* env, int64 step_id, int64 execution_count,
-    SimpleGraphExecutionState* execution_state, PerStepState* pss,
-    CallOptions* call_opts, const RunStepRequest& req, RunStepResponse* resp,
-    CancellationManager* cm) {
-  VLOG(2) << "RunPartitions step_id " << step_id << " execution_count "
-          << execution_count;
-  // Builds an index for feeds provided by the client.
-  std::unordered_map<StringPiece, const TensorProto*, StringPiece::Hasher>
-      feeds(3);
-
+Status MasterSession::ReffedClientGraph::BuildFeedIndex(
+    const RunStepRequest& req, FeedIndex* feeds) {
   for (const auto& feed : req.feed()) {
-    if (!feeds.insert({feed.name(), &feed.tensor()}).second) {
+    if (!feeds->insert({feed.name(), &feed.tensor()}).second) {
       return errors::InvalidArgument("Duplicated feeds: ", feed.name());
     }
   }
+  return Status::OK();
+}
 
-  // Prepares a number of calls to workers. One call per partition.
+Status MasterSession::ReffedClientGraph::PrepareRunGraphCalls(
+    const FeedIndex& feeds, int64 step_id, bool fetch_outputs,
+    RunManyGraphs* calls) {
   ExecutorOpts exec_opts;
   const int num = partitions_.size();
-  RunManyGraphs calls(num);
-
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
-    RunManyGraphs::Call* c = calls.get(i);
+    RunManyGraphs::Call* c = calls->get(i);
     c->req.set_graph_handle(part.graph_handle);
     c->req.set_step_id(step_id);
     *c->req.mutable_exec_opts() = exec_opts;
@@ -536,30 +598,86 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
     for (const auto& feed_key : part.feed_key) {
       const string& feed = feed_key.first;
       const string& key = feed_key.second;
-      const TensorProto* val = feeds[feed];
-      if (val == nullptr) {
+      auto iter = feeds.find(feed);
+      if (iter == feeds.end()) {
         return errors::InvalidArgument("No feed is provided for feed=", feed,
                                        ", key=", key);
       }
       auto* send = c->req.add_send();
       send->set_key(key);
-      *(send->mutable_val()) = *val;  // TODO(mrry): make it faster if needed.
+      // TODO(mrry): make it faster if needed.
+      *(send->mutable_val()) = *iter->second;
     }
-    for (const auto& key_fetch : part.key_fetch) {
-      const string& key = key_fetch.first;
-      c->req.add_recv_key(key);
+    if (fetch_outputs) {
+      for (const auto& key_fetch : part.key_fetch) {
+        const string& key = key_fetch.first;
+        c->req.add_recv_key(key);
+      }
     }
   }
+  return Status::OK();
+}
 
-  // Issues RunGraph calls.
+void MasterSession::ReffedClientGraph::IssueRunGraphCalls(
+    RunManyGraphs* calls) {
+  const int num = partitions_.size();
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
-    RunManyGraphs::Call* call = calls.get(i);
+    RunManyGraphs::Call* call = calls->get(i);
     TRACEPRINTF("Partition %d %s", i, part.name.c_str());
     part.worker->RunGraphAsync(
         &call->opts, &call->req, &call->resp,
-        std::bind(&RunManyGraphs::WhenDone, &calls, i, std::placeholders::_1));
+        std::bind(&RunManyGraphs::WhenDone, calls, i, std::placeholders::_1));
   }
+}
+
+Status MasterSession::ReffedClientGraph::CollectFetches(
+    RunManyGraphs* calls, PerStepState* pss, RunStepResponse* resp) {
+  Status status = calls->status();
+  if (status.ok()) {
+    const int num = partitions_.size();
+    for (int i = 0; i < num; ++i) {
+      const Part& part = partitions_[i];
+      for (auto& recv : *(calls->get(i)->resp.mutable_recv())) {
+        auto* ret = resp->add_tensor();
+        auto iter = part.key_fetch.find(recv.key());
+        if (iter == part.key_fetch.end()) {
+          status.Update(errors::Internal("Unexpected fetch key: ", recv.key()));
+          break;
+        }
+        const string& fetch = iter->second;
+        ret->set_name(fetch);
+        if (!CopyIfNeeded(recv.mutable_val(), ret->mutable_tensor())) {
+          status.Update(
+              errors::Internal("Unexpected unparseable tensor: ", recv.key()));
+          break;
+        }
+      }
+      if (calls->get(i)->resp.has_step_stats()) {
+        pss->step_stats[i].Swap(calls->get(i)->resp.mutable_step_stats());
+      }
+    }
+  }
+  return status;
+}
+
+Status MasterSession::ReffedClientGraph::RunPartitions(
+    const MasterEnv* env, int64 step_id, int64 execution_count,
+    SimpleGraphExecutionState* execution_state, PerStepState* pss,
+    CallOptions* call_opts, const RunStepRequest& req, RunStepResponse* resp,
+    CancellationManager* cm) {
+  VLOG(2) << "RunPartitions step_id " << step_id << " execution_count "
+          << execution_count;
+  // Builds an index for feeds provided by the client.
+  FeedIndex feeds(3);
+  TF_RETURN_IF_ERROR(BuildFeedIndex(req, &feeds));
+
+  // Prepares a number of calls to workers. One call per partition.
+  RunManyGraphs calls(partitions_.size());
+  TF_RETURN_IF_ERROR(PrepareRunGraphCalls(feeds, step_id, true, &calls));
+
+  // Issues RunGraph calls.
+  IssueRunGraphCalls(&calls);
 
   // Waits for the RunGraph calls.
   call_opts->SetCancelCallback([&calls]() { calls.StartCancel(); });
@@ -578,29 +696,112 @@ Status MasterSession::ReffedClientGraph::RunPartitions(
   }
 
   // Collects fetches.
-  Status status = calls.status();
-  if (status.ok()) {
-    for (int i = 0; i < num; ++i) {
-      const Part& part = partitions_[i];
-      for (auto& recv : *(calls.get(i)->resp.mutable_recv())) {
-        auto* ret = resp->add_tensor();
-        auto iter = part.key_fetch.find(recv.key());
-        if (iter == part.key_fetch.end()) {
-          status.Update(errors::Internal("Unexpected fetch key: ", recv.key()));
-          break;
-        }
-        const string& fetch = iter->second;
-        ret->set_name(fetch);
-        if (!CopyIfNeeded(recv.mutable_val(), ret->mutable_tensor())) {
-          status.Update(
-              errors::Internal("Unexpected unparseable tensor: ", recv.key()));
+  return CollectFetches(&calls, pss, resp);
+}
+
+// Number of completed steps RunPartitionsPipelined() accumulates
+// before cleaning them up on the workers. Steps other than the last
+// leave their fetched tensors buffered in the worker rendezvous, so the
+// batch must stay small.
+static const int kMaxStepsPerCleanup = 16;
+
+Status MasterSession::ReffedClientGraph::RunPartitionsPipelined(
+    const MasterEnv* env, const std::vector<int64>& step_ids,
+    int max_steps_in_flight, PerStepState* pss, CallOptions* call_opts,
+    const RunStepRequest& req, RunStepResponse* resp,
+    CancellationManager* cm) {
+  const int num_steps = step_ids.size();
+  VLOG(2) << "RunPartitionsPipelined num_steps " << num_steps
+          << " max_steps_in_flight " << max_steps_in_flight;
+  FeedIndex feeds(3);
+  TF_RETURN_IF_ERROR(BuildFeedIndex(req, &feeds));
+
+  auto cleanup_done = [](const Status& s) {
+    if (!s.ok()) {
+      LOG(ERROR) << "Cleanup partition error: " << s;
+    }
+  };
+
+  // Steps issued but not yet waited for, oldest first. Only this
+  // thread adds or removes steps; "mu" serializes that against the
+  // cancellation callback.
+  mutex mu;
+  std::deque<std::unique_ptr<RunManyGraphs>> in_flight;
+  bool cancelled = false;
+  auto cancel_all = [&mu, &in_flight, &cancelled]() {
+    mutex_lock l(mu);
+    cancelled = true;
+    for (auto& calls : in_flight) calls->StartCancel();
+  };
+  call_opts->SetCancelCallback(cancel_all);
+  auto token = cm->get_cancellation_token();
+  const bool success = cm->RegisterCallback(token, cancel_all);
+  if (!success) {
+    cancel_all();
+  }
+
+  Status status;
+  std::vector<int64> to_cleanup;
+  int num_issued = 0;
+  int num_done = 0;
+  while (num_done < num_steps) {
+    // Keeps the pipeline full. Nothing new is issued after an error.
+    while (status.ok() && num_issued < num_steps &&
+           num_issued - num_done < max_steps_in_flight) {
+      const bool last_step = (num_issued == num_steps - 1);
+      std::unique_ptr<RunManyGraphs> calls(
+          new RunManyGraphs(partitions_.size()));
+      status = PrepareRunGraphCalls(feeds, step_ids[num_issued], last_step,
+                                    calls.get());
+      if (!status.ok()) break;
+      RunManyGraphs* to_issue = calls.get();
+      {
+        mutex_lock l(mu);
+        if (cancelled) {
+          status = errors::Cancelled("Step was cancelled");
           break;
         }
+        in_flight.push_back(std::move(calls));
       }
-      if (calls.get(i)->resp.has_step_stats()) {
-        pss->step_stats[i].Swap(calls.get(i)->resp.mutable_step_stats());
+      IssueRunGraphCalls(to_issue);
+      ++num_issued;
+    }
+    if (in_flight.empty()) break;
+
+    // Waits for the oldest step in flight.
+    RunManyGraphs* oldest = in_flight.front().get();
+    oldest->Wait();
+    if (status.ok()) {
+      status = (num_done == num_steps - 1) ? CollectFetches(oldest, pss, resp)
+                                           : oldest->status();
+      if (!status.ok()) {
+        // Later steps may depend on the failed one, so stops them too.
+        mutex_lock l(mu);
+        for (auto& calls : in_flight) calls->StartCancel();
       }
     }
+    std::unique_ptr<RunManyGraphs> finished;
+    {
+      mutex_lock l(mu);
+      finished = std::move(in_flight.front());
+      in_flight.pop_front();
+    }
+    to_cleanup.push_back(step_ids[num_done]);
+    ++num_done;
+    if (to_cleanup.size() >= static_cast<size_t>(kMaxStepsPerCleanup)) {
+      CleanupPartitionsAsync(to_cleanup, cleanup_done);
+      to_cleanup.clear();
+    }
+  }
+  if (!to_cleanup.empty()) {
+    CleanupPartitionsAsync(to_cleanup, cleanup_done);
+  }
+
+  call_opts->ClearCancelCallback();
+  if (success) {
+    cm->DeregisterCallback(token);
+  } else {
+    return errors::Cancelled("Step was cancelled");
   }
   return status;
 }
@@ -609,9 +810,13 @@ namespace {
 
 class CleanupBroadcastHelper {
  public:
-  CleanupBroadcastHelper(int64 step_id, int num_calls, StatusCallback done)
+  CleanupBroadcastHelper(gtl::ArraySlice<int64> step_ids, int num_calls,
+                         StatusCallback done)
       : resps_(num_calls), num_pending_(num_calls), done_(std::move(done)) {
-    req_.set_step_id(step_id);
+    req_.set_step_id(step_ids[0]);
+    for (size_t i = 1; i < step_ids.size(); ++i) {
+      req_.add_additional_step_ids(step_ids[i]);
+    }
   }
 
   // Returns a non-owned pointer to a request buffer for all calls.
@@ -661,10 +866,17 @@ class CleanupBroadcastHelper {
 
 void MasterSession::ReffedClientGraph::CleanupPartitionsAsync(
     int64 step_id, StatusCallback done) {
+  CleanupPartitionsAsync(gtl::ArraySlice<int64>(&step_id, 1),
+                         std::move(done));
+}
+
+void MasterSession::ReffedClientGraph::CleanupPartitionsAsync(
+    gtl::ArraySlice<int64> step_ids, StatusCallback done) {
+  CHECK(!step_ids.empty());
   const int num = partitions_.size();
   // Helper object will be deleted when the final call completes.
   CleanupBroadcastHelper* helper =
-      new CleanupBroadcastHelper(step_id, num, std::move(done));
+      new CleanupBroadcastHelper(step_ids, num, std::move(done));
   for (int i = 0; i < num; ++i) {
     const Part& part = partitions_[i];
     part.worker->CleanupGraphAsync(
@@ -944,13 +1156,23 @@ Status MasterSession::DoRunWithLocalExecution(CallOptions* opts,
     }
   };
   popts.control_flow_added = false;
-  // TODO(mrry): Enable DT_BFLOAT16 casting.
+  SetTransferCodecs(session_opts_.config.graph_options().transfer_options(),
+                    &popts);
   // TODO(mrry): Enable recv scheduling.
   TF_RETURN_IF_ERROR(rcg->RegisterPartitions(env_, popts, func_def_lib_));
 
-  // Keeps the highest 8 bits 0x01: we reserve some bits of the
-  // step_id for future use.
-  const uint64 step_id = (random::New64() & ((1uLL << 56) - 1)) | (1uLL << 56);
+  const RunOptions& run_options = req->options();
+  if (run_options.num_steps() > 1) {
+    std::vector<int64> step_ids(run_options.num_steps());
+    for (int64& step_id : step_ids) step_id = NewStepId();
+    TF_RETURN_IF_ERROR(rcg->RunPartitionsPipelined(
+        env_, step_ids, std::max(1, run_options.max_steps_in_flight()), &pss,
+        opts, *req, resp, cancellation_manager_));
+    pss.end_micros = Env::Default()->NowMicros();
+    return Status::OK();
+  }
+
+  const uint64 step_id = NewStepId();
   TRACEPRINTF("stepid %llu", step_id);
 
   TF_RETURN_IF_ERROR(rcg->RunPartitions(env_, step_id, count,
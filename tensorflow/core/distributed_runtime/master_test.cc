@@ -92,10 +92,13 @@ class MasterTest : public ::testing::Test {
 
   Status RunStep(const string& handle,
                  const std::vector<std::pair<string, const Tensor*> >& feed,
-                 const std::map<string, Tensor*>& fetch) {
+                 const std::map<string, Tensor*>& fetch,
+                 const RunOptions& options = RunOptions(),
+                 const std::vector<string>& target = {}) {
     ::grpc::ClientContext ctx;
     RunStepRequest req;
     req.set_session_handle(handle);
+    *req.mutable_options() = options;
     for (const auto& p : feed) {
       const string& feed_name = p.first;
       const Tensor* feed_tensor = p.second;
@@ -107,6 +110,9 @@ class MasterTest : public ::testing::Test {
       const string& fetch_name = p.first;
       req.add_fetch(fetch_name);
     }
+    for (const string& target_name : target) {
+      req.add_target(target_name);
+    }
     RunStepResponse resp;
     const Status s = FromGrpcStatus(master_->RunStep(&ctx, req, &resp));
     if (s.ok()) {
@@ -358,6 +364,40 @@ TEST_F(MasterTest, ConcurrentExtendAndRun) {
   TF_ASSERT_OK(CloseSession(handle));
 }
 
+TEST_F(MasterTest, MultiStepRun) {
+  // var = 0; incr: var = var + 1.
+  Graph graph(OpRegistry::Global());
+  Node* var = test::graph::Var(&graph, DT_FLOAT, TensorShape({}), "var");
+  Node* init = test::graph::Assign(
+      &graph, var, test::graph::Constant(&graph, test::AsScalar<float>(0)));
+  Node* one = test::graph::Constant(&graph, test::AsScalar<float>(1));
+  Node* incr =
+      test::graph::Assign(&graph, var, test::graph::Add(&graph, var, one));
+  GraphDef def;
+  test::graph::ToGraphDef(&graph, &def);
+
+  string handle;
+  int64 initial_version;
+  TF_ASSERT_OK(CreateSession(def, &handle, &initial_version));
+  Tensor value(DT_FLOAT, TensorShape({}));
+  TF_ASSERT_OK(RunStep(handle, {}, {}, RunOptions(), {init->name()}));
+
+  // Sequential steps each observe the update of the step before them.
+  RunOptions options;
+  options.set_num_steps(10);
+  TF_ASSERT_OK(RunStep(handle, {}, {{incr->name() + ":0", &value}}, options));
+  EXPECT_EQ(10, value.scalar<float>()());
+
+  // Pipelined steps may read "var" before the steps ahead of them have
+  // updated it, so some of their increments can be overwritten.
+  options.set_max_steps_in_flight(4);
+  TF_ASSERT_OK(RunStep(handle, {}, {{incr->name() + ":0", &value}}, options));
+  EXPECT_GT(value.scalar<float>()(), 10);
+  EXPECT_LE(value.scalar<float>()(), 20);
+
+  TF_ASSERT_OK(CloseSession(handle));
+}
+
 TEST_F(MasterTest, EigenProblem) {
   // A = [3 2; -1 0]; x = rand(2, 1);
   // for i=1:100; x = A * x; end
@@ -180,6 +180,7 @@ Status GrpcSession::Run(const RunOptions& run_options,
   for (const string& target : target_node_names) {
     req.add_target(target);
   }
+  *req.mutable_options() = run_options;
 
   CallOptions call_options;
   call_options.SetTimeout(run_options.timeout_in_ms());
@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
+
+#include <atomic>
+
 #include "grpc++/support/byte_buffer.h"
 #include "grpc++/support/slice.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -26,13 +29,49 @@ limitations under the License.
 namespace tensorflow {
 namespace grpc {
 
-static void do_nothing(void* raw) {}
-static void unref_tensorreference(void* raw) {
-  TensorReference* ref = static_cast<TensorReference*>(raw);
-  ref->Unref();
-  delete ref;
+namespace {
+
+// The refcount of a gpr_slice that points directly into the backing store
+// of a Tensor, and holds a reference to it until gRPC releases the last
+// reference to the slice.
+struct TensorSliceRefcount {
+  // First, since gRPC passes a pointer to "base" to Ref() and Unref().
+  gpr_slice_refcount base;
+  std::atomic<int> refs;
+  TensorReference tensor;
+
+  explicit TensorSliceRefcount(const Tensor& val) : refs(1), tensor(val) {
+    base.ref = &Ref;
+    base.unref = &Unref;
+  }
+
+  static void Ref(void* raw) {
+    static_cast<TensorSliceRefcount*>(raw)->refs.fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  static void Unref(void* raw) {
+    TensorSliceRefcount* r = static_cast<TensorSliceRefcount*>(raw);
+    if (r->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      r->tensor.Unref();
+      delete r;
+    }
+  }
+};
+
+// Returns a slice that shares the backing store "data" of "val".
+gpr_slice NewTensorSlice(const Tensor& val, StringPiece data) {
+  TensorSliceRefcount* refcount = new TensorSliceRefcount(val);
+  gpr_slice s;
+  s.refcount = &refcount->base;
+  s.data.refcounted.bytes =
+      reinterpret_cast<uint8*>(const_cast<char*>(data.data()));
+  s.data.refcounted.length = data.size();
+  return s;
 }
 
+}  // namespace
+
 void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
                                           ::grpc::ByteBuffer* result) {
   size_t len = proto.ByteSize();
@@ -71,9 +110,12 @@ void EncodeRecvTensorResponseToByteBuffer(const RecvTensorResponse& proto,
 // If the tensor data is larger than "kLargeTensorBytes", then A through
 // D2 will be encoded in one gpr_slice, and E will be encoded in a second
 // gpr_slice that points to the backing store for the tensor data, to avoid
-// copying the tensor data (and the gpr_slice setup will be arrange so as
-// to dereference the underlying tensor data buffer when it is no longer
-// needed in the "*result" ByteBuffer).
+// copying the tensor data (the second slice holds a reference to the
+// tensor buffer, which gRPC releases when it is done sending it).
+//
+// DT_STRING tensors have no tensor_content: C is followed by the
+// string_val fields of the strings, which are all encoded along with A
+// through C in a single gpr_slice, without building a RecvTensorResponse.
 static int VarLengthEncodingSize(uint32 tag, size_t bytes) {
   return core::VarintLength(tag << 3) + core::VarintLength(bytes) + bytes;
 }
@@ -138,6 +180,42 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 #endif
 }
 
+// Encodes the DT_STRING tensor "val" after "header" (A) and the encoded
+// skeleton of "val" (C), into a single slice.
+static void EncodeStringTensorToByteBuffer(const string& header,
+                                           StringPiece skeleton,
+                                           const Tensor& val,
+                                           ::grpc::ByteBuffer* result) {
+  const auto& strings = val.flat<string>();
+  size_t tensor_proto_bytes = skeleton.size();
+  for (int64 i = 0; i < strings.size(); ++i) {
+    tensor_proto_bytes += VarLengthEncodingSize(
+        TensorProto::kStringValFieldNumber, strings(i).size());
+  }
+  const size_t expected_size =
+      header.size() + VarLengthEncodingSize(
+                          RecvTensorResponse::kTensorFieldNumber,
+                          tensor_proto_bytes);
+
+  gpr_slice s = gpr_slice_malloc(expected_size);
+  io::ProtoEncodeHelper e(reinterpret_cast<char*>(GPR_SLICE_START_PTR(s)),
+                          expected_size);
+  // (A)
+  e.WriteRawBytes(header);
+  // (B1) & (B2)
+  e.WriteVarlengthBeginning(RecvTensorResponse::kTensorFieldNumber,
+                            tensor_proto_bytes);
+  // (C)
+  e.WriteRawBytes(skeleton);
+  for (int64 i = 0; i < strings.size(); ++i) {
+    e.WriteString(TensorProto::kStringValFieldNumber, strings(i));
+  }
+  CHECK_EQ(e.size(), expected_size);
+
+  ::grpc::Slice slice(s, ::grpc::Slice::STEAL_REF);
+  *result = ::grpc::ByteBuffer(&slice, 1);
+}
+
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
                               ::grpc::ByteBuffer* result) {
   const int kLargeTensorBytes = 1024;
@@ -146,10 +224,8 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
     response.set_is_dead(is_dead);
   }
   response.set_send_start_micros(Env::Default()->NowMicros());
-  if (!DataTypeCanUseMemcpy(val.dtype())) {
+  if (!DataTypeCanUseMemcpy(val.dtype()) && val.dtype() != DT_STRING) {
     // Straightforward but slow path for complicated kinds of tensor data
-    // TODO(jeff,sanjay): If this becomes an issue, we could
-    // go directly from val -> ByteBuffer, with some effort.
     val.AsProtoTensorContent(response.mutable_tensor());
 
     // Encode full protocol buffer to a ByteBuffer
@@ -161,13 +237,21 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
     io::ProtoEncodeHelper e_skeleton(skeleton.data(), skeleton.size());
     EncodeSkeleton(val, &e_skeleton);
 
+    string header;  // All of RecvTensorRequest except the tensor() field
+    response.AppendToString(&header);
+
+    if (val.dtype() == DT_STRING) {
+      EncodeStringTensorToByteBuffer(
+          header, StringPiece(e_skeleton.data(), e_skeleton.size()), val,
+          result);
+      return;
+    }
+
     StringPiece tdata = val.tensor_data();
     uint32 overall_tensor_proto_bytesize =
         (e_skeleton.size() +
          VarLengthEncodingSize(TensorProto::kTensorContentFieldNumber,
                                tdata.size()));
-    string header;  // All of RecvTensorRequest except the tensor() field
-    response.AppendToString(&header);
 
     size_t expected_size =
         (header.size() +
@@ -203,7 +287,7 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
     // All but the tensor backing store are serialized now
 
     // Now allocate memory and put into the ByteBuffer
-    ::grpc::Slice slices[3];
+    ::grpc::Slice slices[2];
     int num_slices = 0;
     {
       size_t slice_len = e.size() + (tensor_data_is_large ? 0 : tdata.size());
@@ -218,42 +302,10 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
     }
 
     if (tensor_data_is_large) {
-      // Encode the actual tensor data by pointing to the backing store,
-      // and add a special zero-length slice that is really a TensorReference
-      // object that we will destroy when we are done.
-      //
-      // TODO(jeff): Note that this approach relies on the fact that
-      // slices are destroyed in the order in which they are added to
-      // the ByteBuffer.  In principle, these could be broken by future
-      // hypothetical grpc_slice-related changes (e.g. the
-      // implementation could decide to destroy 0-length slices
-      // eagerly).  In practice, this does not happen with the current
-      // implementation, and the gpr_slice interface at the moment does
-      // not allow us to do the Tensor-unreferencing in the right way
-      // (since the Tensor pointer is different than the backing store
-      // array pointer).
-      //
-      // TODO(jeff,sanjay): switch to using new
-      // gsr_slice_new_with_user_data interface that allows for
-      // different pointers for the data and the argument to the
-      // destroy function once that has been added integrated into grpc
-      // (see https://github.com/grpc/grpc/pull/7488)
-
       // (E) Encode tensor data, but by sharing backing store
-
-      // TODO(jeff,sanjay): It'd be nice to avoid this TensorReference
-      // allocation, and instead get our hands on the underlying
-      // TensorBuffer object and just directly ref it here and unref
-      // it in unref_tensorreference.
-      TensorReference* ref = new TensorReference(val);
-      gpr_slice s1 = gpr_slice_new(
-          const_cast<void*>(static_cast<const void*>(tdata.data())),
-          tdata.size(), do_nothing);
-      slices[1] = ::grpc::Slice(s1, ::grpc::Slice::STEAL_REF);
-
-      gpr_slice s2 = gpr_slice_new(ref, 0, unref_tensorreference);
-      slices[2] = ::grpc::Slice(s2, ::grpc::Slice::STEAL_REF);
-      num_slices += 2;
+      slices[1] =
+          ::grpc::Slice(NewTensorSlice(val, tdata), ::grpc::Slice::STEAL_REF);
+      num_slices += 1;
     }
     size_t total_bytes = 0;
     for (int i = 0; i < num_slices; i++) {
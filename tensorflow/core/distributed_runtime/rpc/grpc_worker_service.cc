@@ -236,8 +236,10 @@ class GrpcWorkerService : public AsyncServiceInterface {
   void CleanupGraphHandler(
       WorkerCall<CleanupGraphRequest, CleanupGraphResponse>* call) {
     env_->compute_pool->Schedule([this, call]() {
-      const int64 step_id = call->request.step_id();
-      env_->rendezvous_mgr->Cleanup(step_id);
+      env_->rendezvous_mgr->Cleanup(call->request.step_id());
+      for (const int64 step_id : call->request.additional_step_ids()) {
+        env_->rendezvous_mgr->Cleanup(step_id);
+      }
       call->SendResponse(::grpc::Status::OK);
     });
     ENQUEUE_REQUEST(CleanupGraph, false);
@@ -134,6 +134,8 @@ bool ReadNestedMessage(protobuf::io::CodedInputStream* input,
 bool TensorResponse::ParseTensorSubmessage(
     protobuf::io::CodedInputStream* input, TensorProto* tensor_meta) {
   bool seen_tensor_content = false;
+  // The number of string_val fields read into tensor_, for DT_STRING.
+  int64 num_strings = 0;
   while (true) {
     auto p = input->ReadTagWithCutoff(127);
     int tag = GetTagFieldNumber(p.first);
@@ -145,6 +147,13 @@ bool TensorResponse::ParseTensorSubmessage(
         TensorShape shape(tensor_meta->tensor_shape());
         Tensor t(allocator_, tensor_meta->dtype(), shape);
         tensor_ = std::move(t);
+      } else if (ok && num_strings > 0) {
+        // Like Tensor::FromProto(), repeats the last string if there are
+        // fewer strings than elements.
+        auto strings = tensor_.flat<string>();
+        for (int64 i = num_strings; i < strings.size(); ++i) {
+          strings(i) = strings(num_strings - 1);
+        }
       }
       return ok;
     }
@@ -154,7 +163,10 @@ bool TensorResponse::ParseTensorSubmessage(
         if ((wt != WIRETYPE_VARINT) || !input->ReadVarint32(&v)) return false;
         if (seen_tensor_content) return false;
         tensor_meta->set_dtype(static_cast<DataType>(static_cast<int>(v)));
-        if (!DataTypeCanUseMemcpy(tensor_meta->dtype())) return false;
+        if (!DataTypeCanUseMemcpy(tensor_meta->dtype()) &&
+            tensor_meta->dtype() != DT_STRING) {
+          return false;
+        }
         break;
       }
       case TensorProto::kTensorShapeFieldNumber: {
@@ -176,7 +188,8 @@ bool TensorResponse::ParseTensorSubmessage(
         // deal with this in the fast path.
         if (seen_tensor_content) return false;
         if (wt != WIRETYPE_LENGTH_DELIMITED ||
-            !tensor_meta->has_tensor_shape()) {
+            !tensor_meta->has_tensor_shape() ||
+            !DataTypeCanUseMemcpy(tensor_meta->dtype())) {
           return false;
         }
         int num_bytes;
@@ -194,6 +207,30 @@ bool TensorResponse::ParseTensorSubmessage(
         tensor_ = std::move(t);
         break;
       }
+      case TensorProto::kStringValFieldNumber: {
+        // Each string is read directly into its element of tensor_,
+        // which is allocated when the first one is seen.
+        if (wt != WIRETYPE_LENGTH_DELIMITED ||
+            tensor_meta->dtype() != DT_STRING ||
+            !tensor_meta->has_tensor_shape()) {
+          return false;
+        }
+        if (!seen_tensor_content) {
+          seen_tensor_content = true;
+          TensorShape shape(tensor_meta->tensor_shape());
+          Tensor t(allocator_, DT_STRING, shape);
+          tensor_ = std::move(t);
+        }
+        auto strings = tensor_.flat<string>();
+        int length;
+        if (num_strings >= strings.size() ||
+            !ReadVarintSizeAsInt(input, &length) ||
+            !input->ReadString(&strings(num_strings), length)) {
+          return false;
+        }
+        ++num_strings;
+        break;
+      }
       default: {
         // Some other tag our fast path code is not prepared to handle.
         // return false.
@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -155,6 +156,29 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(TensorResponseTest, StringTensorWithFewerValues) {
+  // Like Tensor::FromProto(), the last string fills the remaining elements.
+  RecvTensorResponse proto;
+  TensorProto* tensor_proto = proto.mutable_tensor();
+  tensor_proto->set_dtype(DT_STRING);
+  TensorShape({2, 2}).AsProto(tensor_proto->mutable_tensor_shape());
+  tensor_proto->add_string_val("a");
+  tensor_proto->add_string_val(string(5000, 'b'));
+  string encoded;
+  proto.AppendToString(&encoded);
+
+  StringSource source(&encoded, 1024);
+  TensorResponse response;
+  DummyDevice cpu_device(Env::Default());
+  response.InitAlloc(&cpu_device, AllocatorAttributes());
+  TF_ASSERT_OK(response.ParseFrom(&source));
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>(
+          {"a", string(5000, 'b'), string(5000, 'b'), string(5000, 'b')},
+          {2, 2}),
+      response.tensor());
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
@@ -220,9 +220,19 @@ OpKernelContext::~OpKernelContext() {
   if (params_->record_tensor_accesses) referenced_tensors_.Destroy();
 }
 
-Allocator* OpKernelContext::get_allocator(AllocatorAttributes attr) {
-  Allocator* allocator =
-      params_->device->GetStepAllocator(attr, step_resource_manager());
+Allocator* OpKernelContext::get_allocator(AllocatorAttributes attr,
+                                          bool step_scoped, int output_index) {
+  Allocator* allocator = nullptr;
+  if (step_scoped && !attr.nic_compatible() && !attr.gpu_compatible()) {
+    if (output_index >= 0 && params_->output_allocator_array != nullptr) {
+      allocator = params_->output_allocator_array[output_index];
+    }
+    if (allocator == nullptr) allocator = params_->step_allocator;
+  }
+  if (allocator == nullptr) {
+    allocator =
+        params_->device->GetStepAllocator(attr, step_resource_manager());
+  }
   if (params_->track_allocations) {
     mutex_lock lock(mu_);
     for (const auto& wrapped : wrapped_allocators_) {
@@ -445,8 +455,9 @@ Status OpKernelContext::allocate_output(StringPiece name,
 
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
-    AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+    AllocatorAttributes attr, const AllocationAttributes& allocation_attr,
+    bool step_scoped, int output_index) {
+  Allocator* a = get_allocator(attr, step_scoped, output_index);
   AllocationAttributes logged_attr(allocation_attr);
   logged_attr.allocation_will_be_logged = true;
   Tensor new_tensor(a, type, shape, logged_attr);
@@ -473,7 +484,9 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
   DCHECK(!IsRefType(type));
   DCHECK(mutable_output(index) == nullptr);
   Tensor* output_tensor = new Tensor();
-  Status s = allocate_tensor(type, shape, output_tensor, attr);
+  Status s =
+      allocate_tensor(type, shape, output_tensor, attr, AllocationAttributes(),
+                      true /* step_scoped */, index);
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor);
     *output = outputs_[index].tensor;
@@ -485,8 +498,8 @@ Status OpKernelContext::allocate_temp(
     DataType type, const TensorShape& shape, Tensor* out_temp,
     AllocatorAttributes allocator_attr,
     const AllocationAttributes& allocation_attr) {
-  Status s =
-      allocate_tensor(type, shape, out_temp, allocator_attr, allocation_attr);
+  Status s = allocate_tensor(type, shape, out_temp, allocator_attr,
+                             allocation_attr, true /* step_scoped */);
   return s;
 }
 
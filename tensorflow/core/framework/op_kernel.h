@@ -543,6 +543,17 @@ class OpKernelContext {
 
     // TensorSliceReaderCache support.
     checkpoint::TensorSliceReaderCacheWrapper* slice_reader_cache = nullptr;
+
+    // If not nullptr, the allocator for the outputs and temporaries of
+    // this op kernel invocation that do not need to outlive the step.
+    // Persistent tensors, and tensors with attributes that require a
+    // specific allocator, always come from the device.
+    Allocator* step_allocator = nullptr;
+
+    // If not nullptr, array indexed by output number for this node of the
+    // allocators planned for its outputs, nullptr for outputs without
+    // one. Takes precedence over step_allocator.
+    Allocator* const* output_allocator_array = nullptr;
   };
 
   // params must outlive the OpKernelContext.
@@ -947,7 +958,11 @@ class OpKernelContext {
   void CtxFailureWithWarning(Status s);
 
  private:
-  Allocator* get_allocator(AllocatorAttributes attr);
+  // If "step_scoped" is true, the tensor allocated with the returned
+  // allocator does not need to outlive the step. "output_index" is the
+  // output the tensor is allocated for, or -1.
+  Allocator* get_allocator(AllocatorAttributes attr, bool step_scoped = false,
+                           int output_index = -1);
 
   // Internal method to add a tensor's buffer to the list of buffers
   // referenced during the execution of the Op, so that GPUs may
@@ -966,7 +981,8 @@ class OpKernelContext {
 
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
-                         const AllocationAttributes& allocation_attr);
+                         const AllocationAttributes& allocation_attr,
+                         bool step_scoped = false, int output_index = -1);
 
   // This is called by PersistentTensor::AccessTensor whenever the
   // wrapped tensor is retrieved, to ensure the runtime knows that the
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <atomic>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -140,61 +141,56 @@ class LocalRendezvousImpl : public Rendezvous {
     Args recv_args;
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
+    Shard* shard = GetShard(key_hash);
     {
-      mutex_lock l(mu_);
-      if (!status_.ok()) {
-        return status_;
+      mutex_lock l(shard->mu);
+      if (aborted_.load(std::memory_order_acquire)) {
+        return GetStatus();
       }
-      Item* item = nullptr;
-      Table::iterator iter = table_.find(key_hash);
-      if (iter == table_.end()) {
+      Table::iterator iter = shard->table.find(key_hash);
+      if (iter == shard->table.end()) {
         // There is no waiter for this message. Insert the message
         // into the waiters table. The waiter will pick it up when
         // arrives.
-        item = new Item;
-        item->waiter = nullptr;
+        Item* item = &shard->table[key_hash];
         item->value = val;
         item->is_dead = is_dead;
         if (send_args.device_context) {
           send_args.device_context->Ref();
           item->send_dev_context = send_args.device_context;
         }
-        item->recv_dev_context = nullptr;
 
         // The allocator attributes of item->value.
         item->send_alloc_attrs = send_args.alloc_attrs;
-
-        CHECK(table_.insert({key_hash, item}).second);
         return Status::OK();
-      } else {
-        item = iter->second;
+      }
 
-        if (item->waiter == nullptr) {
-          // There is already a message in the table under the key.
-          // Should not happen unless it has a waiter.
-          return errors::Aborted("Duplicated send: ", key.FullKey());
-        }
-        // Mark item as complete.
-        item->has_been_recvd = true;
+      Item* item = &iter->second;
+      if (item->waiter == nullptr) {
+        // There is already a message in the table under the key.
+        // Should not happen unless it has a waiter.
+        return errors::Aborted("Duplicated send: ", key.FullKey());
+      }
+      // Mark item as complete.
+      item->has_been_recvd = true;
 
-        // Get item->waiter function into waiter and set item->waiter to null
-        std::swap(item->waiter, waiter);
-        DCHECK(item->waiter == nullptr);
-        DCHECK(waiter != nullptr);
+      // Get item->waiter function into waiter and set item->waiter to null
+      std::swap(item->waiter, waiter);
+      DCHECK(item->waiter == nullptr);
+      DCHECK(waiter != nullptr);
 
-        // The ref on recv_dev_context transfers below.
-        recv_args.device_context = item->recv_dev_context;
-        recv_args.alloc_attrs = item->recv_alloc_attrs;
-        item->recv_dev_context = nullptr;
-        if (tolerate_dup_recv_) {
-          item->value = val;
-          item->is_dead = is_dead;
-          if (send_args.device_context) {
-            send_args.device_context->Ref();
-            item->send_dev_context = send_args.device_context;
-          }
-          item->send_alloc_attrs = send_args.alloc_attrs;
+      // The ref on recv_dev_context transfers below.
+      recv_args.device_context = item->recv_dev_context;
+      recv_args.alloc_attrs = item->recv_alloc_attrs;
+      item->recv_dev_context = nullptr;
+      if (tolerate_dup_recv_) {
+        item->value = val;
+        item->is_dead = is_dead;
+        if (send_args.device_context) {
+          send_args.device_context->Ref();
+          item->send_dev_context = send_args.device_context;
         }
+        item->send_alloc_attrs = send_args.alloc_attrs;
       }
     }  // mutex
     // Notify the waiter by invoking its done closure, outside scope
@@ -208,28 +204,31 @@ class LocalRendezvousImpl : public Rendezvous {
                  DoneCallback done) override {
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
-    mu_.lock();
-    if (!status_.ok()) {
+    Shard* shard = GetShard(key_hash);
+    shard->mu.lock();
+    if (aborted_.load(std::memory_order_acquire)) {
       // Rendezvous has been aborted.
-      Status s = status_;
-      mu_.unlock();
-      done(s, Args(), recv_args, Tensor(), false);
+      shard->mu.unlock();
+      done(GetStatus(), Args(), recv_args, Tensor(), false);
       return;
     }
-    Table::iterator iter = table_.find(key_hash);
-    if (iter != table_.end()) {
-      Item* item = iter->second;
+    Table::iterator iter = shard->table.find(key_hash);
+    if (iter != shard->table.end()) {
+      Item* item = &iter->second;
       if (item->has_been_recvd && !tolerate_dup_recv_) {
-        mu_.unlock();
+        shard->mu.unlock();
         done(errors::Aborted("Duplicated recv: ", key.FullKey()), Args(),
              recv_args, Tensor(), false);
       } else if (item->waiter == nullptr || tolerate_dup_recv_) {
         // A message has already arrived and is stored in the table
         // under this key.  Consumes the message and invokes the done
-        // closure.
-        Tensor v = item->value;
-        if (!tolerate_dup_recv_) {
-          item->value = Tensor();
+        // closure. With a single consumer the value is moved out,
+        // which saves a reference count round trip on its buffer.
+        Tensor v;
+        if (tolerate_dup_recv_) {
+          v = item->value;
+        } else {
+          v = std::move(item->value);
         }
         item->has_been_recvd = true;
         // Before dropping the table lock, capture the item values.
@@ -243,13 +242,13 @@ class LocalRendezvousImpl : public Rendezvous {
         Args send_args;
         send_args.device_context = item->send_dev_context;
         send_args.alloc_attrs = item->send_alloc_attrs;
-        mu_.unlock();
+        shard->mu.unlock();
         done(Status::OK(), send_args, recv_args, v, is_dead);
         if (send_dev_context) send_dev_context->Unref();
       } else {
         // Already have a waiter in the waiters table under this key,
         // which should not happen.
-        mu_.unlock();
+        shard->mu.unlock();
         done(errors::Aborted("Duplicated recv: ", key.FullKey()), Args(),
              recv_args, Tensor(), false);
       }
@@ -258,34 +257,42 @@ class LocalRendezvousImpl : public Rendezvous {
     // Waiting for a message that has not arrived yet. Insert into the
     // waiting table. The done closure will be invoked when the
     // message arrives.
-    Item* item = new Item;
+    Item* item = &shard->table[key_hash];
     item->waiter = std::move(done);
     item->recv_alloc_attrs = recv_args.alloc_attrs;
     if (recv_args.device_context) {
       item->recv_dev_context = recv_args.device_context;
       item->recv_dev_context->Ref();
     }
-    CHECK(table_.insert({key_hash, item}).second);
-    mu_.unlock();
-    return;
+    shard->mu.unlock();
   }
 
   void StartAbort(const Status& status) override {
     CHECK(!status.ok());
-    std::vector<Item*> items;
     {
-      mutex_lock l(mu_);
+      mutex_lock l(status_mu_);
       if (!status_.ok()) return;
       status_ = status;
-      items.reserve(table_.size());
-      for (const auto& p : table_) items.push_back(p.second);
-      table_.clear();
+      aborted_.store(true, std::memory_order_release);
     }
-    for (Item* item : items) {
-      if (item->waiter != nullptr) {
-        item->waiter(status, Args(), Args(), Tensor(), false);
+    // Any Send or RecvAsync that takes a shard lock after this point
+    // sees aborted_, so nothing is added to a table once it has been
+    // drained below.
+    std::vector<DoneCallback> waiters;
+    for (Shard& shard : shards_) {
+      Table items;
+      {
+        mutex_lock l(shard.mu);
+        items.swap(shard.table);
+      }
+      for (auto& p : items) {
+        if (p.second.waiter != nullptr) {
+          waiters.push_back(std::move(p.second.waiter));
+        }
       }
-      delete item;
+    }
+    for (const DoneCallback& waiter : waiters) {
+      waiter(status, Args(), Args(), Tensor(), false);
     }
   }
 
@@ -303,6 +310,22 @@ class LocalRendezvousImpl : public Rendezvous {
     AllocatorAttributes send_alloc_attrs;
     AllocatorAttributes recv_alloc_attrs;
 
+    Item() {}
+
+    // The item holds a ref on each device context, which moves with it.
+    Item(Item&& other)
+        : waiter(std::move(other.waiter)),
+          value(std::move(other.value)),
+          is_dead(other.is_dead),
+          has_been_recvd(other.has_been_recvd),
+          send_dev_context(other.send_dev_context),
+          recv_dev_context(other.recv_dev_context),
+          send_alloc_attrs(other.send_alloc_attrs),
+          recv_alloc_attrs(other.recv_alloc_attrs) {
+      other.send_dev_context = nullptr;
+      other.recv_dev_context = nullptr;
+    }
+
     ~Item() {
       if (send_dev_context) {
         send_dev_context->Unref();
@@ -311,25 +334,46 @@ class LocalRendezvousImpl : public Rendezvous {
         recv_dev_context->Unref();
       }
     }
+
+    TF_DISALLOW_COPY_AND_ASSIGN(Item);
   };
   // We key the hash table by KeyHash of the Rendezvous::CreateKey string
   static uint64 KeyHash(const StringPiece& k) {
     return Hash64(k.data(), k.size());
   }
 
-  typedef std::unordered_map<uint64, Item*> Table;
+  // Items live in the table's nodes, so that a send/recv pair costs a
+  // single allocation. Consumed items stay in the table so that
+  // duplicated sends and recvs can be detected.
+  typedef std::unordered_map<uint64, Item> Table;
 
-  // TODO(zhifengc): shard table_.
-  mutex mu_;
-  Table table_ GUARDED_BY(mu_);
-  Status status_;
+  // The table is split into shards, each with its own lock, so that
+  // concurrent transfers on different keys rarely contend. The high
+  // bits of the key hash pick the shard; std::hash<uint64> uses the
+  // low bits within it.
+  static const int kNumShardsLog2 = 4;
+  struct Shard {
+    mutex mu;
+    Table table GUARDED_BY(mu);
+  };
+  Shard shards_[1 << kNumShardsLog2];
 
-  ~LocalRendezvousImpl() override {
-    for (auto i : table_) {
-      delete i.second;
-    }
+  Shard* GetShard(uint64 key_hash) {
+    return &shards_[key_hash >> (64 - kNumShardsLog2)];
+  }
+
+  Status GetStatus() {
+    mutex_lock l(status_mu_);
+    return status_;
   }
 
+  // Set once the rendezvous is aborted, after status_ is set.
+  std::atomic<bool> aborted_{false};
+  mutex status_mu_;
+  Status status_ GUARDED_BY(status_mu_);
+
+  ~LocalRendezvousImpl() override {}
+
   TF_DISALLOW_COPY_AND_ASSIGN(LocalRendezvousImpl);
 };
 
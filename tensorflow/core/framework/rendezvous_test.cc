@@ -15,11 +15,15 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -261,6 +265,38 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
       errors::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+TEST_F(LocalRendezvousTest, AbortWakesAllPendingRecvs) {
+  static const int N = 100;
+  BlockingState state;
+  state.counter = N;
+  for (int i = 0; i < N; ++i) {
+    rendez_->RecvAsync(
+        MakeKey(strings::StrCat(i)), Rendezvous::Args(),
+        [&state](const Status& s, const Rendezvous::Args& send_args,
+                 const Rendezvous::Args& recv_args, const Tensor& val,
+                 bool is_dead) {
+          EXPECT_TRUE(errors::IsAborted(s));
+          mutex_lock l(state.lock);
+          if (--state.counter == 0) state.done.Notify();
+        });
+  }
+  rendez_->StartAbort(errors::Aborted(""));
+  state.done.WaitForNotification();
+}
+
+TEST(LocalRendezvousDupRecvTest, TolerateDupRecv) {
+  Rendezvous* rendez = NewLocalRendezvous(true /* tolerate_dup_recv */);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez->Send(KeyFoo(), args, V("hello"), false));
+  for (int i = 0; i < 2; ++i) {
+    Tensor val(DT_STRING);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez->Recv(KeyFoo(), args, &val, &is_dead));
+    EXPECT_EQ("hello", V(val));
+  }
+  rendez->Unref();
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -346,4 +382,47 @@ static void BM_RecvSend(int iters) {
 }
 BENCHMARK(BM_RecvSend);
 
+// Each of "num_threads" threads sends and then receives its own keys,
+// so the threads only interact through the rendezvous table.
+static void BM_SendRecvContended(int iters, int num_threads) {
+  testing::StopTiming();
+  static const int kKeysPerRound = 256;
+  std::vector<std::vector<Rendezvous::ParsedKey>> keys(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    for (int k = 0; k < kKeysPerRound; ++k) {
+      keys[t].push_back(MakeKey(strings::StrCat("t", t, "_", k)));
+    }
+  }
+  const int rounds = std::max(1, iters / (num_threads * kKeysPerRound));
+  testing::ItemsProcessed(static_cast<int64>(rounds) * num_threads *
+                          kKeysPerRound);
+  thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "test", num_threads);
+  testing::StartTiming();
+  for (int r = 0; r < rounds; ++r) {
+    Rendezvous* rendez = NewLocalRendezvous();
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool->Schedule([rendez, &keys, &counter, t]() {
+        // A tensor per thread, so that threads do not contend on its
+        // reference count.
+        const Tensor orig = V("val");
+        Tensor val(DT_STRING, TensorShape({}));
+        bool is_dead = false;
+        Rendezvous::Args args;
+        for (const Rendezvous::ParsedKey& key : keys[t]) {
+          TF_CHECK_OK(rendez->Send(key, args, orig, false));
+          TF_CHECK_OK(rendez->Recv(key, args, &val, &is_dead));
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    rendez->Unref();
+  }
+  testing::StopTiming();
+  delete pool;
+}
+BENCHMARK(BM_SendRecvContended)->Arg(1)->Arg(4)->Arg(16);
+
 }  // namespace tensorflow
@@ -131,6 +131,22 @@ bool NeedSameDeviceSendRecv(const Edge* edge, const GraphInfo& info) {
   return false;
 }
 
+// Return true iff the tensor carried by 'edge', once cast to
+// 'wire_dtype', should be compressed before it is sent. Compression
+// is only done on CPU, and only for types that can be memcpy'ed.
+bool NeedCompression(const PartitionOptions& opts, const GraphInfo& info,
+                     const Edge* edge, DataType wire_dtype) {
+  if (!opts.should_compress || edge->IsControlEdge() ||
+      NeedSameDeviceSendRecv(edge, info)) {
+    return false;
+  }
+  if (info.device_types[edge->src()->id()] != DEVICE_CPU ||
+      info.device_types[edge->dst()->id()] != DEVICE_CPU) {
+    return false;
+  }
+  return DataTypeCanUseMemcpy(wire_dtype) && opts.should_compress(edge);
+}
+
 // Return true iff (dst, dst_input) is specified on host memory.
 bool IsDstInputOnHost(const Edge* edge, const GraphInfo& info) {
   Node* dst = edge->dst();
@@ -213,6 +229,22 @@ NodeDef* AddSend(const PartitionOptions& opts, const GraphInfo& g_info,
     send_from.Reset(cast->name(), 0, cast_dtype);
   }
 
+  // Add a node that compresses the tensor into a scalar string.
+  if (NeedCompression(opts, g_info, edge, send_from.data_type)) {
+    NodeDefBuilder compress_builder(opts.new_name(src->name()),
+                                    "_CompressTensor");
+    compress_builder.Device(src->assigned_device_name()).Input(send_from);
+    if (opts.scheduling_for_recvs) {
+      compress_builder.Attr("_start_time", start_time);
+    }
+    NodeDef* compress = gdef->add_node();
+    *status = compress_builder.Finalize(compress);
+    if (!status->ok()) return nullptr;
+
+    // Connect the Send op to the compressed tensor.
+    send_from.Reset(compress->name(), 0, DT_STRING);
+  }
+
   // Add the send node.
   const string send_op = (host_memory) ? "_HostSend" : "_Send";
   NodeDefBuilder send_builder(opts.new_name(src->name()), send_op);
@@ -239,6 +271,7 @@ NodeDef* AddRecv(const PartitionOptions& opts, const GraphInfo& g_info,
   if (opts.should_cast && !NeedSameDeviceSendRecv(edge, g_info)) {
     cast_dtype = opts.should_cast(edge);
   }
+  const bool compress = NeedCompression(opts, g_info, edge, cast_dtype);
 
   // host_memory = true iff we need to use HostRecv/HostCast.
   bool host_memory = false;
@@ -253,19 +286,32 @@ NodeDef* AddRecv(const PartitionOptions& opts, const GraphInfo& g_info,
   NodeDefBuilder recv_builder(opts.new_name(src->name()), recv_op);
   SetSendRecvAttrs(opts, edge, &recv_builder);
   recv_builder.Device(dst->assigned_device_name())
-      .Attr("tensor_type", cast_dtype);
+      .Attr("tensor_type", compress ? DT_STRING : cast_dtype);
   NodeDef* recv = gdef->add_node();
   *status = recv_builder.Finalize(recv);
   if (!status->ok()) return nullptr;
   *real_recv = recv;
 
+  // Add the node that uncompresses the received string.
+  NodeDef* received = recv;
+  if (compress) {
+    NodeDefBuilder uncompress_builder(opts.new_name(src->name()),
+                                      "_UncompressTensor");
+    uncompress_builder.Attr("T", cast_dtype);
+    uncompress_builder.Device(dst->assigned_device_name())
+        .Input(recv->name(), 0, DT_STRING);
+    received = gdef->add_node();
+    *status = uncompress_builder.Finalize(received);
+    if (!status->ok()) return nullptr;
+  }
+
   // Add the cast node (from cast_dtype to dtype) or an Identity node.
   if (dtype != cast_dtype) {
     const string cast_op = (host_memory) ? "_HostCast" : "Cast";
     NodeDefBuilder cast_builder(opts.new_name(src->name()), cast_op);
     cast_builder.Attr("DstT", dtype);
     cast_builder.Device(dst->assigned_device_name())
-        .Input(recv->name(), 0, cast_dtype);
+        .Input(received->name(), 0, cast_dtype);
     NodeDef* cast = gdef->add_node();
     *status = cast_builder.Finalize(cast);
     if (!status->ok()) return nullptr;
@@ -280,7 +326,7 @@ NodeDef* AddRecv(const PartitionOptions& opts, const GraphInfo& g_info,
     if (!status->ok()) return nullptr;
     return id;
   } else {
-    return recv;
+    return received;
   }
 }
 
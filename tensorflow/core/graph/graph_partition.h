@@ -61,6 +61,13 @@ struct PartitionOptions {
   typedef std::function<DataType(const Edge*)> ShouldCastFunc;
   ShouldCastFunc should_cast = nullptr;
 
+  // A function that returns true if the tensor should be compressed
+  // before it is sent over the wire. Compression happens after any
+  // cast requested by should_cast, and the send and recv sides of the
+  // edge must both be placed on CPU devices.
+  typedef std::function<bool(const Edge*)> ShouldCompressFunc;
+  ShouldCompressFunc should_compress = nullptr;
+
   // Schedule the execution of the recvs based on their start times
   // computed by some scheduling algorithm. The recvs are divided into
   // epochs based on their start times. A recv is enabled only when
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/control_flow_ops.h"
 #include "tensorflow/cc/ops/random_ops.h"
 #include "tensorflow/cc/ops/sendrecv_ops.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/graph/equal_graph_def.h"
 #include "tensorflow/core/graph/graph.h"
@@ -52,8 +53,11 @@ string DeviceName(const Node* node) {
   }
 }
 
+// Partitions "graph_def" by device. The partitioning callbacks in
+// "popts" are filled in; any other options are kept.
 void Partition(const GraphDef& graph_def,
-               std::unordered_map<string, GraphDef>* partitions) {
+               std::unordered_map<string, GraphDef>* partitions,
+               PartitionOptions popts = PartitionOptions()) {
   Graph g(OpRegistry::Global());
   GraphConstructorOptions opts;
   TF_CHECK_OK(ConvertGraphDefToGraph(opts, graph_def, &g));
@@ -64,7 +68,6 @@ void Partition(const GraphDef& graph_def,
     node->set_assigned_device_name(DeviceName(node));
   }
 
-  PartitionOptions popts;
   popts.node_to_loc = SplitByDevice;
   popts.new_name = [&g](const string& prefix) { return g.NewName(prefix); };
   popts.get_incarnation = [](const string& name) {
@@ -372,5 +375,68 @@ TEST_F(GraphPartitionTest, CrossDeviceLoop1) {
   }
 }
 
+const NodeDef* FindNode(const GraphDef& gdef, const string& name) {
+  for (const NodeDef& ndef : gdef.node()) {
+    if (ndef.name() == name) return &ndef;
+  }
+  return nullptr;
+}
+
+TEST_F(GraphPartitionTest, CrossDeviceTransferCodecs) {
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+  auto a1 = Input(in_.WithOpName("A1"));
+  auto a2 = Input(in_.WithOpName("A2"));
+  auto b1 = Input(in_.WithOpName("B1"));
+  Combine(in_.WithOpName("B2").WithControlDependencies(a2), a1, b1);
+
+  PartitionOptions popts;
+  popts.should_cast = [](const Edge* edge) {
+    return edge->IsControlEdge() ? DT_FLOAT : DT_BFLOAT16;
+  };
+  popts.should_compress = [](const Edge* edge) { return true; };
+  Partition(ToGraphDef(), &partitions_, popts);
+  EXPECT_EQ(2, partitions_.size());
+
+  // A1 is cast to bfloat16 and compressed before it is sent.
+  const GraphDef& gdef_a = partitions_["/job:a/replica:0/task:0/cpu:0"];
+  int num_compressed = 0;
+  for (const NodeDef& send : gdef_a.node()) {
+    if (send.op() != "_Send") continue;
+    DataType send_type;
+    TF_ASSERT_OK(GetNodeAttr(send, "T", &send_type));
+    if (send_type == DT_FLOAT) continue;  // The control edge from A2.
+    EXPECT_EQ(DT_STRING, send_type);
+    const NodeDef* compress = FindNode(gdef_a, send.input(0));
+    ASSERT_TRUE(compress != nullptr);
+    EXPECT_EQ("_CompressTensor", compress->op());
+    const NodeDef* cast = FindNode(gdef_a, compress->input(0));
+    ASSERT_TRUE(cast != nullptr);
+    EXPECT_EQ("Cast", cast->op());
+    EXPECT_EQ("A1", cast->input(0));
+    ++num_compressed;
+  }
+  EXPECT_EQ(1, num_compressed);
+
+  // B2 reads A1 through _Recv, _UncompressTensor and a cast back to float.
+  const GraphDef& gdef_b = partitions_["/job:a/replica:0/task:0/cpu:1"];
+  const NodeDef* b2 = FindNode(gdef_b, "B2");
+  ASSERT_TRUE(b2 != nullptr);
+  const NodeDef* cast = FindNode(gdef_b, b2->input(0));
+  ASSERT_TRUE(cast != nullptr);
+  EXPECT_EQ("Cast", cast->op());
+  const NodeDef* uncompress = FindNode(gdef_b, cast->input(0));
+  ASSERT_TRUE(uncompress != nullptr);
+  EXPECT_EQ("_UncompressTensor", uncompress->op());
+  DataType uncompress_type;
+  TF_ASSERT_OK(GetNodeAttr(*uncompress, "T", &uncompress_type));
+  EXPECT_EQ(DT_BFLOAT16, uncompress_type);
+  const NodeDef* recv = FindNode(gdef_b, uncompress->input(0));
+  ASSERT_TRUE(recv != nullptr);
+  EXPECT_EQ("_Recv", recv->op());
+  DataType recv_type;
+  TF_ASSERT_OK(GetNodeAttr(*recv, "tensor_type", &recv_type));
+  EXPECT_EQ(DT_STRING, recv_type);
+}
+
 }  // namespace
 }  // namespace tensorflow
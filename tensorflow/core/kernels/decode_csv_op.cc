@@ -14,16 +14,158 @@ limitations under the License.
 ==============================================================================*/
 
 // See docs in ../ops/parsing_ops.cc.
+#include <cfloat>
+#include <string.h>
 #include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
+namespace {
+
+// A field of a record. Quoted fields refer to the text between the
+// quotes, in which "escaped" says whether doubled quotes remain to be
+// unescaped.
+struct Field {
+  StringPiece text;
+  bool escaped;
+};
+
+typedef gtl::InlinedVector<Field, 16> Fields;
+
+// Returns a word with the high bit of each byte set iff the byte is zero
+// in "v" (or follows a zero byte).
+inline uint64 ZeroBytes(uint64 v) {
+  return (v - 0x0101010101010101ull) & ~v & 0x8080808080808080ull;
+}
+
+// Returns the first position in [p, end) holding "delim", a quote, '\n'
+// or '\r', or "end" if there is none. Compares eight bytes at a time.
+inline const char* FindUnquotedFieldEnd(const char* p, const char* end,
+                                        char delim) {
+  const uint64 kOnes = 0x0101010101010101ull;
+  const uint64 delims = kOnes * static_cast<uint8>(delim);
+  const uint64 quotes = kOnes * '"';
+  const uint64 newlines = kOnes * '\n';
+  const uint64 returns = kOnes * '\r';
+  while (end - p >= 8) {
+    uint64 w;
+    memcpy(&w, p, 8);
+    if ((ZeroBytes(w ^ delims) | ZeroBytes(w ^ quotes) |
+         ZeroBytes(w ^ newlines) | ZeroBytes(w ^ returns)) != 0) {
+      break;
+    }
+    p += 8;
+  }
+  while (p < end && *p != delim && *p != '"' && *p != '\n' && *p != '\r') {
+    ++p;
+  }
+  return p;
+}
+
+// Returns the text of "field", unescaping it into "*scratch" if needed.
+StringPiece FieldText(const Field& field, string* scratch) {
+  if (!field.escaped) return field.text;
+  scratch->clear();
+  for (size_t i = 0; i < field.text.size(); ++i) {
+    scratch->push_back(field.text[i]);
+    if (field.text[i] == '"') ++i;  // Skips the escaping quote.
+  }
+  return *scratch;
+}
+
+// Parses integers such as "-42" of at most "max_digits" digits, which
+// cannot overflow, with no spaces or other characters. Returns false for
+// anything else.
+bool ParseSimpleInt(StringPiece text, int max_digits, int64* value) {
+  const char* p = text.data();
+  const char* end = p + text.size();
+  const bool negative = (p < end && *p == '-');
+  if (negative) ++p;
+  if (p == end || end - p > max_digits) return false;
+  int64 result = 0;
+  for (; p < end; ++p) {
+    if (*p < '0' || *p > '9') return false;
+    result = result * 10 + (*p - '0');
+  }
+  *value = negative ? -result : result;
+  return true;
+}
+
+// Parses "text" as strings::safe_strto32() and strings::safe_strto64() do.
+bool ParseInt(StringPiece text, int32* value) {
+  int64 result;
+  if (ParseSimpleInt(text, 9, &result)) {
+    *value = static_cast<int32>(result);
+    return true;
+  }
+  return strings::safe_strto32(text, value);
+}
+
+bool ParseInt(StringPiece text, int64* value) {
+  return ParseSimpleInt(text, 18, value) || strings::safe_strto64(text, value);
+}
+
+// Parses plain decimals such as "-12.5". With at most 7 digits, of
+// which at most 10 follow the point, both the digits and the power of
+// ten are exact floats, so one correctly rounded division gives the
+// same result as strtof(). Returns false for anything else.
+bool ParseSimpleFloat(StringPiece text, float* value) {
+  static const float kPowersOf10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                      1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  if (FLT_EVAL_METHOD != 0) return false;
+  const char* p = text.data();
+  const char* end = p + text.size();
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  int32 digits = 0;
+  int32 num_digits = 0;
+  int32 num_fraction_digits = 0;
+  bool seen_point = false;
+  for (; p < end; ++p) {
+    if (*p >= '0' && *p <= '9') {
+      if (++num_digits > 7) return false;
+      digits = digits * 10 + (*p - '0');
+      if (seen_point) ++num_fraction_digits;
+    } else if (*p == '.' && !seen_point) {
+      seen_point = true;
+    } else {
+      return false;
+    }
+  }
+  if (num_digits == 0) return false;
+  const float result =
+      static_cast<float>(digits) / kPowersOf10[num_fraction_digits];
+  *value = negative ? -result : result;
+  return true;
+}
+
+// Parses "text" as strings::safe_strtof() does.
+bool ParseFloat(StringPiece text, float* value) {
+  if (ParseSimpleFloat(text, value)) return true;
+  char buf[64];
+  if (text.size() < sizeof(buf)) {
+    memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+    return strings::safe_strtof(buf, value);
+  }
+  return strings::safe_strtof(text.ToString().c_str(), value);
+}
+
+}  // namespace
+
 class DecodeCSVOp : public OpKernel {
  public:
   explicit DecodeCSVOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
@@ -38,6 +180,12 @@ class DecodeCSVOp : public OpKernel {
                 errors::InvalidArgument("field_delim should be only 1 char"));
 
     delim_ = delim[0];
+
+    // Records are handed out to the threads in chunks of decreasing
+    // size, since their cost depends on their length.
+    shard_cost_.reset(new AdaptiveShardCost(
+        strings::StrCat(type_string(), "/", name()),
+        200 + 100 * out_type_.size(), AdaptiveShardCost::kGuided));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -60,178 +208,191 @@ class DecodeCSVOp : public OpKernel {
     OpOutputList output;
     OP_REQUIRES_OK(ctx, ctx->output_list("output", &output));
 
+    std::vector<Tensor*> outputs(out_type_.size());
     for (int i = 0; i < static_cast<int>(out_type_.size()); ++i) {
-      Tensor* out = nullptr;
-      output.allocate(i, records->shape(), &out);
+      OP_REQUIRES_OK(ctx, output.allocate(i, records->shape(), &outputs[i]));
     }
 
-    for (int64 i = 0; i < records_size; ++i) {
-      const StringPiece record(records_t(i));
-      std::vector<string> fields;
-      ExtractFields(ctx, record, &fields);
-      OP_REQUIRES(ctx, fields.size() == out_type_.size(),
-                  errors::InvalidArgument("Expect ", out_type_.size(),
-                                          " fields but have ", fields.size(),
-                                          " in record ", i));
-
-      // Check each field in the record
-      for (int f = 0; f < static_cast<int>(out_type_.size()); ++f) {
-        const DataType& dtype = out_type_[f];
-        switch (dtype) {
-          case DT_INT32: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-
-              output[f]->flat<int32>()(i) = record_defaults[f].flat<int32>()(0);
-            } else {
-              int32 value;
-              OP_REQUIRES(ctx, strings::safe_strto32(fields[f], &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid int32: ",
-                                                  fields[f]));
-              output[f]->flat<int32>()(i) = value;
-            }
-            break;
-          }
-          case DT_INT64: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-
-              output[f]->flat<int64>()(i) = record_defaults[f].flat<int64>()(0);
-            } else {
-              int64 value;
-              OP_REQUIRES(ctx, strings::safe_strto64(fields[f], &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid int64: ",
-                                                  fields[f]));
-              output[f]->flat<int64>()(i) = value;
-            }
-            break;
-          }
-          case DT_FLOAT: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-              output[f]->flat<float>()(i) = record_defaults[f].flat<float>()(0);
-            } else {
-              float value;
-              OP_REQUIRES(ctx, strings::safe_strtof(fields[f].c_str(), &value),
-                          errors::InvalidArgument("Field ", f, " in record ", i,
-                                                  " is not a valid float: ",
-                                                  fields[f]));
-              output[f]->flat<float>()(i) = value;
-            }
-            break;
+    // Records are parsed in parallel. If several of them are invalid,
+    // the error of the first one is reported.
+    mutex mu;
+    int64 first_error_record = records_size;
+    Status first_error;
+    auto DoWork = [this, &records_t, &record_defaults, &outputs, &mu,
+                   &first_error_record, &first_error](int64 start,
+                                                      int64 limit) {
+      Fields fields;
+      string scratch;
+      for (int64 i = start; i < limit; ++i) {
+        Status s = ParseRecord(records_t(i), i, record_defaults, &fields,
+                               &scratch, &outputs);
+        if (!TF_PREDICT_TRUE(s.ok())) {
+          mutex_lock l(mu);
+          if (i < first_error_record) {
+            first_error_record = i;
+            first_error = s;
           }
-          case DT_STRING: {
-            // If this field is empty, check if default is given:
-            // If yes, use default value; Otherwise report error.
-            if (fields[f].empty()) {
-              OP_REQUIRES(ctx, record_defaults[f].NumElements() == 1,
-                          errors::InvalidArgument(
-                              "Field ", f,
-                              " is required but missing in record ", i, "!"));
-              output[f]->flat<string>()(i) =
-                  record_defaults[f].flat<string>()(0);
-            } else {
-              output[f]->flat<string>()(i) = fields[f];
-            }
-            break;
-          }
-          default:
-            OP_REQUIRES(ctx, false,
-                        errors::InvalidArgument("csv: data type ", dtype,
-                                                " not supported in field ", f));
+          return;
         }
       }
-    }
+    };
+    auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+    AdaptiveShard(worker_threads.num_threads, worker_threads.workers,
+                  records_size, shard_cost_.get(), DoWork);
+    OP_REQUIRES_OK(ctx, first_error);
   }
 
  private:
   std::vector<DataType> out_type_;
   char delim_;
+  std::unique_ptr<AdaptiveShardCost> shard_cost_;
 
-  void ExtractFields(OpKernelContext* ctx, StringPiece input,
-                     std::vector<string>* result) {
-    int64 current_idx = 0;
-    if (!input.empty()) {
-      while (static_cast<size_t>(current_idx) < input.size()) {
-        if (input[current_idx] == '\n' || input[current_idx] == '\r') {
-          current_idx++;
-          continue;
-        }
+  // Parses record "i", whose text is "record", into element "i" of
+  // "*outputs". "fields" and "scratch" are reused across records.
+  Status ParseRecord(StringPiece record, int64 i,
+                     const OpInputList& record_defaults, Fields* fields,
+                     string* scratch, std::vector<Tensor*>* outputs) const {
+    TF_RETURN_IF_ERROR(ExtractFields(record, fields));
+    if (fields->size() != out_type_.size()) {
+      return errors::InvalidArgument("Expect ", out_type_.size(),
+                                     " fields but have ", fields->size(),
+                                     " in record ", i);
+    }
 
-        bool quoted = false;
-        if (input[current_idx] == '"') {
-          quoted = true;
-          current_idx++;
+    // Check each field in the record
+    for (int f = 0; f < static_cast<int>(out_type_.size()); ++f) {
+      const DataType& dtype = out_type_[f];
+      Tensor* out = (*outputs)[f];
+      const Field& field = (*fields)[f];
+      // If this field is empty, check if default is given:
+      // If yes, use default value; Otherwise report error.
+      if (field.text.empty()) {
+        if (record_defaults[f].NumElements() != 1) {
+          return errors::InvalidArgument(
+              "Field ", f, " is required but missing in record ", i, "!");
         }
+        switch (dtype) {
+          case DT_INT32:
+            out->flat<int32>()(i) = record_defaults[f].flat<int32>()(0);
+            break;
+          case DT_INT64:
+            out->flat<int64>()(i) = record_defaults[f].flat<int64>()(0);
+            break;
+          case DT_FLOAT:
+            out->flat<float>()(i) = record_defaults[f].flat<float>()(0);
+            break;
+          case DT_STRING:
+            out->flat<string>()(i) = record_defaults[f].flat<string>()(0);
+            break;
+          default:
+            return errors::InvalidArgument("csv: data type ", dtype,
+                                           " not supported in field ", f);
+        }
+        continue;
+      }
 
-        // This is the body of the field;
-        string field;
-        if (!quoted) {
-          while (static_cast<size_t>(current_idx) < input.size() &&
-                 input[current_idx] != delim_) {
-            OP_REQUIRES(ctx, input[current_idx] != '"' &&
-                                 input[current_idx] != '\n' &&
-                                 input[current_idx] != '\r',
-                        errors::InvalidArgument(
-                            "Unquoted fields cannot have quotes/CRLFs inside"));
-            field += input[current_idx];
-            current_idx++;
+      const StringPiece text = FieldText(field, scratch);
+      switch (dtype) {
+        case DT_INT32: {
+          int32 value;
+          if (!ParseInt(text, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid int32: ", text);
           }
-
-          // Go to next field or the end
-          current_idx++;
-        } else {
-          // Quoted field needs to be ended with '"' and delim or end
-          while (
-              (static_cast<size_t>(current_idx) < input.size() - 1) &&
-              (input[current_idx] != '"' || input[current_idx + 1] != delim_)) {
-            if (input[current_idx] != '"') {
-              field += input[current_idx];
-              current_idx++;
-            } else {
-              OP_REQUIRES(
-                  ctx, input[current_idx + 1] == '"',
-                  errors::InvalidArgument("Quote inside a string has to be "
-                                          "escaped by another quote"));
-              field += '"';
-              current_idx += 2;
-            }
+          out->flat<int32>()(i) = value;
+          break;
+        }
+        case DT_INT64: {
+          int64 value;
+          if (!ParseInt(text, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid int64: ", text);
+          }
+          out->flat<int64>()(i) = value;
+          break;
+        }
+        case DT_FLOAT: {
+          float value;
+          if (!ParseFloat(text, &value)) {
+            return errors::InvalidArgument("Field ", f, " in record ", i,
+                                           " is not a valid float: ", text);
           }
+          out->flat<float>()(i) = value;
+          break;
+        }
+        case DT_STRING:
+          out->flat<string>()(i).assign(text.data(), text.size());
+          break;
+        default:
+          return errors::InvalidArgument("csv: data type ", dtype,
+                                         " not supported in field ", f);
+      }
+    }
+    return Status::OK();
+  }
 
-          OP_REQUIRES(
-              ctx, (static_cast<size_t>(current_idx) < input.size() &&
-                    input[current_idx] == '"' &&
-                    (static_cast<size_t>(current_idx) == input.size() - 1 ||
-                     input[current_idx + 1] == delim_)),
-              errors::InvalidArgument("Quoted field has to end with quote "
-                                      "followed by delim or end"));
+  // Splits "input" into "*result" without copying the fields.
+  Status ExtractFields(StringPiece input, Fields* result) const {
+    result->clear();
+    if (input.empty()) return Status::OK();
+    const char* const data = input.data();
+    const int64 size = input.size();
+    int64 current_idx = 0;
+    while (current_idx < size) {
+      if (data[current_idx] == '\n' || data[current_idx] == '\r') {
+        current_idx++;
+        continue;
+      }
 
-          current_idx += 2;
+      if (data[current_idx] != '"') {
+        const char* end =
+            FindUnquotedFieldEnd(data + current_idx, data + size, delim_);
+        if (end < data + size && *end != delim_) {
+          return errors::InvalidArgument(
+              "Unquoted fields cannot have quotes/CRLFs inside");
         }
+        result->push_back(
+            {StringPiece(data + current_idx, end - (data + current_idx)),
+             false});
+        // Go to next field or the end
+        current_idx = end - data + 1;
+        continue;
+      }
 
-        result->push_back(field);
+      // Quoted field needs to be ended with '"' and delim or end
+      current_idx++;
+      const int64 start = current_idx;
+      bool escaped = false;
+      while (current_idx < size - 1) {
+        const char* quote = static_cast<const char*>(
+            memchr(data + current_idx, '"', size - 1 - current_idx));
+        if (quote == nullptr) {
+          current_idx = size - 1;
+          break;
+        }
+        current_idx = quote - data;
+        if (data[current_idx + 1] == delim_) break;
+        if (data[current_idx + 1] != '"') {
+          return errors::InvalidArgument(
+              "Quote inside a string has to be escaped by another quote");
+        }
+        escaped = true;
+        current_idx += 2;
       }
 
-      // Check if the last field is missing
-      if (input[input.size() - 1] == delim_) result->push_back(string());
+      if (!(current_idx < size && data[current_idx] == '"' &&
+            (current_idx == size - 1 || data[current_idx + 1] == delim_))) {
+        return errors::InvalidArgument(
+            "Quoted field has to end with quote followed by delim or end");
+      }
+      result->push_back(
+          {StringPiece(data + start, current_idx - start), escaped});
+      current_idx += 2;
     }
+
+    // Check if the last field is missing
+    if (data[size - 1] == delim_) result->push_back({StringPiece(), false});
+    return Status::OK();
   }
 };
 
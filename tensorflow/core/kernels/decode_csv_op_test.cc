@@ -0,0 +1,211 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class DecodeCSVOpTest : public OpsTestBase {
+ protected:
+  // Builds a DecodeCSV op for columns of "types", fed "records" and the
+  // given per-column defaults (empty tensors for required columns).
+  Status Init(const DataTypeVector& types,
+              const std::vector<string>& records,
+              const std::vector<Tensor>& defaults) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("decode_csv", "DecodeCSV")
+                           .Input(FakeInput(DT_STRING))
+                           .Input(FakeInput(types))
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    const int64 num_records = records.size();
+    AddInputFromArray<string>(TensorShape({num_records}), records);
+    for (const Tensor& t : defaults) {
+      tensors_.push_back(new Tensor(t));
+      inputs_.push_back({nullptr, tensors_.back()});
+    }
+    return Status::OK();
+  }
+};
+
+TEST_F(DecodeCSVOpTest, AllTypes) {
+  TF_ASSERT_OK(Init({DT_INT32, DT_INT64, DT_FLOAT, DT_STRING},
+                    {"1,-2,3.5,abc", ",9223372036854775807, -1e3 ,\"a,\"\"b\"",
+                     "-7,0,,\"\""},
+                    {test::AsTensor<int32>({42}), Tensor(DT_INT64),
+                     test::AsTensor<float>({0.25f}),
+                     test::AsTensor<string>({"dflt"})}));
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<int32>(*GetOutput(0),
+                                 test::AsTensor<int32>({1, 42, -7}));
+  test::ExpectTensorEqual<int64>(
+      *GetOutput(1), test::AsTensor<int64>({-2, 9223372036854775807LL, 0}));
+  test::ExpectTensorEqual<float>(*GetOutput(2),
+                                 test::AsTensor<float>({3.5f, -1e3f, 0.25f}));
+  test::ExpectTensorEqual<string>(
+      *GetOutput(3), test::AsTensor<string>({"abc", "a,\"b", "dflt"}));
+}
+
+TEST_F(DecodeCSVOpTest, MissingLastField) {
+  TF_ASSERT_OK(Init({DT_STRING, DT_STRING}, {"x,", "\"y\","},
+                    {Tensor(DT_STRING), test::AsTensor<string>({"d"})}));
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<string>(*GetOutput(0),
+                                  test::AsTensor<string>({"x", "y"}));
+  test::ExpectTensorEqual<string>(*GetOutput(1),
+                                  test::AsTensor<string>({"d", "d"}));
+}
+
+TEST_F(DecodeCSVOpTest, FloatsMatchStrtof) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> records;
+  for (int i = 0; i < 2000; ++i) {
+    const int64 digits = rnd.Uniform64(100000000);
+    const int point = rnd.Uniform(10);
+    string s = strings::StrCat(rnd.OneIn(2) ? "-" : "", digits);
+    if (point < static_cast<int>(s.size())) {
+      s.insert(s.size() - point, ".");
+    }
+    records.push_back(s);
+  }
+  TF_ASSERT_OK(Init({DT_FLOAT}, records, {Tensor(DT_FLOAT)}));
+  TF_ASSERT_OK(RunOpKernel());
+  auto out = GetOutput(0)->flat<float>();
+  for (size_t i = 0; i < records.size(); ++i) {
+    float expected;
+    ASSERT_TRUE(strings::safe_strtof(records[i].c_str(), &expected));
+    EXPECT_EQ(expected, out(i)) << records[i];
+  }
+}
+
+TEST_F(DecodeCSVOpTest, IntLimits) {
+  TF_ASSERT_OK(Init({DT_INT32, DT_INT64},
+                    {"-2147483648,-9223372036854775808",
+                     "999999999,999999999999999999", " 7 , -0"},
+                    {Tensor(DT_INT32), Tensor(DT_INT64)}));
+  TF_ASSERT_OK(RunOpKernel());
+  test::ExpectTensorEqual<int32>(
+      *GetOutput(0), test::AsTensor<int32>({-2147483647 - 1, 999999999, 7}));
+  test::ExpectTensorEqual<int64>(
+      *GetOutput(1), test::AsTensor<int64>({-9223372036854775807LL - 1,
+                                            999999999999999999LL, 0}));
+
+  for (const string& record : {"2147483648,0", "0,9223372036854775808"}) {
+    TF_ASSERT_OK(Init({DT_INT32, DT_INT64}, {record},
+                      {Tensor(DT_INT32), Tensor(DT_INT64)}));
+    EXPECT_EQ(error::INVALID_ARGUMENT, RunOpKernel().code()) << record;
+  }
+}
+
+TEST_F(DecodeCSVOpTest, ReportsFirstInvalidRecord) {
+  std::vector<string> records(1000, "1,2");
+  records[500] = "1,x";
+  records[900] = "1";
+  TF_ASSERT_OK(Init({DT_INT32, DT_INT32}, records,
+                    {Tensor(DT_INT32), Tensor(DT_INT32)}));
+  Status s = RunOpKernel();
+  EXPECT_EQ(error::INVALID_ARGUMENT, s.code());
+  EXPECT_TRUE(StringPiece(s.error_message())
+                  .contains("Field 1 in record 500 is not a valid int32: x"))
+      << s;
+}
+
+TEST_F(DecodeCSVOpTest, MalformedRecords) {
+  for (const string& record :
+       {"a\"b,c", "\"a\"b,c", "\"abc", "a\nb,c"}) {
+    TF_ASSERT_OK(Init({DT_STRING, DT_STRING}, {record},
+                      {Tensor(DT_STRING), Tensor(DT_STRING)}));
+    EXPECT_EQ(error::INVALID_ARGUMENT, RunOpKernel().code()) << record;
+  }
+}
+
+// Returns a batch of "batch_size" records of "num_fields" fields of
+// "dtype".
+static Tensor MakeRecords(int batch_size, int num_fields, DataType dtype) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor records(DT_STRING, TensorShape({batch_size}));
+  for (int b = 0; b < batch_size; ++b) {
+    string& record = records.flat<string>()(b);
+    for (int f = 0; f < num_fields; ++f) {
+      if (f > 0) record += ',';
+      switch (dtype) {
+        case DT_INT64:
+          strings::StrAppend(&record, static_cast<int64>(rnd.Rand32()));
+          break;
+        case DT_FLOAT:
+          strings::StrAppend(&record, rnd.Uniform(100000) / 100.0);
+          break;
+        default:
+          strings::StrAppend(&record, "\"str", rnd.Uniform(1000), "\"");
+      }
+    }
+  }
+  return records;
+}
+
+static Graph* DecodeCSV(int batch_size, int num_fields, DataType dtype) {
+  Graph* g = new Graph(OpRegistry::Global());
+  std::vector<NodeBuilder::NodeOut> defaults;
+  for (int f = 0; f < num_fields; ++f) {
+    defaults.emplace_back(test::graph::Constant(g, Tensor(dtype)));
+  }
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "DecodeCSV")
+                  .Input(test::graph::Constant(
+                      g, MakeRecords(batch_size, num_fields, dtype)))
+                  .Input(defaults)
+                  .Finalize(g, &ret));
+  return g;
+}
+
+// B == batch_size, F == num_fields: narrow rows have 4 fields and wide
+// rows 256.
+#define BM_DecodeCSV(TYPE, B, F)                                          \
+  static void BM_DecodeCSV_##TYPE##_##B##_##F(int iters) {                \
+    testing::UseRealTime();                                               \
+    testing::ItemsProcessed(static_cast<int64>(iters) * B * F);           \
+    test::Benchmark("cpu", DecodeCSV(B, F, DT_##TYPE)).Run(iters);        \
+  }                                                                       \
+  BENCHMARK(BM_DecodeCSV_##TYPE##_##B##_##F);
+
+#define BM_AllDecodeCSV(B, F) \
+  BM_DecodeCSV(INT64, B, F);  \
+  BM_DecodeCSV(FLOAT, B, F);  \
+  BM_DecodeCSV(STRING, B, F);
+
+BM_AllDecodeCSV(1024, 4);
+BM_AllDecodeCSV(1024, 256);
+BM_AllDecodeCSV(16384, 4);
+
+}  // namespace
+}  // namespace tensorflow
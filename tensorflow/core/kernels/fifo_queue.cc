@@ -16,7 +16,6 @@ limitations under the License.
 // See docs in ../ops/data_flow_ops.cc.
 
 #include <algorithm>
-#include <deque>
 #include <vector>
 
 #include "tensorflow/core/framework/tensor.h"
@@ -31,22 +30,61 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+// The largest number of elements in the fast path of QueueBase.
+const int64 kMaxFastPathElements = 1024;
+
+}  // namespace
+
 FIFOQueue::FIFOQueue(int capacity, const DataTypeVector& component_dtypes,
                      const std::vector<TensorShape>& component_shapes,
                      const string& name)
     : TypedQueue(capacity, component_dtypes, component_shapes, name) {}
 
-void FIFOQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
-  DCHECK_GT(queues_[0].size(), size_t{0});
+Status FIFOQueue::Initialize() {
+  TF_RETURN_IF_ERROR(TypedQueue::Initialize());
+  mutex_lock lock(mu_);
+  EnableFastPath(std::min<int64>(capacity_, kMaxFastPathElements));
+  return Status::OK();
+}
+
+void FIFOQueue::StoreFastPathElementLocked(Tuple* tuple) {
+  for (int i = 0; i < num_components(); ++i) {
+    queues_[i].PushBackElement((*tuple)[i]);
+  }
+}
+
+Status FIFOQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
+  DCHECK_GT(queues_[0].size(), 0);
   (*tuple).reserve(num_components());
   for (int i = 0; i < num_components(); ++i) {
-    (*tuple).push_back(*queues_[i][0].AccessTensor(ctx));
-    queues_[i].pop_front();
+    Tensor element;
+    TF_RETURN_IF_ERROR(queues_[i].GetElement(0, ctx, &element));
+    (*tuple).push_back(element);
+  }
+  for (int i = 0; i < num_components(); ++i) {
+    queues_[i].PopFront(1);
   }
+  return Status::OK();
+}
+
+bool FIFOQueue::ShareFrontLocked(int64 n, OpKernelContext* ctx, Tuple* tuple) {
+  Tuple batches(num_components());
+  for (int i = 0; i < num_components(); ++i) {
+    if (!queues_[i].ShareFront(n, ctx, &batches[i])) return false;
+  }
+  tuple->swap(batches);
+  return true;
 }
 
 void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                            DoneCallback callback) {
+  if (!ctx->cancellation_manager()->IsCancelled() && TryEnqueueFast(tuple)) {
+    callback();
+    return;
+  }
+
   CancellationManager* cm = ctx->cancellation_manager();
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
@@ -55,6 +93,7 @@ void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
     already_cancelled = !cm->RegisterCallback(
         token, [this, cm, token]() { Cancel(kEnqueue, cm, token); });
     if (!already_cancelled) {
+      StopFastPathLocked();
       enqueue_attempts_.emplace_back(
           1, callback, ctx, cm, token,
           [tuple, this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -63,9 +102,9 @@ void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                   errors::Aborted("FIFOQueue '", name_, "' is closed."));
               return kComplete;
             }
-            if (queues_[0].size() < static_cast<size_t>(capacity_)) {
+            if (queues_[0].size() < capacity_) {
               for (int i = 0; i < num_components(); ++i) {
-                queues_[i].push_back(PersistentTensor(tuple[i]));
+                queues_[i].PushBackElement(tuple[i]);
               }
               return kComplete;
             } else {
@@ -82,21 +121,6 @@ void FIFOQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
   }
 }
 
-/* static */
-Status FIFOQueue::GetElementComponentFromBatch(const FIFOQueue::Tuple& tuple,
-                                               int64 index, int component,
-                                               OpKernelContext* ctx,
-                                               PersistentTensor* out_tensor) {
-  TensorShape element_shape(tuple[component].shape());
-  element_shape.RemoveDim(0);
-  Tensor* element_access = nullptr;
-  TF_RETURN_IF_ERROR(ctx->allocate_persistent(
-      tuple[component].dtype(), element_shape, out_tensor, &element_access));
-  TF_RETURN_IF_ERROR(
-      CopySliceToElement(tuple[component], element_access, index));
-  return Status::OK();
-}
-
 void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
                                DoneCallback callback) {
   const int64 batch_size = tuple[0].dim_size(0);
@@ -105,6 +129,24 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
     return;
   }
 
+  // The queue copies each batch once, since the caller may modify it
+  // afterwards (e.g. if it is the value of a variable), and shares the
+  // copy with the dequeuers.
+  std::vector<PersistentTensor> batches(num_components());
+  for (int i = 0; i < num_components(); ++i) {
+    Tensor* batch = nullptr;
+    Status s = ctx->allocate_persistent(tuple[i].dtype(), tuple[i].shape(),
+                                        &batches[i], &batch);
+    if (s.ok()) {
+      s = TensorChunkQueue::CopyRows(tuple[i], 0, batch_size, batch, 0);
+    }
+    if (!s.ok()) {
+      ctx->SetStatus(s);
+      callback();
+      return;
+    }
+  }
+
   CancellationManager* cm = ctx->cancellation_manager();
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
@@ -113,33 +155,32 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
     already_cancelled = !cm->RegisterCallback(
         token, [this, cm, token]() { Cancel(kEnqueue, cm, token); });
     if (!already_cancelled) {
+      StopFastPathLocked();
       enqueue_attempts_.emplace_back(
           batch_size, callback, ctx, cm, token,
-          [tuple, this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-            if (closed_) {
-              attempt->context->SetStatus(
-                  errors::Aborted("FIFOQueue '", name_, "' is closed."));
-              return kComplete;
-            }
-            RunResult result = kNoProgress;
-            while (queues_[0].size() < static_cast<size_t>(capacity_)) {
-              result = kProgress;
-              const int64 index =
-                  tuple[0].dim_size(0) - attempt->elements_requested;
-              for (int i = 0; i < num_components(); ++i) {
-                PersistentTensor element;
-                attempt->context->SetStatus(GetElementComponentFromBatch(
-                    tuple, index, i, attempt->context, &element));
-                if (!attempt->context->status().ok()) return kComplete;
-                queues_[i].push_back(element);
-              }
-              --attempt->elements_requested;
-              if (attempt->elements_requested == 0) {
-                return kComplete;
-              }
-            }
-            return result;
-          });
+          [batches, batch_size, this](Attempt* attempt)
+              EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+                if (closed_) {
+                  attempt->context->SetStatus(
+                      errors::Aborted("FIFOQueue '", name_, "' is closed."));
+                  return kComplete;
+                }
+                const int64 queue_size = queues_[0].size();
+                if (queue_size >= capacity_) return kNoProgress;
+                // The elements stay in the copies of the batches.
+                const int64 begin = batch_size - attempt->elements_requested;
+                const int64 end =
+                    begin + std::min<int64>(attempt->elements_requested,
+                                            capacity_ - queue_size);
+                for (int i = 0; i < num_components(); ++i) {
+                  queues_[i].PushBack(batches[i], begin, end);
+                }
+                attempt->elements_requested -= end - begin;
+                if (attempt->elements_requested == 0) {
+                  return kComplete;
+                }
+                return kProgress;
+              });
     }
   }
   if (!already_cancelled) {
@@ -151,6 +192,15 @@ void FIFOQueue::TryEnqueueMany(const Tuple& tuple, OpKernelContext* ctx,
 }
 
 void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
+  {
+    Tuple tuple;
+    if (!ctx->cancellation_manager()->IsCancelled() &&
+        TryDequeueFast(&tuple)) {
+      callback(tuple);
+      return;
+    }
+  }
+
   CancellationManager* cm = ctx->cancellation_manager();
   CancellationToken token = cm->get_cancellation_token();
   bool already_cancelled;
@@ -159,6 +209,7 @@ void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
     already_cancelled = !cm->RegisterCallback(
         token, [this, cm, token]() { Cancel(kDequeue, cm, token); });
     if (!already_cancelled) {
+      StopFastPathLocked();
       // TODO(josh11b): This makes two copies of callback, avoid this if possible.
       dequeue_attempts_.emplace_back(
           1, [callback]() { callback(Tuple()); }, ctx, cm, token,
@@ -173,7 +224,9 @@ void FIFOQueue::TryDequeue(OpKernelContext* ctx, CallbackWithTuple callback) {
             }
             if (queue_size > 0) {
               Tuple tuple;
-              DequeueLocked(attempt->context, &tuple);
+              attempt->context->SetStatus(
+                  DequeueLocked(attempt->context, &tuple));
+              if (!attempt->context->status().ok()) return kComplete;
               attempt->done_callback = [callback, tuple]() { callback(tuple); };
               return kComplete;
             } else {
@@ -244,6 +297,7 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
     already_cancelled = !cm->RegisterCallback(
         token, [this, cm, token]() { Cancel(kDequeue, cm, token); });
     if (!already_cancelled) {
+      StopFastPathLocked();
       // TODO(josh11b): This makes two copies of callback, avoid this if possible.
       dequeue_attempts_.emplace_back(
           num_elements, [callback]() { callback(Tuple()); }, ctx, cm, token,
@@ -257,22 +311,11 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                   if (!attempt->tuple.empty()) {
                     // Restore already-dequeued elements to the front of the
                     // queue.
-                    for (int64 i = attempt->tuple[0].dim_size(0) -
-                                   attempt->elements_requested - 1;
-                         i >= 0; --i) {
-                      for (int j = 0; j < num_components(); ++j) {
-                        PersistentTensor element;
-                        Status s = GetElementComponentFromBatch(
-                            attempt->tuple, i, j, attempt->context, &element);
-                        if (!s.ok()) {
-                          attempt->context->SetStatus(
-                              errors::DataLoss("Failed to restore element from "
-                                               "partially-dequeued batch "
-                                               "to FIFOQueue: ",
-                                               s.error_message()));
-                        }
-                        queues_[j].push_front(element);
-                      }
+                    const int64 dequeued = attempt->tuple[0].dim_size(0) -
+                                           attempt->elements_requested;
+                    for (int j = 0; j < num_components(); ++j) {
+                      queues_[j].PushFront(PersistentTensor(attempt->tuple[j]),
+                                           0, dequeued);
                     }
                   }
                   if (allow_small_batch && queues_[0].size() > 0) {
@@ -298,9 +341,18 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                   }
                 }
 
-                RunResult result = kNoProgress;
-                for (; queue_size > 0; --queue_size) {
-                  if (attempt->tuple.empty()) {
+                if (queue_size == 0) return kNoProgress;
+                const int64 n =
+                    std::min<int64>(queue_size, attempt->elements_requested);
+                if (attempt->tuple.empty()) {
+                  if (n == attempt->elements_requested &&
+                      ShareFrontLocked(n, attempt->context, &attempt->tuple)) {
+                    // The whole batch is in the queue as is: no copy.
+                    for (int i = 0; i < num_components(); ++i) {
+                      queues_[i].PopFront(n);
+                    }
+                    attempt->elements_requested = 0;
+                  } else {
                     // Only allocate tuple when we have something to dequeue
                     // so we don't use excessive memory when there are many
                     // blocked dequeue attempts waiting.
@@ -314,27 +366,29 @@ void FIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                       attempt->tuple.emplace_back(element);
                     }
                   }
-                  result = kProgress;
-                  Tuple tuple;
-                  DequeueLocked(attempt->context, &tuple);
+                }
+                if (attempt->elements_requested > 0) {
+                  // Copies the elements chunk by chunk.
                   const int64 index = attempt->tuple[0].dim_size(0) -
                                       attempt->elements_requested;
                   for (int i = 0; i < num_components(); ++i) {
-                    attempt->context->SetStatus(CopyElementToSlice(
-                        tuple[i], &attempt->tuple[i], index));
+                    attempt->context->SetStatus(queues_[i].CopyToBatch(
+                        0, n, attempt->context, &attempt->tuple[i], index));
                     if (!attempt->context->status().ok()) return kComplete;
                   }
-                  tuple.clear();
-                  --attempt->elements_requested;
-                  if (attempt->elements_requested == 0) {
-                    tuple = attempt->tuple;
-                    attempt->done_callback = [callback, tuple]() {
-                      callback(tuple);
-                    };
-                    return kComplete;
+                  for (int i = 0; i < num_components(); ++i) {
+                    queues_[i].PopFront(n);
                   }
+                  attempt->elements_requested -= n;
+                }
+                if (attempt->elements_requested == 0) {
+                  Tuple tuple = attempt->tuple;
+                  attempt->done_callback = [callback, tuple]() {
+                    callback(tuple);
+                  };
+                  return kComplete;
                 }
-                return result;
+                return kProgress;
               });
     }
   }
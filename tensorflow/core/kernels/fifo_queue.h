@@ -16,13 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_KERNELS_FIFO_QUEUE_H_
 #define TENSORFLOW_KERNELS_FIFO_QUEUE_H_
 
-#include <deque>
 #include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/tensor_chunk_queue.h"
 #include "tensorflow/core/kernels/typed_queue.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -30,12 +30,17 @@ limitations under the License.
 
 namespace tensorflow {
 
-class FIFOQueue : public TypedQueue<std::deque<PersistentTensor> > {
+// The elements are stored in chunks of copies of the batches they were
+// enqueued in, which the queue shares, when they are aligned, with the
+// dequeuers.  Single elements are shared with the enqueuers.
+class FIFOQueue : public TypedQueue<TensorChunkQueue> {
  public:
   FIFOQueue(int32 capacity, const DataTypeVector& component_dtypes,
             const std::vector<TensorShape>& component_shapes,
             const string& name);
 
+  Status Initialize() override;
+
   // Implementations of QueueInterface methods --------------------------------
 
   void TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
@@ -50,20 +55,27 @@ class FIFOQueue : public TypedQueue<std::deque<PersistentTensor> > {
 
   int32 size() override {
     mutex_lock lock(mu_);
-    return queues_[0].size();
+    return queues_[0].size() + FastPathSize();
   }
 
  protected:
   ~FIFOQueue() override {}
 
+  int64 StoredSizeLocked() override EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return queues_[0].size();
+  }
+  void StoreFastPathElementLocked(Tuple* tuple) override
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Helper for dequeuing a single element from queues_.
-  void DequeueLocked(OpKernelContext* ctx, Tuple* tuple)
+  Status DequeueLocked(OpKernelContext* ctx, Tuple* tuple)
       EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  static Status GetElementComponentFromBatch(const Tuple& tuple, int64 index,
-                                             int component,
-                                             OpKernelContext* ctx,
-                                             PersistentTensor* out_element);
+  // If the first "n" elements of every component can be shared as a
+  // batch, sets "*tuple" to the batches and returns true.  They are not
+  // removed from queues_.
+  bool ShareFrontLocked(int64 n, OpKernelContext* ctx, Tuple* tuple)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
  private:
   TF_DISALLOW_COPY_AND_ASSIGN(FIFOQueue);
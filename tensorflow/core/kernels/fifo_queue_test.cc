@@ -0,0 +1,282 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/fifo_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+// Tests of the storage of FIFOQueue, and of the fast path it enables in
+// QueueBase: single elements go through a lock-free ring until a
+// slow-path operation moves them to the queue, so every operation must
+// see them in order.
+class FIFOQueueTest : public ::testing::Test {
+ protected:
+  FIFOQueueTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:a/replica:0/task:0")) {}
+
+  // Returns a new queue of int32 scalars, which the caller must Unref().
+  FIFOQueue* NewQueue(int32 capacity) {
+    FIFOQueue* queue = new FIFOQueue(capacity, {DT_INT32}, {TensorShape({})},
+                                     "test_queue");
+    TF_CHECK_OK(queue->Initialize());
+    return queue;
+  }
+
+  // The queue operations below run in a step of their own, and wait for
+  // the queue to call back.
+  Status Enqueue(FIFOQueue* queue, int32 value) {
+    OpKernelContext::Params params;
+    std::unique_ptr<OpKernelContext> ctx(NewContext(&params));
+    Notification done;
+    queue->TryEnqueue({test::AsScalar<int32>(value)}, ctx.get(),
+                      [&done]() { done.Notify(); });
+    done.WaitForNotification();
+    return ctx->status();
+  }
+
+  Status EnqueueMany(FIFOQueue* queue, const Tensor& batch) {
+    OpKernelContext::Params params;
+    std::unique_ptr<OpKernelContext> ctx(NewContext(&params));
+    Notification done;
+    queue->TryEnqueueMany({batch}, ctx.get(), [&done]() { done.Notify(); });
+    done.WaitForNotification();
+    return ctx->status();
+  }
+
+  Status Dequeue(FIFOQueue* queue, int32* value) {
+    OpKernelContext::Params params;
+    std::unique_ptr<OpKernelContext> ctx(NewContext(&params));
+    Notification done;
+    queue->TryDequeue(ctx.get(),
+                      [&done, value](const QueueInterface::Tuple& tuple) {
+                        if (!tuple.empty()) *value = tuple[0].scalar<int32>()();
+                        done.Notify();
+                      });
+    done.WaitForNotification();
+    return ctx->status();
+  }
+
+  Status DequeueMany(FIFOQueue* queue, int num_elements,
+                     bool allow_small_batch, std::vector<int32>* values) {
+    OpKernelContext::Params params;
+    std::unique_ptr<OpKernelContext> ctx(NewContext(&params));
+    Notification done;
+    queue->TryDequeueMany(
+        num_elements, ctx.get(), allow_small_batch,
+        [&done, values](const QueueInterface::Tuple& tuple) {
+          values->clear();
+          if (!tuple.empty()) {
+            auto flat = tuple[0].flat<int32>();
+            values->assign(flat.data(), flat.data() + flat.size());
+          }
+          done.Notify();
+        });
+    done.WaitForNotification();
+    return ctx->status();
+  }
+
+  Status Close(FIFOQueue* queue) {
+    OpKernelContext::Params params;
+    std::unique_ptr<OpKernelContext> ctx(NewContext(&params));
+    Notification done;
+    queue->Close(ctx.get(), false /* cancel_pending_enqueues */,
+                 [&done]() { done.Notify(); });
+    done.WaitForNotification();
+    return ctx->status();
+  }
+
+ private:
+  OpKernelContext* NewContext(OpKernelContext::Params* params) {
+    params->device = device_.get();
+    params->cancellation_manager = &cancellation_manager_;
+    return new OpKernelContext(params, 0);
+  }
+
+  std::unique_ptr<Device> device_;
+  CancellationManager cancellation_manager_;
+};
+
+TEST_F(FIFOQueueTest, FastPathThenDequeueMany) {
+  FIFOQueue* queue = NewQueue(100);
+  core::ScopedUnref unref(queue);
+  for (int32 i = 0; i < 5; ++i) {
+    TF_ASSERT_OK(Enqueue(queue, i));
+  }
+  std::vector<int32> values;
+  TF_ASSERT_OK(DequeueMany(queue, 3, false, &values));
+  EXPECT_EQ(std::vector<int32>({0, 1, 2}), values);
+
+  // The enqueues go to the fast path again, after the two elements left
+  // in the queue.
+  for (int32 i = 5; i < 8; ++i) {
+    TF_ASSERT_OK(Enqueue(queue, i));
+  }
+  TF_ASSERT_OK(DequeueMany(queue, 4, false, &values));
+  EXPECT_EQ(std::vector<int32>({3, 4, 5, 6}), values);
+  int32 value = -1;
+  TF_ASSERT_OK(Dequeue(queue, &value));
+  EXPECT_EQ(7, value);
+  EXPECT_EQ(0, queue->size());
+}
+
+TEST_F(FIFOQueueTest, EnqueueManyCopiesTheBatch) {
+  FIFOQueue* queue = NewQueue(100);
+  core::ScopedUnref unref(queue);
+  Tensor batch = test::AsTensor<int32>({0, 1, 2, 3});
+  TF_ASSERT_OK(EnqueueMany(queue, batch));
+  // As an assignment to an enqueued variable does.
+  batch.flat<int32>().setConstant(-1);
+
+  std::vector<int32> values;
+  TF_ASSERT_OK(DequeueMany(queue, 2, false, &values));
+  EXPECT_EQ(std::vector<int32>({0, 1}), values);
+  batch.flat<int32>().setConstant(-2);
+  int32 value = -1;
+  TF_ASSERT_OK(Dequeue(queue, &value));
+  EXPECT_EQ(2, value);
+  TF_ASSERT_OK(DequeueMany(queue, 1, false, &values));
+  EXPECT_EQ(std::vector<int32>({3}), values);
+}
+
+TEST_F(FIFOQueueTest, SizeCountsFastPathElements) {
+  FIFOQueue* queue = NewQueue(100);
+  core::ScopedUnref unref(queue);
+  EXPECT_EQ(0, queue->size());
+  for (int32 i = 0; i < 3; ++i) {
+    TF_ASSERT_OK(Enqueue(queue, i));
+    EXPECT_EQ(i + 1, queue->size());
+  }
+  int32 value = -1;
+  TF_ASSERT_OK(Dequeue(queue, &value));
+  EXPECT_EQ(0, value);
+  EXPECT_EQ(2, queue->size());
+
+  // Some elements stored by the queue, and some in the fast path.
+  std::vector<int32> values;
+  TF_ASSERT_OK(DequeueMany(queue, 1, false, &values));
+  EXPECT_EQ(std::vector<int32>({1}), values);
+  EXPECT_EQ(1, queue->size());
+  TF_ASSERT_OK(Enqueue(queue, 3));
+  TF_ASSERT_OK(Enqueue(queue, 4));
+  EXPECT_EQ(3, queue->size());
+}
+
+TEST_F(FIFOQueueTest, CloseDrainsFastPath) {
+  FIFOQueue* queue = NewQueue(100);
+  core::ScopedUnref unref(queue);
+  for (int32 i = 0; i < 5; ++i) {
+    TF_ASSERT_OK(Enqueue(queue, i));
+  }
+  TF_ASSERT_OK(Close(queue));
+  EXPECT_EQ(5, queue->size());
+  EXPECT_TRUE(errors::IsAborted(Enqueue(queue, 5)));
+
+  int32 value = -1;
+  TF_ASSERT_OK(Dequeue(queue, &value));
+  EXPECT_EQ(0, value);
+  std::vector<int32> values;
+  TF_ASSERT_OK(DequeueMany(queue, 2, false, &values));
+  EXPECT_EQ(std::vector<int32>({1, 2}), values);
+  for (int32 i = 3; i < 5; ++i) {
+    TF_ASSERT_OK(Dequeue(queue, &value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(Dequeue(queue, &value)));
+  EXPECT_TRUE(errors::IsOutOfRange(DequeueMany(queue, 1, false, &values)));
+}
+
+TEST_F(FIFOQueueTest, ConcurrentFastAndSlowPaths) {
+  const int kProducers = 4;
+  const int kSingleConsumers = 2;
+  const int kManyConsumers = 2;
+  const int32 kValuesPerProducer = 2000;
+  FIFOQueue* queue = NewQueue(50);
+  core::ScopedUnref unref(queue);
+
+  mutex mu;
+  // The number of times each value was enqueued, and dequeued.
+  std::vector<int> enqueued(kProducers * kValuesPerProducer, 0);
+  std::vector<int> dequeued(kProducers * kValuesPerProducer, 0);
+  Notification first_producer_done;
+  {
+    thread::ThreadPool pool(Env::Default(), "test",
+                            kProducers + kSingleConsumers + kManyConsumers);
+    for (int p = 0; p < kProducers; ++p) {
+      pool.Schedule([this, queue, p, &mu, &enqueued, &first_producer_done]() {
+        for (int32 i = p * kValuesPerProducer; i < (p + 1) * kValuesPerProducer;
+             ++i) {
+          if (Enqueue(queue, i).ok()) {
+            mutex_lock l(mu);
+            ++enqueued[i];
+          }
+        }
+        if (p == 0) first_producer_done.Notify();
+      });
+    }
+    for (int c = 0; c < kSingleConsumers; ++c) {
+      pool.Schedule([this, queue, &mu, &dequeued]() {
+        int32 value;
+        while (Dequeue(queue, &value).ok()) {
+          mutex_lock l(mu);
+          ++dequeued[value];
+        }
+      });
+    }
+    for (int c = 0; c < kManyConsumers; ++c) {
+      pool.Schedule([this, queue, c, &mu, &dequeued]() {
+        std::vector<int32> values;
+        while (DequeueMany(queue, 3 + c, true, &values).ok()) {
+          mutex_lock l(mu);
+          for (int32 value : values) ++dequeued[value];
+        }
+      });
+    }
+    // Close while the other producers may still be enqueuing.
+    first_producer_done.WaitForNotification();
+    TF_EXPECT_OK(Close(queue));
+  }
+
+  EXPECT_EQ(0, queue->size());
+  int64 num_enqueued = 0;
+  for (int i = 0; i < kProducers * kValuesPerProducer; ++i) {
+    EXPECT_EQ(enqueued[i], dequeued[i]) << "value " << i;
+    num_enqueued += enqueued[i];
+  }
+  EXPECT_GE(num_enqueued, kValuesPerProducer);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,176 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_LOCK_FREE_RING_H_
+#define TENSORFLOW_CORE_KERNELS_LOCK_FREE_RING_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A bounded first-in first-out queue that any number of threads may push
+// to and pop from concurrently without locking.
+//
+// Each slot of a ring buffer has a sequence number telling whether it
+// holds a value for the push or the pop at a given position: threads
+// claim positions by compare-and-swap, then publish the slot by updating
+// its sequence number.  A push (pop) fails instead of waiting when the
+// ring is full (empty), including for the short time another thread has
+// claimed but not yet published the slot it needs.
+template <typename T>
+class LockFreeRing {
+ public:
+  // "max_capacity" is the largest capacity the ring may be set to.
+  explicit LockFreeRing(int64 max_capacity);
+
+  // Returns the number of values in the ring.  Pushes and pops in
+  // progress are counted as done.
+  int64 size() const { return size_.load(std::memory_order_relaxed); }
+
+  int64 capacity() const { return capacity_; }
+  int64 max_capacity() const { return max_capacity_; }
+
+  // Sets the number of values the ring holds at most.
+  // REQUIRES: 0 <= capacity <= max_capacity, and no concurrent calls to
+  // any method.
+  void set_capacity(int64 capacity) {
+    DCHECK_GE(capacity, 0);
+    DCHECK_LE(capacity, max_capacity_);
+    capacity_ = capacity;
+  }
+
+  // Appends a copy of "value" and returns true, unless the ring is full.
+  bool TryPush(const T& value);
+
+  // Moves the first value to "*value" and returns true, unless the ring is
+  // empty.
+  bool TryPop(T* value);
+
+ private:
+  struct Slot {
+    std::atomic<uint64> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  const uint64 mask_;  // The number of slots, a power of two, minus one.
+  const int64 max_capacity_;
+  int64 capacity_;
+  std::atomic<int64> size_;
+  std::atomic<uint64> push_position_;
+  std::atomic<uint64> pop_position_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(LockFreeRing);
+};
+
+// Implementation details follow.
+
+namespace lock_free_ring_internal {
+
+// Returns the smallest power of two that is at least "n" and 2.
+inline uint64 RoundUpToPowerOfTwo(int64 n) {
+  uint64 power = 2;
+  while (power < static_cast<uint64>(n)) power <<= 1;
+  return power;
+}
+
+}  // namespace lock_free_ring_internal
+
+template <typename T>
+LockFreeRing<T>::LockFreeRing(int64 max_capacity)
+    : mask_(lock_free_ring_internal::RoundUpToPowerOfTwo(max_capacity) - 1),
+      max_capacity_(max_capacity),
+      capacity_(max_capacity),
+      size_(0),
+      push_position_(0),
+      pop_position_(0) {
+  DCHECK_GE(max_capacity, 0);
+  slots_.reset(new Slot[mask_ + 1]);
+  for (uint64 i = 0; i <= mask_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+bool LockFreeRing<T>::TryPush(const T& value) {
+  // Reserves room for the value first, so that capacity_ bounds the values
+  // whether or not they are published yet.
+  if (size_.fetch_add(1, std::memory_order_relaxed) >= capacity_) {
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  uint64 position = push_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & mask_];
+    const uint64 sequence = slot->sequence.load(std::memory_order_acquire);
+    const int64 diff =
+        static_cast<int64>(sequence) - static_cast<int64>(position);
+    if (diff == 0) {
+      if (push_position_.compare_exchange_weak(position, position + 1,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The value of the slot has been claimed but not yet popped.
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = push_position_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->value = value;
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool LockFreeRing<T>::TryPop(T* value) {
+  uint64 position = pop_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & mask_];
+    const uint64 sequence = slot->sequence.load(std::memory_order_acquire);
+    const int64 diff =
+        static_cast<int64>(sequence) - static_cast<int64>(position + 1);
+    if (diff == 0) {
+      if (pop_position_.compare_exchange_weak(position, position + 1,
+                                              std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The slot has not been pushed to, or its value not yet published.
+      return false;
+    } else {
+      position = pop_position_.load(std::memory_order_relaxed);
+    }
+  }
+  *value = std::move(slot->value);
+  // Releases what the slot still refers to before it may be reused.
+  slot->value = T();
+  slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_LOCK_FREE_RING_H_
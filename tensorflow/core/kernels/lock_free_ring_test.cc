@@ -0,0 +1,107 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/lock_free_ring.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(LockFreeRingTest, PushAndPop) {
+  LockFreeRing<int> ring(3);
+  EXPECT_EQ(3, ring.capacity());
+  int value;
+  EXPECT_FALSE(ring.TryPop(&value));
+  for (int round = 0; round < 5; ++round) {
+    EXPECT_TRUE(ring.TryPush(3 * round));
+    EXPECT_TRUE(ring.TryPush(3 * round + 1));
+    EXPECT_TRUE(ring.TryPush(3 * round + 2));
+    EXPECT_FALSE(ring.TryPush(-1));
+    EXPECT_EQ(3, ring.size());
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(ring.TryPop(&value));
+      EXPECT_EQ(3 * round + i, value);
+    }
+    EXPECT_FALSE(ring.TryPop(&value));
+    EXPECT_EQ(0, ring.size());
+  }
+}
+
+TEST(LockFreeRingTest, SetCapacity) {
+  LockFreeRing<int> ring(4);
+  ring.set_capacity(1);
+  EXPECT_TRUE(ring.TryPush(1));
+  EXPECT_FALSE(ring.TryPush(2));
+  ring.set_capacity(4);
+  EXPECT_TRUE(ring.TryPush(2));
+  ring.set_capacity(0);
+  EXPECT_FALSE(ring.TryPush(3));
+  int value;
+  ASSERT_TRUE(ring.TryPop(&value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(ring.TryPop(&value));
+  EXPECT_EQ(2, value);
+}
+
+TEST(LockFreeRingTest, Concurrent) {
+  const int kThreads = 4;
+  const int kValuesPerThread = 10000;
+  LockFreeRing<int> ring(16);
+  // Each value is pushed by one producer and popped by one consumer, and
+  // the values of each producer are popped in order.
+  std::vector<std::vector<int>> popped(kThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 2 * kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+      pool.Schedule([&ring, t]() {
+        for (int i = 0; i < kValuesPerThread; ++i) {
+          while (!ring.TryPush(t * kValuesPerThread + i)) {
+            Env::Default()->SleepForMicroseconds(1);
+          }
+        }
+      });
+      pool.Schedule([&ring, &popped, t]() {
+        while (popped[t].size() < kValuesPerThread) {
+          int value;
+          if (ring.TryPop(&value)) {
+            popped[t].push_back(value);
+          } else {
+            Env::Default()->SleepForMicroseconds(1);
+          }
+        }
+      });
+    }
+  }
+  std::vector<int> count(kThreads * kValuesPerThread, 0);
+  for (int t = 0; t < kThreads; ++t) {
+    std::vector<int> consumer_last(kThreads, -1);
+    for (int value : popped[t]) {
+      const int producer = value / kValuesPerThread;
+      EXPECT_LT(consumer_last[producer], value);
+      consumer_last[producer] = value;
+      ++count[value];
+    }
+  }
+  for (int c : count) EXPECT_EQ(1, c);
+  EXPECT_EQ(0, ring.size());
+}
+
+}  // namespace
+}  // namespace tensorflow
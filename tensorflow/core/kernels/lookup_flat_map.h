@@ -0,0 +1,212 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_LOOKUP_FLAT_MAP_H_
+#define TENSORFLOW_CORE_KERNELS_LOOKUP_FLAT_MAP_H_
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// Returns the 64-bit fingerprint of a lookup table key.
+inline uint64 HashKey(const string& key) { return Hash64(key); }
+
+inline uint64 HashKey(int64 key) {
+  // The finalizer of MurmurHash3, which spreads the bits of consecutive
+  // keys over the whole fingerprint.
+  uint64 h = static_cast<uint64>(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+template <class K>
+inline uint64 HashKey(const K& key) {
+  return std::hash<K>()(key);
+}
+
+// A hash map from keys of type K to values of type V, with open addressing.
+//
+// The keys and values are stored in insertion order in two flat arrays,
+// which the slots of a linear probing table index.  Each slot also holds
+// the fingerprint of its key, so that probing compares keys only when
+// their fingerprints are equal, and growing the table does not rehash
+// them.  Keys cannot be removed, except all at once by Clear().
+//
+// The const methods may be called concurrently with each other, but not
+// with the others.
+template <class K, class V>
+class FlatMap {
+ public:
+  FlatMap() : slots_(new Slot[kMinSlots]), mask_(kMinSlots - 1) {}
+
+  int64 size() const { return keys_.size(); }
+
+  // The key and value of the i^th entry, in insertion order.
+  // REQUIRES: 0 <= i < size()
+  const K& key(int64 i) const { return keys_[i]; }
+  const V& value(int64 i) const { return values_[i]; }
+
+  // Makes room for "n" entries in total, so that inserting them does not
+  // grow the table.
+  void Reserve(int64 n);
+
+  // Removes all the entries.
+  void Clear();
+
+  // Returns the value of "key", or nullptr if it is not in the map.
+  const V* Find(const K& key) const {
+    const int64 index = IndexOf(key, HashKey(key));
+    return index < 0 ? nullptr : &values_[index];
+  }
+
+  // Inserts "key" with "value" unless "key" is in the map already.  Returns
+  // the value of "key" in the map, valid until the next insertion, and
+  // whether it was inserted.
+  std::pair<const V*, bool> Insert(const K& key, const V& value);
+
+  // Inserts "key" with "value", or sets the value of "key" to "value" if
+  // it is in the map already.
+  void InsertOrAssign(const K& key, const V& value);
+
+ private:
+  static const int64 kMinSlots = 8;
+
+  struct Slot {
+    uint64 hash;
+    int64 index;  // In keys_ and values_, or -1 if the slot is empty.
+    Slot() : index(-1) {}
+  };
+
+  // Returns the index of "key", whose fingerprint is "hash", or -1.
+  int64 IndexOf(const K& key, uint64 hash) const;
+
+  // Adds "key" with "value" at the end of the arrays, and indexes it.
+  // REQUIRES: "key" is not in the map.
+  void Append(const K& key, uint64 hash, const V& value);
+
+  // Rebuilds the table with "num_slots" slots, a power of two.
+  void Rehash(int64 num_slots);
+
+  // Returns the number of slots needed for "n" entries.  The table is at
+  // most 3/4 full, which keeps the probe sequences short.
+  static int64 SlotsFor(int64 n) {
+    int64 num_slots = kMinSlots;
+    while (num_slots * 3 < n * 4) num_slots <<= 1;
+    return num_slots;
+  }
+
+  std::unique_ptr<Slot[]> slots_;
+  uint64 mask_;  // The number of slots, a power of two, minus one.
+  std::vector<K> keys_;
+  std::vector<V> values_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FlatMap);
+};
+
+// Implementation details follow.
+
+template <class K, class V>
+void FlatMap<K, V>::Reserve(int64 n) {
+  keys_.reserve(n);
+  values_.reserve(n);
+  const int64 num_slots = SlotsFor(n);
+  if (num_slots > static_cast<int64>(mask_ + 1)) Rehash(num_slots);
+}
+
+template <class K, class V>
+void FlatMap<K, V>::Clear() {
+  keys_.clear();
+  values_.clear();
+  for (uint64 i = 0; i <= mask_; ++i) {
+    slots_[i].index = -1;
+  }
+}
+
+template <class K, class V>
+int64 FlatMap<K, V>::IndexOf(const K& key, uint64 hash) const {
+  for (uint64 i = hash & mask_;; i = (i + 1) & mask_) {
+    const Slot& slot = slots_[i];
+    if (slot.index < 0) return -1;
+    if (slot.hash == hash && keys_[slot.index] == key) return slot.index;
+  }
+}
+
+template <class K, class V>
+std::pair<const V*, bool> FlatMap<K, V>::Insert(const K& key, const V& value) {
+  const uint64 hash = HashKey(key);
+  const int64 index = IndexOf(key, hash);
+  if (index >= 0) return std::make_pair(&values_[index], false);
+  Append(key, hash, value);
+  return std::make_pair(&values_.back(), true);
+}
+
+template <class K, class V>
+void FlatMap<K, V>::InsertOrAssign(const K& key, const V& value) {
+  const uint64 hash = HashKey(key);
+  const int64 index = IndexOf(key, hash);
+  if (index >= 0) {
+    values_[index] = value;
+  } else {
+    Append(key, hash, value);
+  }
+}
+
+template <class K, class V>
+void FlatMap<K, V>::Append(const K& key, uint64 hash, const V& value) {
+  const int64 index = keys_.size();
+  if (SlotsFor(index + 1) > static_cast<int64>(mask_ + 1)) {
+    Rehash(2 * (mask_ + 1));
+  }
+  keys_.push_back(key);
+  values_.push_back(value);
+  uint64 i = hash & mask_;
+  while (slots_[i].index >= 0) i = (i + 1) & mask_;
+  slots_[i].hash = hash;
+  slots_[i].index = index;
+}
+
+template <class K, class V>
+void FlatMap<K, V>::Rehash(int64 num_slots) {
+  DCHECK_EQ(0, num_slots & (num_slots - 1));
+  std::unique_ptr<Slot[]> old_slots(new Slot[num_slots]);
+  old_slots.swap(slots_);
+  const uint64 old_mask = mask_;
+  mask_ = num_slots - 1;
+  for (uint64 j = 0; j <= old_mask; ++j) {
+    const Slot& slot = old_slots[j];
+    if (slot.index < 0) continue;
+    uint64 i = slot.hash & mask_;
+    while (slots_[i].index >= 0) i = (i + 1) & mask_;
+    slots_[i] = slot;
+  }
+}
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_LOOKUP_FLAT_MAP_H_
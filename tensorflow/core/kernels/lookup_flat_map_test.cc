@@ -0,0 +1,133 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/lookup_flat_map.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+TEST(FlatMapTest, InsertAndFind) {
+  FlatMap<string, int64> map;
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(nullptr, map.Find("a"));
+
+  auto inserted = map.Insert("a", 1);
+  EXPECT_TRUE(inserted.second);
+  EXPECT_EQ(1, *inserted.first);
+  inserted = map.Insert("a", 2);
+  EXPECT_FALSE(inserted.second);
+  EXPECT_EQ(1, *inserted.first);
+  map.InsertOrAssign("b", 3);
+  map.InsertOrAssign("a", 4);
+
+  EXPECT_EQ(2, map.size());
+  ASSERT_NE(nullptr, map.Find("a"));
+  EXPECT_EQ(4, *map.Find("a"));
+  ASSERT_NE(nullptr, map.Find("b"));
+  EXPECT_EQ(3, *map.Find("b"));
+  EXPECT_EQ(nullptr, map.Find("c"));
+  EXPECT_EQ("a", map.key(0));
+  EXPECT_EQ(4, map.value(0));
+  EXPECT_EQ("b", map.key(1));
+  EXPECT_EQ(3, map.value(1));
+}
+
+TEST(FlatMapTest, Grow) {
+  const int64 kNumKeys = 10000;
+  FlatMap<int64, string> map;
+  for (int64 i = 0; i < kNumKeys; ++i) {
+    EXPECT_TRUE(map.Insert(i * 7, strings::StrCat(i)).second);
+  }
+  EXPECT_EQ(kNumKeys, map.size());
+  for (int64 i = 0; i < 7 * kNumKeys; ++i) {
+    const string* value = map.Find(i);
+    if (i % 7 == 0) {
+      ASSERT_NE(nullptr, value);
+      EXPECT_EQ(strings::StrCat(i / 7), *value);
+    } else {
+      EXPECT_EQ(nullptr, value);
+    }
+  }
+}
+
+TEST(FlatMapTest, ReserveAndClear) {
+  FlatMap<string, float> map;
+  map.Reserve(100);
+  for (int i = 0; i < 100; ++i) {
+    map.InsertOrAssign(strings::StrCat("key", i), i);
+  }
+  EXPECT_EQ(100, map.size());
+  map.Clear();
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(nullptr, map.Find("key0"));
+  map.InsertOrAssign("key1", -1);
+  EXPECT_EQ(1, map.size());
+  EXPECT_EQ(-1, *map.Find("key1"));
+}
+
+TEST(FlatMapTest, ConcurrentFind) {
+  const int kThreads = 4;
+  const int64 kNumKeys = 1000;
+  FlatMap<string, int64> map;
+  for (int64 i = 0; i < kNumKeys; ++i) {
+    map.Insert(strings::StrCat(i), i);
+  }
+  std::vector<int64> found(kThreads, 0);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+      pool.Schedule([&map, &found, t]() {
+        for (int64 i = 0; i < 2 * kNumKeys; ++i) {
+          const int64* value = map.Find(strings::StrCat(i));
+          if (value != nullptr && *value == i) ++found[t];
+        }
+      });
+    }
+  }
+  for (int64 n : found) EXPECT_EQ(kNumKeys, n);
+}
+
+static void BM_FlatMapFind(int iters, int num_keys) {
+  testing::StopTiming();
+  FlatMap<string, int64> map;
+  std::vector<string> keys;
+  for (int i = 0; i < num_keys; ++i) {
+    keys.push_back(strings::StrCat("vocabulary_word_", i));
+    map.Insert(keys.back(), i);
+  }
+  testing::StartTiming();
+  int64 sum = 0;
+  for (int i = 0; i < iters; ++i) {
+    const int64* value = map.Find(keys[(i * 7919) % num_keys]);
+    if (value != nullptr) sum += *value;
+  }
+  testing::StopTiming();
+  CHECK_GE(sum, 0);
+  testing::ItemsProcessed(iters);
+}
+BENCHMARK(BM_FlatMapFind)->Arg(1000)->Arg(1000000);
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
@@ -24,9 +24,11 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
+#include "tensorflow/core/kernels/lookup_flat_map.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
-#include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -49,21 +51,88 @@ const float SubtleMustCopyUnlessStringOrFloat(const float value) {
   return value;
 }
 
+// A lock held either by any number of readers or by one writer.  Waiting
+// writers keep new readers out, so that a stream of lookups cannot starve
+// the updates of a table.
+class LOCKABLE SharedMutex {
+ public:
+  SharedMutex() {}
+
+  void lock() EXCLUSIVE_LOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    ++waiting_writers_;
+    while (writer_ || readers_ > 0) cv_.wait(l);
+    --waiting_writers_;
+    writer_ = true;
+  }
+
+  void unlock() UNLOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    writer_ = false;
+    cv_.notify_all();
+  }
+
+  void lock_shared() SHARED_LOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    while (writer_ || waiting_writers_ > 0) cv_.wait(l);
+    ++readers_;
+  }
+
+  void unlock_shared() UNLOCK_FUNCTION() {
+    mutex_lock l(mu_);
+    if (--readers_ == 0) cv_.notify_all();
+  }
+
+ private:
+  mutex mu_;
+  condition_variable cv_;
+  int readers_ GUARDED_BY(mu_) = 0;
+  int waiting_writers_ GUARDED_BY(mu_) = 0;
+  bool writer_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMutex);
+};
+
+class SCOPED_LOCKABLE ReaderLock {
+ public:
+  explicit ReaderLock(SharedMutex* mu) SHARED_LOCK_FUNCTION(mu) : mu_(mu) {
+    mu_->lock_shared();
+  }
+  ~ReaderLock() UNLOCK_FUNCTION() { mu_->unlock_shared(); }
+
+ private:
+  SharedMutex* const mu_;
+  TF_DISALLOW_COPY_AND_ASSIGN(ReaderLock);
+};
+
+class SCOPED_LOCKABLE WriterLock {
+ public:
+  explicit WriterLock(SharedMutex* mu) EXCLUSIVE_LOCK_FUNCTION(mu) : mu_(mu) {
+    mu_->lock();
+  }
+  ~WriterLock() UNLOCK_FUNCTION() { mu_->unlock(); }
+
+ private:
+  SharedMutex* const mu_;
+  TF_DISALLOW_COPY_AND_ASSIGN(WriterLock);
+};
+
 }  // namespace
 
-// Lookup table that wraps an unordered_map, where the key and value data type
-// is specified.
+// Lookup table that wraps a FlatMap, where the key and value data type is
+// specified.
 //
 // This table is recommended for any variations to key values.
 //
 // For look up, the table is required to be initialized (allocated
-// and populated). Once the table is marked as initialized it becomes read-only.
+// and populated). Once the table is marked as initialized it becomes read-only,
+// and lookups run concurrently without locking.
 //
 // Sample use case:
 //
 // HashTable<int64, int64> table;  // int64 -> int64.
-// table.Prepare(10); // Prepare the underlying data structure, the number of
-//                    // elements is required by interface, but not used.
+// table.Prepare(10); // Prepare the underlying data structure, presized for
+//                    // the given number of elements.
 // // Populate the table, elements could be added in one or multiple calls.
 // table.Insert(key_tensor, value_tensor); // Populate the table.
 // ...
@@ -90,13 +159,17 @@ class HashTable : public InitializableLookupTable {
   DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
 
  protected:
-  Status DoPrepare(size_t unused) override {
+  Status DoPrepare(size_t expected_num_elements) override {
     if (is_initialized_) {
       return errors::Aborted("HashTable already initialized.");
     }
     if (!table_) {
-      table_ = std::unique_ptr<std::unordered_map<K, V>>(
-          new std::unordered_map<K, V>());
+      table_ = std::unique_ptr<FlatMap<K, V>>(new FlatMap<K, V>());
+    }
+    // Initializers that do not know their size pass -1.
+    const int64 num_elements = static_cast<int64>(expected_num_elements);
+    if (num_elements > 0) {
+      table_->Reserve(num_elements);
     }
     return Status::OK();
   };
@@ -111,7 +184,7 @@ class HashTable : public InitializableLookupTable {
     for (int64 i = 0; i < key_values.size(); ++i) {
       const K key = SubtleMustCopyUnlessStringOrFloat(key_values(i));
       const V value = SubtleMustCopyUnlessStringOrFloat(value_values(i));
-      const V& previous_value = gtl::LookupOrInsert(table_.get(), key, value);
+      const V& previous_value = *table_->Insert(key, value).first;
       if (previous_value != value) {
         return errors::FailedPrecondition(
             "HashTable has different value for same key. Key ", key, " has ",
@@ -128,22 +201,24 @@ class HashTable : public InitializableLookupTable {
     auto value_values = value->flat<V>();
 
     for (int64 i = 0; i < key_values.size(); ++i) {
-      value_values(i) = gtl::FindWithDefault(
-          *table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
-          default_val);
+      const V* found =
+          table_->Find(SubtleMustCopyUnlessStringOrFloat(key_values(i)));
+      value_values(i) = found != nullptr ? *found : default_val;
     }
     return Status::OK();
   }
 
  private:
-  std::unique_ptr<std::unordered_map<K, V>> table_;
+  std::unique_ptr<FlatMap<K, V>> table_;
 };
 
-// Lookup table that wraps an unordered_map, where the key and value data type
-// is specified. Each individual value must be a scalar. If vector values are
+// Lookup table that wraps a FlatMap, where the key and value data type is
+// specified. Each individual value must be a scalar. If vector values are
 // required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// Lookups share a reader-writer lock, so that they run concurrently with each
+// other, but not with the updates.
 //
 // Sample use case:
 //
@@ -159,7 +234,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
   MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
 
   size_t size() const override {
-    mutex_lock l(mu_);
+    ReaderLock l(&mu_);
     return table_.size();
   }
 
@@ -169,11 +244,11 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
-    mutex_lock l(mu_);
+    ReaderLock l(&mu_);
     for (int64 i = 0; i < key_values.size(); ++i) {
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)),
-          default_val);
+      const V* found =
+          table_.Find(SubtleMustCopyUnlessStringOrFloat(key_values(i)));
+      value_values(i) = found != nullptr ? *found : default_val;
     }
 
     return Status::OK();
@@ -183,14 +258,15 @@ class MutableHashTableOfScalars final : public LookupInterface {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
+    WriterLock l(&mu_);
     if (clear) {
-      table_.clear();
+      table_.Clear();
+      table_.Reserve(key_values.size());
     }
     for (int64 i = 0; i < key_values.size(); ++i) {
       const K key = SubtleMustCopyUnlessStringOrFloat(key_values(i));
       const V value = SubtleMustCopyUnlessStringOrFloat(value_values(i));
-      gtl::InsertOrUpdate(&table_, key, value);
+      table_.InsertOrAssign(key, value);
     }
     return Status::OK();
   }
@@ -204,7 +280,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    mutex_lock l(mu_);
+    ReaderLock l(&mu_);
     int64 size = table_.size();
 
     Tensor* keys;
@@ -216,10 +292,9 @@ class MutableHashTableOfScalars final : public LookupInterface {
 
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
-    int64 i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
+    for (int64 i = 0; i < size; ++i) {
+      keys_data(i) = table_.key(i);
+      values_data(i) = table_.value(i);
     }
     return Status::OK();
   }
@@ -231,12 +306,11 @@ class MutableHashTableOfScalars final : public LookupInterface {
   TensorShape value_shape() const override { return TensorShape(); }
 
  private:
-  // TODO(andreasst): consider using a read/write lock or a concurrent map
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ GUARDED_BY(mu_);
+  mutable SharedMutex mu_;
+  FlatMap<K, V> table_ GUARDED_BY(mu_);
 };
 
-// Lookup table that wraps an unordered_map. Behaves identical to
+// Lookup table that wraps a FlatMap. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
 class MutableHashTableOfTensors final : public LookupInterface {
@@ -251,7 +325,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   size_t size() const override {
-    mutex_lock l(mu_);
+    ReaderLock l(&mu_);
     return table_.size();
   }
 
@@ -262,10 +336,10 @@ class MutableHashTableOfTensors final : public LookupInterface {
     auto value_values = value->flat_inner_dims<V, 2>();
     int64 value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
+    ReaderLock l(&mu_);
     for (int64 i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec = gtl::FindOrNull(
-          table_, SubtleMustCopyUnlessStringOrFloat(key_values(i)));
+      const ValueArray* value_vec =
+          table_.Find(SubtleMustCopyUnlessStringOrFloat(key_values(i)));
       if (value_vec != nullptr) {
         for (int64 j = 0; j < value_dim; j++) {
           value_values(i, j) = value_vec->at(j);
@@ -285,9 +359,10 @@ class MutableHashTableOfTensors final : public LookupInterface {
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64 value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
+    WriterLock l(&mu_);
     if (clear) {
-      table_.clear();
+      table_.Clear();
+      table_.Reserve(key_values.size());
     }
     for (int64 i = 0; i < key_values.size(); ++i) {
       const K key = SubtleMustCopyUnlessStringOrFloat(key_values(i));
@@ -296,7 +371,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
         V value = value_values(i, j);
         value_vec.push_back(value);
       }
-      gtl::InsertOrUpdate(&table_, key, value_vec);
+      table_.InsertOrAssign(key, value_vec);
     }
     return Status::OK();
   }
@@ -310,7 +385,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    mutex_lock l(mu_);
+    ReaderLock l(&mu_);
     int64 size = table_.size();
     int64 value_dim = value_shape_.dim_size(0);
 
@@ -323,11 +398,9 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
     auto keys_data = keys->flat<K>();
     auto values_data = values->matrix<V>();
-    int64 i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
-      keys_data(i) = key;
+    for (int64 i = 0; i < size; ++i) {
+      keys_data(i) = table_.key(i);
+      const ValueArray& value = table_.value(i);
       for (int64 j = 0; j < value_dim; j++) {
         values_data(i, j) = value[j];
       }
@@ -343,10 +416,9 @@ class MutableHashTableOfTensors final : public LookupInterface {
 
  private:
   TensorShape value_shape_;
-  // TODO(andreasst): consider using a read/write lock or a concurrent map
-  mutable mutex mu_;
+  mutable SharedMutex mu_;
   typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ GUARDED_BY(mu_);
+  FlatMap<K, ValueArray> table_ GUARDED_BY(mu_);
 };
 
 }  // namespace lookup
@@ -15,7 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/data_flow_ops.cc.
 
-#include <deque>
+#include <algorithm>
 #include <vector>
 
 #include "tensorflow/core/framework/register_types.h"
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/padding_fifo_queue.h"
 #include "tensorflow/core/kernels/queue_base.h"
+#include "tensorflow/core/kernels/tensor_chunk_queue.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -52,18 +53,6 @@ Status PaddingFIFOQueue::Initialize() {
   return Status::OK();
 }
 
-/* static */
-Status PaddingFIFOQueue::GetElementComponent(
-    const PaddingFIFOQueue::Tuple& tuple, int component, OpKernelContext* ctx,
-    PersistentTensor* out_tensor) {
-  TensorShape element_shape(tuple[component].shape());
-  Tensor* element_access = nullptr;
-  TF_RETURN_IF_ERROR(ctx->allocate_persistent(
-      tuple[component].dtype(), element_shape, out_tensor, &element_access));
-  *element_access = tuple[component];
-  return Status::OK();
-}
-
 void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                                       bool allow_small_batch,
                                       CallbackWithTuple callback) {
@@ -91,30 +80,23 @@ void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
     already_cancelled = !cm->RegisterCallback(
         token, [this, cm, token]() { Cancel(kDequeue, cm, token); });
     if (!already_cancelled) {
+      StopFastPathLocked();
       // TODO(josh11b): This makes two copies of callback, avoid this if possible.
       dequeue_attempts_.emplace_back(
           num_elements, [callback]() { callback(Tuple()); }, ctx, cm, token,
           [callback, allow_small_batch,
            this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-            int32 queue_size = queues_[0].size();
+            int64 queue_size = queues_[0].size();
             if (closed_ && queue_size < attempt->elements_requested) {
               // If we don't have enough for a full dequeue, we have
               // to reset the attempt tuple.
               if (!attempt->tuples.empty()) {
                 // Restore already-dequeued elements to the front of the queue.
-                for (int64 i = attempt->tuples.size() - 1; i >= 0; --i) {
-                  for (int j = 0; j < num_components(); ++j) {
-                    PersistentTensor element;
-                    Status s = GetElementComponent(attempt->tuples[i], j,
-                                                   attempt->context, &element);
-                    if (!s.ok()) {
-                      attempt->context->SetStatus(
-                          errors::DataLoss("Failed to restore element from "
-                                           "partially-dequeued batch "
-                                           "to PaddingFIFOQueue: ",
-                                           s.error_message()));
-                    }
-                    queues_[j].push_front(element);
+                for (int j = 0; j < num_components(); ++j) {
+                  const Tuple& runs = attempt->tuples[j];
+                  for (int64 i = runs.size() - 1; i >= 0; --i) {
+                    queues_[j].PushFront(PersistentTensor(runs[i]), 0,
+                                         runs[i].dim_size(0));
                   }
                 }
               }
@@ -141,83 +123,83 @@ void PaddingFIFOQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
               }
             }
 
-            RunResult result = kNoProgress;
-            for (; queue_size > 0; --queue_size) {
-              result = kProgress;
-              Tuple tuple;
-              DequeueLocked(attempt->context, &tuple);
-              attempt->tuples.push_back(tuple);
-              tuple.clear();
-              --attempt->elements_requested;
-
-              if (attempt->elements_requested == 0) {
-                // Finished.  Allocate attempt->tuple and
-                // copy from attempt->tuples to attempt->tuple.
-                attempt->tuple.reserve(num_components());
-                const std::vector<Tuple>& tuples = attempt->tuples;
-
-                std::vector<bool> dynamic_shape;
-                const int64 batch_size = tuples.size();
-
-                for (int i = 0; i < num_components(); ++i) {
-                  const PartialTensorShape partial_shape =
-                      PartialTensorShape({batch_size})
-                          .Concatenate(partial_shapes_[i]);
-                  TensorShape shape({batch_size});
-
-                  for (int j = 0; j < partial_shape.dims() - 1; ++j) {
-                    if (partial_shape.dim_size(j + 1) > -1) {
-                      shape.AddDim(partial_shape.dim_size(j + 1));
-                    } else {
-                      // Expand sizes to match.
-                      int64 max_val = 0;
-                      for (const Tuple& t : tuples) {
-                        max_val = std::max(max_val, t[i].shape().dim_size(j));
-                      }
-                      shape.AddDim(max_val);
-                    }
-                  }
-
-                  Tensor element;
-                  attempt->context->allocate_temp(component_dtypes_[i], shape,
-                                                  &element);
-
-                  bool has_dynamic_shape = !partial_shape.IsFullyDefined();
-                  if (has_dynamic_shape) {
-                    // Set all values to zero because not all values
-                    // will get written over.
-                    attempt->context->SetStatus(SetElementZero(&element));
-                    if (!attempt->context->status().ok()) return kComplete;
+            if (queue_size == 0) return kNoProgress;
+            // The dequeued elements are kept in attempt->tuples, whose
+            // i^th tuple holds batches of those of component i, as they
+            // were stored in the queue: the shape of the result is only
+            // known once all of them are dequeued.
+            const int64 n =
+                std::min<int64>(queue_size, attempt->elements_requested);
+            attempt->tuples.resize(num_components());
+            for (int i = 0; i < num_components(); ++i) {
+              Tuple* runs = &attempt->tuples[i];
+              attempt->context->SetStatus(queues_[i].ForEachRun(
+                  0, n, attempt->context,
+                  [runs](const Tensor& batch, int64 begin, int64 end) {
+                    runs->push_back(batch.Slice(begin, end));
+                    return Status::OK();
+                  }));
+              if (!attempt->context->status().ok()) return kComplete;
+            }
+            for (int i = 0; i < num_components(); ++i) {
+              queues_[i].PopFront(n);
+            }
+            attempt->elements_requested -= n;
+            if (attempt->elements_requested > 0) return kProgress;
+
+            // Finished.  Allocate attempt->tuple and
+            // copy from attempt->tuples to attempt->tuple.
+            attempt->tuple.reserve(num_components());
+            for (int i = 0; i < num_components(); ++i) {
+              const Tuple& runs = attempt->tuples[i];
+              int64 batch_size = 0;
+              for (const Tensor& run : runs) batch_size += run.dim_size(0);
+
+              const PartialTensorShape partial_shape =
+                  PartialTensorShape({batch_size})
+                      .Concatenate(partial_shapes_[i]);
+              TensorShape shape({batch_size});
+
+              for (int j = 0; j < partial_shape.dims() - 1; ++j) {
+                if (partial_shape.dim_size(j + 1) > -1) {
+                  shape.AddDim(partial_shape.dim_size(j + 1));
+                } else {
+                  // Expand sizes to match.
+                  int64 max_val = 0;
+                  for (const Tensor& run : runs) {
+                    max_val = std::max(max_val, run.dim_size(j + 1));
                   }
+                  shape.AddDim(max_val);
+                }
+              }
 
-                  dynamic_shape.push_back(has_dynamic_shape);
+              Tensor element;
+              attempt->context->allocate_temp(component_dtypes_[i], shape,
+                                              &element);
 
-                  // TODO(ebrevdo): should this be a persistent tensor?
-                  attempt->tuple.emplace_back(element);
-                }
+              bool has_dynamic_shape = !partial_shape.IsFullyDefined();
+              if (has_dynamic_shape) {
+                // Set all values to zero because not all values
+                // will get written over.
+                attempt->context->SetStatus(SetElementZero(&element));
+                if (!attempt->context->status().ok()) return kComplete;
+              }
 
-                for (size_t index = 0; index < tuples.size(); ++index) {
-                  for (int i = 0; i < num_components(); ++i) {
-                    if (dynamic_shape[i]) {
-                      // Slightly slower copy operation
-                      attempt->context->SetStatus(CopyElementToLargerSlice(
-                          tuples[index][i], &attempt->tuple[i], index));
-                    } else {
-                      attempt->context->SetStatus(CopyElementToSlice(
-                          tuples[index][i], &attempt->tuple[i], index));
-                    }
-                    if (!attempt->context->status().ok()) return kComplete;
-                  }
-                }
-                tuple = attempt->tuple;
-                attempt->tuples.clear();
-                attempt->done_callback = [callback, tuple]() {
-                  callback(tuple);
-                };
-                return kComplete;
+              int64 index = 0;
+              for (const Tensor& run : runs) {
+                attempt->context->SetStatus(
+                    CopyRunToSlices(run, attempt->context, &element, index));
+                if (!attempt->context->status().ok()) return kComplete;
+                index += run.dim_size(0);
               }
+
+              // TODO(ebrevdo): should this be a persistent tensor?
+              attempt->tuple.emplace_back(element);
             }
-            return result;
+            Tuple tuple = attempt->tuple;
+            attempt->tuples.clear();
+            attempt->done_callback = [callback, tuple]() { callback(tuple); };
+            return kComplete;
           });
     }
   }
@@ -372,6 +354,33 @@ Status PaddingFIFOQueue::CopyElementToLargerSlice(const Tensor& element,
   }
 }
 
+/* static */
+Status PaddingFIFOQueue::CopyRunToSlices(const Tensor& run,
+                                         OpKernelContext* ctx, Tensor* parent,
+                                         int64 index) {
+  TensorShape element_shape(run.shape());
+  element_shape.RemoveDim(0);
+  TensorShape slice_shape(parent->shape());
+  slice_shape.RemoveDim(0);
+  if (element_shape.IsSameSize(slice_shape)) {
+    // No padding: the run is copied as is.
+    return TensorChunkQueue::CopyRows(run, 0, run.dim_size(0), parent, index);
+  }
+  TensorShape row_shape({1});
+  row_shape.AppendShape(element_shape);
+  for (int64 i = 0; i < run.dim_size(0); ++i) {
+    // The elements are copied to aligned tensors first, since the run
+    // may not be aligned.
+    Tensor row;
+    TF_RETURN_IF_ERROR(ctx->allocate_temp(run.dtype(), row_shape, &row));
+    TF_RETURN_IF_ERROR(TensorChunkQueue::CopyRows(run, i, 1, &row, 0));
+    Tensor element;
+    CHECK(element.CopyFrom(row, element_shape));
+    TF_RETURN_IF_ERROR(CopyElementToLargerSlice(element, parent, index + i));
+  }
+  return Status::OK();
+}
+
 // Static method
 Status PaddingFIFOQueue::SetElementZero(Tensor* element) {
 #define HANDLE_TYPE(T)                                \
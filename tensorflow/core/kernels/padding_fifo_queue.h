@@ -16,7 +16,6 @@ limitations under the License.
 #ifndef TENSORFLOW_KERNELS_PADDING_FIFO_QUEUE_H_
 #define TENSORFLOW_KERNELS_PADDING_FIFO_QUEUE_H_
 
-#include <deque>
 #include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
@@ -69,15 +68,17 @@ class PaddingFIFOQueue : public FIFOQueue {
   static Status CopyElementToLargerSlice(const Tensor& element, Tensor* parent,
                                          int index);
 
+  // Copies the elements of "run", a batch of elements of the same shape,
+  // to the slices of parent starting at the index^th, padding them if
+  // the slices are larger.
+  static Status CopyRunToSlices(const Tensor& run, OpKernelContext* ctx,
+                                Tensor* parent, int64 index);
+
   std::vector<PartialTensorShape> partial_shapes_;
 
  private:
   ~PaddingFIFOQueue() override {}
 
-  static Status GetElementComponent(const PaddingFIFOQueue::Tuple& tuple,
-                                    int component, OpKernelContext* ctx,
-                                    PersistentTensor* out_tensor);
-
   static Status IsSameSizeExceptZerosInFirst(const TensorShape& first,
                                              const TensorShape& second);
 
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/queue_base.h"
 
+#include <algorithm>
 #include <vector>
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -73,7 +74,10 @@ QueueBase::QueueBase(int32 capacity, const DataTypeVector& component_dtypes,
       component_dtypes_(component_dtypes),
       component_shapes_(component_shapes),
       name_(name),
-      closed_(false) {}
+      closed_(false),
+      fast_path_open_(false),
+      fast_path_users_(0),
+      fast_path_dequeues_(false) {}
 
 QueueBase::~QueueBase() {}
 
@@ -238,6 +242,7 @@ void QueueBase::CloseAndCancel() {
   std::vector<DoneCallback> callbacks;
   {
     mutex_lock lock(mu_);
+    StopFastPathLocked();
     closed_ = true;
     for (Attempt& attempt : enqueue_attempts_) {
       if (!attempt.is_cancelled) {
@@ -262,6 +267,7 @@ void QueueBase::Close(OpKernelContext* ctx, bool cancel_pending_enqueues,
   } else {
     {
       mutex_lock lock(mu_);
+      StopFastPathLocked();
       enqueue_attempts_.emplace_back(
           0, callback, ctx, nullptr, CancellationManager::kInvalidToken,
           [this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -338,6 +344,7 @@ void QueueBase::FlushUnlocked() {
       changed = TryAttemptLocked(kEnqueue, &clean_up);
       changed = TryAttemptLocked(kDequeue, &clean_up) || changed;
     } while (changed);
+    MaybeOpenFastPathLocked();
   }
   Unref();
   for (const auto& to_clean : clean_up) {
@@ -351,6 +358,56 @@ void QueueBase::FlushUnlocked() {
   }
 }
 
+void QueueBase::EnableFastPath(int64 max_elements) {
+  DCHECK(fast_path_ == nullptr);
+  fast_path_.reset(new LockFreeRing<Tuple>(max_elements));
+  MaybeOpenFastPathLocked();
+}
+
+bool QueueBase::TryEnqueueFast(const Tuple& tuple) {
+  if (fast_path_ == nullptr) return false;
+  // Sequentially consistent, like the accesses of StopFastPathLocked(), so
+  // that either it waits for this operation or this one sees it closed.
+  fast_path_users_.fetch_add(1);
+  const bool done = fast_path_open_.load() && fast_path_->TryPush(tuple);
+  fast_path_users_.fetch_sub(1);
+  return done;
+}
+
+bool QueueBase::TryDequeueFast(Tuple* tuple) {
+  if (fast_path_ == nullptr) return false;
+  fast_path_users_.fetch_add(1);
+  const bool done = fast_path_open_.load() && fast_path_dequeues_ &&
+                    fast_path_->TryPop(tuple);
+  fast_path_users_.fetch_sub(1);
+  return done;
+}
+
+void QueueBase::StopFastPathLocked() {
+  if (!fast_path_open_.load(std::memory_order_relaxed)) return;
+  fast_path_open_.store(false);
+  // The operations in progress are short: they never wait for another.
+  while (fast_path_users_.load() > 0) {
+  }
+  Tuple tuple;
+  while (fast_path_->TryPop(&tuple)) {
+    StoreFastPathElementLocked(&tuple);
+  }
+}
+
+void QueueBase::MaybeOpenFastPathLocked() {
+  if (fast_path_ == nullptr ||
+      fast_path_open_.load(std::memory_order_relaxed) || closed_ ||
+      !enqueue_attempts_.empty() || !dequeue_attempts_.empty()) {
+    return;
+  }
+  const int64 stored = StoredSizeLocked();
+  fast_path_->set_capacity(std::max<int64>(
+      0, std::min<int64>(capacity_ - stored, fast_path_->max_capacity())));
+  fast_path_dequeues_ = stored == 0;
+  fast_path_open_.store(true);
+}
+
 Status QueueBase::CopySliceToElement(const Tensor& parent, Tensor* element,
                                      int64 index) {
 #define HANDLE_TYPE(DT)                                                   \
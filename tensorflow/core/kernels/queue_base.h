@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_QUEUE_BASE_H_
 #define TENSORFLOW_CORE_KERNELS_QUEUE_BASE_H_
 
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
@@ -24,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/lock_free_ring.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -129,6 +132,41 @@ class QueueBase : public QueueInterface {
   // of the *_attempts_ queues.
   void FlushUnlocked();
 
+  // The fast path completes single-element enqueues and dequeues that need
+  // not wait without taking mu_: the elements are pushed to, and popped
+  // from, a lock-free ring of at most "max_elements" elements that follows
+  // those stored by the subclass.  It is open only while no attempt is
+  // pending and the queue is not closed, and dequeues only while the
+  // subclass stores no element, so that the order of the elements and of
+  // the attempts is kept.  Subclasses that enable it must implement
+  // StoredSizeLocked() and StoreFastPathElementLocked(), and call
+  // StopFastPathLocked() before adding an attempt.
+  void EnableFastPath(int64 max_elements) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Enqueues "tuple" (dequeues to "*tuple") and returns true if it can be
+  // done now through the fast path.  Otherwise returns false, and the
+  // caller must take the slow path.
+  bool TryEnqueueFast(const Tuple& tuple);
+  bool TryDequeueFast(Tuple* tuple);
+
+  // Closes the fast path, waits for the operations in progress on it, and
+  // moves its elements to the subclass with StoreFastPathElementLocked().
+  // It is reopened by FlushUnlocked() once no attempt is left.
+  void StopFastPathLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the number of elements in the fast path.
+  int64 FastPathSize() const {
+    return fast_path_ == nullptr ? 0 : fast_path_->size();
+  }
+
+  // Returns the number of elements the subclass stores.
+  virtual int64 StoredSizeLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) { return 0; }
+
+  // Appends "*tuple", moved out of the fast path, to the elements the
+  // subclass stores.
+  virtual void StoreFastPathElementLocked(Tuple* tuple)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {}
+
   ~QueueBase() override;
 
   // Helpers for implementing MatchesNodeDef().
@@ -174,6 +212,20 @@ class QueueBase : public QueueInterface {
   std::deque<Attempt> enqueue_attempts_ GUARDED_BY(mu_);
   std::deque<Attempt> dequeue_attempts_ GUARDED_BY(mu_);
 
+ private:
+  // Opens the fast path if it is enabled and may be open.
+  void MaybeOpenFastPathLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Null unless the fast path is enabled.
+  std::unique_ptr<LockFreeRing<Tuple>> fast_path_;
+  // Written under mu_ only.  The operations on the fast path are counted
+  // in fast_path_users_ before they check that it is open.
+  std::atomic<bool> fast_path_open_;
+  std::atomic<int32> fast_path_users_;
+  // Whether dequeues may take the fast path while it is open.  Only written
+  // while it is closed.
+  bool fast_path_dequeues_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(QueueBase);
 };
 
@@ -0,0 +1,134 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+// The number of values of the elements.
+static const int kElementSize = 10;
+
+// Returns a graph that enqueues a batch of "batch_size" elements in a
+// queue of type "queue_op", then dequeues them in "num_dequeues" batches.
+static Graph* QueueThroughput(const string& queue_op, int batch_size,
+                              int num_dequeues) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor components(DT_FLOAT, TensorShape({batch_size, kElementSize}));
+  components.flat<float>().setRandom();
+
+  Node* queue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("queue"), queue_op)
+                  .Attr("component_types", DataTypeVector({DT_FLOAT}))
+                  .Attr("shapes",
+                        std::vector<TensorShape>({TensorShape({kElementSize})}))
+                  .Attr("capacity", batch_size)
+                  .Finalize(g, &queue));
+  Node* enqueue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("enqueue"), "QueueEnqueueMany")
+                  .Input(queue)
+                  .Input(std::vector<NodeBuilder::NodeOut>(
+                      {test::graph::Constant(g, components)}))
+                  .Finalize(g, &enqueue));
+  Node* last = enqueue;
+  Node* n = test::graph::Constant(
+      g, test::AsScalar<int32>(batch_size / num_dequeues));
+  for (int i = 0; i < num_dequeues; ++i) {
+    Node* dequeue;
+    TF_CHECK_OK(NodeBuilder(g->NewName("dequeue"), "QueueDequeueMany")
+                    .Input(queue)
+                    .Input(n)
+                    .Attr("component_types", DataTypeVector({DT_FLOAT}))
+                    .ControlInput(last)
+                    .Finalize(g, &dequeue));
+    last = dequeue;
+  }
+  return g;
+}
+
+// Returns a graph that enqueues "n" elements one at a time in a queue of
+// type "queue_op", then dequeues them one at a time.  The enqueues (and the
+// dequeues) are independent, so they run concurrently.
+static Graph* QueueSingleThroughput(const string& queue_op, int n) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor component(DT_FLOAT, TensorShape({kElementSize}));
+  component.flat<float>().setRandom();
+
+  Node* queue;
+  TF_CHECK_OK(NodeBuilder(g->NewName("queue"), queue_op)
+                  .Attr("component_types", DataTypeVector({DT_FLOAT}))
+                  .Attr("shapes",
+                        std::vector<TensorShape>({TensorShape({kElementSize})}))
+                  .Attr("capacity", n)
+                  .Finalize(g, &queue));
+  Node* value = test::graph::Constant(g, component);
+  std::vector<Node*> enqueues;
+  for (int i = 0; i < n; ++i) {
+    Node* enqueue;
+    TF_CHECK_OK(NodeBuilder(g->NewName("enqueue"), "QueueEnqueue")
+                    .Input(queue)
+                    .Input(std::vector<NodeBuilder::NodeOut>({value}))
+                    .Finalize(g, &enqueue));
+    enqueues.push_back(enqueue);
+  }
+  Node* enqueued = test::graph::NoOp(g, enqueues);
+  for (int i = 0; i < n; ++i) {
+    Node* dequeue;
+    TF_CHECK_OK(NodeBuilder(g->NewName("dequeue"), "QueueDequeue")
+                    .Input(queue)
+                    .Attr("component_types", DataTypeVector({DT_FLOAT}))
+                    .ControlInput(enqueued)
+                    .Finalize(g, &dequeue));
+  }
+  return g;
+}
+
+#define BM_QueueThroughputDev(QUEUE, B, D)                                  \
+  static void BM_QueueThroughput_##QUEUE##_##B##_##D(int iters) {           \
+    testing::ItemsProcessed(static_cast<int64>(iters) * B);                 \
+    testing::BytesProcessed(static_cast<int64>(iters) * B * kElementSize *  \
+                            sizeof(float));                                 \
+    test::Benchmark("cpu", QueueThroughput(#QUEUE, B, D)).Run(iters);       \
+  }                                                                         \
+  BENCHMARK(BM_QueueThroughput_##QUEUE##_##B##_##D)
+
+BM_QueueThroughputDev(FIFOQueue, 100, 1);
+BM_QueueThroughputDev(FIFOQueue, 10000, 1);
+BM_QueueThroughputDev(FIFOQueue, 10000, 4);
+BM_QueueThroughputDev(PaddingFIFOQueue, 10000, 1);
+BM_QueueThroughputDev(PaddingFIFOQueue, 10000, 4);
+BM_QueueThroughputDev(RandomShuffleQueue, 100, 1);
+BM_QueueThroughputDev(RandomShuffleQueue, 10000, 1);
+BM_QueueThroughputDev(RandomShuffleQueue, 10000, 4);
+
+#define BM_QueueSingleThroughputDev(QUEUE, N)                              \
+  static void BM_QueueSingleThroughput_##QUEUE##_##N(int iters) {          \
+    testing::ItemsProcessed(static_cast<int64>(iters) * N);                \
+    test::Benchmark("cpu", QueueSingleThroughput(#QUEUE, N)).Run(iters);   \
+  }                                                                        \
+  BENCHMARK(BM_QueueSingleThroughput_##QUEUE##_##N)
+
+BM_QueueSingleThroughputDev(FIFOQueue, 100);
+BM_QueueSingleThroughputDev(FIFOQueue, 1000);
+BM_QueueSingleThroughputDev(PaddingFIFOQueue, 1000);
+BM_QueueSingleThroughputDev(RandomShuffleQueue, 1000);
+
+}  // namespace tensorflow
@@ -15,7 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/data_flow_ops.cc.
 
-#include <deque>
+#include <algorithm>
 #include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/queue_op.h"
+#include "tensorflow/core/kernels/tensor_chunk_queue.h"
 #include "tensorflow/core/kernels/typed_queue.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/random/philox_random.h"
@@ -37,15 +38,16 @@ limitations under the License.
 
 namespace tensorflow {
 
-class RandomShuffleQueue : public TypedQueue<std::vector<PersistentTensor> > {
+// The elements are stored in chunks of the batches they were enqueued in.
+// The queue owns copies of the batches, since dequeuing an element moves
+// the last one in its place.
+class RandomShuffleQueue : public TypedQueue<TensorChunkQueue> {
  public:
   RandomShuffleQueue(int32 capacity, int32 min_after_dequeue, int64 seed,
                      int64 seed2, const DataTypeVector& component_dtypes,
                      const std::vector<TensorShape>& component_shapes,
                      const string& name);
 
-  Status Initialize() override;  // Must be called before any other method.
-
   // Implementations of QueueInterface methods --------------------------------
   void TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                   DoneCallback callback) override;
@@ -66,13 +68,24 @@ class RandomShuffleQueue : public TypedQueue<std::vector<PersistentTensor> > {
   ~RandomShuffleQueue() override {}
 
   // Helper for dequeuing a single random element from queues_.
-  void DequeueLocked(OpKernelContext* ctx, Tuple* tuple)
+  Status DequeueLocked(OpKernelContext* ctx, Tuple* tuple)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Helper for dequeuing a single random element from queues_ to the
+  // index^th slices of the batches in "tuple".
+  Status DequeueToBatchLocked(OpKernelContext* ctx, Tuple* tuple, int64 index)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Removes the element at "index" from queues_, moving the last one in
+  // its place.
+  Status RemoveLocked(OpKernelContext* ctx, int64 index)
       EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
-  static Status GetElementComponentFromBatch(const Tuple& tuple, int64 index,
-                                             int component,
-                                             OpKernelContext* ctx,
-                                             PersistentTensor* out_tensor);
+  // Appends copies of the slices [begin, end) of the batches in "tuple"
+  // to queues_.
+  Status EnqueueCopyLocked(OpKernelContext* ctx, const Tuple& tuple,
+                           int64 begin, int64 end)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   const int32 min_after_dequeue_;
   const int64 original_seed_;
@@ -101,26 +114,57 @@ RandomShuffleQueue::RandomShuffleQueue(
   parent_generator_ = random::PhiloxRandom(seed, seed2);
 }
 
-Status RandomShuffleQueue::Initialize() {
-  Status s = TypedQueue::Initialize();
-  if (!s.ok()) return s;
+Status RandomShuffleQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
+  DCHECK_GT(queues_[0].size(), 0);
+  const int64 index = generator_() % queues_[0].size();
+  (*tuple).reserve(num_components());
+  for (int i = 0; i < num_components(); ++i) {
+    Tensor element;
+    TF_RETURN_IF_ERROR(queues_[i].CopyElement(index, ctx, &element));
+    (*tuple).push_back(element);
+  }
+  return RemoveLocked(ctx, index);
+}
 
-  mutex_lock lock(mu_);
+Status RandomShuffleQueue::DequeueToBatchLocked(OpKernelContext* ctx,
+                                                Tuple* tuple, int64 index) {
+  DCHECK_GT(queues_[0].size(), 0);
+  const int64 element = generator_() % queues_[0].size();
   for (int i = 0; i < num_components(); ++i) {
-    queues_.back().reserve(min_after_dequeue_);
+    TF_RETURN_IF_ERROR(
+        queues_[i].CopyToBatch(element, 1, ctx, &(*tuple)[i], index));
+  }
+  return RemoveLocked(ctx, element);
+}
+
+Status RandomShuffleQueue::RemoveLocked(OpKernelContext* ctx, int64 index) {
+  const int64 last = queues_[0].size() - 1;
+  for (int i = 0; i < num_components(); ++i) {
+    TF_RETURN_IF_ERROR(queues_[i].MoveElement(last, index, ctx));
+  }
+  for (int i = 0; i < num_components(); ++i) {
+    queues_[i].PopBack(1);
   }
   return Status::OK();
 }
 
-void RandomShuffleQueue::DequeueLocked(OpKernelContext* ctx, Tuple* tuple) {
-  DCHECK_GT(queues_[0].size(), size_t{0});
-  int64 index = generator_() % queues_[0].size();
-  (*tuple).reserve(num_components());
+Status RandomShuffleQueue::EnqueueCopyLocked(OpKernelContext* ctx,
+                                             const Tuple& tuple, int64 begin,
+                                             int64 end) {
+  std::vector<PersistentTensor> batches(num_components());
+  for (int i = 0; i < num_components(); ++i) {
+    TensorShape shape(tuple[i].shape());
+    shape.set_dim(0, end - begin);
+    Tensor* batch = nullptr;
+    TF_RETURN_IF_ERROR(ctx->allocate_persistent(tuple[i].dtype(), shape,
+                                                &batches[i], &batch));
+    TF_RETURN_IF_ERROR(
+        TensorChunkQueue::CopyRows(tuple[i], begin, end - begin, batch, 0));
+  }
   for (int i = 0; i < num_components(); ++i) {
-    (*tuple).push_back(*queues_[i][index].AccessTensor(ctx));
-    queues_[i][index] = queues_[i].back();
-    queues_[i].pop_back();
+    queues_[i].PushBack(batches[i], 0, end - begin);
   }
+  return Status::OK();
 }
 
 void RandomShuffleQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
@@ -141,10 +185,18 @@ void RandomShuffleQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
                   "RandomShuffleQueue '", name_, "' is closed."));
               return kComplete;
             }
-            if (queues_[0].size() < static_cast<size_t>(capacity_)) {
+            if (queues_[0].size() < capacity_) {
+              Tuple batch;
+              batch.reserve(num_components());
               for (int i = 0; i < num_components(); ++i) {
-                queues_[i].push_back(PersistentTensor(tuple[i]));
+                TensorShape shape({1});
+                shape.AppendShape(tuple[i].shape());
+                Tensor element;
+                CHECK(element.CopyFrom(tuple[i], shape));
+                batch.push_back(element);
               }
+              attempt->context->SetStatus(
+                  EnqueueCopyLocked(attempt->context, batch, 0, 1));
               return kComplete;
             } else {
               return kNoProgress;
@@ -160,20 +212,6 @@ void RandomShuffleQueue::TryEnqueue(const Tuple& tuple, OpKernelContext* ctx,
   }
 }
 
-/* static */
-Status RandomShuffleQueue::GetElementComponentFromBatch(
-    const Tuple& tuple, int64 index, int component, OpKernelContext* ctx,
-    PersistentTensor* out_tensor) {
-  TensorShape element_shape(tuple[component].shape());
-  element_shape.RemoveDim(0);
-  Tensor* element_access = nullptr;
-  TF_RETURN_IF_ERROR(ctx->allocate_persistent(
-      tuple[component].dtype(), element_shape, out_tensor, &element_access));
-  TF_RETURN_IF_ERROR(
-      CopySliceToElement(tuple[component], element_access, index));
-  return Status::OK();
-}
-
 void RandomShuffleQueue::TryEnqueueMany(const Tuple& tuple,
                                         OpKernelContext* ctx,
                                         DoneCallback callback) {
@@ -199,24 +237,21 @@ void RandomShuffleQueue::TryEnqueueMany(const Tuple& tuple,
                   "RandomShuffleQueue '", name_, "' is closed."));
               return kComplete;
             }
-            RunResult result = kNoProgress;
-            while (queues_[0].size() < static_cast<size_t>(capacity_)) {
-              result = kProgress;
-              const int index =
-                  tuple[0].dim_size(0) - attempt->elements_requested;
-              for (int i = 0; i < num_components(); ++i) {
-                PersistentTensor element;
-                attempt->context->SetStatus(GetElementComponentFromBatch(
-                    tuple, index, i, attempt->context, &element));
-                if (!attempt->context->status().ok()) return kComplete;
-                queues_[i].push_back(element);
-              }
-              --attempt->elements_requested;
-              if (attempt->elements_requested == 0) {
-                return kComplete;
-              }
+            const int64 queue_size = queues_[0].size();
+            if (queue_size >= capacity_) return kNoProgress;
+            const int64 begin =
+                tuple[0].dim_size(0) - attempt->elements_requested;
+            const int64 end =
+                begin + std::min<int64>(attempt->elements_requested,
+                                        capacity_ - queue_size);
+            attempt->context->SetStatus(
+                EnqueueCopyLocked(attempt->context, tuple, begin, end));
+            if (!attempt->context->status().ok()) return kComplete;
+            attempt->elements_requested -= end - begin;
+            if (attempt->elements_requested == 0) {
+              return kComplete;
             }
-            return result;
+            return kProgress;
           });
     }
   }
@@ -242,7 +277,7 @@ void RandomShuffleQueue::TryDequeue(OpKernelContext* ctx,
       dequeue_attempts_.emplace_back(
           1, [callback]() { callback(Tuple()); }, ctx, cm, token,
           [callback, this](Attempt* attempt) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-            int32 queue_size = queues_[0].size();
+            int64 queue_size = queues_[0].size();
             if (closed_ && queue_size == 0) {
               attempt->context->SetStatus(errors::OutOfRange(
                   "RandomShuffleQueue '", name_, "' is closed and has ",
@@ -253,7 +288,9 @@ void RandomShuffleQueue::TryDequeue(OpKernelContext* ctx,
             if (!closed_) queue_size -= min_after_dequeue_;
             if (queue_size > 0) {
               Tuple tuple;
-              DequeueLocked(attempt->context, &tuple);
+              attempt->context->SetStatus(
+                  DequeueLocked(attempt->context, &tuple));
+              if (!attempt->context->status().ok()) return kComplete;
               attempt->done_callback = [callback, tuple]() { callback(tuple); };
               return kComplete;
             } else {
@@ -329,28 +366,18 @@ void RandomShuffleQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
           num_elements, [callback]() { callback(Tuple()); }, ctx, cm, token,
           [callback, allow_small_batch, this](Attempt* attempt)
               EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-                int32 queue_size = queues_[0].size();
+                int64 queue_size = queues_[0].size();
                 if (closed_ && queue_size < attempt->elements_requested) {
                   // If we don't have enough for a full dequeue, we have
                   // to reset the attempt tuple.
                   if (!attempt->tuple.empty()) {
-                    // Restore already-dequeued elements to the queue.
-                    for (int64 i = attempt->tuple[0].dim_size(0) -
-                                   attempt->elements_requested - 1;
-                         i >= 0; --i) {
-                      for (int j = 0; j < num_components(); ++j) {
-                        PersistentTensor element;
-                        Status s = GetElementComponentFromBatch(
-                            attempt->tuple, i, j, attempt->context, &element);
-                        if (!s.ok()) {
-                          attempt->context->SetStatus(
-                              errors::DataLoss("Failed to restore element from "
-                                               "partially-dequeued batch "
-                                               "to RandomShuffleQueue: ",
-                                               s.error_message()));
-                        }
-                        queues_[j].push_back(element);
-                      }
+                    // Restore already-dequeued elements to the queue.  The
+                    // queue owns the batches from now on.
+                    const int64 dequeued = attempt->tuple[0].dim_size(0) -
+                                           attempt->elements_requested;
+                    for (int j = 0; j < num_components(); ++j) {
+                      queues_[j].PushBack(PersistentTensor(attempt->tuple[j]),
+                                          0, dequeued);
                     }
                   }
                   if (allow_small_batch && queues_[0].size() > 0) {
@@ -394,19 +421,14 @@ void RandomShuffleQueue::TryDequeueMany(int num_elements, OpKernelContext* ctx,
                     }
                   }
                   result = kProgress;
-                  Tuple tuple;
-                  DequeueLocked(attempt->context, &tuple);
-                  const int index = attempt->tuple[0].dim_size(0) -
-                                    attempt->elements_requested;
-                  for (int i = 0; i < num_components(); ++i) {
-                    attempt->context->SetStatus(CopyElementToSlice(
-                        tuple[i], &attempt->tuple[i], index));
-                    if (!attempt->context->status().ok()) return kComplete;
-                  }
-                  tuple.clear();
+                  const int64 index = attempt->tuple[0].dim_size(0) -
+                                      attempt->elements_requested;
+                  attempt->context->SetStatus(DequeueToBatchLocked(
+                      attempt->context, &attempt->tuple, index));
+                  if (!attempt->context->status().ok()) return kComplete;
                   --attempt->elements_requested;
                   if (attempt->elements_requested == 0) {
-                    tuple = attempt->tuple;
+                    Tuple tuple = attempt->tuple;
                     attempt->done_callback = [callback, tuple]() {
                       callback(tuple);
                     };
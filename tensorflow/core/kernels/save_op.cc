@@ -16,34 +16,244 @@ limitations under the License.
 // See docs in ../ops/io_ops.cc
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include <unordered_map>
+#include <vector>
+
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_slice_writer.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
-class SaveOp : public OpKernel {
+// Saves tensors, as the Save and SaveSlices ops.  Each run may write its
+// checkpoint in the background, and be a delta of the last full checkpoint
+// written by the op (see the docs of the ops).
+class SaveOpBase : public OpKernel {
  public:
-  explicit SaveOp(OpKernelConstruction* context) : OpKernel(context) {}
+  SaveOpBase(OpKernelConstruction* context, bool save_slices)
+      : OpKernel(context), save_slices_(save_slices) {
+    OP_REQUIRES_OK(context, context->GetAttr("background", &background_));
+    OP_REQUIRES_OK(context, context->GetAttr("max_deltas", &max_deltas_));
+  }
+
+  ~SaveOpBase() override {
+    mutex_lock l(mu_);
+    Status s = FinishWrite();
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+    }
+  }
 
   void Compute(OpKernelContext* context) override {
-    SaveTensors(context, &checkpoint::CreateTableTensorSliceBuilder, false);
+    std::unique_ptr<Write> write(new Write);
+    OP_REQUIRES_OK(context,
+                   GetTensorsToSave(context, save_slices_, &write->filename,
+                                    &write->tensors));
+    if (!background_ && max_deltas_ == 0) {
+      OP_REQUIRES_OK(context, WriteCheckpoint(*write));
+      return;
+    }
+
+    // The checkpoints are written one at a time, so that each delta is
+    // of the full checkpoint written last.
+    mutex_lock l(mu_);
+    OP_REQUIRES_OK(context, FinishWrite());
+    thread::ThreadPool* pool =
+        context->device()->tensorflow_cpu_worker_threads()->workers;
+    std::vector<uint64> fingerprints(write->tensors.size());
+    const bool background = background_;
+    const bool fingerprint = max_deltas_ > 0;
+    ForEachTensor(pool, write->tensors, [&write, &fingerprints, background,
+                                         fingerprint](int i) {
+      Tensor* data = &write->tensors[i].data;
+      if (background) {
+        // The inputs may share their buffers with variables, which later
+        // steps update in place while the copies are written.
+        *data = tensor::DeepCopy(*data);
+      }
+      if (fingerprint) {
+        fingerprints[i] = Fingerprint(*data);
+      }
+    });
+    if (max_deltas_ > 0) {
+      write->delta = !base_.empty() && num_deltas_ < max_deltas_ &&
+                     write->filename != base_;
+      if (write->delta) {
+        // Only the slices changed since the base are saved.
+        write->base = RelativeBase(write->filename);
+        std::vector<TensorToSave> changed;
+        for (size_t i = 0; i < write->tensors.size(); ++i) {
+          const TensorToSave& t = write->tensors[i];
+          const string key = checkpoint::EncodeTensorNameSlice(t.name, t.slice);
+          const uint64* base_fingerprint =
+              gtl::FindOrNull(base_fingerprints_, key);
+          if (base_fingerprint == nullptr ||
+              *base_fingerprint != fingerprints[i]) {
+            changed.push_back(t);
+          }
+        }
+        write->tensors.swap(changed);
+      } else {
+        for (size_t i = 0; i < write->tensors.size(); ++i) {
+          const TensorToSave& t = write->tensors[i];
+          write->fingerprints[checkpoint::EncodeTensorNameSlice(
+              t.name, t.slice)] = fingerprints[i];
+        }
+      }
+    }
+
+    if (!background_) {
+      OP_REQUIRES_OK(context, WriteCheckpoint(*write));
+      Commit(write.get());
+      return;
+    }
+    write_ = std::move(write);
+    Write* w = write_.get();
+    writer_thread_.reset(context->env()->StartThread(
+        ThreadOptions(), "save_tensors", [w]() {
+          w->status = WriteCheckpoint(*w);
+          w->tensors.clear();
+        }));
   }
+
+ private:
+  // A checkpoint to write.
+  struct Write {
+    string filename;
+    std::vector<TensorToSave> tensors;
+    // Whether the checkpoint is a delta, and the base it refers to.
+    bool delta = false;
+    string base;
+    // For full checkpoints, the fingerprints of the slices saved, by key.
+    std::unordered_map<string, uint64> fingerprints;
+    // The status of writing the checkpoint in the background.
+    Status status;
+  };
+
+  static Status WriteCheckpoint(const Write& write) {
+    return WriteTensors(write.filename, write.base,
+                        &checkpoint::CreateTableTensorSliceBuilder,
+                        write.tensors);
+  }
+
+  // Waits for the checkpoint being written in the background, if any, and
+  // returns the status of writing it.
+  Status FinishWrite() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (write_ == nullptr) {
+      return Status::OK();
+    }
+    writer_thread_.reset();  // Joins the thread.
+    std::unique_ptr<Write> write = std::move(write_);
+    if (!write->status.ok()) {
+      return Status(write->status.code(),
+                    strings::StrCat("Failed to write checkpoint ",
+                                    write->filename, " in the background: ",
+                                    write->status.error_message()));
+    }
+    Commit(write.get());
+    return Status::OK();
+  }
+
+  // Records that "write" was written.
+  void Commit(Write* write) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (max_deltas_ == 0) {
+      return;
+    }
+    if (write->delta) {
+      ++num_deltas_;
+    } else {
+      base_ = write->filename;
+      base_fingerprints_.swap(write->fingerprints);
+      num_deltas_ = 0;
+    }
+  }
+
+  // Returns the name of base_ as stored in a delta checkpoint "filename".
+  string RelativeBase(const string& filename) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const StringPiece dir = io::Dirname(base_);
+    if (dir == io::Dirname(filename)) {
+      return io::Basename(base_).ToString();
+    }
+    // Keeps a relative name from being read from the delta's directory.
+    return dir.empty() ? io::JoinPath(".", base_) : base_;
+  }
+
+  // Calls fn(i) for each of "tensors", in parallel on "pool".
+  static void ForEachTensor(thread::ThreadPool* pool,
+                            const std::vector<TensorToSave>& tensors,
+                            const std::function<void(int)>& fn) {
+    int64 total_bytes = 0;
+    for (const TensorToSave& t : tensors) {
+      total_bytes += t.data.TotalBytes();
+    }
+    const int64 cost_per_tensor =
+        tensors.empty() ? 0 : total_bytes / tensors.size();
+    Shard(pool->NumThreads(), pool, tensors.size(), cost_per_tensor,
+          [&fn](int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              fn(i);
+            }
+          });
+  }
+
+  // Returns a fingerprint of the type, shape and contents of "t".
+  static uint64 Fingerprint(const Tensor& t) {
+    uint64 fingerprint = Hash64Combine(Hash64(t.shape().DebugString()),
+                                       static_cast<uint64>(t.dtype()));
+    if (DataTypeCanUseMemcpy(t.dtype())) {
+      const StringPiece data = t.tensor_data();
+      return Hash64(data.data(), data.size(), fingerprint);
+    }
+    CHECK_EQ(t.dtype(), DT_STRING);
+    auto strings = t.flat<string>();
+    for (int64 i = 0; i < strings.size(); ++i) {
+      fingerprint = Hash64(strings(i).data(), strings(i).size(), fingerprint);
+    }
+    return fingerprint;
+  }
+
+  const bool save_slices_;
+  bool background_;
+  int max_deltas_;
+
+  mutex mu_;
+  // The checkpoint being written in the background, if any, and the thread
+  // writing it.
+  std::unique_ptr<Write> write_ GUARDED_BY(mu_);
+  std::unique_ptr<Thread> writer_thread_ GUARDED_BY(mu_);
+  // The last full checkpoint written, the fingerprints of its slices by
+  // key, and the number of deltas of it written.
+  string base_ GUARDED_BY(mu_);
+  std::unordered_map<string, uint64> base_fingerprints_ GUARDED_BY(mu_);
+  int num_deltas_ GUARDED_BY(mu_) = 0;
+};
+
+class SaveOp : public SaveOpBase {
+ public:
+  explicit SaveOp(OpKernelConstruction* context) : SaveOpBase(context, false) {}
 };
 
 REGISTER_KERNEL_BUILDER(Name("Save").Device(DEVICE_CPU), SaveOp);
 
-class SaveSlicesOp : public OpKernel {
+class SaveSlicesOp : public SaveOpBase {
  public:
-  explicit SaveSlicesOp(OpKernelConstruction* context) : OpKernel(context) {}
-
-  void Compute(OpKernelContext* context) override {
-    SaveTensors(context, &checkpoint::CreateTableTensorSliceBuilder, true);
-  }
+  explicit SaveSlicesOp(OpKernelConstruction* context)
+      : SaveOpBase(context, true) {}
 };
 
 REGISTER_KERNEL_BUILDER(Name("SaveSlices").Device(DEVICE_CPU), SaveSlicesOp);
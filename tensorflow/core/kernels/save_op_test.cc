@@ -36,6 +36,8 @@ limitations under the License.
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/util/saved_tensor_slice.pb.h"
+#include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 
 namespace tensorflow {
@@ -657,6 +659,127 @@ TEST_F(SaveOpSlices2Test, TwoSlices) {
   }
 }
 
+class SaveOpModesTest : public OpsTestBase {
+ protected:
+  void MakeOp(bool background, int max_deltas) {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "Save")
+                     .Input(FakeInput())
+                     .Input(FakeInput())
+                     .Input(FakeInput({DT_FLOAT, DT_INT32}))
+                     .Attr("background", background)
+                     .Attr("max_deltas", max_deltas)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    AddInputFromArray<string>(TensorShape({}), {""});
+    AddInputFromArray<string>(TensorShape({2}), {"a", "b"});
+    AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+    AddInputFromArray<int32>(TensorShape({2}), {4, 5});
+  }
+
+  // Saves the inputs to "filename".
+  Status Save(const string& filename) {
+    inputs_[0]->scalar<string>()() = filename;
+    return RunOpKernel();
+  }
+
+  // Returns the names of the tensors saved in "filename" itself, and sets
+  // "*base" to the base it refers to.
+  std::vector<string> SavedNames(const string& filename, string* base) {
+    checkpoint::TensorSliceReader::Table* table;
+    TF_CHECK_OK(checkpoint::OpenTableTensorSliceReader(filename, &table));
+    std::unique_ptr<checkpoint::TensorSliceReader::Table> owned(table);
+    string value;
+    SavedTensorSlices sts;
+    CHECK(table->Get(checkpoint::kSavedTensorSlicesKey, &value));
+    CHECK(sts.ParseFromString(value));
+    *base = sts.meta().base();
+    std::vector<string> names;
+    for (const SavedSliceMeta& ssm : sts.meta().tensor()) {
+      names.push_back(ssm.name());
+    }
+    return names;
+  }
+
+  // Checks that "filename" restores "a" and "b" to the given values.
+  void ExpectRestored(const string& filename, float a0, int32 b0) {
+    checkpoint::TensorSliceReader reader(filename);
+    TF_ASSERT_OK(reader.status());
+    float a[3];
+    ASSERT_TRUE(reader.CopySliceData("a", TensorSlice(1), a));
+    EXPECT_EQ(a0, a[0]);
+    EXPECT_EQ(2, a[1]);
+    int32 b[2];
+    ASSERT_TRUE(reader.CopySliceData("b", TensorSlice(1), b));
+    EXPECT_EQ(b0, b[0]);
+    EXPECT_EQ(5, b[1]);
+  }
+};
+
+TEST_F(SaveOpModesTest, Background) {
+  const string first = io::JoinPath(testing::TmpDir(), "background_first");
+  const string second = io::JoinPath(testing::TmpDir(), "background_second");
+  MakeOp(true, 0);
+  TF_ASSERT_OK(Save(first));
+  // The inputs are copied, so updating them does not change the checkpoint
+  // being written.
+  inputs_[2]->flat<float>()(0) = 10;
+  TF_ASSERT_OK(Save(second));
+  // Waits for the second write.
+  kernel_.reset();
+  ExpectRestored(first, 1, 4);
+  ExpectRestored(second, 10, 4);
+}
+
+TEST_F(SaveOpModesTest, BackgroundError) {
+  const string bad = io::JoinPath(testing::TmpDir(), "no_such_dir/ckpt");
+  MakeOp(true, 0);
+  TF_ASSERT_OK(Save(bad));
+  // The error is reported by the next run.
+  const Status s = Save(io::JoinPath(testing::TmpDir(), "background_ok"));
+  EXPECT_TRUE(StringPiece(s.ToString()).contains(bad)) << s;
+  TF_EXPECT_OK(Save(io::JoinPath(testing::TmpDir(), "background_ok")));
+}
+
+TEST_F(SaveOpModesTest, Deltas) {
+  const string full = io::JoinPath(testing::TmpDir(), "deltas_full");
+  const string delta = io::JoinPath(testing::TmpDir(), "deltas_delta");
+  const string next = io::JoinPath(testing::TmpDir(), "deltas_next");
+  MakeOp(false, 1);
+  TF_ASSERT_OK(Save(full));
+  inputs_[2]->flat<float>()(0) = 10;
+  TF_ASSERT_OK(Save(delta));
+  inputs_[3]->flat<int32>()(0) = 40;
+  // The next checkpoint is a full one again, after max_deltas deltas.
+  TF_ASSERT_OK(Save(next));
+
+  string base;
+  EXPECT_EQ(std::vector<string>({"a", "b"}), SavedNames(full, &base));
+  EXPECT_EQ("", base);
+  EXPECT_EQ(std::vector<string>({"a"}), SavedNames(delta, &base));
+  EXPECT_EQ("deltas_full", base);
+  EXPECT_EQ(std::vector<string>({"a", "b"}), SavedNames(next, &base));
+  EXPECT_EQ("", base);
+  ExpectRestored(full, 1, 4);
+  ExpectRestored(delta, 10, 4);
+  ExpectRestored(next, 10, 40);
+}
+
+TEST_F(SaveOpModesTest, BackgroundDeltas) {
+  const string full = io::JoinPath(testing::TmpDir(), "background_deltas_full");
+  const string delta =
+      io::JoinPath(testing::TmpDir(), "background_deltas_delta");
+  MakeOp(true, 2);
+  TF_ASSERT_OK(Save(full));
+  inputs_[3]->flat<int32>()(0) = 40;
+  TF_ASSERT_OK(Save(delta));
+  kernel_.reset();
+
+  string base;
+  EXPECT_EQ(std::vector<string>({"b"}), SavedNames(delta, &base));
+  EXPECT_EQ("background_deltas_full", base);
+  ExpectRestored(delta, 1, 40);
+}
+
 // Benchmark-related code below.
 
 static void BM_LargeTensorWrite(int iters, int num_elements) {
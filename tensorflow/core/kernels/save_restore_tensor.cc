@@ -33,99 +33,123 @@ limitations under the License.
 
 namespace tensorflow {
 
-void SaveTensors(
-    OpKernelContext* context,
-    checkpoint::TensorSliceWriter::CreateBuilderFunction builder_func,
-    bool save_slices) {
+Status GetTensorsToSave(OpKernelContext* context, bool save_slices,
+                        string* filename, std::vector<TensorToSave>* tensors) {
   const Tensor& filename_t = context->input(0);
   {
     const int64 size = filename_t.NumElements();
-    OP_REQUIRES(
-        context, size == 1,
-        errors::InvalidArgument(
-            "Input 0 (filename) must be a string scalar; got a tensor of ",
-            size, "elements"));
+    if (size != 1) {
+      return errors::InvalidArgument(
+          "Input 0 (filename) must be a string scalar; got a tensor of ", size,
+          "elements");
+    }
   }
 
   // Path, names, and slices if save_slices is true.
   const int kFixedInputs = save_slices ? 3 : 2;
   const Tensor& tensor_names_t = context->input(1);
-  OP_REQUIRES(context,
-              FastBoundsCheck(tensor_names_t.NumElements() + kFixedInputs,
-                              std::numeric_limits<int>::max()),
-              errors::InvalidArgument("Too many inputs to SaveTensors"));
+  if (!FastBoundsCheck(tensor_names_t.NumElements() + kFixedInputs,
+                       std::numeric_limits<int>::max())) {
+    return errors::InvalidArgument("Too many inputs to SaveTensors");
+  }
   const int N = static_cast<int>(tensor_names_t.NumElements());
   const string* tensor_shapes_and_slices_ptr = nullptr;
   if (save_slices) {
     const Tensor& tensor_shapes_and_slices_t = context->input(2);
-    OP_REQUIRES(
-        context,
-        tensor_shapes_and_slices_t.NumElements() == static_cast<int64>(N),
-        errors::InvalidArgument("Expected ", N,
-                                " elements for the tensor "
-                                "shapes and slices but got ",
-                                tensor_shapes_and_slices_t.NumElements()));
+    if (tensor_shapes_and_slices_t.NumElements() != static_cast<int64>(N)) {
+      return errors::InvalidArgument("Expected ", N,
+                                     " elements for the tensor "
+                                     "shapes and slices but got ",
+                                     tensor_shapes_and_slices_t.NumElements());
+    }
     tensor_shapes_and_slices_ptr =
         tensor_shapes_and_slices_t.flat<string>().data();
   }
-  OP_REQUIRES(context, context->num_inputs() == N + kFixedInputs,
-              errors::InvalidArgument("Expected totally ", N + kFixedInputs,
-                                      " inputs as input #1 (which is a string "
-                                      "tensor of saved names) contains ",
-                                      N, " names, but received ",
-                                      context->num_inputs(), " inputs"));
-
-  VLOG(1) << "About to save tensors to file " << filename_t.flat<string>()(0)
-          << "...";
-  checkpoint::TensorSliceWriter writer(filename_t.flat<string>()(0),
-                                       builder_func);
-
-  Status s;
-  auto tensor_names_flat = tensor_names_t.flat<string>();
+  if (context->num_inputs() != N + kFixedInputs) {
+    return errors::InvalidArgument("Expected totally ", N + kFixedInputs,
+                                   " inputs as input #1 (which is a string "
+                                   "tensor of saved names) contains ",
+                                   N, " names, but received ",
+                                   context->num_inputs(), " inputs");
+  }
 
+  *filename = filename_t.flat<string>()(0);
+  auto tensor_names_flat = tensor_names_t.flat<string>();
+  tensors->clear();
+  tensors->reserve(N);
   for (int i = 0; i < N; ++i) {
-    const string& name = tensor_names_flat(i);
     const Tensor& input = context->input(i + kFixedInputs);
     TensorShape shape(input.shape());
     TensorSlice slice(input.dims());
     if (save_slices && !tensor_shapes_and_slices_ptr[i].empty()) {
       const string& shape_spec = tensor_shapes_and_slices_ptr[i];
       TensorShape slice_shape;
-      OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
-                                  shape_spec, &shape, &slice, &slice_shape));
-      OP_REQUIRES(context, slice_shape.IsSameSize(input.shape()),
-                  errors::InvalidArgument("Slice in shape_and_slice "
-                                          "specification does not match the "
-                                          "shape of the tensor to  save: ",
-                                          shape_spec, ", tensor: ",
-                                          input.shape().DebugString()));
+      TF_RETURN_IF_ERROR(checkpoint::ParseShapeAndSlice(shape_spec, &shape,
+                                                        &slice, &slice_shape));
+      if (!slice_shape.IsSameSize(input.shape())) {
+        return errors::InvalidArgument(
+            "Slice in shape_and_slice "
+            "specification does not match the "
+            "shape of the tensor to  save: ",
+            shape_spec, ", tensor: ", input.shape().DebugString());
+      }
     }
+    switch (input.dtype()) {
+#define SAVABLE_TYPE(T) case DataTypeToEnum<T>::value:
+      TF_CALL_ALL_TYPES(SAVABLE_TYPE)
+      TF_CALL_QUANTIZED_TYPES(SAVABLE_TYPE)
+#undef SAVABLE_TYPE
+      break;
+      default:
+        return errors::Unimplemented("Saving data type ",
+                                     DataTypeString(input.dtype()),
+                                     " not yet supported");
+    }
+    tensors->push_back({tensor_names_flat(i), shape, slice, input});
+  }
+  return Status::OK();
+}
+
+Status WriteTensors(
+    const string& filename, const string& base,
+    checkpoint::TensorSliceWriter::CreateBuilderFunction builder_func,
+    const std::vector<TensorToSave>& tensors) {
+  VLOG(1) << "About to save tensors to file " << filename << "...";
+  checkpoint::TensorSliceWriter writer(filename, builder_func);
+  if (!base.empty()) {
+    writer.SetBase(base);
+  }
 
-#define WRITER_ADD(T)                                           \
-  case DataTypeToEnum<T>::value:                                \
-    s = writer.Add(name, shape, slice, input.flat<T>().data()); \
+  for (const TensorToSave& t : tensors) {
+#define WRITER_ADD(T)                                                      \
+  case DataTypeToEnum<T>::value:                                           \
+    TF_RETURN_IF_ERROR(                                                    \
+        writer.Add(t.name, t.shape, t.slice, t.data.flat<T>().data()));    \
     break;
 
-    switch (input.dtype()) {
+    switch (t.data.dtype()) {
       TF_CALL_ALL_TYPES(WRITER_ADD)
       TF_CALL_QUANTIZED_TYPES(WRITER_ADD)
       default:
-        context->SetStatus(errors::Unimplemented("Saving data type ",
-                                                 DataTypeString(input.dtype()),
-                                                 " not yet supported"));
-        return;
+        return errors::Unimplemented("Saving data type ",
+                                     DataTypeString(t.data.dtype()),
+                                     " not yet supported");
     }
 #undef WRITER_ADD
-    if (!s.ok()) {
-      context->SetStatus(s);
-      return;
-    }
   }
 
-  s = writer.Finish();
-  if (!s.ok()) {
-    context->SetStatus(s);
-  }
+  return writer.Finish();
+}
+
+void SaveTensors(
+    OpKernelContext* context,
+    checkpoint::TensorSliceWriter::CreateBuilderFunction builder_func,
+    bool save_slices) {
+  string filename;
+  std::vector<TensorToSave> tensors;
+  OP_REQUIRES_OK(context,
+                 GetTensorsToSave(context, save_slices, &filename, &tensors));
+  OP_REQUIRES_OK(context, WriteTensors(filename, "", builder_func, tensors));
 }
 
 void RestoreTensor(OpKernelContext* context,
@@ -212,9 +236,15 @@ void RestoreTensor(OpKernelContext* context,
   Tensor* t = nullptr;
   OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &t));
 
-#define READER_COPY(T)                                                      \
-  case DataTypeToEnum<T>::value:                                            \
-    reader->CopySliceData(tensor_name, slice_to_load, t->flat<T>().data()); \
+  // The saved slices, and the bytes of large ones, are copied in parallel
+  // on the device's worker threads.
+  thread::ThreadPool* pool =
+      context->device()->tensorflow_cpu_worker_threads()->workers;
+
+#define READER_COPY(T)                                                       \
+  case DataTypeToEnum<T>::value:                                             \
+    reader->CopySliceData(tensor_name, slice_to_load, t->flat<T>().data(),   \
+                          pool);                                             \
     break;
 
   switch (type) {
@@ -16,6 +16,12 @@ limitations under the License.
 #ifndef TENSORFLOW_KERNELS_SAVE_RESTORE_TENSOR_H_
 #define TENSORFLOW_KERNELS_SAVE_RESTORE_TENSOR_H_
 
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_writer.h"
 
@@ -23,6 +29,28 @@ namespace tensorflow {
 
 class OpKernelContext;
 
+// A tensor, or a slice of a larger tensor, to save.
+struct TensorToSave {
+  string name;
+  TensorShape shape;  // The shape of the whole tensor.
+  TensorSlice slice;  // The slice of it in "data".
+  Tensor data;
+};
+
+// Checks the inputs of *context, which are as for SaveTensors(), and
+// sets "*filename" and "*tensors" to them.  The tensors share the buffers
+// of the inputs.
+Status GetTensorsToSave(OpKernelContext* context, bool save_slices,
+                        string* filename, std::vector<TensorToSave>* tensors);
+
+// Saves "tensors" to "filename" with a writer built from builder_func().
+// If "base" is not empty, the file is a delta checkpoint of "base" (see
+// TensorSliceWriter::SetBase()).
+Status WriteTensors(
+    const string& filename, const string& base,
+    checkpoint::TensorSliceWriter::CreateBuilderFunction builder_func,
+    const std::vector<TensorToSave>& tensors);
+
 // Save input tensors in *context to a writer built from builder_func().
 // context must have the following inputs:
 //  0: a single element string tensor that contains the file name.
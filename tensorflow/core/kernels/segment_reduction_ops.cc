@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -100,77 +101,73 @@ class SegmentReductionOp : public OpKernel {
                 errors::InvalidArgument("segment ids must be >= 0"));
     auto output_flat = output->flat_outer_dims<T>();
 
-#if !defined(EIGEN_HAS_INDEX_LIST)
-    Eigen::DSizes<Eigen::DenseIndex, 1> dims_to_reduce;
-    dims_to_reduce[0] = 0;
-#else
-    Eigen::IndexList<Eigen::type2index<0>> dims_to_reduce;
-#endif
-    Index start = 0, end = 1;
-
-    Index out_index = internal::SubtleMustCopy(segment_vec(start));
+    // Finds the first input row of every segment, verifying that the segment
+    // ids start at 0 and grow by one each time, so that we cover every
+    // possible output value.
+    std::vector<int64> segment_start(output_rows + 1);
+    Index out_index = internal::SubtleMustCopy(segment_vec(0));
     OP_REQUIRES(context, out_index == 0,
                 errors::InvalidArgument("segment ids do not start at 0"));
-
-    // TODO(agarwal): if this loop becomes a bottleneck, consider sharding it
-    // across threads.
-    Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
-    while (end <= num_indices) {
-      // We initialize next_index to 0 to avoid "warning: 'next_index' may be
-      // used uninitialized in this function" in the Mac build (since the
-      // compiler isn't smart enough to realize the code is safe).
-      Index next_index = 0;
-      if (end < num_indices) {
-        next_index = internal::SubtleMustCopy(segment_vec(end));
-        if (out_index == next_index) {
-          ++end;
-          continue;
-        }
-        // We have a new segment here.  Verify that the segment ids grow by one
-        // each time, so that we cover every possible output value.
-        OP_REQUIRES(
-            context, out_index + 1 == next_index,
-            errors::InvalidArgument("segment ids are not increasing by 1"));
-      }
-
-      // Process segment [start, end)
-      const T* in_slice_ptr = &input_flat(start, 0);
-      typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
-                               Eigen::Unaligned>
-          OutT;
-
+    segment_start[0] = 0;
+    for (int64 end = 1; end < num_indices; ++end) {
+      const Index next_index = internal::SubtleMustCopy(segment_vec(end));
+      if (out_index == next_index) continue;
       OP_REQUIRES(
-          context, FastBoundsCheck(out_index, output_rows),
+          context, out_index + 1 == next_index,
+          errors::InvalidArgument("segment ids are not increasing by 1"));
+      OP_REQUIRES(
+          context, FastBoundsCheck(next_index, output_rows),
           errors::InvalidArgument(
-              "Segment id ", out_index, " out of range [0, ", output_rows,
+              "Segment id ", next_index, " out of range [0, ", output_rows,
               "), probably because 'segment_ids' input is not sorted."));
-      T* out_slice_ptr = &output_flat(out_index, 0);
-      OutT out_slice(out_slice_ptr, out_slice_shape);
-      // We don't use out_slice.device(context->eigen_device<Device>)
-      // because these pieces of work are likely to be very small and
-      // the context switching overhead dwarfs any benefit we get from
-      // using another thread to do this work.
-      if (start == end - 1) {
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, out_slice_shape);
-        out_slice = in_slice;
-      } else {
-        Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(end - start,
-                                                           num_col);
-        typedef Eigen::TensorMap<Eigen::Tensor<const T, 2, Eigen::RowMajor>,
-                                 Eigen::Unaligned>
-            InT;
-        InT in_slice(in_slice_ptr, in_slice_shape);
-
-        out_slice = in_slice.reduce(dims_to_reduce, Reducer());
-      }
-      if (end >= num_indices) break;
-      start = end;
-      ++end;
+      segment_start[next_index] = end;
       out_index = next_index;
     }
+    OP_REQUIRES(
+        context, out_index + 1 == output_rows,
+        errors::InvalidArgument("segment ids are not increasing by 1"));
+    segment_start[output_rows] = num_indices;
+
+    // Each segment is reduced by a single thread, without splitting its
+    // reduction, since the segments are typically too small to be worth it.
+    auto work = [&input_flat, &output_flat, &segment_start, num_col](
+        int64 begin, int64 end) {
+#if !defined(EIGEN_HAS_INDEX_LIST)
+      Eigen::DSizes<Eigen::DenseIndex, 1> dims_to_reduce;
+      dims_to_reduce[0] = 0;
+#else
+      Eigen::IndexList<Eigen::type2index<0>> dims_to_reduce;
+#endif
+      Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
+      typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
+                               Eigen::Unaligned>
+          OutT;
+      for (int64 out_index = begin; out_index < end; ++out_index) {
+        const int64 start = segment_start[out_index];
+        const int64 limit = segment_start[out_index + 1];
+        const T* in_slice_ptr = &input_flat(start, 0);
+        OutT out_slice(&output_flat(out_index, 0), out_slice_shape);
+        if (start == limit - 1) {
+          typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
+                                   Eigen::Unaligned>
+              InT;
+          InT in_slice(in_slice_ptr, out_slice_shape);
+          out_slice = in_slice;
+        } else {
+          Eigen::DSizes<Eigen::DenseIndex, 2> in_slice_shape(limit - start,
+                                                             num_col);
+          typedef Eigen::TensorMap<
+              Eigen::Tensor<const T, 2, Eigen::RowMajor>, Eigen::Unaligned>
+              InT;
+          InT in_slice(in_slice_ptr, in_slice_shape);
+          out_slice = in_slice.reduce(dims_to_reduce, Reducer());
+        }
+      }
+    };
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, output_rows,
+          (num_indices / output_rows + 1) * num_col, work);
   }
 };
 
@@ -217,8 +214,122 @@ REGISTER_COMPLEX_CPU_KERNELS_ALL(complex128);
 #undef REGISTER_REAL_CPU_KERNELS_ALL
 #undef REGISTER_COMPLEX_CPU_KERNELS_ALL
 
+// The minimum cost of the rows of an unsorted segment reduction for it to be
+// sharded across threads.
+static const int64 kMinParallelSegmentReductionCost = 20000;
+
 namespace functor {
 
+// The reductions of the unsorted segment ops on CPU.  Each output row starts
+// as Initial(), is combined by Reduce() with its input rows in order, then
+// passed to Finish() with their number.
+template <typename T>
+struct UnsortedSegmentSumReduction {
+  static T Initial() { return T(0); }
+  static void Reduce(typename TTypes<T>::UnalignedVec out,
+                     typename TTypes<T>::UnalignedConstVec in) {
+    out += in;
+  }
+  static void Finish(typename TTypes<T>::UnalignedVec out, int64 count) {}
+};
+
+template <typename T>
+struct UnsortedSegmentMaxReduction {
+  static T Initial() { return Eigen::NumTraits<T>::lowest(); }
+  static void Reduce(typename TTypes<T>::UnalignedVec out,
+                     typename TTypes<T>::UnalignedConstVec in) {
+    out = out.cwiseMax(in);
+  }
+  static void Finish(typename TTypes<T>::UnalignedVec out, int64 count) {}
+};
+
+template <typename T>
+struct UnsortedSegmentMeanReduction {
+  static T Initial() { return T(0); }
+  static void Reduce(typename TTypes<T>::UnalignedVec out,
+                     typename TTypes<T>::UnalignedConstVec in) {
+    out += in;
+  }
+  static void Finish(typename TTypes<T>::UnalignedVec out, int64 count) {
+    if (count > 1) out = out / out.constant(static_cast<T>(count));
+  }
+};
+
+// Reduces the rows of "data" into the rows of "output" given by
+// "segment_ids" with "Reduction".  Large inputs are sharded across threads
+// by output row, each reduced in input order by a single thread, so that
+// the results do not depend on the number of threads.
+template <typename T, typename Index, typename Reduction>
+void UnsortedSegmentReduceCPU(OpKernelContext* ctx, const Index output_rows,
+                              const TensorShape& segment_ids_shape,
+                              typename TTypes<Index>::ConstFlat segment_ids,
+                              const Index data_size, const T* data,
+                              typename TTypes<T, 2>::Tensor output) {
+  output.setConstant(Reduction::Initial());
+  if (data_size == 0) {
+    return;
+  }
+  const int64 N = segment_ids.dimension(0);
+  const int64 num_col = data_size / N;
+  // Copies the segment ids, so that they cannot change once checked, and
+  // counts the input rows of each segment.
+  std::vector<Index> ids(N);
+  std::vector<int64> segment_start(output_rows + 1, 0);
+  for (int64 i = 0; i < N; ++i) {
+    Index j = internal::SubtleMustCopy(segment_ids(i));
+    OP_REQUIRES(ctx, FastBoundsCheck(j, output_rows),
+                errors::InvalidArgument(
+                    "segment_ids", SliceDebugString(segment_ids_shape, i),
+                    " = ", j, " is out of range [0, ", output_rows, ")"));
+    ids[i] = j;
+    ++segment_start[j + 1];
+  }
+
+  auto in_row = [data, num_col](int64 i) {
+    return typename TTypes<T>::UnalignedConstVec(data + i * num_col, num_col);
+  };
+  auto out_row = [&output, num_col](int64 j) {
+    return typename TTypes<T>::UnalignedVec(&output(j, 0), num_col);
+  };
+
+  const DeviceBase::CpuWorkerThreads& worker_threads =
+      *ctx->device()->tensorflow_cpu_worker_threads();
+  const int num_threads = worker_threads.num_threads;
+  if (num_threads <= 1 || N * num_col < kMinParallelSegmentReductionCost) {
+    for (int64 i = 0; i < N; ++i) {
+      Reduction::Reduce(out_row(ids[i]), in_row(i));
+    }
+    for (int64 j = 0; j < output_rows; ++j) {
+      Reduction::Finish(out_row(j), segment_start[j + 1]);
+    }
+    return;
+  }
+
+  // Sorts the input rows by segment, keeping their order within each.
+  for (int64 j = 0; j < output_rows; ++j) {
+    segment_start[j + 1] += segment_start[j];
+  }
+  std::vector<int64> rows(N);
+  {
+    std::vector<int64> next(segment_start.begin(), segment_start.end() - 1);
+    for (int64 i = 0; i < N; ++i) {
+      rows[next[ids[i]]++] = i;
+    }
+  }
+
+  auto work = [&segment_start, &rows, &in_row, &out_row](int64 begin,
+                                                         int64 end) {
+    for (int64 j = begin; j < end; ++j) {
+      for (int64 k = segment_start[j]; k < segment_start[j + 1]; ++k) {
+        Reduction::Reduce(out_row(j), in_row(rows[k]));
+      }
+      Reduction::Finish(out_row(j), segment_start[j + 1] - segment_start[j]);
+    }
+  };
+  Shard(num_threads, worker_threads.workers, output_rows,
+        (N / output_rows + 1) * num_col, work);
+}
+
 // UnsortedSegmentSumFunctor implementation for CPUDevice.
 template <typename T, typename Index>
 struct UnsortedSegmentSumFunctor<CPUDevice, T, Index> {
@@ -227,31 +338,48 @@ struct UnsortedSegmentSumFunctor<CPUDevice, T, Index> {
                   typename TTypes<Index>::ConstFlat segment_ids,
                   const Index data_size, const T* data,
                   typename TTypes<T, 2>::Tensor output) {
-    output.setZero();
-    if (data_size == 0) {
-      return;
-    }
-    const int64 N = segment_ids.dimension(0);
-    auto data_flat = typename TTypes<T, 2>::ConstTensor(data, N, data_size / N);
-    for (int64 i = 0; i < N; ++i) {
-      Index j = internal::SubtleMustCopy(segment_ids(i));
-      OP_REQUIRES(ctx, FastBoundsCheck(j, output_rows),
-                  errors::InvalidArgument(
-                      "segment_ids", SliceDebugString(segment_ids_shape, i),
-                      " = ", j, " is out of range [0, ", output_rows, ")"));
-      output.template chip<0>(j) += data_flat.template chip<0>(i);
-    }
+    UnsortedSegmentReduceCPU<T, Index, UnsortedSegmentSumReduction<T>>(
+        ctx, output_rows, segment_ids_shape, segment_ids, data_size, data,
+        output);
+  }
+};
+
+// UnsortedSegmentMaxFunctor implementation for CPUDevice.
+template <typename T, typename Index>
+struct UnsortedSegmentMaxFunctor<CPUDevice, T, Index> {
+  void operator()(OpKernelContext* ctx, const CPUDevice& d,
+                  const Index output_rows, const TensorShape& segment_ids_shape,
+                  typename TTypes<Index>::ConstFlat segment_ids,
+                  const Index data_size, const T* data,
+                  typename TTypes<T, 2>::Tensor output) {
+    UnsortedSegmentReduceCPU<T, Index, UnsortedSegmentMaxReduction<T>>(
+        ctx, output_rows, segment_ids_shape, segment_ids, data_size, data,
+        output);
+  }
+};
+
+// UnsortedSegmentMeanFunctor implementation for CPUDevice.
+template <typename T, typename Index>
+struct UnsortedSegmentMeanFunctor<CPUDevice, T, Index> {
+  void operator()(OpKernelContext* ctx, const CPUDevice& d,
+                  const Index output_rows, const TensorShape& segment_ids_shape,
+                  typename TTypes<Index>::ConstFlat segment_ids,
+                  const Index data_size, const T* data,
+                  typename TTypes<T, 2>::Tensor output) {
+    UnsortedSegmentReduceCPU<T, Index, UnsortedSegmentMeanReduction<T>>(
+        ctx, output_rows, segment_ids_shape, segment_ids, data_size, data,
+        output);
   }
 };
 
 }  // namespace functor
 
 // Similar to SegmentReductionOp but can handle unsorted segment definitions and
-// specifying size of output.
-template <typename Device, class T, class Index>
-class UnsortedSegmentSumOp : public OpKernel {
+// specifying size of output.  "Functor" does the reduction.
+template <typename Device, class T, class Index, typename Functor>
+class UnsortedSegmentReductionOp : public OpKernel {
  public:
-  explicit UnsortedSegmentSumOp(OpKernelConstruction* context)
+  explicit UnsortedSegmentReductionOp(OpKernelConstruction* context)
       : OpKernel(context) {}
 
   void Compute(OpKernelContext* context) override {
@@ -288,27 +416,52 @@ class UnsortedSegmentSumOp : public OpKernel {
     auto output_flat = output->flat_outer_dims<T>();
 
     auto data_ptr = data.template flat<T>().data();
-    functor::UnsortedSegmentSumFunctor<Device, T, Index>()(
-        context, context->template eigen_device<Device>(), output_rows,
-        segment_ids.shape(), segment_flat, data.NumElements(), data_ptr,
-        output_flat);
+    Functor()(context, context->template eigen_device<Device>(), output_rows,
+              segment_ids.shape(), segment_flat, data.NumElements(), data_ptr,
+              output_flat);
   }
 };
 
-#define REGISTER_CPU_UNSORTED_KERNELS(type, index_type)                \
-  REGISTER_KERNEL_BUILDER(Name("UnsortedSegmentSum")                   \
-                              .Device(DEVICE_CPU)                      \
-                              .TypeConstraint<type>("T")               \
-                              .TypeConstraint<index_type>("Tindices"), \
-                          UnsortedSegmentSumOp<CPUDevice, type, index_type>);
-
-#define REGISTER_CPU_UNSORTED_KERNELS_ALL(type) \
-  REGISTER_CPU_UNSORTED_KERNELS(type, int32);   \
-  REGISTER_CPU_UNSORTED_KERNELS(type, int64);
-
-TF_CALL_NUMBER_TYPES(REGISTER_CPU_UNSORTED_KERNELS_ALL);
-#undef REGISTER_CPU_UNSORTED_KERNELS
-#undef REGISTER_CPU_UNSORTED_KERNELS_ALL
+#define REGISTER_CPU_UNSORTED_KERNEL(name, reduction, type, index_type) \
+  REGISTER_KERNEL_BUILDER(                                             \
+      Name(name)                                                       \
+          .Device(DEVICE_CPU)                                          \
+          .TypeConstraint<type>("T")                                   \
+          .TypeConstraint<index_type>("Tindices"),                     \
+      UnsortedSegmentReductionOp<                                      \
+          CPUDevice, type, index_type,                                 \
+          functor::reduction<CPUDevice, type, index_type>>)
+
+#define REGISTER_REAL_CPU_UNSORTED_KERNELS(type, index_type)             \
+  REGISTER_CPU_UNSORTED_KERNEL("UnsortedSegmentSum",                     \
+                               UnsortedSegmentSumFunctor, type,          \
+                               index_type);                              \
+  REGISTER_CPU_UNSORTED_KERNEL("UnsortedSegmentMax",                     \
+                               UnsortedSegmentMaxFunctor, type,          \
+                               index_type);                              \
+  REGISTER_CPU_UNSORTED_KERNEL("UnsortedSegmentMean",                    \
+                               UnsortedSegmentMeanFunctor, type, index_type)
+
+#define REGISTER_COMPLEX_CPU_UNSORTED_KERNELS(type, index_type) \
+  REGISTER_CPU_UNSORTED_KERNEL("UnsortedSegmentSum",            \
+                               UnsortedSegmentSumFunctor, type, index_type)
+
+#define REGISTER_REAL_CPU_UNSORTED_KERNELS_ALL(type) \
+  REGISTER_REAL_CPU_UNSORTED_KERNELS(type, int32);   \
+  REGISTER_REAL_CPU_UNSORTED_KERNELS(type, int64)
+
+#define REGISTER_COMPLEX_CPU_UNSORTED_KERNELS_ALL(type) \
+  REGISTER_COMPLEX_CPU_UNSORTED_KERNELS(type, int32);   \
+  REGISTER_COMPLEX_CPU_UNSORTED_KERNELS(type, int64)
+
+TF_CALL_REAL_NUMBER_TYPES(REGISTER_REAL_CPU_UNSORTED_KERNELS_ALL);
+REGISTER_COMPLEX_CPU_UNSORTED_KERNELS_ALL(complex64);
+REGISTER_COMPLEX_CPU_UNSORTED_KERNELS_ALL(complex128);
+#undef REGISTER_CPU_UNSORTED_KERNEL
+#undef REGISTER_REAL_CPU_UNSORTED_KERNELS
+#undef REGISTER_COMPLEX_CPU_UNSORTED_KERNELS
+#undef REGISTER_REAL_CPU_UNSORTED_KERNELS_ALL
+#undef REGISTER_COMPLEX_CPU_UNSORTED_KERNELS_ALL
 
 #if GOOGLE_CUDA
 #define REGISTER_GPU_UNSORTED_KERNELS(type, index_type)                \
@@ -317,7 +470,10 @@ TF_CALL_NUMBER_TYPES(REGISTER_CPU_UNSORTED_KERNELS_ALL);
                               .HostMemory("num_segments")              \
                               .TypeConstraint<type>("T")               \
                               .TypeConstraint<index_type>("Tindices"), \
-                          UnsortedSegmentSumOp<GPUDevice, type, index_type>);
+                          UnsortedSegmentReductionOp<                  \
+                              GPUDevice, type, index_type,             \
+                              functor::UnsortedSegmentSumFunctor<      \
+                                  GPUDevice, type, index_type>>);
 
 #define REGISTER_GPU_UNSORTED_KERNELS_ALL(type) \
   REGISTER_GPU_UNSORTED_KERNELS(type, int32);   \
@@ -45,6 +45,28 @@ struct UnsortedSegmentSumFunctor {
                   typename TTypes<T, 2>::Tensor output);
 };
 
+// Functor for the UnsortedSegmentMax op, with the arguments of
+// UnsortedSegmentSumFunctor.  Only implemented for CPUDevice.
+template <typename Device, typename T, typename Index>
+struct UnsortedSegmentMaxFunctor {
+  void operator()(OpKernelContext* ctx, const Device& d,
+                  const Index output_rows, const TensorShape& segment_ids_shape,
+                  typename TTypes<Index>::ConstFlat segment_ids,
+                  const Index data_size, const T* data,
+                  typename TTypes<T, 2>::Tensor output);
+};
+
+// Functor for the UnsortedSegmentMean op, with the arguments of
+// UnsortedSegmentSumFunctor.  Only implemented for CPUDevice.
+template <typename Device, typename T, typename Index>
+struct UnsortedSegmentMeanFunctor {
+  void operator()(OpKernelContext* ctx, const Device& d,
+                  const Index output_rows, const TensorShape& segment_ids_shape,
+                  typename TTypes<Index>::ConstFlat segment_ids,
+                  const Index data_size, const T* data,
+                  typename TTypes<T, 2>::Tensor output);
+};
+
 }  // namespace functor
 }  // namespace tensorflow
 
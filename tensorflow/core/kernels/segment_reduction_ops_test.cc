@@ -113,6 +113,48 @@ BM_Reduce_Arg(64, 32, 2);
 BM_Reduce_Arg(4096, 32, 2);
 BM_Reduce_Arg(4096, 128, 2);
 
+static void UnsortedSegmentReductionHelper(int iters, const string& reduction,
+                                           int num_rows, int num_cols,
+                                           int num_segments) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor data(DT_FLOAT, TensorShape({num_rows, num_cols}));
+  data.flat<float>().setRandom();
+  Tensor segment_ids(DT_INT32, TensorShape({num_rows}));
+  auto segment_ids_flat = segment_ids.flat<int32>();
+  for (int i = 0; i < num_rows; ++i) {
+    segment_ids_flat(i) = (i * 31) % num_segments;
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), reduction)
+                  .Input(test::graph::Constant(g, data))
+                  .Input(test::graph::Constant(g, segment_ids))
+                  .Input(test::graph::Constant(g, test::AsScalar(num_segments)))
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+
+  testing::UseRealTime();
+  testing::BytesProcessed(static_cast<int64>(iters) * num_rows * num_cols *
+                          sizeof(float));
+  testing::StartTiming();
+  test::Benchmark("cpu", g).Run(iters);
+}
+
+#define BM_UnsortedReduce(O, R, C, S)                   \
+  static void BM_##O##_##R##_##C##_##S(int iters) {     \
+    UnsortedSegmentReductionHelper(iters, #O, R, C, S); \
+  }                                                     \
+  BENCHMARK(BM_##O##_##R##_##C##_##S);
+
+#define BM_UnsortedReduce_Arg(R, C, S)            \
+  BM_UnsortedReduce(UnsortedSegmentSum, R, C, S); \
+  BM_UnsortedReduce(UnsortedSegmentMax, R, C, S); \
+  BM_UnsortedReduce(UnsortedSegmentMean, R, C, S);
+
+BM_UnsortedReduce_Arg(4096, 128, 64);
+BM_UnsortedReduce_Arg(65536, 128, 4096);
+
 static void SparseSegmentMeanGradHelper(int iters, float uniqueness, int size) {
   testing::StopTiming();
   Graph* g = new Graph(OpRegistry::Global());
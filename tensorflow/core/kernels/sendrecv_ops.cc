@@ -17,9 +17,14 @@ limitations under the License.
 
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/snappy.h"
 
 namespace tensorflow {
 
@@ -140,4 +145,124 @@ REGISTER_KERNEL_BUILDER(Name("_HostRecv").Device(DEVICE_CPU), RecvOp);
 REGISTER_KERNEL_BUILDER(
     Name("_HostRecv").Device(DEVICE_GPU).HostMemory("tensor"), RecvOp);
 
+// _CompressTensor encodes a tensor as a scalar string containing:
+//   a format byte (kRawTensor or kSnappyTensor),
+//   the number of dimensions as a varint32,
+//   each dimension size as a varint64,
+//   the tensor bytes, snappy-compressed if the format is kSnappyTensor.
+static const char kRawTensor = 0;
+static const char kSnappyTensor = 1;
+
+class CompressTensorOp : public OpKernel {
+ public:
+  explicit CompressTensorOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
+    DataType dtype;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("T", &dtype));
+    OP_REQUIRES(ctx, DataTypeCanUseMemcpy(dtype),
+                errors::InvalidArgument("Cannot compress tensors of type ",
+                                        DataTypeString(dtype)));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& input = ctx->input(0);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
+    string* encoded = &output->scalar<string>()();
+
+    string header;
+    core::PutVarint32(&header, input.dims());
+    for (int d = 0; d < input.dims(); ++d) {
+      core::PutVarint64(&header, input.dim_size(d));
+    }
+
+    // Fall back to the raw bytes if snappy is not linked in or does
+    // not make the tensor any smaller.
+    const StringPiece data = input.tensor_data();
+    string compressed;
+    if (port::Snappy_Compress(data.data(), data.size(), &compressed) &&
+        compressed.size() < data.size()) {
+      encoded->reserve(1 + header.size() + compressed.size());
+      encoded->push_back(kSnappyTensor);
+      encoded->append(header);
+      encoded->append(compressed);
+    } else {
+      encoded->reserve(1 + header.size() + data.size());
+      encoded->push_back(kRawTensor);
+      encoded->append(header);
+      encoded->append(data.data(), data.size());
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("_CompressTensor").Device(DEVICE_CPU),
+                        CompressTensorOp);
+
+class UncompressTensorOp : public OpKernel {
+ public:
+  explicit UncompressTensorOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
+    DataType dtype;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("T", &dtype));
+    OP_REQUIRES(ctx, DataTypeCanUseMemcpy(dtype),
+                errors::InvalidArgument("Cannot uncompress tensors of type ",
+                                        DataTypeString(dtype)));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& input = ctx->input(0);
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(input.shape()),
+                errors::InvalidArgument("Compressed tensor must be a scalar: ",
+                                        input.shape().DebugString()));
+    StringPiece encoded(input.scalar<string>()());
+    OP_REQUIRES(ctx, !encoded.empty(),
+                errors::DataLoss("Empty compressed tensor"));
+    const char format = encoded[0];
+    encoded.remove_prefix(1);
+
+    uint32 dims;
+    OP_REQUIRES(ctx, core::GetVarint32(&encoded, &dims),
+                errors::DataLoss("Corrupt compressed tensor header"));
+    OP_REQUIRES(ctx, dims <= TensorShape::MaxDimensions(),
+                errors::DataLoss("Compressed tensor has too many dimensions: ",
+                                 dims));
+    gtl::InlinedVector<int64, 4> dim_sizes(dims);
+    for (uint32 d = 0; d < dims; ++d) {
+      uint64 dim_size;
+      OP_REQUIRES(ctx, core::GetVarint64(&encoded, &dim_size),
+                  errors::DataLoss("Corrupt compressed tensor header"));
+      dim_sizes[d] = static_cast<int64>(dim_size);
+    }
+    TensorShape shape;
+    OP_REQUIRES_OK(ctx,
+                   TensorShapeUtils::MakeShape(dim_sizes.data(), dims, &shape));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, shape, &output));
+    const StringPiece dst = output->tensor_data();
+    char* buf = const_cast<char*>(dst.data());
+    if (format == kRawTensor) {
+      OP_REQUIRES(ctx, encoded.size() == dst.size(),
+                  errors::DataLoss("Compressed tensor has ", encoded.size(),
+                                   " bytes, expected ", dst.size()));
+      memcpy(buf, encoded.data(), encoded.size());
+    } else if (format == kSnappyTensor) {
+      size_t uncompressed_size;
+      OP_REQUIRES(ctx, port::Snappy_GetUncompressedLength(
+                           encoded.data(), encoded.size(), &uncompressed_size),
+                  errors::DataLoss("Corrupt snappy-compressed tensor"));
+      OP_REQUIRES(ctx, uncompressed_size == dst.size(),
+                  errors::DataLoss("Compressed tensor has ", uncompressed_size,
+                                   " bytes, expected ", dst.size()));
+      OP_REQUIRES(
+          ctx, port::Snappy_Uncompress(encoded.data(), encoded.size(), buf),
+          errors::DataLoss("Corrupt snappy-compressed tensor"));
+    } else {
+      ctx->SetStatus(errors::DataLoss("Unknown compressed tensor format ",
+                                      static_cast<int>(format)));
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("_UncompressTensor").Device(DEVICE_CPU),
+                        UncompressTensorOp);
+
 }  // end namespace tensorflow
@@ -0,0 +1,115 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class TransferCodecOpTest : public OpsTestBase {
+ protected:
+  // Runs "op" (_CompressTensor or _UncompressTensor) with T = "dtype"
+  // on "input", and stores its output in "*output".
+  Status RunCodec(const string& op, DataType dtype, const Tensor& input,
+                  Tensor* output) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("codec", op)
+                           .Input(FakeInput(input.dtype()))
+                           .Attr("T", dtype)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    tensors_.push_back(new Tensor(input));
+    inputs_.push_back({nullptr, tensors_.back()});
+    TF_RETURN_IF_ERROR(RunOpKernel());
+    *output = *GetOutput(0);
+    return Status::OK();
+  }
+
+  template <typename T>
+  void ExpectRoundTrip(const Tensor& input) {
+    Tensor compressed;
+    TF_ASSERT_OK(
+        RunCodec("_CompressTensor", input.dtype(), input, &compressed));
+    EXPECT_EQ(DT_STRING, compressed.dtype());
+    EXPECT_TRUE(TensorShapeUtils::IsScalar(compressed.shape()));
+
+    Tensor uncompressed;
+    TF_ASSERT_OK(RunCodec("_UncompressTensor", input.dtype(), compressed,
+                          &uncompressed));
+    test::ExpectTensorEqual<T>(input, uncompressed);
+  }
+};
+
+TEST_F(TransferCodecOpTest, RoundTripSparseFloats) {
+  Tensor input(DT_FLOAT, TensorShape({16, 1024}));
+  input.flat<float>().setZero();
+  for (int i = 0; i < input.NumElements(); i += 97) {
+    input.flat<float>()(i) = i * 0.5f;
+  }
+  ExpectRoundTrip<float>(input);
+}
+
+TEST_F(TransferCodecOpTest, RoundTripRandomInts) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  Tensor input(DT_INT32, TensorShape({3, 5, 7}));
+  for (int i = 0; i < input.NumElements(); ++i) {
+    input.flat<int32>()(i) = rnd.Rand32();
+  }
+  ExpectRoundTrip<int32>(input);
+}
+
+TEST_F(TransferCodecOpTest, RoundTripSmallTensors) {
+  ExpectRoundTrip<float>(test::AsScalar<float>(3.5f));
+  ExpectRoundTrip<float>(Tensor(DT_FLOAT, TensorShape({0, 4})));
+  ExpectRoundTrip<int64>(test::AsTensor<int64>({1, 2}, {2}));
+}
+
+TEST_F(TransferCodecOpTest, CorruptInput) {
+  Tensor input(DT_FLOAT, TensorShape({64}));
+  input.flat<float>().setConstant(1.0f);
+  Tensor compressed;
+  TF_ASSERT_OK(RunCodec("_CompressTensor", DT_FLOAT, input, &compressed));
+
+  Tensor truncated(DT_STRING, TensorShape({}));
+  const string& encoded = compressed.scalar<string>()();
+  truncated.scalar<string>()() = encoded.substr(0, encoded.size() - 1);
+  Tensor uncompressed;
+  Status s =
+      RunCodec("_UncompressTensor", DT_FLOAT, truncated, &uncompressed);
+  EXPECT_EQ(error::DATA_LOSS, s.code()) << s;
+
+  s = RunCodec("_UncompressTensor", DT_FLOAT, test::AsScalar<string>(""),
+               &uncompressed);
+  EXPECT_EQ(error::DATA_LOSS, s.code()) << s;
+}
+
+TEST_F(TransferCodecOpTest, RejectsStrings) {
+  TF_ASSERT_OK(NodeDefBuilder("codec", "_CompressTensor")
+                   .Input(FakeInput(DT_STRING))
+                   .Finalize(node_def()));
+  EXPECT_EQ(error::INVALID_ARGUMENT, InitOp().code());
+}
+
+}  // namespace
+}  // namespace tensorflow
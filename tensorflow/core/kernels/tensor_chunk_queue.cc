@@ -0,0 +1,232 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/tensor_chunk_queue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Returns the shape of the rows of a tensor of shape "shape".
+TensorShape RowShape(const TensorShape& shape) {
+  TensorShape row_shape(shape);
+  row_shape.RemoveDim(0);
+  return row_shape;
+}
+
+// Returns the number of values in the rows of "t".
+int64 RowSize(const Tensor& t) {
+  const int64 rows = t.dim_size(0);
+  return rows > 0 ? t.NumElements() / rows
+                  : RowShape(t.shape()).num_elements();
+}
+
+// Returns a tensor of a single row that shares the buffer of "element".
+Tensor AsRow(const Tensor& element) {
+  TensorShape shape({1});
+  shape.AppendShape(element.shape());
+  Tensor row;
+  CHECK(row.CopyFrom(element, shape));
+  return row;
+}
+
+}  // namespace
+
+void TensorChunkQueue::PushBack(const PersistentTensor& batch, int64 begin,
+                                int64 end) {
+  if (begin == end) return;
+  int64 start = 0;
+  if (!chunks_.empty()) {
+    const Chunk& back = chunks_.back();
+    start = back.start + back.end - back.begin;
+  }
+  chunks_.push_back({batch, begin, end, start});
+  size_ += end - begin;
+}
+
+void TensorChunkQueue::PushFront(const PersistentTensor& batch, int64 begin,
+                                 int64 end) {
+  if (begin == end) return;
+  chunks_.push_front({batch, begin, end, front() - (end - begin)});
+  size_ += end - begin;
+}
+
+void TensorChunkQueue::PushBackElement(const Tensor& element) {
+  PushBack(PersistentTensor(AsRow(element)), 0, 1);
+}
+
+void TensorChunkQueue::PopFront(int64 n) {
+  DCHECK_LE(n, size_);
+  while (n > 0) {
+    Chunk& chunk = chunks_.front();
+    const int64 popped = std::min(n, chunk.end - chunk.begin);
+    chunk.begin += popped;
+    chunk.start += popped;
+    size_ -= popped;
+    n -= popped;
+    if (chunk.begin == chunk.end) chunks_.pop_front();
+  }
+}
+
+void TensorChunkQueue::PopBack(int64 n) {
+  DCHECK_LE(n, size_);
+  while (n > 0) {
+    Chunk& chunk = chunks_.back();
+    const int64 popped = std::min(n, chunk.end - chunk.begin);
+    chunk.end -= popped;
+    size_ -= popped;
+    n -= popped;
+    if (chunk.begin == chunk.end) chunks_.pop_back();
+  }
+}
+
+std::deque<TensorChunkQueue::Chunk>::iterator TensorChunkQueue::FindChunk(
+    int64 index) {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, size_);
+  const int64 position = front() + index;
+  auto it = std::upper_bound(
+      chunks_.begin(), chunks_.end(), position,
+      [](int64 p, const Chunk& chunk) { return p < chunk.start; });
+  return --it;
+}
+
+Status TensorChunkQueue::GetElement(int64 index, OpKernelContext* ctx,
+                                    Tensor* element) {
+  auto chunk = FindChunk(index);
+  const Tensor& batch = *chunk->batch.AccessTensor(ctx);
+  const int64 row = chunk->begin + front() + index - chunk->start;
+  const Tensor slice =
+      batch.dim_size(0) == 1 ? batch : batch.Slice(row, row + 1);
+  if (slice.IsAligned() && element->CopyFrom(slice, RowShape(batch.shape()))) {
+    return Status::OK();
+  }
+  return CopyElement(index, ctx, element);
+}
+
+Status TensorChunkQueue::CopyElement(int64 index, OpKernelContext* ctx,
+                                     Tensor* element) {
+  auto chunk = FindChunk(index);
+  const Tensor& batch = *chunk->batch.AccessTensor(ctx);
+  const int64 row = chunk->begin + front() + index - chunk->start;
+  TF_RETURN_IF_ERROR(
+      ctx->allocate_temp(batch.dtype(), RowShape(batch.shape()), element));
+  Tensor element_row = AsRow(*element);
+  return CopyRows(batch, row, 1, &element_row, 0);
+}
+
+bool TensorChunkQueue::ShareFront(int64 n, OpKernelContext* ctx,
+                                  Tensor* batch) {
+  if (chunks_.empty()) return false;
+  Chunk& chunk = chunks_.front();
+  if (n > chunk.end - chunk.begin) return false;
+  const Tensor& chunk_batch = *chunk.batch.AccessTensor(ctx);
+  if (chunk.begin == 0 && n == chunk_batch.dim_size(0)) {
+    *batch = chunk_batch;
+    return true;
+  }
+  const Tensor slice = chunk_batch.Slice(chunk.begin, chunk.begin + n);
+  if (!slice.IsAligned()) return false;
+  *batch = slice;
+  return true;
+}
+
+Status TensorChunkQueue::CopyToBatch(int64 index, int64 n,
+                                     OpKernelContext* ctx, Tensor* batch,
+                                     int64 row) {
+  return ForEachRun(index, n, ctx,
+                    [batch, &row](const Tensor& src, int64 begin, int64 end) {
+                      const int64 rows = end - begin;
+                      Status s = CopyRows(src, begin, rows, batch, row);
+                      row += rows;
+                      return s;
+                    });
+}
+
+Status TensorChunkQueue::MoveElement(int64 from, int64 to,
+                                     OpKernelContext* ctx) {
+  if (from == to) return Status::OK();
+  auto src = FindChunk(from);
+  auto dst = FindChunk(to);
+  return CopyRows(*src->batch.AccessTensor(ctx),
+                  src->begin + front() + from - src->start, 1,
+                  dst->batch.AccessTensor(ctx),
+                  dst->begin + front() + to - dst->start);
+}
+
+Status TensorChunkQueue::ForEachRun(int64 index, int64 n, OpKernelContext* ctx,
+                                    const RunCallback& fn) {
+  if (n == 0) return Status::OK();
+  DCHECK_LE(index + n, size_);
+  auto chunk = FindChunk(index);
+  int64 begin = chunk->begin + front() + index - chunk->start;
+  while (n > 0) {
+    const int64 end = std::min(chunk->end, begin + n);
+    TF_RETURN_IF_ERROR(fn(*chunk->batch.AccessTensor(ctx), begin, end));
+    n -= end - begin;
+    ++chunk;
+    if (n > 0) begin = chunk->begin;
+  }
+  return Status::OK();
+}
+
+/* static */
+Status TensorChunkQueue::CopyRows(const Tensor& src, int64 src_row, int64 n,
+                                  Tensor* dst, int64 dst_row) {
+  if (src.dtype() != dst->dtype()) {
+    return errors::Internal("CopyRows: mismatched types: ",
+                            DataTypeString(src.dtype()), " vs. ",
+                            DataTypeString(dst->dtype()));
+  }
+  const int64 row_size = RowSize(src);
+  if (RowSize(*dst) != row_size) {
+    return errors::Internal("CopyRows: mismatched row shapes: ",
+                            src.shape().DebugString(), " vs. ",
+                            dst->shape().DebugString());
+  }
+  DCHECK_LE(src_row + n, src.dim_size(0));
+  DCHECK_LE(dst_row + n, dst->dim_size(0));
+  if (n == 0 || row_size == 0) return Status::OK();
+  // Slices of tensors may not be aligned, so the values are accessed
+  // through their raw buffers.
+  const char* src_data = src.tensor_data().data();
+  char* dst_data = const_cast<char*>(dst->tensor_data().data());
+  const int value_size = DataTypeSize(src.dtype());
+  if (DataTypeCanUseMemcpy(src.dtype()) && value_size > 0) {
+    const int64 row_bytes = row_size * value_size;
+    memcpy(dst_data + dst_row * row_bytes, src_data + src_row * row_bytes,
+           n * row_bytes);
+    return Status::OK();
+  }
+  if (src.dtype() == DT_STRING) {
+    const string* src_values =
+        reinterpret_cast<const string*>(src_data) + src_row * row_size;
+    string* dst_values =
+        reinterpret_cast<string*>(dst_data) + dst_row * row_size;
+    std::copy(src_values, src_values + n * row_size, dst_values);
+    return Status::OK();
+  }
+  return errors::Unimplemented("CopyRows: unhandled data type: ",
+                               DataTypeString(src.dtype()));
+}
+
+}  // namespace tensorflow
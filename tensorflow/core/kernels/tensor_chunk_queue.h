@@ -0,0 +1,119 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_TENSOR_CHUNK_QUEUE_H_
+#define TENSORFLOW_CORE_KERNELS_TENSOR_CHUNK_QUEUE_H_
+
+#include <deque>
+#include <functional>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A queue of the values of one component of the elements of a queue.
+//
+// The values are not stored one tensor per element.  They are kept in
+// chunks, each a range of rows of a batch tensor whose first dimension
+// indexes the elements, as they were enqueued: the elements of a chunk
+// have the same shape.  Whole ranges of elements are thus moved with one
+// copy per chunk, or shared without any copy.
+//
+// Not thread-safe.  Copies share the chunks.
+class TensorChunkQueue {
+ public:
+  TensorChunkQueue() : size_(0) {}
+
+  // Returns the number of elements in the queue.
+  int64 size() const { return size_; }
+
+  // Appends (prepends) the elements that are the rows [begin, end) of
+  // "batch".  The queue shares the buffer of "batch", so it must not be
+  // modified by the caller afterwards.
+  void PushBack(const PersistentTensor& batch, int64 begin, int64 end);
+  void PushFront(const PersistentTensor& batch, int64 begin, int64 end);
+
+  // Appends "element", whose buffer the queue shares.
+  void PushBackElement(const Tensor& element);
+
+  // Removes the first (last) "n" elements.
+  // REQUIRES: n <= size()
+  void PopFront(int64 n);
+  void PopBack(int64 n);
+
+  // Sets "*element" to the index^th element.  It shares the buffer of
+  // the queue unless the element is not aligned.
+  Status GetElement(int64 index, OpKernelContext* ctx, Tensor* element);
+
+  // Sets "*element" to a copy of the index^th element.
+  Status CopyElement(int64 index, OpKernelContext* ctx, Tensor* element);
+
+  // If the first "n" elements are stored in one chunk and are aligned,
+  // sets "*batch" to them, sharing the buffer of the queue, and returns
+  // true.  Otherwise returns false.
+  bool ShareFront(int64 n, OpKernelContext* ctx, Tensor* batch);
+
+  // Copies the "n" elements starting at the index^th to the rows
+  // starting at "row" of "*batch", which must have the shape of the
+  // elements.
+  Status CopyToBatch(int64 index, int64 n, OpKernelContext* ctx, Tensor* batch,
+                     int64 row);
+
+  // Copies the "from"^th element over the "to"^th.  The chunk of the
+  // "to"^th element must not be shared with anything but the queue.
+  Status MoveElement(int64 from, int64 to, OpKernelContext* ctx);
+
+  // Calls "fn(batch, begin, end)" for the elements from the index^th to
+  // the (index + n - 1)^th in order, once per chunk they are stored in:
+  // the elements are the rows [begin, end) of "batch".  Stops at, and
+  // returns, the first error "fn" returns.
+  typedef std::function<Status(const Tensor&, int64, int64)> RunCallback;
+  Status ForEachRun(int64 index, int64 n, OpKernelContext* ctx,
+                    const RunCallback& fn);
+
+  // Copies the rows [src_row, src_row + n) of "src" to the rows starting
+  // at "dst_row" of "*dst", whose rows must have as many values as those
+  // of "src".  Unlike Tensor methods, it does not require the tensors to
+  // be aligned.
+  static Status CopyRows(const Tensor& src, int64 src_row, int64 n,
+                         Tensor* dst, int64 dst_row);
+
+ private:
+  struct Chunk {
+    PersistentTensor batch;
+    int64 begin;  // The first row of batch in the queue.
+    int64 end;    // One past the last row of batch in the queue.
+    int64 start;  // The position of the first row in the queue.
+  };
+
+  // Returns the chunk of the index^th element.
+  // REQUIRES: 0 <= index < size()
+  std::deque<Chunk>::iterator FindChunk(int64 index);
+
+  // The position of the front of the queue.  It is that of the first
+  // chunk, whose positions are consecutive.
+  int64 front() const { return chunks_.empty() ? 0 : chunks_.front().start; }
+
+  std::deque<Chunk> chunks_;
+  int64 size_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_TENSOR_CHUNK_QUEUE_H_
@@ -0,0 +1,161 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/tensor_chunk_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+class TensorChunkQueueTest : public ::testing::Test {
+ protected:
+  TensorChunkQueueTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:a/replica:0/task:0")) {
+    params_.device = device_.get();
+    context_.reset(new OpKernelContext(&params_, 0));
+  }
+
+  // Returns a batch of "n" elements of "width" values, where the j^th
+  // value of the i^th element is 10 * (first + i) + j.
+  static Tensor Batch(int64 first, int64 n, int64 width) {
+    Tensor batch(DT_FLOAT, TensorShape({n, width}));
+    for (int64 i = 0; i < n; ++i) {
+      for (int64 j = 0; j < width; ++j) {
+        batch.matrix<float>()(i, j) = 10 * (first + i) + j;
+      }
+    }
+    return batch;
+  }
+
+  std::unique_ptr<Device> device_;
+  OpKernelContext::Params params_;
+  std::unique_ptr<OpKernelContext> context_;
+};
+
+TEST_F(TensorChunkQueueTest, PushAndPop) {
+  TensorChunkQueue queue;
+  EXPECT_EQ(0, queue.size());
+  queue.PushBack(PersistentTensor(Batch(0, 4, 2)), 1, 4);
+  queue.PushBackElement(test::AsTensor<float>({40, 41}));
+  queue.PushFront(PersistentTensor(Batch(-2, 2, 2)), 0, 2);
+  queue.PushBack(PersistentTensor(Batch(5, 2, 2)), 0, 2);
+  EXPECT_EQ(8, queue.size());
+
+  Tensor batch(DT_FLOAT, TensorShape({8, 2}));
+  TF_ASSERT_OK(queue.CopyToBatch(0, 8, context_.get(), &batch, 0));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({-20, -19, -10, -9, 10, 11, 20, 21, 30, 31, 40, 41,
+                             50, 51, 60, 61},
+                            TensorShape({8, 2})),
+      batch);
+
+  queue.PopFront(3);
+  queue.PopBack(1);
+  EXPECT_EQ(4, queue.size());
+  batch = Tensor(DT_FLOAT, TensorShape({4, 2}));
+  TF_ASSERT_OK(queue.CopyToBatch(0, 4, context_.get(), &batch, 0));
+  test::ExpectTensorEqual<float>(Batch(2, 4, 2), batch);
+}
+
+TEST_F(TensorChunkQueueTest, GetElement) {
+  TensorChunkQueue queue;
+  const Tensor batch = Batch(0, 3, 4);
+  queue.PushBack(PersistentTensor(batch), 0, 3);
+  for (int64 i = 0; i < 3; ++i) {
+    Tensor element;
+    TF_ASSERT_OK(queue.GetElement(i, context_.get(), &element));
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({10.0f * i, 10.0f * i + 1, 10.0f * i + 2,
+                               10.0f * i + 3}),
+        element);
+    TF_ASSERT_OK(queue.CopyElement(i, context_.get(), &element));
+    EXPECT_FALSE(element.SharesBufferWith(batch));
+    test::ExpectTensorEqual<float>(
+        test::AsTensor<float>({10.0f * i, 10.0f * i + 1, 10.0f * i + 2,
+                               10.0f * i + 3}),
+        element);
+  }
+}
+
+TEST_F(TensorChunkQueueTest, ShareFront) {
+  TensorChunkQueue queue;
+  const Tensor batch = Batch(0, 4, 2);
+  queue.PushBack(PersistentTensor(batch), 0, 4);
+  queue.PushBack(PersistentTensor(Batch(4, 2, 2)), 0, 2);
+  Tensor shared;
+  EXPECT_TRUE(queue.ShareFront(4, context_.get(), &shared));
+  EXPECT_TRUE(shared.SharesBufferWith(batch));
+  test::ExpectTensorEqual<float>(batch, shared);
+  // The elements span two chunks.
+  EXPECT_FALSE(queue.ShareFront(5, context_.get(), &shared));
+}
+
+TEST_F(TensorChunkQueueTest, MoveElement) {
+  TensorChunkQueue queue;
+  queue.PushBack(PersistentTensor(Batch(0, 2, 1)), 0, 2);
+  queue.PushBack(PersistentTensor(Batch(2, 2, 1)), 0, 2);
+  TF_ASSERT_OK(queue.MoveElement(3, 0, context_.get()));
+  queue.PopBack(1);
+  Tensor batch(DT_FLOAT, TensorShape({3, 1}));
+  TF_ASSERT_OK(queue.CopyToBatch(0, 3, context_.get(), &batch, 0));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({30, 10, 20}, TensorShape({3, 1})), batch);
+}
+
+TEST_F(TensorChunkQueueTest, ForEachRun) {
+  TensorChunkQueue queue;
+  queue.PushBack(PersistentTensor(Batch(0, 3, 1)), 0, 3);
+  queue.PushBack(PersistentTensor(Batch(3, 5, 1)), 1, 5);
+  std::vector<std::pair<int64, int64>> runs;
+  TF_ASSERT_OK(queue.ForEachRun(
+      1, 4, context_.get(),
+      [&runs](const Tensor& batch, int64 begin, int64 end) {
+        runs.emplace_back(begin, end);
+        return Status::OK();
+      }));
+  ASSERT_EQ(2, runs.size());
+  EXPECT_EQ(std::make_pair(int64{1}, int64{3}), runs[0]);
+  EXPECT_EQ(std::make_pair(int64{1}, int64{3}), runs[1]);
+}
+
+TEST_F(TensorChunkQueueTest, CopyRows) {
+  Tensor src(DT_STRING, TensorShape({3, 2}));
+  for (int i = 0; i < 6; ++i) src.flat<string>()(i) = strings::StrCat(i);
+  Tensor dst(DT_STRING, TensorShape({2, 2}));
+  TF_ASSERT_OK(TensorChunkQueue::CopyRows(src, 1, 2, &dst, 0));
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>({"2", "3", "4", "5"}, TensorShape({2, 2})), dst);
+
+  Tensor wrong_type(DT_INT32, TensorShape({2, 2}));
+  EXPECT_FALSE(TensorChunkQueue::CopyRows(src, 0, 1, &wrong_type, 0).ok());
+  Tensor wrong_shape(DT_STRING, TensorShape({2, 3}));
+  EXPECT_FALSE(TensorChunkQueue::CopyRows(src, 0, 1, &wrong_shape, 0).ok());
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,9 +16,12 @@ limitations under the License.
 // See docs in ../ops/io_ops.cc.
 
 #include <memory>
+#include <vector>
 #include "tensorflow/core/framework/reader_op_kernel.h"
 #include "tensorflow/core/kernels/reader_base.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/prefetching_record_reader.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -28,26 +31,35 @@ namespace tensorflow {
 class TFRecordReader : public ReaderBase {
  public:
   TFRecordReader(const string& node_name, const string& compression_type,
+                 const io::PrefetchingRecordReaderOptions& prefetch_options,
                  Env* env)
       : ReaderBase(strings::StrCat("TFRecordReader '", node_name, "'")),
         env_(env),
         offset_(0),
-        compression_type_(compression_type) {}
+        compression_type_(compression_type),
+        prefetch_options_(prefetch_options) {
+    if (prefetch_options_.readahead_depth > 0) {
+      readahead_pool_.reset(new thread::ThreadPool(
+          env, "record_readahead", prefetch_options_.readahead_depth));
+    }
+  }
 
   Status OnWorkStartedLocked() override {
     offset_ = 0;
     TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(current_work(), &file_));
 
-    io::RecordReaderOptions options;
+    // Compressed files are read one record at a time, uncompressed ones
+    // in large chunks read ahead.
     if (compression_type_ == "ZLIB") {
+      io::RecordReaderOptions options;
       options.compression_type = io::RecordReaderOptions::ZLIB_COMPRESSION;
+      reader_.reset(new io::RecordReader(file_.get(), options));
     }
-
-    reader_.reset(new io::RecordReader(file_.get(), options));
     return Status::OK();
   }
 
   Status OnWorkFinishedLocked() override {
+    prefetching_reader_.reset(nullptr);
     reader_.reset(nullptr);
     file_.reset(nullptr);
     return Status::OK();
@@ -55,6 +67,20 @@ class TFRecordReader : public ReaderBase {
 
   Status ReadLocked(string* key, string* value, bool* produced,
                     bool* at_end) override {
+    if (reader_ == nullptr) {
+      std::vector<string> keys;
+      std::vector<string> values;
+      int64 num_read;
+      TF_RETURN_IF_ERROR(
+          ReadUpToLocked(1, &keys, &values, &num_read, at_end));
+      if (num_read > 0) {
+        *key = std::move(keys[0]);
+        *value = std::move(values[0]);
+        *produced = true;
+      }
+      return Status::OK();
+    }
+
     *key = strings::StrCat(current_work(), ":", offset_);
     Status status = reader_->ReadRecord(&offset_, value);
     if (errors::IsOutOfRange(status)) {
@@ -66,8 +92,41 @@ class TFRecordReader : public ReaderBase {
     return Status::OK();
   }
 
+  Status ReadUpToLocked(int64 num_records, std::vector<string>* keys,
+                        std::vector<string>* values, int64* num_read,
+                        bool* at_end) override {
+    if (reader_ != nullptr) {
+      return ReaderBase::ReadUpToLocked(num_records, keys, values, num_read,
+                                        at_end);
+    }
+
+    if (prefetching_reader_ == nullptr) {
+      prefetching_reader_.reset(new io::PrefetchingRecordReader(
+          file_.get(), offset_, prefetch_options_, readahead_pool_.get()));
+    }
+    const size_t num_values = values->size();
+    offsets_.clear();
+    Status status =
+        prefetching_reader_->ReadRecords(num_records, values, &offsets_);
+    *num_read = values->size() - num_values;
+    for (uint64 offset : offsets_) {
+      keys->push_back(strings::StrCat(current_work(), ":", offset));
+    }
+    offset_ = prefetching_reader_->offset();
+    if (errors::IsOutOfRange(status)) {
+      *at_end = true;
+      return Status::OK();
+    }
+    if (!status.ok()) {
+      // A rerun reads again from the bad record.
+      prefetching_reader_.reset(nullptr);
+    }
+    return status;
+  }
+
   Status ResetLocked() override {
     offset_ = 0;
+    prefetching_reader_.reset(nullptr);
     reader_.reset(nullptr);
     file_.reset(nullptr);
     return ReaderBase::ResetLocked();
@@ -81,6 +140,12 @@ class TFRecordReader : public ReaderBase {
   std::unique_ptr<RandomAccessFile> file_;
   std::unique_ptr<io::RecordReader> reader_;
   string compression_type_ = "";
+
+  const io::PrefetchingRecordReaderOptions prefetch_options_;
+  // Must outlive prefetching_reader_.
+  std::unique_ptr<thread::ThreadPool> readahead_pool_;
+  std::unique_ptr<io::PrefetchingRecordReader> prefetching_reader_;
+  std::vector<uint64> offsets_;
 };
 
 class TFRecordReaderOp : public ReaderOpKernel {
@@ -92,8 +157,18 @@ class TFRecordReaderOp : public ReaderOpKernel {
     string compression_type;
     context->GetAttr("compression_type", &compression_type);
 
-    SetReaderFactory([this, compression_type, env]() {
-      return new TFRecordReader(name(), compression_type, env);
+    int64 buffer_size;
+    OP_REQUIRES_OK(context, context->GetAttr("buffer_size", &buffer_size));
+    int64 readahead_depth;
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("readahead_depth", &readahead_depth));
+    io::PrefetchingRecordReaderOptions prefetch_options;
+    prefetch_options.buffer_size = buffer_size;
+    prefetch_options.readahead_depth = readahead_depth;
+
+    SetReaderFactory([this, compression_type, prefetch_options, env]() {
+      return new TFRecordReader(name(), compression_type, prefetch_options,
+                                env);
     });
   }
 };
@@ -17,9 +17,11 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/training_ops.h"
 #include <algorithm>
+#include <vector>
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -33,7 +35,90 @@ inline T sgn(const T x) {
   T one(1);
   return (x == zero ? zero : (x < zero ? -one : one));
 }
+
+// Returns the row^th row of "matrix" as a vector, whose operations Eigen
+// vectorizes.
+template <typename T>
+inline typename TTypes<T>::UnalignedVec Row(typename TTypes<T>::Matrix matrix,
+                                            int64 row) {
+  return typename TTypes<T>::UnalignedVec(&matrix(row, 0),
+                                          matrix.dimension(1));
+}
+
+template <typename T>
+inline typename TTypes<T>::UnalignedConstVec Row(
+    typename TTypes<T>::ConstMatrix matrix, int64 row) {
+  return typename TTypes<T>::UnalignedConstVec(&matrix(row, 0),
+                                               matrix.dimension(1));
+}
+
+// Sparse updates costing less than this are run on the calling thread.
+const int64 kMinParallelSparseUpdateCost = 20000;
+
+// Checks that the values of "indices" are rows in [0, first_dim_size), and
+// then calls "update(i, index)" for each offset i in indices, where "index"
+// is indices(i), at an estimated cost of "cost_per_update" each.
+//
+// The updates are run on the CPU worker threads.  The offsets are
+// partitioned by row, and those of a row run on one thread in order, so
+// that the results are the same as those of a loop over the offsets, even
+// when some indices are repeated.
+template <typename Tindex, typename UpdateFn>
+Status ParallelSparseUpdate(OpKernelContext* ctx, const Tensor& indices,
+                            Tindex first_dim_size, int64 cost_per_update,
+                            const UpdateFn& update) {
+  auto indices_vec = indices.vec<Tindex>();
+  const int64 N = indices_vec.dimension(0);
+  // Copies the indices, so that they cannot change once checked.
+  std::vector<Tindex> rows(N);
+  for (int64 i = 0; i < N; i++) {
+    const Tindex index = internal::SubtleMustCopy(indices_vec(i));
+    if (!FastBoundsCheck(index, first_dim_size)) {
+      return errors::InvalidArgument(strings::StrCat(
+          "Index ", index, " at offset ", i, " in indices is out of range"));
+    }
+    rows[i] = index;
+  }
+
+  const DeviceBase::CpuWorkerThreads& worker_threads =
+      *ctx->device()->tensorflow_cpu_worker_threads();
+  const int num_threads = worker_threads.num_threads;
+  if (num_threads <= 1 || N * cost_per_update < kMinParallelSparseUpdateCost) {
+    for (int64 i = 0; i < N; i++) {
+      update(i, rows[i]);
+    }
+    return Status::OK();
+  }
+
+  // Sorts the offsets by partition of their rows, keeping their order
+  // within each.
+  std::vector<int64> partition_start(num_threads + 1, 0);
+  for (int64 i = 0; i < N; i++) {
+    ++partition_start[rows[i] % num_threads + 1];
+  }
+  for (int p = 0; p < num_threads; p++) {
+    partition_start[p + 1] += partition_start[p];
+  }
+  std::vector<int64> offsets(N);
+  {
+    std::vector<int64> next(partition_start.begin(), partition_start.end() - 1);
+    for (int64 i = 0; i < N; i++) {
+      offsets[next[rows[i] % num_threads]++] = i;
+    }
+  }
+
+  auto work = [&rows, &partition_start, &offsets, &update](int64 begin,
+                                                            int64 end) {
+    for (int64 k = partition_start[begin]; k < partition_start[end]; k++) {
+      const int64 i = offsets[k];
+      update(i, rows[i]);
+    }
+  };
+  Shard(num_threads, worker_threads.workers, num_threads,
+        N * cost_per_update / num_threads, work);
+  return Status::OK();
 }
+}  // namespace
 
 namespace functor {
 template <typename T>
@@ -561,16 +646,6 @@ class SparseApplyAdadeltaOp : public OpKernel {
 
     if (N > 0) {
       const Tindex first_dim_size = var.dim_size(0);
-      // Validate all the indices are in range
-      auto indices_vec = indices.vec<Tindex>();
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-        OP_REQUIRES(ctx, index >= 0 && index < first_dim_size,
-                    errors::InvalidArgument(
-                        strings::StrCat("Index ", index, " at offset ", i,
-                                        " in indices is out of range")));
-      }
-
       auto var_flat = var.flat_outer_dims<T>();
       auto accum_grad_flat = accum_grad.flat_outer_dims<T>();
       auto accum_update_flat = accum_update.flat_outer_dims<T>();
@@ -579,11 +654,10 @@ class SparseApplyAdadeltaOp : public OpKernel {
       const T rho_scalar = rho.scalar<T>()();
       const T epsilon_scalar = epsilon.scalar<T>()();
 
-      for (Tindex i = 0; i < N; i++) {
-        const Tindex index = indices_vec(i);
-        auto accum_ = accum_grad_flat.template chip<0>(index);
-        auto accum_update_ = accum_update_flat.template chip<0>(index);
-        auto grad_ = grad_flat.template chip<0>(i);
+      auto update_row = [&](int64 i, Tindex index) {
+        auto accum_ = Row<T>(accum_grad_flat, index);
+        auto accum_update_ = Row<T>(accum_update_flat, index);
+        auto grad_ = Row<T>(grad_flat, i);
 
         accum_ = accum_ * accum_.constant(rho_scalar) +
                  grad_.square() * grad_.constant(T(1) - rho_scalar);
@@ -593,9 +667,12 @@ class SparseApplyAdadeltaOp : public OpKernel {
         accum_update_ =
             accum_update_ * accum_update_.constant(rho_scalar) +
             update.square() * update.constant(static_cast<T>(1) - rho_scalar);
-        auto v = var_flat.template chip<0>(index);
+        auto v = Row<T>(var_flat, index);
         v -= update * update.constant(lr_scalar);
-      }
+      };
+      OP_REQUIRES_OK(ctx, ParallelSparseUpdate(ctx, indices, first_dim_size,
+                                               30 * grad_flat.dimension(1),
+                                               update_row));
     }
     if (use_exclusive_lock_) {
       mu_var->unlock();
@@ -1054,45 +1131,35 @@ class SparseApplyAdagradOp : public OpKernel {
     if (N > 0) {
       if (inner_dim > 1) {
         const Tindex first_dim_size = var.dim_size(0);
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat_outer_dims<T>();
         auto accum_flat = accum.flat_outer_dims<T>();
         auto grad_flat = grad.flat_outer_dims<T>();
         T lr_scalar = lr.scalar<T>()();
 
-        // Note(yonghui): It might be worth multi-threading square() and
-        // rsqrt().
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-          auto a = accum_flat.template chip<0>(index);
-          auto g = grad_flat.template chip<0>(i);
-          auto v = var_flat.template chip<0>(index);
+        auto update = [&](int64 i, Tindex index) {
+          auto a = Row<T>(accum_flat, index);
+          auto g = Row<T>(grad_flat, i);
+          auto v = Row<T>(var_flat, index);
           a += g.square();
           v -= g.constant(lr_scalar) * g * a.rsqrt();
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseUpdate(ctx, indices, first_dim_size,
+                                                 10 * inner_dim, update));
       } else {
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
         auto accum_flat = accum.flat<T>();
         auto grad_flat = grad.flat<T>();
         T lr_scalar = lr.scalar<T>()();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&](int64 i, Tindex index) {
           T& a = accum_flat(index);
           const T& g = grad_flat(i);
           a += g * g;
           var_flat(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseUpdate(ctx, indices, first_dim_size,
+                                                 20, update));
       }
     }
 
@@ -1189,7 +1256,6 @@ class SparseApplyProximalAdagradOp : public OpKernel {
     if (N > 0) {
       if (inner_dim > 1) {
         const Tindex first_dim_size = var.dim_size(0);
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat_outer_dims<T>();
         auto accum_flat = accum.flat_outer_dims<T>();
         auto grad_flat = grad.flat_outer_dims<T>();
@@ -1197,15 +1263,10 @@ class SparseApplyProximalAdagradOp : public OpKernel {
         T l1_scalar = l1.scalar<T>()();
         T l2_scalar = l2.scalar<T>()();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
-          auto a = accum_flat.template chip<0>(index);
-          auto g = grad_flat.template chip<0>(i);
-          auto v = var_flat.template chip<0>(index);
+        auto update = [&](int64 i, Tindex index) {
+          auto a = Row<T>(accum_flat, index);
+          auto g = Row<T>(grad_flat, i);
+          auto v = Row<T>(var_flat, index);
           a += g.square();
           // compute learning_rate for current step.
           auto learning_rate = a.constant(lr_scalar) * a.rsqrt();
@@ -1222,9 +1283,10 @@ class SparseApplyProximalAdagradOp : public OpKernel {
           if (l2_scalar > 0) {
             v /= (v.constant(1.0) + v.constant(l2_scalar) * learning_rate);
           }
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseUpdate(ctx, indices, first_dim_size,
+                                                 20 * inner_dim, update));
       } else {
-        auto indices_vec = indices.vec<Tindex>();
         auto var_flat = var.flat<T>();
         auto accum_flat = accum.flat<T>();
         auto grad_flat = grad.flat<T>();
@@ -1233,12 +1295,7 @@ class SparseApplyProximalAdagradOp : public OpKernel {
         T l2_scalar = l2.scalar<T>()();
         const Tindex first_dim_size = accum_flat.size();
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          OP_REQUIRES(ctx, FastBoundsCheck(index, first_dim_size),
-                      errors::InvalidArgument(
-                          strings::StrCat("Index ", index, " at offset ", i,
-                                          " in indices is out of range")));
+        auto update = [&](int64 i, Tindex index) {
           T& a = accum_flat(index);
           const T& g = grad_flat(i);
           a += g * g;
@@ -1255,7 +1312,9 @@ class SparseApplyProximalAdagradOp : public OpKernel {
           if (l2_scalar > 0) {
             var_flat(index) /= (1.0 + l2_scalar * learning_rate);
           }
-        }
+        };
+        OP_REQUIRES_OK(ctx, ParallelSparseUpdate(ctx, indices, first_dim_size,
+                                                 30, update));
       }
     }
 
@@ -233,4 +233,50 @@ static void BM_RMSProp(int iters, int params) {
 }
 BENCHMARK(BM_RMSProp)->Arg(128 << 10)->Arg(256 << 10);
 
+static void SparseAdagrad(int32 rows, int32 cols, int32 n, Graph** init_g,
+                          Graph** train_g) {
+  const TensorShape shape({rows, cols});
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = test::graph::Var(g, DT_FLOAT, shape);
+    auto accum = test::graph::Var(g, DT_FLOAT, shape);
+    Tensor zero(DT_FLOAT, shape);
+    zero.flat<float>().setZero();
+    test::graph::Assign(g, var, test::graph::Constant(g, zero));
+    test::graph::Assign(g, accum, test::graph::Constant(g, zero));
+    *init_g = g;
+  }
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = test::graph::Var(g, DT_FLOAT, shape);
+    auto accum = test::graph::Var(g, DT_FLOAT, shape);
+    auto lr = Scalar(g, 0.01);
+    Tensor grad(DT_FLOAT, TensorShape({n, cols}));
+    grad.flat<float>().setRandom();
+    // Some rows are updated more than once.
+    Tensor indices(DT_INT32, TensorShape({n}));
+    for (int32 i = 0; i < n; ++i) {
+      indices.vec<int32>()(i) = (i * 7919) % rows;
+    }
+    test::graph::Multi(g, "SparseApplyAdagrad",
+                       {var, accum, lr, test::graph::Constant(g, grad),
+                        test::graph::Constant(g, indices)});
+    *train_g = g;
+  }
+}
+
+// Unlike the benchmarks above, sparse updates use the intra-op threads.
+static void BM_SparseAdagrad(int iters, int n) {
+  const int32 kRows = 64 << 10;
+  const int32 kCols = 64;
+  const int64 tot = static_cast<int64>(iters) * n * kCols;
+  testing::ItemsProcessed(tot);
+  testing::BytesProcessed(tot * sizeof(float));
+  Graph* init;
+  Graph* train;
+  SparseAdagrad(kRows, kCols, n, &init, &train);
+  test::Benchmark("cpu", train, nullptr, init).Run(iters);
+}
+BENCHMARK(BM_SparseAdagrad)->Arg(16 << 10)->Arg(128 << 10);
+
 }  // end namespace tensorflow
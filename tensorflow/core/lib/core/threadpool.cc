@@ -18,6 +18,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/denormal.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -48,6 +49,11 @@ struct EigenEnvironment {
 
   EnvThread* CreateThread(std::function<void()> f) {
     return env_->StartThread(thread_options_, name_, [=]() {
+      if (thread_options_.numa_node != port::kNUMANoAffinity &&
+          !port::NUMASetThreadNodeAffinity(thread_options_.numa_node)) {
+        LOG(WARNING) << "Could not bind thread of " << name_
+                     << " to NUMA node " << thread_options_.numa_node;
+      }
       // Set the processor flag to flush denormals to zero
       port::ScopedFlushDenormal flush;
       f();
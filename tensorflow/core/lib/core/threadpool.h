@@ -34,7 +34,8 @@ class ThreadPool {
   ThreadPool(Env* env, const string& name, int num_threads);
 
   // Construct a pool that contains "num_threads" threads with specified "name".
-  // env->StartThread() is used to create individual threads.
+  // env->StartThread() is used to create individual threads, and each
+  // thread binds itself to thread_options.numa_node, if any.
   //
   // REQUIRES: num_threads > 0
   ThreadPool(Env* env, const ThreadOptions& thread_options, const string& name,
@@ -16,7 +16,9 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 
 #include <atomic>
+#include <vector>
 
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/test.h"
@@ -57,6 +59,30 @@ TEST(ThreadPool, DoWork) {
   }
 }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+TEST(ThreadPool, NUMAAffinity) {
+  for (int node = 0; node < port::NUMANumNodes(); ++node) {
+    std::vector<int> cpus;
+    port::NUMANodeCPUs(node, &cpus);
+    if (cpus.empty()) continue;
+    fprintf(stderr, "Testing NUMA node %d\n", node);
+    const int kWorkItems = 15;
+    std::atomic<int> num_bound(0);
+    {
+      ThreadOptions thread_options;
+      thread_options.numa_node = node;
+      ThreadPool pool(Env::Default(), thread_options, "test", 4);
+      for (int i = 0; i < kWorkItems; i++) {
+        pool.Schedule([&num_bound, node]() {
+          if (port::NUMAGetThreadNodeAffinity() == node) ++num_bound;
+        });
+      }
+    }
+    EXPECT_EQ(kWorkItems, num_bound);
+  }
+}
+#endif
+
 #ifdef EIGEN_USE_NONBLOCKING_THREAD_POOL
 TEST(ThreadPool, ParallelFor) {
   // Make ParallelFor use as many threads as possible.
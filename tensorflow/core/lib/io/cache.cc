@@ -0,0 +1,298 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/cache.h"
+
+#include <unordered_map>
+
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace table {
+
+Cache::~Cache() {}
+
+namespace {
+
+// An entry of the cache, which is also the handle returned for it.
+struct LRUHandle : public Cache::Handle {
+  void* value;
+  Cache::Deleter deleter;
+  size_t charge;
+  // References held by clients, plus one held by the cache while
+  // in_cache is true.
+  uint32 refs;
+  // Whether the entry is in the cache's table.
+  bool in_cache;
+  LRUHandle* next;
+  LRUHandle* prev;
+  string key;
+};
+
+// A single shard of a sharded cache.
+//
+// The cache keeps two linked lists of the entries in its table.  Each
+// entry is in exactly one of them:
+// - lru_: entries not referenced by clients, in LRU order.
+// - in_use_: entries referenced by clients, in no particular order.
+// Only the entries of lru_ may be evicted.
+class LRUCacheShard {
+ public:
+  LRUCacheShard() : capacity_(0), usage_(0) {
+    lru_.next = lru_.prev = &lru_;
+    in_use_.next = in_use_.prev = &in_use_;
+  }
+
+  ~LRUCacheShard() {
+    CHECK(in_use_.next == &in_use_) << "cache destroyed with unreleased "
+                                       "handles";
+    for (LRUHandle* e = lru_.next; e != &lru_;) {
+      LRUHandle* next = e->next;
+      CHECK_EQ(e->refs, 1);
+      e->in_cache = false;
+      Unref(e);
+      e = next;
+    }
+  }
+
+  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+
+  Cache::Handle* Insert(const StringPiece& key, void* value, size_t charge,
+                        Cache::Deleter deleter) {
+    LRUHandle* e = new LRUHandle;
+    e->value = value;
+    e->deleter = deleter;
+    e->charge = charge;
+    e->refs = 1;  // For the returned handle.
+    e->in_cache = false;
+    e->next = e->prev = nullptr;
+    e->key.assign(key.data(), key.size());
+
+    mutex_lock l(mu_);
+    if (capacity_ > 0) {
+      e->refs++;  // For the cache's reference.
+      e->in_cache = true;
+      Append(&in_use_, e);
+      usage_ += charge;
+      auto it = table_.find(key);
+      if (it != table_.end()) {
+        LRUHandle* old = it->second;
+        table_.erase(it);
+        FinishErase(old);
+      }
+      table_[StringPiece(e->key)] = e;
+    }
+    // Otherwise caching is turned off, and the returned handle is the
+    // only reference to the entry.
+    EvictLocked();
+    return e;
+  }
+
+  Cache::Handle* Lookup(const StringPiece& key) {
+    mutex_lock l(mu_);
+    auto it = table_.find(key);
+    if (it == table_.end()) {
+      ++num_misses_;
+      return nullptr;
+    }
+    ++num_hits_;
+    Ref(it->second);
+    return it->second;
+  }
+
+  void Release(Cache::Handle* handle) {
+    mutex_lock l(mu_);
+    Unref(static_cast<LRUHandle*>(handle));
+    // Entries larger than the capacity are evicted once released.
+    EvictLocked();
+  }
+
+  void Erase(const StringPiece& key) {
+    mutex_lock l(mu_);
+    auto it = table_.find(key);
+    if (it != table_.end()) {
+      LRUHandle* e = it->second;
+      table_.erase(it);
+      FinishErase(e);
+    }
+  }
+
+  size_t TotalCharge() const {
+    mutex_lock l(mu_);
+    return usage_;
+  }
+
+  int64 NumHits() const {
+    mutex_lock l(mu_);
+    return num_hits_;
+  }
+
+  int64 NumMisses() const {
+    mutex_lock l(mu_);
+    return num_misses_;
+  }
+
+ private:
+  static void Remove(LRUHandle* e) {
+    e->next->prev = e->prev;
+    e->prev->next = e->next;
+  }
+
+  // Makes "e" the newest entry of "*list".
+  static void Append(LRUHandle* list, LRUHandle* e) {
+    e->next = list;
+    e->prev = list->prev;
+    e->prev->next = e;
+    e->next->prev = e;
+  }
+
+  void Ref(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (e->refs == 1 && e->in_cache) {
+      // Moves from lru_ to in_use_.
+      Remove(e);
+      Append(&in_use_, e);
+    }
+    e->refs++;
+  }
+
+  void Unref(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    DCHECK_GT(e->refs, 0);
+    e->refs--;
+    if (e->refs == 0) {
+      (*e->deleter)(e->key, e->value);
+      delete e;
+    } else if (e->in_cache && e->refs == 1) {
+      // No longer in use by clients: moves to lru_.
+      Remove(e);
+      Append(&lru_, e);
+    }
+  }
+
+  // Evicts unused entries, oldest first, while over capacity.
+  void EvictLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    while (usage_ > capacity_ && lru_.next != &lru_) {
+      LRUHandle* old = lru_.next;
+      table_.erase(StringPiece(old->key));
+      FinishErase(old);
+    }
+  }
+
+  // Finishes removing "*e", which has just been removed from table_.
+  void FinishErase(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    DCHECK(e->in_cache);
+    Remove(e);
+    e->in_cache = false;
+    usage_ -= e->charge;
+    Unref(e);
+  }
+
+  // Set before the shard is used.
+  size_t capacity_;
+
+  mutable mutex mu_;
+  size_t usage_ GUARDED_BY(mu_);
+  // Dummy heads of the lists of entries.  lru_.prev is the newest entry
+  // and lru_.next the oldest.
+  LRUHandle lru_ GUARDED_BY(mu_);
+  LRUHandle in_use_ GUARDED_BY(mu_);
+  // The keys point into the entries' own keys.
+  std::unordered_map<StringPiece, LRUHandle*, StringPiece::Hasher> table_
+      GUARDED_BY(mu_);
+  int64 num_hits_ GUARDED_BY(mu_) = 0;
+  int64 num_misses_ GUARDED_BY(mu_) = 0;
+};
+
+const int kNumShardBits = 4;
+const int kNumShards = 1 << kNumShardBits;
+
+class ShardedLRUCache : public Cache {
+ public:
+  explicit ShardedLRUCache(size_t capacity) {
+    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
+    for (int s = 0; s < kNumShards; s++) {
+      shards_[s].SetCapacity(per_shard);
+    }
+  }
+
+  Handle* Insert(const StringPiece& key, void* value, size_t charge,
+                 Deleter deleter) override {
+    return Shard(key)->Insert(key, value, charge, deleter);
+  }
+
+  Handle* Lookup(const StringPiece& key) override {
+    return Shard(key)->Lookup(key);
+  }
+
+  void Release(Handle* handle) override {
+    LRUHandle* h = static_cast<LRUHandle*>(handle);
+    Shard(h->key)->Release(handle);
+  }
+
+  void* Value(Handle* handle) override {
+    return static_cast<LRUHandle*>(handle)->value;
+  }
+
+  void Erase(const StringPiece& key) override { Shard(key)->Erase(key); }
+
+  uint64 NewId() override {
+    mutex_lock l(id_mu_);
+    return ++last_id_;
+  }
+
+  size_t TotalCharge() const override {
+    size_t total = 0;
+    for (int s = 0; s < kNumShards; s++) {
+      total += shards_[s].TotalCharge();
+    }
+    return total;
+  }
+
+  int64 NumHits() const override {
+    int64 total = 0;
+    for (int s = 0; s < kNumShards; s++) {
+      total += shards_[s].NumHits();
+    }
+    return total;
+  }
+
+  int64 NumMisses() const override {
+    int64 total = 0;
+    for (int s = 0; s < kNumShards; s++) {
+      total += shards_[s].NumMisses();
+    }
+    return total;
+  }
+
+ private:
+  LRUCacheShard* Shard(const StringPiece& key) {
+    const uint32 hash = Hash32(key.data(), key.size(), 0);
+    return &shards_[hash >> (32 - kNumShardBits)];
+  }
+
+  LRUCacheShard shards_[kNumShards];
+
+  mutex id_mu_;
+  uint64 last_id_ GUARDED_BY(id_mu_) = 0;
+};
+
+}  // namespace
+
+Cache* NewLRUCache(size_t capacity) { return new ShardedLRUCache(capacity); }
+
+}  // namespace table
+}  // namespace tensorflow
@@ -0,0 +1,110 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_CACHE_H_
+#define TENSORFLOW_LIB_IO_CACHE_H_
+
+#include <stddef.h>
+
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace table {
+
+// A Cache maps keys to values.  It has internal synchronization and
+// may be safely accessed concurrently from multiple threads.  It may
+// automatically evict entries to make room for new entries.  Values
+// have a specified charge against the cache capacity.  For example, a
+// cache where the values are variable length strings may use the
+// length of the string as the charge for the string.
+//
+// Table uses a Cache (see Options::block_cache) to keep recently read
+// blocks in memory.  A single cache may be shared by many tables.
+class Cache {
+ public:
+  Cache() {}
+
+  // Destroys all existing entries by calling the "deleter" function
+  // that was passed to Insert().
+  virtual ~Cache();
+
+  // Opaque handle to an entry stored in the cache.
+  struct Handle {};
+
+  typedef void (*Deleter)(const StringPiece& key, void* value);
+
+  // Inserts a mapping from key->value into the cache and assigns it
+  // the specified charge against the total cache capacity.
+  //
+  // Returns a handle that corresponds to the mapping.  The caller
+  // must call Release(handle) when the returned mapping is no longer
+  // needed.
+  //
+  // When the inserted entry is no longer needed, the key and value
+  // will be passed to "deleter".
+  virtual Handle* Insert(const StringPiece& key, void* value, size_t charge,
+                         Deleter deleter) = 0;
+
+  // If the cache has no mapping for "key", returns nullptr.  Otherwise
+  // returns a handle that corresponds to the mapping.  The caller must
+  // call Release(handle) when the returned mapping is no longer needed.
+  virtual Handle* Lookup(const StringPiece& key) = 0;
+
+  // Releases a mapping returned by a previous Lookup() or Insert().
+  // REQUIRES: handle must not have been released yet.
+  virtual void Release(Handle* handle) = 0;
+
+  // Returns the value encapsulated in a handle returned by a
+  // successful Lookup() or Insert().
+  // REQUIRES: handle must not have been released yet.
+  virtual void* Value(Handle* handle) = 0;
+
+  // If the cache contains an entry for key, erases it.  The underlying
+  // entry is kept around until all existing handles to it have been
+  // released.
+  virtual void Erase(const StringPiece& key) = 0;
+
+  // Returns a new numeric id.  May be used by multiple clients who are
+  // sharing the same cache to partition the key space.  Typically the
+  // client will allocate a new id at startup and prepend the id to its
+  // cache keys.
+  virtual uint64 NewId() = 0;
+
+  // Returns an estimate of the combined charges of all elements stored
+  // in the cache.
+  virtual size_t TotalCharge() const = 0;
+
+  // Returns the number of calls to Lookup() that found, or did not
+  // find, their key.
+  virtual int64 NumHits() const = 0;
+  virtual int64 NumMisses() const = 0;
+
+ private:
+  TF_DISALLOW_COPY_AND_ASSIGN(Cache);
+};
+
+// Creates a new cache with a fixed size capacity, which evicts the
+// least recently used entries that are not in use once the total
+// charge of its entries exceeds the capacity.  The cache is split into
+// shards with their own locks, so that concurrent lookups of different
+// keys rarely contend.
+Cache* NewLRUCache(size_t capacity);
+
+}  // namespace table
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_CACHE_H_
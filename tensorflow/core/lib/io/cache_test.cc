@@ -0,0 +1,249 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/cache.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace table {
+namespace {
+
+// Conversions between numeric keys/values and the types expected by Cache.
+string EncodeKey(int k) {
+  string result;
+  core::PutFixed32(&result, k);
+  return result;
+}
+int DecodeKey(const StringPiece& k) {
+  CHECK_EQ(k.size(), 4);
+  return core::DecodeFixed32(k.data());
+}
+void* EncodeValue(uintptr_t v) { return reinterpret_cast<void*>(v); }
+int DecodeValue(void* v) { return reinterpret_cast<uintptr_t>(v); }
+
+const int kCacheSize = 1000;
+
+class CacheTest : public ::testing::Test {
+ protected:
+  CacheTest() : cache_(NewLRUCache(kCacheSize)) { current_ = this; }
+
+  ~CacheTest() override {
+    cache_.reset();  // Calls Deleter() for the remaining entries.
+    current_ = nullptr;
+  }
+
+  static void Deleter(const StringPiece& key, void* v) {
+    current_->deleted_keys_.push_back(DecodeKey(key));
+    current_->deleted_values_.push_back(DecodeValue(v));
+  }
+
+  int Lookup(int key) {
+    Cache::Handle* handle = cache_->Lookup(EncodeKey(key));
+    const int r = (handle == nullptr) ? -1 : DecodeValue(cache_->Value(handle));
+    if (handle != nullptr) {
+      cache_->Release(handle);
+    }
+    return r;
+  }
+
+  void Insert(int key, int value, int charge = 1) {
+    cache_->Release(cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
+                                   &CacheTest::Deleter));
+  }
+
+  Cache::Handle* InsertAndReturnHandle(int key, int value, int charge = 1) {
+    return cache_->Insert(EncodeKey(key), EncodeValue(value), charge,
+                          &CacheTest::Deleter);
+  }
+
+  void Erase(int key) { cache_->Erase(EncodeKey(key)); }
+
+  static CacheTest* current_;
+
+  std::vector<int> deleted_keys_;
+  std::vector<int> deleted_values_;
+  std::unique_ptr<Cache> cache_;
+};
+CacheTest* CacheTest::current_;
+
+TEST_F(CacheTest, HitAndMiss) {
+  EXPECT_EQ(-1, Lookup(100));
+
+  Insert(100, 101);
+  EXPECT_EQ(101, Lookup(100));
+  EXPECT_EQ(-1, Lookup(200));
+  EXPECT_EQ(-1, Lookup(300));
+
+  Insert(200, 201);
+  EXPECT_EQ(101, Lookup(100));
+  EXPECT_EQ(201, Lookup(200));
+  EXPECT_EQ(-1, Lookup(300));
+
+  Insert(100, 102);
+  EXPECT_EQ(102, Lookup(100));
+  EXPECT_EQ(201, Lookup(200));
+  EXPECT_EQ(-1, Lookup(300));
+
+  ASSERT_EQ(1, deleted_keys_.size());
+  EXPECT_EQ(100, deleted_keys_[0]);
+  EXPECT_EQ(101, deleted_values_[0]);
+
+  EXPECT_EQ(5, cache_->NumHits());
+  EXPECT_EQ(5, cache_->NumMisses());
+}
+
+TEST_F(CacheTest, Erase) {
+  Erase(200);
+  EXPECT_EQ(0, deleted_keys_.size());
+
+  Insert(100, 101);
+  Insert(200, 201);
+  Erase(100);
+  EXPECT_EQ(-1, Lookup(100));
+  EXPECT_EQ(201, Lookup(200));
+  ASSERT_EQ(1, deleted_keys_.size());
+  EXPECT_EQ(100, deleted_keys_[0]);
+  EXPECT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  EXPECT_EQ(-1, Lookup(100));
+  EXPECT_EQ(201, Lookup(200));
+  EXPECT_EQ(1, deleted_keys_.size());
+}
+
+TEST_F(CacheTest, EntriesArePinned) {
+  Insert(100, 101);
+  Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
+  EXPECT_EQ(101, DecodeValue(cache_->Value(h1)));
+
+  Insert(100, 102);
+  Cache::Handle* h2 = cache_->Lookup(EncodeKey(100));
+  EXPECT_EQ(102, DecodeValue(cache_->Value(h2)));
+  EXPECT_EQ(0, deleted_keys_.size());
+
+  cache_->Release(h1);
+  ASSERT_EQ(1, deleted_keys_.size());
+  EXPECT_EQ(100, deleted_keys_[0]);
+  EXPECT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  EXPECT_EQ(-1, Lookup(100));
+  EXPECT_EQ(1, deleted_keys_.size());
+
+  cache_->Release(h2);
+  ASSERT_EQ(2, deleted_keys_.size());
+  EXPECT_EQ(100, deleted_keys_[1]);
+  EXPECT_EQ(102, deleted_values_[1]);
+}
+
+TEST_F(CacheTest, EvictionPolicy) {
+  Insert(100, 101);
+  Insert(200, 201);
+  Insert(300, 301);
+  Cache::Handle* h = cache_->Lookup(EncodeKey(300));
+
+  // Frequently used entries must be kept around, as must things that
+  // are still in use.
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i);
+    EXPECT_EQ(2000 + i, Lookup(1000 + i));
+    EXPECT_EQ(101, Lookup(100));
+  }
+  EXPECT_EQ(101, Lookup(100));
+  EXPECT_EQ(-1, Lookup(200));
+  EXPECT_EQ(301, Lookup(300));
+  cache_->Release(h);
+}
+
+TEST_F(CacheTest, UseExceedsCacheSize) {
+  // Overfills the cache, keeping handles on all inserted entries.
+  std::vector<Cache::Handle*> h;
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    h.push_back(InsertAndReturnHandle(1000 + i, 2000 + i));
+  }
+
+  // Checks that all the entries can be found in the cache.
+  for (size_t i = 0; i < h.size(); i++) {
+    EXPECT_EQ(2000 + i, Lookup(1000 + i));
+  }
+
+  // Once released, the cache shrinks back to its capacity, up to the
+  // rounding of the capacity of its shards.
+  for (size_t i = 0; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+  EXPECT_LE(cache_->TotalCharge(), kCacheSize + kCacheSize / 10);
+}
+
+TEST_F(CacheTest, HeavyEntries) {
+  // Adds a bunch of light and heavy entries and then counts the
+  // combined size of items still in the cache, which must be
+  // approximately the same as the total capacity.
+  const int kLight = 1;
+  const int kHeavy = 10;
+  int added = 0;
+  int index = 0;
+  while (added < 2 * kCacheSize) {
+    const int weight = (index & 1) ? kLight : kHeavy;
+    Insert(index, 1000 + index, weight);
+    added += weight;
+    index++;
+  }
+
+  int cached_weight = 0;
+  for (int i = 0; i < index; i++) {
+    const int weight = (i & 1 ? kLight : kHeavy);
+    int r = Lookup(i);
+    if (r >= 0) {
+      cached_weight += weight;
+      EXPECT_EQ(1000 + i, r);
+    }
+  }
+  EXPECT_LE(cached_weight, kCacheSize + kCacheSize / 10);
+  EXPECT_EQ(cached_weight, cache_->TotalCharge());
+}
+
+TEST_F(CacheTest, EntryLargerThanShardIsEvictedOnRelease) {
+  Cache::Handle* h = InsertAndReturnHandle(100, 101, 10 * kCacheSize);
+  EXPECT_EQ(101, Lookup(100));
+  cache_->Release(h);
+  EXPECT_EQ(-1, Lookup(100));
+  EXPECT_EQ(0, cache_->TotalCharge());
+  ASSERT_EQ(1, deleted_keys_.size());
+}
+
+TEST_F(CacheTest, NewId) {
+  uint64 a = cache_->NewId();
+  uint64 b = cache_->NewId();
+  EXPECT_NE(a, b);
+}
+
+TEST_F(CacheTest, ZeroSizeCache) {
+  cache_.reset(NewLRUCache(0));
+
+  Insert(1, 100);
+  EXPECT_EQ(-1, Lookup(1));
+  EXPECT_EQ(1, deleted_keys_.size());
+}
+
+}  // namespace
+}  // namespace table
+}  // namespace tensorflow
@@ -0,0 +1,127 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/filter_block.h"
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace table {
+
+// A filter block consists of:
+//    filter[0..num-1]: one filter per kFilterBase bytes of data blocks
+//    offset of filter[i]: fixed32, for each i in [0..num-1]
+//    offset of the above array: fixed32
+//    kFilterBaseLg: uint8
+//
+// The filter for the data block starting at offset "o" is filter[o >>
+// kFilterBaseLg].
+
+// Generate new filter every 2KB of data
+static const size_t kFilterBaseLg = 11;
+static const size_t kFilterBase = 1 << kFilterBaseLg;
+
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
+    : policy_(policy) {}
+
+void FilterBlockBuilder::StartBlock(uint64 block_offset) {
+  const uint64 filter_index = (block_offset / kFilterBase);
+  CHECK_GE(filter_index, filter_offsets_.size());
+  while (filter_index > filter_offsets_.size()) {
+    GenerateFilter();
+  }
+}
+
+void FilterBlockBuilder::AddKey(const StringPiece& key) {
+  start_.push_back(keys_.size());
+  keys_.append(key.data(), key.size());
+}
+
+StringPiece FilterBlockBuilder::Finish() {
+  if (!start_.empty()) {
+    GenerateFilter();
+  }
+
+  // Append array of per-filter offsets
+  const uint32 array_offset = result_.size();
+  for (size_t i = 0; i < filter_offsets_.size(); i++) {
+    core::PutFixed32(&result_, filter_offsets_[i]);
+  }
+
+  core::PutFixed32(&result_, array_offset);
+  result_.push_back(kFilterBaseLg);  // Save encoding parameter in result
+  return StringPiece(result_);
+}
+
+void FilterBlockBuilder::GenerateFilter() {
+  const size_t num_keys = start_.size();
+  if (num_keys == 0) {
+    // Fast path if there are no keys for this filter
+    filter_offsets_.push_back(result_.size());
+    return;
+  }
+
+  // Make list of keys from flattened key structure
+  start_.push_back(keys_.size());  // Simplify length computation
+  tmp_keys_.resize(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    const char* base = keys_.data() + start_[i];
+    size_t length = start_[i + 1] - start_[i];
+    tmp_keys_[i] = StringPiece(base, length);
+  }
+
+  // Generate filter for current set of keys and append to result_.
+  filter_offsets_.push_back(result_.size());
+  policy_->CreateFilter(&tmp_keys_[0], static_cast<int>(num_keys), &result_);
+
+  tmp_keys_.clear();
+  keys_.clear();
+  start_.clear();
+}
+
+FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,
+                                     const StringPiece& contents)
+    : policy_(policy), data_(nullptr), offset_(nullptr), num_(0), base_lg_(0) {
+  const size_t n = contents.size();
+  if (n < 5) return;  // 1 byte for base_lg_ and 4 for start of offset array
+  base_lg_ = static_cast<uint8>(contents[n - 1]);
+  const uint32 last_word = core::DecodeFixed32(contents.data() + n - 5);
+  if (last_word > n - 5) return;
+  data_ = contents.data();
+  offset_ = data_ + last_word;
+  num_ = (n - 5 - last_word) / 4;
+}
+
+bool FilterBlockReader::KeyMayMatch(uint64 block_offset,
+                                    const StringPiece& key) const {
+  const uint64 index = block_offset >> base_lg_;
+  if (index < num_) {
+    const uint32 start = core::DecodeFixed32(offset_ + index * 4);
+    const uint32 limit = core::DecodeFixed32(offset_ + index * 4 + 4);
+    if (start <= limit && limit <= static_cast<size_t>(offset_ - data_)) {
+      StringPiece filter = StringPiece(data_ + start, limit - start);
+      return policy_->KeyMayMatch(key, filter);
+    } else if (start == limit) {
+      // Empty filters do not match any keys
+      return false;
+    }
+  }
+  return true;  // Errors are treated as potential matches
+}
+
+}  // namespace table
+}  // namespace tensorflow
@@ -0,0 +1,86 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A filter block is stored near the end of a Table file.  It contains
+// filters (e.g., bloom filters) for all data blocks in the table
+// combined into a single filter block.
+
+#ifndef TENSORFLOW_LIB_IO_FILTER_BLOCK_H_
+#define TENSORFLOW_LIB_IO_FILTER_BLOCK_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace table {
+
+class FilterPolicy;
+
+// A FilterBlockBuilder is used to construct all of the filters for a
+// particular Table.  It generates a single string which is stored as
+// a special block in the Table.
+//
+// The sequence of calls to FilterBlockBuilder must match the regexp:
+//      (StartBlock AddKey*)* Finish
+class FilterBlockBuilder {
+ public:
+  explicit FilterBlockBuilder(const FilterPolicy* policy);
+
+  void StartBlock(uint64 block_offset);
+  void AddKey(const StringPiece& key);
+  StringPiece Finish();
+
+ private:
+  void GenerateFilter();
+
+  const FilterPolicy* policy_;
+  string keys_;                        // Flattened key contents
+  std::vector<size_t> start_;          // Starting index in keys_ of each key
+  string result_;                      // Filter data computed so far
+  std::vector<StringPiece> tmp_keys_;  // policy_->CreateFilter() argument
+  std::vector<uint32> filter_offsets_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FilterBlockBuilder);
+};
+
+class FilterBlockReader {
+ public:
+  // REQUIRES: "contents" and "*policy" must stay live while *this is
+  // live.
+  FilterBlockReader(const FilterPolicy* policy, const StringPiece& contents);
+
+  // Returns false only if "key" is not in the data block starting at
+  // "block_offset".
+  bool KeyMayMatch(uint64 block_offset, const StringPiece& key) const;
+
+ private:
+  const FilterPolicy* policy_;
+  const char* data_;    // Pointer to filter data (at block-start)
+  const char* offset_;  // Pointer to beginning of offset array (at block-end)
+  size_t num_;          // Number of entries in offset array
+  size_t base_lg_;      // Encoding parameter (see kFilterBaseLg in .cc file)
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FilterBlockReader);
+};
+
+}  // namespace table
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_FILTER_BLOCK_H_
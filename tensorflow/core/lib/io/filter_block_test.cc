@@ -0,0 +1,204 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/filter_block.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace table {
+namespace {
+
+// For testing: emit an array with one hash value per key
+class TestHashFilter : public FilterPolicy {
+ public:
+  const char* Name() const override { return "TestHashFilter"; }
+
+  void CreateFilter(const StringPiece* keys, int n,
+                    string* dst) const override {
+    for (int i = 0; i < n; i++) {
+      core::PutFixed32(dst, Hash32(keys[i].data(), keys[i].size(), 1));
+    }
+  }
+
+  bool KeyMayMatch(const StringPiece& key,
+                   const StringPiece& filter) const override {
+    const uint32 h = Hash32(key.data(), key.size(), 1);
+    for (size_t i = 0; i + 4 <= filter.size(); i += 4) {
+      if (h == core::DecodeFixed32(filter.data() + i)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+TEST(FilterBlockTest, EmptyBuilder) {
+  TestHashFilter policy;
+  FilterBlockBuilder builder(&policy);
+  StringPiece block = builder.Finish();
+  EXPECT_EQ(StringPiece("\x00\x00\x00\x00\x0b", 5), block);
+  FilterBlockReader reader(&policy, block);
+  EXPECT_TRUE(reader.KeyMayMatch(0, "foo"));
+  EXPECT_TRUE(reader.KeyMayMatch(100000, "foo"));
+}
+
+TEST(FilterBlockTest, SingleChunk) {
+  TestHashFilter policy;
+  FilterBlockBuilder builder(&policy);
+  builder.StartBlock(100);
+  builder.AddKey("foo");
+  builder.AddKey("bar");
+  builder.AddKey("box");
+  builder.StartBlock(200);
+  builder.AddKey("box");
+  builder.StartBlock(300);
+  builder.AddKey("hello");
+  StringPiece block = builder.Finish();
+  FilterBlockReader reader(&policy, block);
+  EXPECT_TRUE(reader.KeyMayMatch(100, "foo"));
+  EXPECT_TRUE(reader.KeyMayMatch(100, "bar"));
+  EXPECT_TRUE(reader.KeyMayMatch(100, "box"));
+  EXPECT_TRUE(reader.KeyMayMatch(100, "hello"));
+  EXPECT_TRUE(reader.KeyMayMatch(100, "foo"));
+  EXPECT_FALSE(reader.KeyMayMatch(100, "missing"));
+  EXPECT_FALSE(reader.KeyMayMatch(100, "other"));
+}
+
+TEST(FilterBlockTest, MultiChunk) {
+  TestHashFilter policy;
+  FilterBlockBuilder builder(&policy);
+
+  // First filter
+  builder.StartBlock(0);
+  builder.AddKey("foo");
+  builder.StartBlock(2000);
+  builder.AddKey("bar");
+
+  // Second filter
+  builder.StartBlock(3100);
+  builder.AddKey("box");
+
+  // Third filter is empty
+
+  // Last filter
+  builder.StartBlock(9000);
+  builder.AddKey("box");
+  builder.AddKey("hello");
+
+  StringPiece block = builder.Finish();
+  FilterBlockReader reader(&policy, block);
+
+  // Check first filter
+  EXPECT_TRUE(reader.KeyMayMatch(0, "foo"));
+  EXPECT_TRUE(reader.KeyMayMatch(2000, "bar"));
+  EXPECT_FALSE(reader.KeyMayMatch(0, "box"));
+  EXPECT_FALSE(reader.KeyMayMatch(0, "hello"));
+
+  // Check second filter
+  EXPECT_TRUE(reader.KeyMayMatch(3100, "box"));
+  EXPECT_FALSE(reader.KeyMayMatch(3100, "foo"));
+  EXPECT_FALSE(reader.KeyMayMatch(3100, "bar"));
+  EXPECT_FALSE(reader.KeyMayMatch(3100, "hello"));
+
+  // Check third filter (empty)
+  EXPECT_FALSE(reader.KeyMayMatch(4100, "foo"));
+  EXPECT_FALSE(reader.KeyMayMatch(4100, "bar"));
+  EXPECT_FALSE(reader.KeyMayMatch(4100, "box"));
+  EXPECT_FALSE(reader.KeyMayMatch(4100, "hello"));
+
+  // Check last filter
+  EXPECT_TRUE(reader.KeyMayMatch(9000, "box"));
+  EXPECT_TRUE(reader.KeyMayMatch(9000, "hello"));
+  EXPECT_FALSE(reader.KeyMayMatch(9000, "foo"));
+  EXPECT_FALSE(reader.KeyMayMatch(9000, "bar"));
+}
+
+string Key(int i) {
+  string key;
+  core::PutFixed32(&key, i);
+  return key;
+}
+
+// Tests the bloom filter policy on filters of keys Key(0..n-1).
+class BloomTest : public ::testing::Test {
+ protected:
+  BloomTest() : policy_(NewBloomFilterPolicy(10)) {}
+
+  void Build(int n) {
+    std::vector<string> keys;
+    for (int i = 0; i < n; i++) keys.push_back(Key(i));
+    std::vector<StringPiece> pieces(keys.begin(), keys.end());
+    filter_.clear();
+    policy_->CreateFilter(pieces.data(), n, &filter_);
+  }
+
+  bool Matches(const string& key) {
+    return policy_->KeyMayMatch(key, filter_);
+  }
+
+  double FalsePositiveRate() {
+    int result = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (Matches(Key(i + 1000000000))) result++;
+    }
+    return result / 10000.0;
+  }
+
+  std::unique_ptr<const FilterPolicy> policy_;
+  string filter_;
+};
+
+TEST_F(BloomTest, EmptyFilter) {
+  Build(0);
+  EXPECT_FALSE(Matches("hello"));
+  EXPECT_FALSE(Matches("world"));
+}
+
+TEST_F(BloomTest, VaryingLengths) {
+  // Counts the number of filters that significantly exceed the false
+  // positive rate.
+  int mediocre_filters = 0;
+  int good_filters = 0;
+  for (int length = 1; length <= 10000; length = length * 5 / 4 + 1) {
+    Build(length);
+    EXPECT_LE(filter_.size(), (length * 10 / 8) + 40) << length;
+
+    // All added keys must match.
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i))) << "Length " << length << "; key " << i;
+    }
+
+    const double rate = FalsePositiveRate();
+    // Must not be over 2%, except by chance for filters of a few keys.
+    EXPECT_LE(rate, length < 10 ? 0.03 : 0.02) << length;
+    if (rate > 0.0125) {
+      mediocre_filters++;  // Allowed, but not too often
+    } else {
+      good_filters++;
+    }
+  }
+  EXPECT_LE(mediocre_filters, good_filters / 5);
+}
+
+}  // namespace
+}  // namespace table
+}  // namespace tensorflow
@@ -0,0 +1,114 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/filter_policy.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/hash/hash.h"
+
+namespace tensorflow {
+namespace table {
+
+FilterPolicy::~FilterPolicy() {}
+
+namespace {
+
+// The hash of the keys is part of the persistent format of the filters.
+// Its two halves are the two hashes combined into the probes.
+uint64 BloomHash(const StringPiece& key) {
+  return Hash64(key.data(), key.size(), 0xbc9f1d34);
+}
+
+class BloomFilterPolicy : public FilterPolicy {
+ public:
+  explicit BloomFilterPolicy(int bits_per_key) : bits_per_key_(bits_per_key) {
+    // We intentionally round down to reduce probing cost a little bit.
+    k_ = static_cast<size_t>(bits_per_key * 0.69);  // 0.69 =~ ln(2)
+    k_ = std::max<size_t>(1, std::min<size_t>(30, k_));
+  }
+
+  const char* Name() const override {
+    return "tensorflow.BuiltinBloomFilter";
+  }
+
+  void CreateFilter(const StringPiece* keys, int n,
+                    string* dst) const override {
+    // Computes the bloom filter size (in both bits and bytes).  For
+    // small n, uses a minimum bloom filter length to avoid a very high
+    // false positive rate.
+    size_t bits = std::max<size_t>(64, n * bits_per_key_);
+    const size_t bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + bytes, 0);
+    dst->push_back(static_cast<char>(k_));  // Remember # of probes.
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      // Uses double-hashing to generate a sequence of hash values.
+      // See analysis in [Kirsch,Mitzenmacher 2006].
+      const uint64 hash = BloomHash(keys[i]);
+      uint32 h = static_cast<uint32>(hash);
+      const uint32 delta = static_cast<uint32>(hash >> 32);
+      for (size_t j = 0; j < k_; j++) {
+        const uint32 bitpos = h % bits;
+        array[bitpos / 8] |= (1 << (bitpos % 8));
+        h += delta;
+      }
+    }
+  }
+
+  bool KeyMayMatch(const StringPiece& key,
+                   const StringPiece& bloom_filter) const override {
+    const size_t len = bloom_filter.size();
+    if (len < 2) return false;
+
+    const char* array = bloom_filter.data();
+    const size_t bits = (len - 1) * 8;
+
+    // Uses the encoded k so that we can read filters generated by bloom
+    // filters created using different parameters.
+    const size_t k = static_cast<uint8>(array[len - 1]);
+    if (k > 30) {
+      // Reserved for potentially new encodings for short bloom filters.
+      // Consider it a match.
+      return true;
+    }
+
+    const uint64 hash = BloomHash(key);
+    uint32 h = static_cast<uint32>(hash);
+    const uint32 delta = static_cast<uint32>(hash >> 32);
+    for (size_t j = 0; j < k; j++) {
+      const uint32 bitpos = h % bits;
+      if ((array[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+      h += delta;
+    }
+    return true;
+  }
+
+ private:
+  size_t bits_per_key_;
+  size_t k_;
+};
+
+}  // namespace
+
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key) {
+  return new BloomFilterPolicy(bits_per_key);
+}
+
+}  // namespace table
+}  // namespace tensorflow
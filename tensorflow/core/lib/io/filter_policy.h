@@ -0,0 +1,67 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A FilterPolicy summarizes a set of keys in a small filter, which a
+// Table (see Options::filter_policy) consults to avoid reading the
+// data blocks of keys that are not present.
+
+#ifndef TENSORFLOW_LIB_IO_FILTER_POLICY_H_
+#define TENSORFLOW_LIB_IO_FILTER_POLICY_H_
+
+#include <string>
+
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace table {
+
+class FilterPolicy {
+ public:
+  virtual ~FilterPolicy();
+
+  // Returns the name of this policy.  Note that if the filter encoding
+  // changes in an incompatible way, the name returned by this method
+  // must be changed.  Otherwise, old incompatible filters may be
+  // passed to methods of this type.
+  virtual const char* Name() const = 0;
+
+  // keys[0,n-1] contains a list of keys (potentially with duplicates).
+  // Appends a filter that summarizes keys[0,n-1] to *dst.
+  virtual void CreateFilter(const StringPiece* keys, int n,
+                            string* dst) const = 0;
+
+  // "filter" contains the data appended by a preceding call to
+  // CreateFilter() on this class.  This method must return true if
+  // the key was in the list of keys passed to CreateFilter().
+  // This method may return true or false if the key was not on the
+  // list, but it should aim to return false with a high probability.
+  virtual bool KeyMayMatch(const StringPiece& key,
+                           const StringPiece& filter) const = 0;
+};
+
+// Returns a new filter policy that uses a bloom filter with
+// approximately the specified number of bits per key.  A good value
+// for bits_per_key is 10, which yields a filter with ~1% false
+// positive rate.
+//
+// Callers must delete the result after any table using it has been
+// closed.
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+
+}  // namespace table
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_FILTER_POLICY_H_
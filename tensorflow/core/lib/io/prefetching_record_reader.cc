@@ -0,0 +1,261 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/prefetching_record_reader.h"
+
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace io {
+
+namespace {
+
+const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+const size_t kFooterSize = sizeof(uint32);
+
+// Batches of records smaller than this are verified by the calling
+// thread alone.
+const size_t kMinParallelVerifyBytes = 256 << 10;
+
+}  // namespace
+
+struct PrefetchingRecordReader::Chunk {
+  uint64 offset = 0;
+  size_t size = 0;
+
+  // The bytes read, fewer than "size" only if "end_of_file".
+  string data;
+  bool end_of_file = false;
+  Status status;
+
+  // Set under mu_ once the above are filled in.
+  bool done = false;
+};
+
+PrefetchingRecordReader::PrefetchingRecordReader(
+    RandomAccessFile* file, uint64 offset,
+    const PrefetchingRecordReaderOptions& options, thread::ThreadPool* pool)
+    : file_(file),
+      options_(options),
+      pool_(pool),
+      offset_(offset),
+      next_chunk_offset_(offset) {
+  CHECK_GT(options_.buffer_size, 0);
+  if (pool_ != nullptr) {
+    mutex_lock l(mu_);
+    ScheduleReadsLocked();
+  }
+}
+
+PrefetchingRecordReader::~PrefetchingRecordReader() {
+  mutex_lock l(mu_);
+  while (num_reads_in_flight_ > 0) {
+    chunk_read_.wait(l);
+  }
+}
+
+std::shared_ptr<PrefetchingRecordReader::Chunk>
+PrefetchingRecordReader::NewChunkLocked() {
+  std::shared_ptr<Chunk> chunk(new Chunk);
+  chunk->offset = next_chunk_offset_;
+  chunk->size =
+      options_.buffer_size - next_chunk_offset_ % options_.buffer_size;
+  next_chunk_offset_ += chunk->size;
+  return chunk;
+}
+
+void PrefetchingRecordReader::ScheduleReadsLocked() {
+  const size_t depth = std::max(options_.readahead_depth, 1);
+  while (!end_of_file_queued_ && chunks_.size() < depth) {
+    std::shared_ptr<Chunk> chunk = NewChunkLocked();
+    chunks_.push_back(chunk);
+    ++num_reads_in_flight_;
+    pool_->Schedule([this, chunk]() {
+      ReadChunk(chunk.get());
+      mutex_lock l(mu_);
+      chunk->done = true;
+      if (chunk->end_of_file) end_of_file_queued_ = true;
+      --num_reads_in_flight_;
+      chunk_read_.notify_all();
+    });
+  }
+}
+
+void PrefetchingRecordReader::ReadChunk(Chunk* chunk) const {
+  chunk->data.resize(chunk->size);
+  StringPiece result;
+  Status s = file_->Read(chunk->offset, chunk->size, &result, &chunk->data[0]);
+  if (!s.ok() && !errors::IsOutOfRange(s)) {
+    chunk->status = s;
+    chunk->data.clear();
+    return;
+  }
+  if (result.data() != chunk->data.data()) {
+    // RandomAccessFile placed the data in some other location.
+    memmove(&chunk->data[0], result.data(), result.size());
+  }
+  chunk->data.resize(result.size());
+  chunk->end_of_file = result.size() < chunk->size;
+}
+
+Status PrefetchingRecordReader::NextChunk() {
+  std::shared_ptr<Chunk> chunk;
+  if (pool_ == nullptr) {
+    {
+      mutex_lock l(mu_);
+      chunk = NewChunkLocked();
+    }
+    ReadChunk(chunk.get());
+  } else {
+    mutex_lock l(mu_);
+    chunk = chunks_.front();
+    while (!chunk->done) {
+      chunk_read_.wait(l);
+    }
+    chunks_.pop_front();
+    ScheduleReadsLocked();
+  }
+  current_ = std::move(chunk);
+  pos_ = 0;
+  return current_->status;
+}
+
+Status PrefetchingRecordReader::ReadBytes(size_t n, char* dst,
+                                          size_t* n_read) {
+  *n_read = 0;
+  while (*n_read < n) {
+    if (current_ == nullptr || pos_ == current_->data.size()) {
+      if (current_ != nullptr && current_->end_of_file) break;
+      TF_RETURN_IF_ERROR(NextChunk());
+      continue;
+    }
+    const size_t k = std::min(n - *n_read, current_->data.size() - pos_);
+    memcpy(dst + *n_read, current_->data.data() + pos_, k);
+    pos_ += k;
+    *n_read += k;
+  }
+  return Status::OK();
+}
+
+Status PrefetchingRecordReader::ReadRecord(string* record,
+                                           uint32* masked_crc) {
+  char header[kHeaderSize];
+  size_t n_read;
+  TF_RETURN_IF_ERROR(ReadBytes(kHeaderSize, header, &n_read));
+  if (n_read == 0) {
+    return errors::OutOfRange("eof");
+  }
+  if (n_read < kHeaderSize) {
+    return errors::DataLoss("truncated record at ", offset_);
+  }
+  const uint32 header_crc = core::DecodeFixed32(header + sizeof(uint64));
+  if (crc32c::Unmask(header_crc) != crc32c::Value(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record at ", offset_);
+  }
+  const uint64 length = core::DecodeFixed64(header);
+  if (length >= SIZE_MAX - kFooterSize) {
+    return errors::DataLoss("record size too large");
+  }
+
+  record->resize(length);
+  TF_RETURN_IF_ERROR(ReadBytes(length, &(*record)[0], &n_read));
+  if (n_read < length) {
+    return errors::DataLoss("truncated record at ", offset_);
+  }
+  char footer[kFooterSize];
+  TF_RETURN_IF_ERROR(ReadBytes(kFooterSize, footer, &n_read));
+  if (n_read < kFooterSize) {
+    return errors::DataLoss("truncated record at ", offset_);
+  }
+  *masked_crc = core::DecodeFixed32(footer);
+  return Status::OK();
+}
+
+Status PrefetchingRecordReader::ReadRecords(int64 max_records,
+                                            std::vector<string>* records,
+                                            std::vector<uint64>* offsets) {
+  if (!status_.ok()) return status_;
+
+  const size_t first = records->size();
+  const size_t first_offset = offsets->size();
+  std::vector<uint32> masked_crcs;
+  size_t num_bytes = 0;
+  Status status;
+  while (static_cast<int64>(masked_crcs.size()) < max_records) {
+    string record;
+    uint32 masked_crc;
+    status = ReadRecord(&record, &masked_crc);
+    if (!status.ok()) break;
+    offsets->push_back(offset_);
+    offset_ += kHeaderSize + record.size() + kFooterSize;
+    num_bytes += record.size();
+    records->push_back(std::move(record));
+    masked_crcs.push_back(masked_crc);
+  }
+
+  // Verifies the data of the records read, in parallel if there is
+  // enough of it.
+  const int64 num_records = masked_crcs.size();
+  std::vector<char> valid(num_records);
+  auto verify = [records, first, &masked_crcs, &valid](int64 begin,
+                                                       int64 end) {
+    for (int64 i = begin; i < end; ++i) {
+      const string& record = (*records)[first + i];
+      valid[i] = crc32c::Unmask(masked_crcs[i]) ==
+                 crc32c::Value(record.data(), record.size());
+    }
+  };
+  if (pool_ != nullptr && num_records > 1 &&
+      num_bytes >= kMinParallelVerifyBytes) {
+    const int64 num_shards =
+        std::min<int64>(pool_->NumThreads() + 1, num_records);
+    BlockingCounter counter(num_shards - 1);
+    for (int64 shard = 1; shard < num_shards; ++shard) {
+      pool_->Schedule([&verify, &counter, shard, num_shards, num_records]() {
+        verify(num_records * shard / num_shards,
+               num_records * (shard + 1) / num_shards);
+        counter.DecrementCount();
+      });
+    }
+    verify(0, num_records / num_shards);
+    counter.Wait();
+  } else {
+    verify(0, num_records);
+  }
+  for (int64 i = 0; i < num_records; ++i) {
+    if (!valid[i]) {
+      offset_ = (*offsets)[first_offset + i];
+      records->resize(first + i);
+      offsets->resize(first_offset + i);
+      status = errors::DataLoss("corrupted record at ", offset_ + kHeaderSize);
+      break;
+    }
+  }
+
+  status_ = status;
+  return records->size() > first ? Status::OK() : status_;
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,132 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LIB_IO_PREFETCHING_RECORD_READER_H_
+#define TENSORFLOW_LIB_IO_PREFETCHING_RECORD_READER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class RandomAccessFile;
+
+namespace io {
+
+class PrefetchingRecordReaderOptions {
+ public:
+  // Size of the chunks in which the file is read. Chunks other than the
+  // first start at multiples of buffer_size in the file.
+  size_t buffer_size = 256 << 10;
+
+  // Number of chunks read ahead of the records being returned. Ignored
+  // if the reader has no thread pool.
+  int readahead_depth = 2;
+};
+
+// Reads the uncompressed records written by RecordWriter sequentially,
+// in large chunks of the file.
+//
+// With a thread pool, up to readahead_depth chunks are read ahead on it
+// while the records of earlier chunks are returned, and the checksums of
+// large batches of records are verified on it in parallel. Without one,
+// each chunk is read when it is needed.
+//
+// The records, offsets and errors are those RecordReader::ReadRecord()
+// would return. Not thread-safe.
+class PrefetchingRecordReader {
+ public:
+  // Reads the records of "*file" from "offset", which must be the offset
+  // of a record. "*file" and "*pool" (which may be null) must remain
+  // live while this reader is in use.
+  PrefetchingRecordReader(RandomAccessFile* file, uint64 offset,
+                          const PrefetchingRecordReaderOptions& options =
+                              PrefetchingRecordReaderOptions(),
+                          thread::ThreadPool* pool = nullptr);
+
+  // Waits for the chunks being read ahead.
+  ~PrefetchingRecordReader();
+
+  // Appends up to "max_records" records to "*records", and their offsets
+  // to "*offsets". Returns OK if some records were appended, OUT_OF_RANGE
+  // at end of file, or something else for an error. An error found after
+  // some records is returned by the next call instead. Once an error has
+  // been returned, offset() is that of the bad record and every later
+  // call returns the same error.
+  Status ReadRecords(int64 max_records, std::vector<string>* records,
+                     std::vector<uint64>* offsets);
+
+  // The offset of the next record to be read.
+  uint64 offset() const { return offset_; }
+
+ private:
+  struct Chunk;
+
+  // Reads the next "n" bytes of the file into "dst", and sets "*n_read"
+  // to their number, which is less than "n" only at end of file.
+  Status ReadBytes(size_t n, char* dst, size_t* n_read);
+
+  // Makes the next chunk of the file current.
+  Status NextChunk();
+
+  // Returns a new chunk following the previous ones.
+  std::shared_ptr<Chunk> NewChunkLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Starts reading chunks ahead until readahead_depth chunks are queued.
+  void ScheduleReadsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Reads "*chunk" from the file.
+  void ReadChunk(Chunk* chunk) const;
+
+  // Reads the next record and stores the checksum of its data in
+  // "*masked_crc".
+  Status ReadRecord(string* record, uint32* masked_crc);
+
+  RandomAccessFile* const file_;
+  const PrefetchingRecordReaderOptions options_;
+  thread::ThreadPool* const pool_;
+
+  uint64 offset_;
+  Status status_;
+
+  // The chunk being consumed and the position in it.
+  std::shared_ptr<Chunk> current_;
+  size_t pos_ = 0;
+
+  mutex mu_;
+  condition_variable chunk_read_;
+  // The chunks following current_, in file order.
+  std::deque<std::shared_ptr<Chunk>> chunks_ GUARDED_BY(mu_);
+  // The offset of the first chunk not yet in chunks_.
+  uint64 next_chunk_offset_ GUARDED_BY(mu_);
+  // True once a queued chunk was found to end the file.
+  bool end_of_file_queued_ GUARDED_BY(mu_) = false;
+  int num_reads_in_flight_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PrefetchingRecordReader);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_LIB_IO_PREFETCHING_RECORD_READER_H_
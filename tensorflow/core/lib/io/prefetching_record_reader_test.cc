@@ -0,0 +1,242 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/prefetching_record_reader.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+const size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+const size_t kFooterSize = sizeof(uint32);
+
+// Returns "num_records" records of skewed lengths.
+std::vector<string> MakeRecords(int num_records, int max_log) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<string> records;
+  for (int i = 0; i < num_records; ++i) {
+    string record = strings::StrCat(i, ".");
+    record.resize(rnd.Skewed(max_log), 'a' + i % 26);
+    records.push_back(record);
+  }
+  return records;
+}
+
+// Writes "records" to "fname" and returns their offsets.
+std::vector<uint64> WriteRecords(const string& fname,
+                                 const std::vector<string>& records) {
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(Env::Default()->NewWritableFile(fname, &file));
+  RecordWriter writer(file.get());
+  std::vector<uint64> offsets;
+  uint64 offset = 0;
+  for (const string& record : records) {
+    offsets.push_back(offset);
+    offset += kHeaderSize + record.size() + kFooterSize;
+    TF_CHECK_OK(writer.WriteRecord(record));
+  }
+  TF_CHECK_OK(file->Close());
+  return offsets;
+}
+
+// Adds "delta" to the byte at "offset" of "fname".
+void CorruptByte(const string& fname, uint64 offset, int delta) {
+  string contents;
+  TF_CHECK_OK(ReadFileToString(Env::Default(), fname, &contents));
+  contents[offset] += delta;
+  TF_CHECK_OK(WriteStringToFile(Env::Default(), fname, contents));
+}
+
+// Reads the records of "fname" from "offset" in batches of "batch_size".
+Status ReadAll(const string& fname, uint64 offset,
+               const PrefetchingRecordReaderOptions& options,
+               thread::ThreadPool* pool, int64 batch_size,
+               std::vector<string>* records, std::vector<uint64>* offsets) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  PrefetchingRecordReader reader(file.get(), offset, options, pool);
+  while (true) {
+    const size_t num_read = records->size();
+    Status s = reader.ReadRecords(batch_size, records, offsets);
+    if (!s.ok()) return s;
+    EXPECT_GT(records->size(), num_read);
+    EXPECT_LE(records->size(), num_read + batch_size);
+    EXPECT_EQ(records->size(), offsets->size());
+  }
+}
+
+TEST(PrefetchingRecordReaderTest, ReadsAllRecords) {
+  const string fname = testing::TmpDir() + "/prefetching_record_reader_all";
+  const std::vector<string> records = MakeRecords(200, 10);
+  const std::vector<uint64> offsets = WriteRecords(fname, records);
+  thread::ThreadPool pool(Env::Default(), "test", 3);
+
+  for (size_t buffer_size : {5, 12, 13, 100, 4096, 1 << 20}) {
+    for (int readahead_depth : {0, 1, 3}) {
+      for (int64 batch_size : {1, 7, 1000}) {
+        PrefetchingRecordReaderOptions options;
+        options.buffer_size = buffer_size;
+        options.readahead_depth = readahead_depth;
+        std::vector<string> read_records;
+        std::vector<uint64> read_offsets;
+        Status s = ReadAll(fname, 0, options,
+                           readahead_depth > 0 ? &pool : nullptr, batch_size,
+                           &read_records, &read_offsets);
+        EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+        EXPECT_EQ(records, read_records);
+        EXPECT_EQ(offsets, read_offsets);
+      }
+    }
+  }
+}
+
+TEST(PrefetchingRecordReaderTest, StartsAtOffset) {
+  const string fname = testing::TmpDir() + "/prefetching_record_reader_start";
+  const std::vector<string> records = MakeRecords(50, 10);
+  const std::vector<uint64> offsets = WriteRecords(fname, records);
+  thread::ThreadPool pool(Env::Default(), "test", 2);
+
+  PrefetchingRecordReaderOptions options;
+  options.buffer_size = 64;
+  std::vector<string> read_records;
+  std::vector<uint64> read_offsets;
+  Status s = ReadAll(fname, offsets[17], options, &pool, 10, &read_records,
+                     &read_offsets);
+  EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+  EXPECT_EQ(std::vector<string>(records.begin() + 17, records.end()),
+            read_records);
+  EXPECT_EQ(std::vector<uint64>(offsets.begin() + 17, offsets.end()),
+            read_offsets);
+}
+
+TEST(PrefetchingRecordReaderTest, EmptyFile) {
+  const string fname = testing::TmpDir() + "/prefetching_record_reader_empty";
+  WriteRecords(fname, {});
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+  PrefetchingRecordReader reader(file.get(), 0);
+  std::vector<string> read_records;
+  std::vector<uint64> read_offsets;
+  Status s = reader.ReadRecords(1, &read_records, &read_offsets);
+  EXPECT_TRUE(errors::IsOutOfRange(s)) << s;
+}
+
+TEST(PrefetchingRecordReaderTest, CorruptedRecords) {
+  const string fname = testing::TmpDir() + "/prefetching_record_reader_crc";
+  // Large enough for the checksums to be verified in parallel.
+  const std::vector<string> records = MakeRecords(100, 18);
+  const std::vector<uint64> offsets = WriteRecords(fname, records);
+  thread::ThreadPool pool(Env::Default(), "test", 2);
+
+  // Corrupts the data of one record, then the header of an earlier one.
+  for (int bad : {60, 30}) {
+    const uint64 corrupt_offset =
+        bad == 60 ? offsets[bad] + kHeaderSize : offsets[bad];
+    CorruptByte(fname, corrupt_offset, 1);
+    thread::ThreadPool* pools[] = {&pool, nullptr};
+    for (thread::ThreadPool* p : pools) {
+      std::unique_ptr<RandomAccessFile> file;
+      TF_ASSERT_OK(Env::Default()->NewRandomAccessFile(fname, &file));
+      PrefetchingRecordReaderOptions options;
+      options.buffer_size = 4096;
+      PrefetchingRecordReader reader(file.get(), 0, options, p);
+      std::vector<string> read_records;
+      std::vector<uint64> read_offsets;
+      TF_EXPECT_OK(reader.ReadRecords(1000, &read_records, &read_offsets));
+      EXPECT_EQ(std::vector<string>(records.begin(), records.begin() + bad),
+                read_records);
+      for (int i = 0; i < 2; ++i) {
+        Status s = reader.ReadRecords(1000, &read_records, &read_offsets);
+        EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+        EXPECT_EQ(strings::StrCat("corrupted record at ", corrupt_offset),
+                  s.error_message());
+      }
+      EXPECT_EQ(bad, static_cast<int>(read_records.size()));
+      EXPECT_EQ(offsets[bad], reader.offset());
+    }
+  }
+}
+
+TEST(PrefetchingRecordReaderTest, TruncatedFile) {
+  const string fname = testing::TmpDir() + "/prefetching_record_reader_trunc";
+  std::vector<string> records = MakeRecords(20, 10);
+  records.push_back("last record");
+  const std::vector<uint64> offsets = WriteRecords(fname, records);
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), fname, &contents));
+
+  // Truncates the file in the header, data and footer of the last record.
+  const uint64 last = offsets.back();
+  const uint64 kSizes[] = {last + 5, last + kHeaderSize + 1,
+                           contents.size() - 1};
+  for (uint64 size : kSizes) {
+    TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname,
+                                   StringPiece(contents.data(), size)));
+    PrefetchingRecordReaderOptions options;
+    options.buffer_size = 16;
+    std::vector<string> read_records;
+    std::vector<uint64> read_offsets;
+    Status s = ReadAll(fname, 0, options, nullptr, 3, &read_records,
+                       &read_offsets);
+    EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+    EXPECT_EQ(strings::StrCat("truncated record at ", last),
+              s.error_message());
+    EXPECT_EQ(records.size() - 1, read_records.size());
+  }
+}
+
+static void BM_ReadRecords(int iters, int record_size, int readahead_depth) {
+  testing::StopTiming();
+  const string fname = testing::TmpDir() + "/prefetching_record_reader_bm";
+  const int kNumRecords = (64 << 20) / record_size;
+  std::vector<string> records(kNumRecords, string(record_size, 'x'));
+  WriteRecords(fname, records);
+  thread::ThreadPool pool(Env::Default(), "bm", std::max(readahead_depth, 1));
+  PrefetchingRecordReaderOptions options;
+  options.readahead_depth = readahead_depth;
+  testing::BytesProcessed(static_cast<int64>(iters) * kNumRecords *
+                          record_size);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    std::vector<string> read_records;
+    std::vector<uint64> read_offsets;
+    ReadAll(fname, 0, options, readahead_depth > 0 ? &pool : nullptr, 1024,
+            &read_records, &read_offsets);
+  }
+}
+BENCHMARK(BM_ReadRecords)
+    ->ArgPair(100, 0)
+    ->ArgPair(100, 2)
+    ->ArgPair(10000, 0)
+    ->ArgPair(10000, 2);
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
@@ -18,6 +18,9 @@ limitations under the License.
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/io/block.h"
+#include "tensorflow/core/lib/io/cache.h"
+#include "tensorflow/core/lib/io/filter_block.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/format.h"
 #include "tensorflow/core/lib/io/table_options.h"
 #include "tensorflow/core/lib/io/two_level_iterator.h"
@@ -27,17 +30,38 @@ namespace tensorflow {
 namespace table {
 
 struct Table::Rep {
-  ~Rep() { delete index_block; }
+  ~Rep() {
+    delete filter;
+    delete[] filter_data;
+    delete index_block;
+  }
 
   Options options;
   Status status;
   RandomAccessFile* file;
-  // XXX  uint64 cache_id;
+  uint64 cache_id;
+  FilterBlockReader* filter;
+  const char* filter_data;
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
 };
 
+namespace {
+
+// The key of a block in the block cache: the cache id of its table,
+// followed by its offset in the table.
+const size_t kCacheKeySize = 2 * sizeof(uint64);
+
+StringPiece EncodeCacheKey(uint64 cache_id, const BlockHandle& handle,
+                           char* buf) {
+  core::EncodeFixed64(buf, cache_id);
+  core::EncodeFixed64(buf + sizeof(uint64), handle.offset());
+  return StringPiece(buf, kCacheKeySize);
+}
+
+}  // namespace
+
 Status Table::Open(const Options& options, RandomAccessFile* file, uint64 size,
                    Table** table) {
   *table = NULL;
@@ -73,9 +97,11 @@ Status Table::Open(const Options& options, RandomAccessFile* file, uint64 size,
     rep->file = file;
     rep->metaindex_handle = footer.metaindex_handle();
     rep->index_block = index_block;
-    // XXX    rep->cache_id = (options.block_cache ?
-    // options.block_cache->NewId() : 0);
+    rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
+    rep->filter_data = NULL;
+    rep->filter = NULL;
     *table = new Table(rep);
+    (*table)->ReadMeta(footer);
   } else {
     if (index_block) delete index_block;
   }
@@ -83,19 +109,88 @@ Status Table::Open(const Options& options, RandomAccessFile* file, uint64 size,
   return s;
 }
 
-Table::~Table() { delete rep_; }
+void Table::ReadMeta(const Footer& footer) {
+  if (rep_->options.filter_policy == NULL) {
+    return;  // Do not need any metadata
+  }
+
+  BlockContents contents;
+  if (!ReadBlock(rep_->file, footer.metaindex_handle(), &contents).ok()) {
+    // Do not propagate errors since meta info is not needed for operation
+    return;
+  }
+  Block* meta = new Block(contents);
+
+  Iterator* iter = meta->NewIterator();
+  string key = "filter.";
+  key.append(rep_->options.filter_policy->Name());
+  iter->Seek(key);
+  if (iter->Valid() && iter->key() == StringPiece(key)) {
+    ReadFilter(iter->value());
+  }
+  delete iter;
+  delete meta;
+}
+
+void Table::ReadFilter(const StringPiece& filter_handle_value) {
+  StringPiece v = filter_handle_value;
+  BlockHandle filter_handle;
+  if (!filter_handle.DecodeFrom(&v).ok()) {
+    return;
+  }
+
+  BlockContents block;
+  if (!ReadBlock(rep_->file, filter_handle, &block).ok()) {
+    return;
+  }
+  if (block.heap_allocated) {
+    rep_->filter_data = block.data.data();  // Will need to delete later
+  }
+  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+}
+
+Table::~Table() {
+  // Drops the blocks of this table from the cache, since nothing can
+  // look them up any more.
+  Cache* block_cache = rep_->options.block_cache;
+  if (block_cache != NULL) {
+    Iterator* iiter = rep_->index_block->NewIterator();
+    for (iiter->SeekToFirst(); iiter->Valid(); iiter->Next()) {
+      BlockHandle handle;
+      StringPiece input = iiter->value();
+      if (handle.DecodeFrom(&input).ok()) {
+        char cache_key_buffer[kCacheKeySize];
+        block_cache->Erase(
+            EncodeCacheKey(rep_->cache_id, handle, cache_key_buffer));
+      }
+    }
+    delete iiter;
+  }
+  delete rep_;
+}
 
 static void DeleteBlock(void* arg, void* ignored) {
   delete reinterpret_cast<Block*>(arg);
 }
 
+static void DeleteCachedBlock(const StringPiece& key, void* value) {
+  Block* block = reinterpret_cast<Block*>(value);
+  delete block;
+}
+
+static void ReleaseBlock(void* arg, void* h) {
+  Cache* cache = reinterpret_cast<Cache*>(arg);
+  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
+  cache->Release(handle);
+}
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg, const StringPiece& index_value) {
   Table* table = reinterpret_cast<Table*>(arg);
-  //  Cache* block_cache = table->rep_->options.block_cache;
+  Cache* block_cache = table->rep_->options.block_cache;
   Block* block = NULL;
-  //  Cache::Handle* cache_handle = NULL;
+  Cache::Handle* cache_handle = NULL;
 
   BlockHandle handle;
   StringPiece input = index_value;
@@ -105,16 +200,39 @@ Iterator* Table::BlockReader(void* arg, const StringPiece& index_value) {
 
   if (s.ok()) {
     BlockContents contents;
-    s = ReadBlock(table->rep_->file, handle, &contents);
-    if (s.ok()) {
-      block = new Block(contents);
+    if (block_cache != NULL) {
+      char cache_key_buffer[kCacheKeySize];
+      const StringPiece key =
+          EncodeCacheKey(table->rep_->cache_id, handle, cache_key_buffer);
+      cache_handle = block_cache->Lookup(key);
+      if (cache_handle != NULL) {
+        block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+      } else {
+        s = ReadBlock(table->rep_->file, handle, &contents);
+        if (s.ok()) {
+          block = new Block(contents);
+          if (contents.cachable) {
+            cache_handle = block_cache->Insert(key, block, block->size(),
+                                               &DeleteCachedBlock);
+          }
+        }
+      }
+    } else {
+      s = ReadBlock(table->rep_->file, handle, &contents);
+      if (s.ok()) {
+        block = new Block(contents);
+      }
     }
   }
 
   Iterator* iter;
   if (block != NULL) {
     iter = block->NewIterator();
-    iter->RegisterCleanup(&DeleteBlock, block, NULL);
+    if (cache_handle == NULL) {
+      iter->RegisterCleanup(&DeleteBlock, block, NULL);
+    } else {
+      iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+    }
   } else {
     iter = NewErrorIterator(s);
   }
@@ -128,19 +246,27 @@ Iterator* Table::NewIterator() const {
 
 Status Table::InternalGet(const StringPiece& k, void* arg,
                           void (*saver)(void*, const StringPiece&,
-                                        const StringPiece&)) {
+                                        const StringPiece&)) const {
   Status s;
   Iterator* iiter = rep_->index_block->NewIterator();
   iiter->Seek(k);
   if (iiter->Valid()) {
+    FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
-    Iterator* block_iter = BlockReader(this, iiter->value());
-    block_iter->Seek(k);
-    if (block_iter->Valid()) {
-      (*saver)(arg, block_iter->key(), block_iter->value());
+    StringPiece handle_value = iiter->value();
+    if (filter != NULL && handle.DecodeFrom(&handle_value).ok() &&
+        !filter->KeyMayMatch(handle.offset(), k)) {
+      // Not found
+    } else {
+      Iterator* block_iter =
+          BlockReader(const_cast<Table*>(this), iiter->value());
+      block_iter->Seek(k);
+      if (block_iter->Valid()) {
+        (*saver)(arg, block_iter->key(), block_iter->value());
+      }
+      s = block_iter->status();
+      delete block_iter;
     }
-    s = block_iter->status();
-    delete block_iter;
   }
   if (s.ok()) {
     s = iiter->status();
@@ -149,6 +275,33 @@ Status Table::InternalGet(const StringPiece& k, void* arg,
   return s;
 }
 
+namespace {
+
+struct GetState {
+  StringPiece key;
+  string* value;
+  bool found;
+};
+
+void SaveValue(void* arg, const StringPiece& k, const StringPiece& v) {
+  GetState* state = reinterpret_cast<GetState*>(arg);
+  if (k == state->key) {
+    state->value->assign(v.data(), v.size());
+    state->found = true;
+  }
+}
+
+}  // namespace
+
+Status Table::Get(const StringPiece& key, string* value) const {
+  GetState state = {key, value, false};
+  TF_RETURN_IF_ERROR(InternalGet(key, &state, &SaveValue));
+  if (!state.found) {
+    return errors::NotFound("key not found in table");
+  }
+  return Status::OK();
+}
+
 uint64 Table::ApproximateOffsetOf(const StringPiece& key) const {
   Iterator* index_iter = rep_->index_block->NewIterator();
   index_iter->Seek(key);
@@ -62,6 +62,12 @@ class Table {
   // be close to the file length.
   uint64 ApproximateOffsetOf(const StringPiece& key) const;
 
+  // If the table contains "key", sets "*value" to its value and returns
+  // OK.  Returns NOT_FOUND if it does not.  Unlike a Seek() on an
+  // iterator, does not read any data block if the table's filter (see
+  // Options::filter_policy) says that the key is not present.
+  Status Get(const StringPiece& key, string* value) const;
+
  private:
   struct Rep;
   Rep* rep_;
@@ -74,7 +80,13 @@ class Table {
   // that key is not present.
   Status InternalGet(const StringPiece& key, void* arg,
                      void (*handle_result)(void* arg, const StringPiece& k,
-                                           const StringPiece& v));
+                                           const StringPiece& v)) const;
+
+  // Reads the filter of the table, if it has one for the filter policy
+  // of its options.  Errors are ignored, leaving the table without a
+  // filter.
+  void ReadMeta(const Footer& footer);
+  void ReadFilter(const StringPiece& filter_handle_value);
 
   // No copying allowed
   Table(const Table&);
@@ -21,6 +21,9 @@ limitations under the License.
 namespace tensorflow {
 namespace table {
 
+class Cache;
+class FilterPolicy;
+
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
 // being stored in a file.  The following enum describes which
@@ -60,6 +63,23 @@ struct Options {
   // incompressible, the kSnappyCompression implementation will
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression = kSnappyCompression;
+
+  // If non-null, use the specified cache for blocks read by Table.
+  // The cache may be shared by many tables, and must outlive them.
+  //
+  // Default: nullptr, in which case every block is read from the file
+  // each time it is needed.
+  Cache* block_cache = nullptr;
+
+  // If non-null, TableBuilder stores a filter created with this policy
+  // for the keys of each data block, and Table uses it to skip reading
+  // the data blocks of keys that are not present.  Tables must be
+  // opened with a policy of the same Name() as the one they were built
+  // with for their filters to be used.  The policy must outlive the
+  // builders and tables using it.
+  //
+  // Default: nullptr
+  const FilterPolicy* filter_policy = nullptr;
 };
 
 }  // namespace table
@@ -17,11 +17,15 @@ limitations under the License.
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/block.h"
 #include "tensorflow/core/lib/io/block_builder.h"
+#include "tensorflow/core/lib/io/cache.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/format.h"
 #include "tensorflow/core/lib/io/iterator.h"
 #include "tensorflow/core/lib/io/table_builder.h"
@@ -224,11 +228,17 @@ class TableConstructor : public Constructor {
     // Open the table
     source_ = new StringSource(sink.contents());
     Options table_options;
+    table_options.block_cache = options.block_cache;
+    table_options.filter_policy = options.filter_policy;
     return Table::Open(table_options, source_, sink.contents().size(), &table_);
   }
 
   virtual Iterator* NewIterator() const { return table_->NewIterator(); }
 
+  Status Get(const StringPiece& key, string* value) const {
+    return table_->Get(key, value);
+  }
+
   uint64 ApproximateOffsetOf(const StringPiece& key) const {
     return table_->ApproximateOffsetOf(key);
   }
@@ -252,17 +262,23 @@ enum TestType { TABLE_TEST, BLOCK_TEST };
 struct TestArgs {
   TestType type;
   int restart_interval;
+  bool cache_and_filter;
 };
 
 static const TestArgs kTestArgList[] = {
-    {TABLE_TEST, 16}, {TABLE_TEST, 1}, {TABLE_TEST, 1024},
-    {BLOCK_TEST, 16}, {BLOCK_TEST, 1}, {BLOCK_TEST, 1024},
+    {TABLE_TEST, 16, false}, {TABLE_TEST, 1, false},
+    {TABLE_TEST, 1024, false}, {TABLE_TEST, 16, true},
+    {BLOCK_TEST, 16, false}, {BLOCK_TEST, 1, false},
+    {BLOCK_TEST, 1024, false},
 };
 static const int kNumTestArgs = sizeof(kTestArgList) / sizeof(kTestArgList[0]);
 
 class Harness : public ::testing::Test {
  public:
-  Harness() : constructor_(NULL) {}
+  Harness()
+      : constructor_(NULL),
+        block_cache_(NewLRUCache(4096)),
+        filter_policy_(NewBloomFilterPolicy(10)) {}
 
   void Init(const TestArgs& args) {
     delete constructor_;
@@ -273,6 +289,10 @@ class Harness : public ::testing::Test {
     // Use shorter block size for tests to exercise block boundary
     // conditions more.
     options_.block_size = 256;
+    if (args.cache_and_filter) {
+      options_.block_cache = block_cache_.get();
+      options_.filter_policy = filter_policy_.get();
+    }
     switch (args.type) {
       case TABLE_TEST:
         constructor_ = new TableConstructor();
@@ -414,6 +434,8 @@ class Harness : public ::testing::Test {
  private:
   Options options_;
   Constructor* constructor_;
+  std::unique_ptr<Cache> block_cache_;
+  std::unique_ptr<const FilterPolicy> filter_policy_;
 };
 
 // Test empty table/block.
@@ -620,5 +642,128 @@ TEST(TableTest, SeekToFirstKeyDoesNotReadTooMuch) {
   EXPECT_LT(c.BytesRead(), 200);
 }
 
+// Adds "n" entries with keys "k000000", "k000002", ... (with only even
+// numbers) and 100 byte values to "*c", and finishes it.
+static void AddEvenKeys(int n, const Options& options, TableConstructor* c) {
+  for (int i = 0; i < n; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "k%06d", 2 * i);
+    c->Add(key, string(100, 'a' + i % 26));
+  }
+  std::vector<string> keys;
+  KVMap kvmap;
+  c->Finish(options, &keys, &kvmap);
+}
+
+TEST(TableTest, Get) {
+  std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  for (int variant = 0; variant < 4; variant++) {
+    TableConstructor c;
+    Options options;
+    options.block_size = 1024;
+    options.compression = kNoCompression;
+    if (variant & 1) options.block_cache = cache.get();
+    if (variant & 2) options.filter_policy = policy.get();
+    AddEvenKeys(200, options, &c);
+
+    for (int i = 0; i < 400; i++) {
+      char key[16];
+      snprintf(key, sizeof(key), "k%06d", i);
+      string value;
+      Status s = c.Get(key, &value);
+      if (i % 2 == 0) {
+        TF_EXPECT_OK(s);
+        EXPECT_EQ(string(100, 'a' + (i / 2) % 26), value);
+      } else {
+        EXPECT_TRUE(errors::IsNotFound(s)) << s;
+      }
+    }
+    string value;
+    EXPECT_TRUE(errors::IsNotFound(c.Get("a", &value)));
+    EXPECT_TRUE(errors::IsNotFound(c.Get("z", &value)));
+  }
+}
+
+TEST(TableTest, BlockCacheAvoidsRereads) {
+  std::unique_ptr<Cache> cache(NewLRUCache(1 << 20));
+  std::unique_ptr<TableConstructor> table(new TableConstructor);
+  TableConstructor& c = *table;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  options.block_cache = cache.get();
+  AddEvenKeys(200, options, &c);
+
+  string value;
+  TF_EXPECT_OK(c.Get("k000000", &value));
+  TF_EXPECT_OK(c.Get("k000200", &value));
+  const uint64 bytes_read = c.BytesRead();
+  const int64 misses = cache->NumMisses();
+  EXPECT_EQ(2, misses);
+  EXPECT_EQ(0, cache->NumHits());
+
+  // The same blocks are now found in the cache, by lookups and scans.
+  TF_EXPECT_OK(c.Get("k000002", &value));
+  TF_EXPECT_OK(c.Get("k000200", &value));
+  Iterator* iter = c.NewIterator();
+  iter->Seek("k000000");
+  ASSERT_TRUE(iter->Valid());
+  delete iter;
+  EXPECT_EQ(bytes_read, c.BytesRead());
+  EXPECT_EQ(3, cache->NumHits());
+  EXPECT_EQ(misses, cache->NumMisses());
+  EXPECT_GT(cache->TotalCharge(), 2048);
+
+  // The blocks of a table are dropped when it is closed.
+  table.reset();
+  EXPECT_EQ(0, cache->TotalCharge());
+}
+
+TEST(TableTest, BlockCacheIsBounded) {
+  std::unique_ptr<Cache> cache(NewLRUCache(64 << 10));
+  TableConstructor c;
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  options.block_cache = cache.get();
+  AddEvenKeys(5000, options, &c);
+
+  Iterator* iter = c.NewIterator();
+  int n = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) n++;
+  EXPECT_EQ(5000, n);
+  delete iter;
+  EXPECT_LE(cache->TotalCharge(), 64 << 10);
+}
+
+TEST(TableTest, FilterSkipsAbsentKeys) {
+  std::unique_ptr<const FilterPolicy> policy(NewBloomFilterPolicy(10));
+  for (bool use_filter : {false, true}) {
+    TableConstructor c;
+    Options options;
+    options.block_size = 1024;
+    options.compression = kNoCompression;
+    if (use_filter) options.filter_policy = policy.get();
+    AddEvenKeys(1000, options, &c);
+
+    // Looks up the odd keys, which fall inside the data blocks.
+    const uint64 bytes_read = c.BytesRead();
+    for (int i = 1; i < 2000; i += 2) {
+      char key[16];
+      snprintf(key, sizeof(key), "k%06d", i);
+      string value;
+      EXPECT_TRUE(errors::IsNotFound(c.Get(key, &value)));
+    }
+    const uint64 lookup_bytes = c.BytesRead() - bytes_read;
+    if (use_filter) {
+      // Only false positives (~1%) read a data block.
+      EXPECT_LT(lookup_bytes, 50 * 1024);
+    } else {
+      EXPECT_GT(lookup_bytes, 1000 * 1024);
+    }
+  }
+}
+
 }  // namespace table
 }  // namespace tensorflow
@@ -43,6 +43,8 @@ REGISTER_OP("Save")
     .Input("tensor_names: string")
     .Input("data: T")
     .Attr("T: list(type)")
+    .Attr("background: bool = false")
+    .Attr("max_deltas: int >= 0 = 0")
     .SetShapeFn([](InferenceContext* c) {
       ShapeHandle unused;
       ShapeHandle s;
@@ -70,6 +72,13 @@ filename: Must have a single element. The name of the file to which we write
   the tensor.
 tensor_names: Shape `[N]`. The names of the tensors to be saved.
 data: `N` tensors to save.
+background: If true, the op copies `data` and returns, and the copy is written
+  to `filename` in the background.  The file appears once it is complete.  The
+  next run of the op first waits for the write, and fails if the write did.
+max_deltas: The number of delta checkpoints written after each full one.  A
+  delta checkpoint only holds the tensors that changed since the last full
+  checkpoint written by the op, and refers to that one for the others, which
+  must be kept to restore it.
 )doc");
 
 REGISTER_OP("SaveSlices")
@@ -78,6 +87,8 @@ REGISTER_OP("SaveSlices")
     .Input("shapes_and_slices: string")
     .Input("data: T")
     .Attr("T: list(type)")
+    .Attr("background: bool = false")
+    .Attr("max_deltas: int >= 0 = 0")
     .SetShapeFn([](InferenceContext* c) {
       ShapeHandle unused;
       ShapeHandle s;
@@ -127,6 +138,9 @@ tensor_names: Shape `[N]`. The names of the tensors to be saved.
 shapes_and_slices: Shape `[N]`.  The shapes and slice specifications to use when
   saving the tensors.
 data: `N` tensors to save.
+background: As for `Save`.
+max_deltas: As for `Save`.  Slices are compared, and saved in deltas, each on
+  their own.
 )doc");
 
 REGISTER_OP("Restore")
@@ -294,16 +308,25 @@ REGISTER_OP("TFRecordReader")
     .Attr("container: string = ''")
     .Attr("shared_name: string = ''")
     .Attr("compression_type: string = ''")
+    .Attr("buffer_size: int >= 1 = 262144")
+    .Attr("readahead_depth: int >= 0 = 2")
     .SetIsStateful()
     .SetShapeFn(shape_inference::ScalarShape)
     .Doc(R"doc(
 A Reader that outputs the records from a TensorFlow Records file.
 
+Uncompressed files are read in chunks of `buffer_size` bytes, and up to
+`readahead_depth` chunks are read ahead on background threads.
+
 reader_handle: The handle to reference the Reader.
 container: If non-empty, this reader is placed in the given container.
         Otherwise, a default container is used.
 shared_name: If non-empty, this reader is named in the given bucket
              with this shared_name. Otherwise, the node name is used instead.
+buffer_size: The size in bytes of the chunks in which uncompressed files
+  are read.
+readahead_depth: The number of chunks read ahead of the records being
+  output. If 0, each chunk is read when it is needed.
 )doc");
 
 REGISTER_OP("IdentityReader")
@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/op.h"
 
 namespace tensorflow {
@@ -115,4 +116,32 @@ client_terminated: If set to true, this indicates that the node was added
   locally by the caller.
 )doc");
 
+REGISTER_OP("_CompressTensor")
+    .Input("tensor: T")
+    .Output("compressed: string")
+    .Attr("T: type")
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Encodes a tensor as a scalar string before it is sent to another task.
+
+The tensor's shape and bytes are stored in the string, compressed with snappy
+when that makes the encoding smaller. Added by graph partitioning when
+GraphOptions.transfer_options.compress is set; decoded by _UncompressTensor.
+
+tensor: The tensor to encode. T must be a type that can be memcpy'ed.
+compressed: A scalar string holding the encoded tensor.
+)doc");
+
+REGISTER_OP("_UncompressTensor")
+    .Input("compressed: string")
+    .Output("tensor: T")
+    .Attr("T: type")
+    .SetShapeFn(shape_inference::UnknownShape)
+    .Doc(R"doc(
+Decodes a tensor that was encoded by _CompressTensor.
+
+compressed: A scalar string produced by _CompressTensor.
+tensor: The decoded tensor.
+)doc");
+
 }  // end namespace tensorflow
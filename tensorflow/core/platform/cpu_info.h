@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_PLATFORM_CPU_INFO_H_
 #define TENSORFLOW_PLATFORM_CPU_INFO_H_
 
+#include <vector>
+
 namespace tensorflow {
 namespace port {
 
@@ -28,6 +30,28 @@ static const bool kLittleEndian = true;
 // software can change it dynamically.
 int NumSchedulableCPUs();
 
+// Denotes a thread or memory that is not bound to a NUMA node.
+static const int kNUMANoAffinity = -1;
+
+// Returns the number of NUMA nodes of the machine. Returns 1 if the
+// machine is not a NUMA machine or its topology cannot be discovered
+// (on Linux, it is read from /sys/devices/system/node).
+int NUMANumNodes();
+
+// Stores in "*cpus", in increasing order, the CPUs of NUMA node "node"
+// that this process may run on. If the topology is unknown, node 0 has
+// all the schedulable CPUs.
+void NUMANodeCPUs(int node, std::vector<int>* cpus);
+
+// Binds the calling thread to the CPUs of NUMA node "node". Returns
+// false if the binding is not supported or failed, in which case the
+// affinity of the thread is unchanged.
+bool NUMASetThreadNodeAffinity(int node);
+
+// Returns the NUMA node whose CPUs the calling thread is restricted to,
+// or kNUMANoAffinity if it may run on the CPUs of several nodes.
+int NUMAGetThreadNodeAffinity();
+
 }  // namespace port
 }  // namespace tensorflow
 
@@ -37,6 +37,12 @@ namespace port {
 void* aligned_malloc(size_t size, int minimum_alignment);
 void aligned_free(void* aligned_memory);
 
+// Allocates "size" bytes aligned to "minimum_alignment", which must not
+// exceed the page size, from the memory of NUMA node "node" where
+// supported. The memory must be released with NUMAFree(ptr, size).
+void* NUMAMalloc(int node, size_t size, int minimum_alignment);
+void NUMAFree(void* ptr, size_t size);
+
 // Tries to release num_bytes of free memory back to the operating
 // system for reuse.  Use this routine with caution -- to get this
 // memory back may require faulting pages back in by the OS, and
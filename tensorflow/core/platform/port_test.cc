@@ -13,8 +13,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <string.h>
 #include <condition_variable>
+#include <vector>
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/test.h"
@@ -32,6 +35,40 @@ TEST(Port, AlignedMalloc) {
   }
 }
 
+TEST(Port, NUMATopology) {
+  const int num_nodes = NUMANumNodes();
+  ASSERT_GE(num_nodes, 1);
+  // Every schedulable CPU belongs to exactly one node.
+  std::vector<bool> seen;
+  int num_cpus = 0;
+  for (int node = 0; node < num_nodes; ++node) {
+    std::vector<int> cpus;
+    NUMANodeCPUs(node, &cpus);
+    for (int cpu : cpus) {
+      if (cpu >= static_cast<int>(seen.size())) seen.resize(cpu + 1);
+      EXPECT_FALSE(seen[cpu]) << cpu;
+      seen[cpu] = true;
+      ++num_cpus;
+    }
+  }
+  EXPECT_EQ(NumSchedulableCPUs(), num_cpus);
+  std::vector<int> cpus;
+  NUMANodeCPUs(num_nodes, &cpus);
+  EXPECT_TRUE(cpus.empty());
+}
+
+TEST(Port, NUMAMalloc) {
+  for (int node = 0; node < NUMANumNodes(); ++node) {
+    for (size_t size = 1; size <= 1 << 22; size <<= 3) {
+      void* p = NUMAMalloc(node, size, 64);
+      ASSERT_TRUE(p != NULL) << "NUMAMalloc(" << node << ", " << size << ")";
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 64, 0);
+      memset(p, 0, size);
+      NUMAFree(p, size);
+    }
+  }
+}
+
 TEST(ConditionVariable, WaitForMilliseconds_Timeout) {
   mutex m;
   mutex_lock l(m);
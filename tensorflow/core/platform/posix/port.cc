@@ -13,9 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/types.h"
 #if defined(__linux__) && !defined(__ANDROID__)
 #include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #endif
 #include <stdio.h>
 #include <stdlib.h>
@@ -58,6 +62,160 @@ int NumSchedulableCPUs() {
   return kDefaultCores;
 }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+namespace {
+
+// Parses a list of CPUs or NUMA nodes in the format of /sys, e.g.
+// "0-3,8,10-11".
+bool ParseSysList(const char* s, std::vector<int>* out) {
+  out->clear();
+  while (*s != '\0' && *s != '\n') {
+    char* end;
+    const long first = strtol(s, &end, 10);
+    if (end == s || first < 0) return false;
+    long last = first;
+    s = end;
+    if (*s == '-') {
+      ++s;
+      last = strtol(s, &end, 10);
+      if (end == s || last < first) return false;
+      s = end;
+    }
+    for (long i = first; i <= last; ++i) out->push_back(i);
+    if (*s == ',') ++s;
+  }
+  return true;
+}
+
+bool ReadSysList(const char* path, std::vector<int>* out) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) return false;
+  char buf[4096];
+  const bool ok = fgets(buf, sizeof buf, f) != NULL;
+  fclose(f);
+  return ok && ParseSysList(buf, out);
+}
+
+// Returns the CPUs of each NUMA node, indexed by node, or an empty
+// vector if the topology cannot be read.
+const std::vector<std::vector<int>>& NUMATopology() {
+  static const std::vector<std::vector<int>>* topology = []() {
+    std::vector<std::vector<int>>* cpus = new std::vector<std::vector<int>>;
+    std::vector<int> nodes;
+    if (ReadSysList("/sys/devices/system/node/online", &nodes) &&
+        !nodes.empty()) {
+      cpus->resize(nodes.back() + 1);
+      for (int node : nodes) {
+        char path[128];
+        snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist",
+                 node);
+        if (!ReadSysList(path, &(*cpus)[node])) {
+          cpus->clear();
+          break;
+        }
+      }
+    }
+    return cpus;
+  }();
+  return *topology;
+}
+
+// MPOL_PREFERRED in <linux/mempolicy.h>.
+const int kMPolPreferred = 1;
+
+}  // namespace
+
+int NUMANumNodes() {
+  const int n = NUMATopology().size();
+  return n > 0 ? n : 1;
+}
+
+void NUMANodeCPUs(int node, std::vector<int>* cpus) {
+  cpus->clear();
+  // The affinity of the process rather than that of the calling
+  // thread, which may already be bound to a node.
+  cpu_set_t cpuset;
+  if (sched_getaffinity(getpid(), sizeof(cpu_set_t), &cpuset) != 0) return;
+  const std::vector<std::vector<int>>& topology = NUMATopology();
+  if (topology.empty()) {
+    if (node != 0) return;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpuset)) cpus->push_back(cpu);
+    }
+    return;
+  }
+  if (node < 0 || node >= static_cast<int>(topology.size())) return;
+  for (int cpu : topology[node]) {
+    if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &cpuset)) cpus->push_back(cpu);
+  }
+}
+
+bool NUMASetThreadNodeAffinity(int node) {
+  std::vector<int> cpus;
+  NUMANodeCPUs(node, &cpus);
+  if (cpus.empty()) return false;
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int cpu : cpus) CPU_SET(cpu, &cpuset);
+  return sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == 0;
+}
+
+int NUMAGetThreadNodeAffinity() {
+  cpu_set_t cpuset;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) != 0) {
+    return kNUMANoAffinity;
+  }
+  const int num_cpus = CPU_COUNT(&cpuset);
+  std::vector<int> cpus;
+  for (int node = 0; node < NUMANumNodes(); ++node) {
+    NUMANodeCPUs(node, &cpus);
+    int num_node_cpus = 0;
+    for (int cpu : cpus) {
+      if (CPU_ISSET(cpu, &cpuset)) ++num_node_cpus;
+    }
+    if (num_cpus > 0 && num_node_cpus == num_cpus) return node;
+  }
+  return kNUMANoAffinity;
+}
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+  // Pages are aligned beyond any "minimum_alignment" we support, and
+  // can be bound to a node as a whole.
+  void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) return NULL;
+  if (node >= 0 && node < static_cast<int>(8 * sizeof(unsigned long))) {
+    // The node is preferred rather than required, so that the memory
+    // comes from the other nodes when it is full. A failure leaves the
+    // memory usable with the default policy.
+    const unsigned long nodemask = 1UL << node;
+    syscall(SYS_mbind, ptr, size, kMPolPreferred, &nodemask,
+            8 * sizeof(nodemask), 0);
+  }
+  return ptr;
+}
+
+void NUMAFree(void* ptr, size_t size) { munmap(ptr, size); }
+#else   // !(defined(__linux__) && !defined(__ANDROID__))
+int NUMANumNodes() { return 1; }
+
+void NUMANodeCPUs(int node, std::vector<int>* cpus) {
+  cpus->clear();
+  if (node != 0) return;
+  for (int cpu = 0; cpu < NumSchedulableCPUs(); ++cpu) cpus->push_back(cpu);
+}
+
+bool NUMASetThreadNodeAffinity(int node) { return false; }
+
+int NUMAGetThreadNodeAffinity() { return kNUMANoAffinity; }
+
+void* NUMAMalloc(int node, size_t size, int minimum_alignment) {
+  return aligned_malloc(size, minimum_alignment);
+}
+
+void NUMAFree(void* ptr, size_t size) { aligned_free(ptr); }
+#endif  // defined(__linux__) && !defined(__ANDROID__)
+
 void* aligned_malloc(size_t size, int minimum_alignment) {
 #if defined(__ANDROID__)
   return memalign(minimum_alignment, size);
@@ -80,8 +80,10 @@ limitations under the License.
 //
 // 0. Checkpoints saved before checkpoint versioning.
 // 1. First real version (10feb2015).
+// 2. Delta checkpoints, which read the slices they do not save from a base
+//    checkpoint (17oct2016).
 #define TF_CHECKPOINT_VERSION_MIN_PRODUCER 0
 #define TF_CHECKPOINT_VERSION_MIN_CONSUMER 0
-#define TF_CHECKPOINT_VERSION 1
+#define TF_CHECKPOINT_VERSION 2
 
 #endif  // TENSORFLOW_CORE_PUBLIC_VERSION_H_
@@ -0,0 +1,342 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/example_proto_fast_parsing.h"
+
+#include <string.h>
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/proto_wire_format.h"
+
+namespace tensorflow {
+
+namespace {
+
+using proto_wire::kFixed32;
+using proto_wire::kLengthDelimited;
+using proto_wire::kVarint;
+using proto_wire::ReadLengthDelimited;
+using proto_wire::ReadTag;
+using proto_wire::SkipField;
+
+// Field numbers of the messages in example.proto and feature.proto.
+const uint32 kExampleFeatures = 1;     // Example.features
+const uint32 kFeaturesFeature = 1;     // Features.feature (a map)
+const uint32 kMapEntryKey = 1;         // Features.feature key
+const uint32 kMapEntryValue = 2;       // Features.feature value
+const uint32 kFeatureBytesList = 1;    // Feature.bytes_list
+const uint32 kFeatureFloatList = 2;    // Feature.float_list
+const uint32 kFeatureInt64List = 3;    // Feature.int64_list
+const uint32 kListValue = 1;           // {Bytes,Float,Int64}List.value
+
+// Serialized pieces of a message. Parsing the concatenation of serialized
+// messages merges them, so several pieces form one message.
+typedef gtl::InlinedVector<StringPiece, 1> Pieces;
+
+// Finds which list the Feature made of "feature" holds, and collects the
+// serialized pieces of that list in "*lists". Sets "*kind" to the field
+// number of the list, or to 0 if the Feature is empty.
+bool ParseFeature(const Pieces& feature, uint32* kind, Pieces* lists) {
+  *kind = 0;
+  lists->clear();
+  for (StringPiece input : feature) {
+    while (!input.empty()) {
+      uint32 field, wire_type;
+      if (!ReadTag(&input, &field, &wire_type)) return false;
+      if (wire_type == kLengthDelimited && field >= kFeatureBytesList &&
+          field <= kFeatureInt64List) {
+        StringPiece list;
+        if (!ReadLengthDelimited(&input, &list)) return false;
+        // Setting another member of the "kind" oneof replaces the list,
+        // while setting the same member again merges into it.
+        if (field != *kind) {
+          *kind = field;
+          lists->clear();
+        }
+        lists->push_back(list);
+      } else if (!SkipField(&input, wire_type)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Counts the floats in the FloatList made of "lists", and also copies
+// them to "out" unless it is null.
+bool ReadFloats(const Pieces& lists, float* out, int64* count) {
+  int64 n = 0;
+  for (StringPiece input : lists) {
+    while (!input.empty()) {
+      uint32 field, wire_type;
+      if (!ReadTag(&input, &field, &wire_type)) return false;
+      if (field == kListValue && wire_type == kLengthDelimited) {
+        StringPiece packed;
+        if (!ReadLengthDelimited(&input, &packed) || packed.size() % 4 != 0) {
+          return false;
+        }
+        const int64 num = packed.size() / 4;
+        if (out != nullptr) {
+          if (port::kLittleEndian) {
+            memcpy(out + n, packed.data(), packed.size());
+          } else {
+            for (int64 i = 0; i < num; ++i) {
+              const uint32 bits = core::DecodeFixed32(packed.data() + 4 * i);
+              memcpy(out + n + i, &bits, 4);
+            }
+          }
+        }
+        n += num;
+      } else if (field == kListValue && wire_type == kFixed32) {
+        if (input.size() < 4) return false;
+        if (out != nullptr) {
+          const uint32 bits = core::DecodeFixed32(input.data());
+          memcpy(out + n, &bits, 4);
+        }
+        input.remove_prefix(4);
+        ++n;
+      } else if (!SkipField(&input, wire_type)) {
+        return false;
+      }
+    }
+  }
+  *count = n;
+  return true;
+}
+
+// Counts the int64s in the Int64List made of "lists", and also copies
+// them to "out" unless it is null.
+bool ReadInt64s(const Pieces& lists, int64* out, int64* count) {
+  int64 n = 0;
+  for (StringPiece input : lists) {
+    while (!input.empty()) {
+      uint32 field, wire_type;
+      if (!ReadTag(&input, &field, &wire_type)) return false;
+      if (field == kListValue && wire_type == kLengthDelimited) {
+        StringPiece packed;
+        if (!ReadLengthDelimited(&input, &packed)) return false;
+        if (out == nullptr) {
+          // Every varint ends with the only one of its bytes that has the
+          // high bit clear.
+          for (const char c : packed) {
+            if ((c & 0x80) == 0) ++n;
+          }
+          if (!packed.empty() && (packed[packed.size() - 1] & 0x80) != 0) {
+            return false;
+          }
+        } else {
+          while (!packed.empty()) {
+            uint64 value;
+            if (!core::GetVarint64(&packed, &value)) return false;
+            out[n++] = static_cast<int64>(value);
+          }
+        }
+      } else if (field == kListValue && wire_type == kVarint) {
+        uint64 value;
+        if (!core::GetVarint64(&input, &value)) return false;
+        if (out != nullptr) out[n] = static_cast<int64>(value);
+        ++n;
+      } else if (!SkipField(&input, wire_type)) {
+        return false;
+      }
+    }
+  }
+  *count = n;
+  return true;
+}
+
+// Counts the strings in the BytesList made of "lists", and also copies
+// them to "out" unless it is null.
+bool ReadBytes(const Pieces& lists, string* out, int64* count) {
+  int64 n = 0;
+  for (StringPiece input : lists) {
+    while (!input.empty()) {
+      uint32 field, wire_type;
+      if (!ReadTag(&input, &field, &wire_type)) return false;
+      if (field == kListValue && wire_type == kLengthDelimited) {
+        StringPiece value;
+        if (!ReadLengthDelimited(&input, &value)) return false;
+        if (out != nullptr) out[n].assign(value.data(), value.size());
+        ++n;
+      } else if (!SkipField(&input, wire_type)) {
+        return false;
+      }
+    }
+  }
+  *count = n;
+  return true;
+}
+
+// Counts the values of the list of type "dtype" made of "lists", and
+// copies them to "out" at element "offset" unless "out" is null.
+bool ReadValues(DataType dtype, const Pieces& lists, Tensor* out, int64 offset,
+                int64* count) {
+  switch (dtype) {
+    case DT_INT64:
+      return ReadInt64s(lists, out ? out->flat<int64>().data() + offset : nullptr,
+                        count);
+    case DT_FLOAT:
+      return ReadFloats(lists, out ? out->flat<float>().data() + offset : nullptr,
+                        count);
+    case DT_STRING:
+      return ReadBytes(lists, out ? out->flat<string>().data() + offset : nullptr,
+                       count);
+    default:
+      LOG(FATAL) << "Not supposed to be here.  Saw dtype: " << dtype;
+      return false;
+  }
+}
+
+// Returns the Feature field number of the list holding values of "dtype".
+uint32 FeatureKind(DataType dtype) {
+  switch (dtype) {
+    case DT_INT64:
+      return kFeatureInt64List;
+    case DT_FLOAT:
+      return kFeatureFloatList;
+    case DT_STRING:
+      return kFeatureBytesList;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+FastExampleParser::FastExampleParser(
+    const std::vector<FixedLenFeature>& fixed_len_features,
+    const std::vector<VarLenFeature>& var_len_features)
+    : fixed_len_features_(fixed_len_features),
+      var_len_features_(var_len_features) {
+  const int num_dense = fixed_len_features_.size();
+  const int num_slots = num_dense + var_len_features_.size();
+  key_to_slot_.reserve(num_slots);
+  value_slot_.resize(num_slots);
+  for (int s = 0; s < num_slots; ++s) {
+    const string& key = (s < num_dense)
+                            ? fixed_len_features_[s].key
+                            : var_len_features_[s - num_dense].key;
+    value_slot_[s] = key_to_slot_.insert({key, s}).first->second;
+  }
+}
+
+bool FastExampleParser::Parse(
+    StringPiece serialized, int batch_index,
+    std::vector<Tensor*>* dense_values,
+    std::vector<std::vector<Tensor>>* sparse_values_temporary_vector) const {
+  const int num_dense = fixed_len_features_.size();
+  const int num_sparse = var_len_features_.size();
+
+  // The serialized Feature of each configured key. As for any map, the
+  // last entry with a key replaces the earlier ones.
+  std::vector<Pieces> features(num_dense + num_sparse);
+  Pieces entry_value;
+  StringPiece example = serialized;
+  while (!example.empty()) {
+    uint32 field, wire_type;
+    if (!ReadTag(&example, &field, &wire_type)) return false;
+    if (field != kExampleFeatures || wire_type != kLengthDelimited) {
+      if (!SkipField(&example, wire_type)) return false;
+      continue;
+    }
+    StringPiece map;
+    if (!ReadLengthDelimited(&example, &map)) return false;
+    while (!map.empty()) {
+      if (!ReadTag(&map, &field, &wire_type)) return false;
+      if (field != kFeaturesFeature || wire_type != kLengthDelimited) {
+        if (!SkipField(&map, wire_type)) return false;
+        continue;
+      }
+      StringPiece entry;
+      if (!ReadLengthDelimited(&map, &entry)) return false;
+      StringPiece key;
+      entry_value.clear();
+      while (!entry.empty()) {
+        if (!ReadTag(&entry, &field, &wire_type)) return false;
+        if (field == kMapEntryKey && wire_type == kLengthDelimited) {
+          if (!ReadLengthDelimited(&entry, &key)) return false;
+        } else if (field == kMapEntryValue && wire_type == kLengthDelimited) {
+          StringPiece value;
+          if (!ReadLengthDelimited(&entry, &value)) return false;
+          entry_value.push_back(value);
+        } else if (!SkipField(&entry, wire_type)) {
+          return false;
+        }
+      }
+      auto iter = key_to_slot_.find(key);
+      if (iter != key_to_slot_.end()) {
+        features[iter->second] = entry_value;
+      }
+    }
+  }
+
+  Pieces lists;
+  uint32 kind;
+
+  // Handle dense features.
+  for (int d = 0; d < num_dense; ++d) {
+    const FixedLenFeature& feature_config = fixed_len_features_[d];
+    const DataType dtype = feature_config.dtype;
+    if (!ParseFeature(features[value_slot_[d]], &kind, &lists)) return false;
+    Tensor* out = (*dense_values)[d];
+
+    if (kind == 0) {
+      // A missing required feature is an error.
+      if (feature_config.default_value.NumElements() == 0) return false;
+      RowDenseCopy(batch_index, dtype, feature_config.default_value, out);
+      continue;
+    }
+    if (kind != FeatureKind(dtype)) return false;
+
+    const int64 num_elements = feature_config.shape.num_elements();
+    int64 count;
+    if (!ReadValues(dtype, lists, nullptr, 0, &count) ||
+        count != num_elements) {
+      return false;
+    }
+    if (!ReadValues(dtype, lists, out, batch_index * num_elements, &count)) {
+      return false;
+    }
+  }
+
+  // Handle sparse features.
+  for (int d = 0; d < num_sparse; ++d) {
+    const VarLenFeature& feature_config = var_len_features_[d];
+    const DataType dtype = feature_config.dtype;
+    if (!ParseFeature(features[value_slot_[num_dense + d]], &kind, &lists)) {
+      return false;
+    }
+    Tensor* out = &(*sparse_values_temporary_vector)[d][batch_index];
+
+    if (kind == 0) {
+      *out = Tensor(dtype, TensorShape({0}));
+      continue;
+    }
+    if (kind != FeatureKind(dtype)) return false;
+
+    int64 count;
+    if (!ReadValues(dtype, lists, nullptr, 0, &count)) return false;
+    *out = Tensor(dtype, TensorShape({count}));
+    if (!ReadValues(dtype, lists, out, 0, &count)) return false;
+  }
+
+  return true;
+}
+
+}  // namespace tensorflow
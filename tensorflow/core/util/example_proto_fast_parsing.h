@@ -0,0 +1,84 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef THIRD_PARTY_TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
+#define THIRD_PARTY_TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/example_proto_helper.h"
+
+namespace tensorflow {
+
+// Parses serialized tensorflow::Example protos directly from the wire
+// format, without constructing Example messages. The serialized bytes
+// are walked once, the keys of the feature map are matched against the
+// configured features through a hash table built at construction, and
+// the values of the matching features are decoded straight into the
+// output tensors.
+//
+// The outputs are the same as those of parsing the Example with
+// ParseProtoUnlimited() and passing it to SingleExampleProtoToTensors(),
+// including the protobuf rules for repeated and duplicated fields.
+//
+// A FastExampleParser is immutable after construction and may be used
+// by several threads at once.
+class FastExampleParser {
+ public:
+  // "fixed_len_features" and "var_len_features" must outlive the parser.
+  FastExampleParser(const std::vector<FixedLenFeature>& fixed_len_features,
+                    const std::vector<VarLenFeature>& var_len_features);
+
+  // Parses "serialized" as an Example, and updates "dense_values" and
+  // "sparse_values_temporary_vector" at "batch_index" as
+  // SingleExampleProtoToTensors() does. Returns true on success.
+  //
+  // Returns false if "serialized" is malformed, does not match the
+  // feature configuration, or uses parts of the wire format that the fast
+  // path does not handle (e.g. groups in unknown fields). The outputs at
+  // "batch_index" may then be partially written, and the caller should
+  // parse the example with the protobuf library and
+  // SingleExampleProtoToTensors(), which overwrites them or reports the
+  // error.
+  bool Parse(StringPiece serialized, int batch_index,
+             std::vector<Tensor*>* dense_values,
+             std::vector<std::vector<Tensor>>* sparse_values_temporary_vector)
+      const;
+
+ private:
+  const std::vector<FixedLenFeature>& fixed_len_features_;
+  const std::vector<VarLenFeature>& var_len_features_;
+
+  // Dense features use slots [0, num_dense) and sparse features the
+  // following ones. Maps each feature key to the first slot with that
+  // key.
+  std::unordered_map<StringPiece, int, StringPiece::Hasher> key_to_slot_;
+
+  // The slot whose key_to_slot_ entry collects the values of each slot,
+  // which differs from the slot itself only if a key is configured more
+  // than once.
+  std::vector<int> value_slot_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FastExampleParser);
+};
+
+}  // namespace tensorflow
+
+#endif  // THIRD_PARTY_TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
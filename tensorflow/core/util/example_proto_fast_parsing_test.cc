@@ -0,0 +1,340 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/example_proto_fast_parsing.h"
+
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the serialization of a length-delimited field.
+string LengthDelimitedField(int field, const string& value) {
+  string out;
+  core::PutVarint32(&out, (field << 3) | 2);
+  core::PutVarint32(&out, value.size());
+  out.append(value);
+  return out;
+}
+
+// Returns the serialization of an Example holding one map entry, whose
+// key is "key" and whose value is made of the serialized Features in
+// "values".
+string ExampleWithEntry(const string& key,
+                        const std::vector<string>& values) {
+  string entry = LengthDelimitedField(1, key);
+  for (const string& value : values) {
+    entry.append(LengthDelimitedField(2, value));
+  }
+  return LengthDelimitedField(1, LengthDelimitedField(1, entry));
+}
+
+string FloatFeature(const std::vector<float>& values) {
+  Feature f;
+  for (float v : values) f.mutable_float_list()->add_value(v);
+  return f.SerializeAsString();
+}
+
+string Int64Feature(const std::vector<int64>& values) {
+  Feature f;
+  for (int64 v : values) f.mutable_int64_list()->add_value(v);
+  return f.SerializeAsString();
+}
+
+class FastExampleParserTest : public ::testing::Test {
+ protected:
+  void AddDense(const string& key, DataType dtype, const TensorShape& shape,
+                const Tensor& default_value) {
+    FixedLenFeature config;
+    config.key = key;
+    config.dtype = dtype;
+    config.shape = shape;
+    config.default_value = default_value;
+    dense_.push_back(config);
+  }
+
+  void AddSparse(const string& key, DataType dtype) {
+    VarLenFeature config;
+    config.key = key;
+    config.dtype = dtype;
+    sparse_.push_back(config);
+  }
+
+  // Outputs of parsing one example.
+  struct Outputs {
+    std::vector<Tensor> dense;
+    std::vector<Tensor*> dense_ptrs;
+    std::vector<std::vector<Tensor>> sparse;
+  };
+
+  void InitOutputs(Outputs* out) {
+    *out = Outputs();
+    for (const FixedLenFeature& config : dense_) {
+      TensorShape shape({1});
+      shape.AppendShape(config.shape);
+      out->dense.emplace_back(config.dtype, shape);
+    }
+    for (Tensor& t : out->dense) out->dense_ptrs.push_back(&t);
+    out->sparse.assign(sparse_.size(), std::vector<Tensor>(1));
+  }
+
+  // Parses "serialized" with the fast parser, and returns whether it
+  // handled it.
+  bool FastParse(const string& serialized, Outputs* out) {
+    InitOutputs(out);
+    FastExampleParser parser(dense_, sparse_);
+    return parser.Parse(serialized, 0, &out->dense_ptrs, &out->sparse);
+  }
+
+  // Parses "serialized" with the protobuf library.
+  Status ProtoParse(const string& serialized, Outputs* out) {
+    InitOutputs(out);
+    Example example;
+    if (!ParseProtoUnlimited(&example, serialized)) {
+      return errors::InvalidArgument("Could not parse example");
+    }
+    return SingleExampleProtoToTensors(example, "<unknown>", 0, dense_,
+                                       sparse_, &out->dense_ptrs,
+                                       &out->sparse);
+  }
+
+  // Checks that the fast parser handles "serialized" like the protobuf
+  // library does.
+  void ExpectSameAsProto(const string& serialized) {
+    Outputs expected;
+    TF_ASSERT_OK(ProtoParse(serialized, &expected));
+    Outputs actual;
+    ASSERT_TRUE(FastParse(serialized, &actual));
+    for (size_t d = 0; d < dense_.size(); ++d) {
+      ExpectEqual(expected.dense[d], actual.dense[d]);
+    }
+    for (size_t d = 0; d < sparse_.size(); ++d) {
+      ExpectEqual(expected.sparse[d][0], actual.sparse[d][0]);
+    }
+  }
+
+  void ExpectEqual(const Tensor& x, const Tensor& y) {
+    switch (x.dtype()) {
+      case DT_INT64:
+        test::ExpectTensorEqual<int64>(x, y);
+        break;
+      case DT_FLOAT:
+        test::ExpectTensorEqual<float>(x, y);
+        break;
+      case DT_STRING:
+        test::ExpectTensorEqual<string>(x, y);
+        break;
+      default:
+        FAIL() << "Unexpected dtype " << x.dtype();
+    }
+  }
+
+  std::vector<FixedLenFeature> dense_;
+  std::vector<VarLenFeature> sparse_;
+};
+
+TEST_F(FastExampleParserTest, RandomExamples) {
+  AddDense("dense_int64", DT_INT64, TensorShape({2}),
+           test::AsTensor<int64>({-1, -2}));
+  AddDense("dense_float", DT_FLOAT, TensorShape({3}), Tensor(DT_FLOAT));
+  AddDense("dense_string", DT_STRING, TensorShape({1}),
+           test::AsTensor<string>({"default"}));
+  AddSparse("sparse_int64", DT_INT64);
+  AddSparse("sparse_float", DT_FLOAT);
+  AddSparse("sparse_string", DT_STRING);
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  for (int i = 0; i < 100; ++i) {
+    Example example;
+    auto& features = *example.mutable_features()->mutable_feature();
+    if (rnd.OneIn(2)) {
+      for (int j = 0; j < 2; ++j) {
+        features["dense_int64"].mutable_int64_list()->add_value(
+            static_cast<int64>(rnd.Rand64()));
+      }
+    }
+    for (int j = 0; j < 3; ++j) {
+      features["dense_float"].mutable_float_list()->add_value(rnd.RandFloat());
+    }
+    if (rnd.OneIn(2)) {
+      features["dense_string"].mutable_bytes_list()->add_value(
+          strings::StrCat("s", rnd.Rand32()));
+    }
+    for (int j = rnd.Uniform(5); j > 0; --j) {
+      features["sparse_int64"].mutable_int64_list()->add_value(
+          static_cast<int64>(rnd.Rand64()) >> rnd.Uniform(64));
+      features["sparse_float"].mutable_float_list()->add_value(
+          rnd.RandFloat());
+      features["sparse_string"].mutable_bytes_list()->add_value(
+          string(rnd.Uniform(300), 'x'));
+      features[strings::StrCat("unused_", j)].mutable_float_list()->add_value(
+          1.0f);
+    }
+    ExpectSameAsProto(example.SerializeAsString());
+  }
+}
+
+TEST_F(FastExampleParserTest, EmptyExample) {
+  AddDense("a", DT_FLOAT, TensorShape({}), test::AsScalar<float>(3.0f));
+  AddSparse("b", DT_STRING);
+  ExpectSameAsProto("");
+}
+
+TEST_F(FastExampleParserTest, KeyConfiguredTwice) {
+  AddDense("a", DT_FLOAT, TensorShape({2}), Tensor(DT_FLOAT));
+  AddSparse("a", DT_FLOAT);
+  ExpectSameAsProto(ExampleWithEntry("a", {FloatFeature({1, 2})}));
+}
+
+TEST_F(FastExampleParserTest, LastMapEntryWins) {
+  AddSparse("a", DT_INT64);
+  ExpectSameAsProto(ExampleWithEntry("a", {Int64Feature({1, 2})}) +
+                    ExampleWithEntry("a", {Int64Feature({3})}));
+}
+
+TEST_F(FastExampleParserTest, RepeatedValuesMerge) {
+  AddSparse("a", DT_INT64);
+  AddSparse("b", DT_FLOAT);
+  // Same member of the oneof: the lists are concatenated.
+  ExpectSameAsProto(ExampleWithEntry(
+      "a", {Int64Feature({1, 2}), Int64Feature({3, -4})}));
+  // Another member of the oneof: the last one wins.
+  ExpectSameAsProto(
+      ExampleWithEntry("b", {Int64Feature({1, 2}), FloatFeature({3})}));
+}
+
+TEST_F(FastExampleParserTest, UnpackedValues) {
+  AddSparse("a", DT_INT64);
+  AddSparse("b", DT_FLOAT);
+  string int64_list;
+  for (int v : {5, 300, -1}) {
+    core::PutVarint32(&int64_list, (1 << 3) | 0);
+    core::PutVarint64(&int64_list, static_cast<int64>(v));
+  }
+  string float_list;
+  for (float v : {0.5f, -2.0f}) {
+    core::PutVarint32(&float_list, (1 << 3) | 5);
+    char buf[4];
+    memcpy(buf, &v, 4);
+    float_list.append(buf, 4);
+  }
+  ExpectSameAsProto(
+      ExampleWithEntry("a", {LengthDelimitedField(3, int64_list)}) +
+      ExampleWithEntry("b", {LengthDelimitedField(2, float_list)}));
+}
+
+TEST_F(FastExampleParserTest, FallsBack) {
+  AddDense("a", DT_FLOAT, TensorShape({2}), Tensor(DT_FLOAT));
+  Outputs out;
+  // Malformed.
+  const string valid = ExampleWithEntry("a", {FloatFeature({1, 2})});
+  EXPECT_TRUE(FastParse(valid, &out));
+  EXPECT_FALSE(FastParse(valid.substr(0, valid.size() - 1), &out));
+  EXPECT_FALSE(FastParse("\xff", &out));
+  // Missing required feature.
+  EXPECT_FALSE(FastParse("", &out));
+  // Wrong type.
+  EXPECT_FALSE(FastParse(ExampleWithEntry("a", {Int64Feature({1, 2})}), &out));
+  // Wrong number of values.
+  EXPECT_FALSE(FastParse(ExampleWithEntry("a", {FloatFeature({1})}), &out));
+}
+
+// Returns a serialized example with "num_keys" features, each holding
+// "num_values" floats.
+string MakeBenchmarkExample(int num_keys, int num_values) {
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  for (int k = 0; k < num_keys; ++k) {
+    FloatList* list =
+        features[strings::StrCat("feature_", k)].mutable_float_list();
+    for (int v = 0; v < num_values; ++v) list->add_value(v);
+  }
+  return example.SerializeAsString();
+}
+
+void MakeBenchmarkConfig(int num_keys, int num_values,
+                         std::vector<FixedLenFeature>* dense,
+                         std::vector<Tensor>* outputs,
+                         std::vector<Tensor*>* output_ptrs) {
+  for (int k = 0; k < num_keys; ++k) {
+    FixedLenFeature config;
+    config.key = strings::StrCat("feature_", k);
+    config.dtype = DT_FLOAT;
+    config.shape = TensorShape({num_values});
+    dense->push_back(config);
+    outputs->emplace_back(DT_FLOAT, TensorShape({1, num_values}));
+  }
+  for (Tensor& t : *outputs) output_ptrs->push_back(&t);
+}
+
+static void BM_ProtoParseExample(int iters, int num_keys, int num_values) {
+  testing::StopTiming();
+  const string serialized = MakeBenchmarkExample(num_keys, num_values);
+  std::vector<FixedLenFeature> dense;
+  std::vector<VarLenFeature> sparse;
+  std::vector<Tensor> outputs;
+  std::vector<Tensor*> output_ptrs;
+  MakeBenchmarkConfig(num_keys, num_values, &dense, &outputs, &output_ptrs);
+  std::vector<std::vector<Tensor>> sparse_outputs;
+  testing::BytesProcessed(static_cast<int64>(iters) * serialized.size());
+  testing::StartTiming();
+  while (--iters >= 0) {
+    protobuf::Arena arena;
+    Example* ex = protobuf::Arena::CreateMessage<Example>(&arena);
+    CHECK(ParseProtoUnlimited(ex, serialized));
+    TF_CHECK_OK(SingleExampleProtoToTensors(*ex, "", 0, dense, sparse,
+                                            &output_ptrs, &sparse_outputs));
+  }
+}
+BENCHMARK(BM_ProtoParseExample)
+    ->ArgPair(10, 1)
+    ->ArgPair(100, 1)
+    ->ArgPair(10, 100);
+
+static void BM_FastParseExample(int iters, int num_keys, int num_values) {
+  testing::StopTiming();
+  const string serialized = MakeBenchmarkExample(num_keys, num_values);
+  std::vector<FixedLenFeature> dense;
+  std::vector<VarLenFeature> sparse;
+  std::vector<Tensor> outputs;
+  std::vector<Tensor*> output_ptrs;
+  MakeBenchmarkConfig(num_keys, num_values, &dense, &outputs, &output_ptrs);
+  std::vector<std::vector<Tensor>> sparse_outputs;
+  const FastExampleParser parser(dense, sparse);
+  testing::BytesProcessed(static_cast<int64>(iters) * serialized.size());
+  testing::StartTiming();
+  while (--iters >= 0) {
+    CHECK(parser.Parse(serialized, 0, &output_ptrs, &sparse_outputs));
+  }
+}
+BENCHMARK(BM_FastParseExample)
+    ->ArgPair(10, 1)
+    ->ArgPair(100, 1)
+    ->ArgPair(10, 100);
+
+}  // namespace
+}  // namespace tensorflow
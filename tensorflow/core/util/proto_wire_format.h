@@ -0,0 +1,85 @@
+/* Copyright 2016 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_UTIL_PROTO_WIRE_FORMAT_H_
+#define TENSORFLOW_CORE_UTIL_PROTO_WIRE_FORMAT_H_
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace proto_wire {
+
+// Helpers that read serialized protocol buffers field by field, for the
+// parsers that skip building the messages. Each one consumes what it reads
+// from the front of "*input", and returns false if the input is malformed.
+
+// Protocol buffer wire types. Groups are not supported.
+enum WireType {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kFixed32 = 5,
+};
+
+// Reads a field tag.
+inline bool ReadTag(StringPiece* input, uint32* field, uint32* wire_type) {
+  uint32 tag;
+  if (!core::GetVarint32(input, &tag)) return false;
+  *field = tag >> 3;
+  *wire_type = tag & 7;
+  return *field != 0;
+}
+
+// Reads a length-delimited field value.
+inline bool ReadLengthDelimited(StringPiece* input, StringPiece* value) {
+  uint64 length;
+  if (!core::GetVarint64(input, &length) || length > input->size()) {
+    return false;
+  }
+  *value = StringPiece(input->data(), length);
+  input->remove_prefix(length);
+  return true;
+}
+
+// Skips a field value of type "wire_type".
+inline bool SkipField(StringPiece* input, uint32 wire_type) {
+  switch (wire_type) {
+    case kVarint: {
+      uint64 unused;
+      return core::GetVarint64(input, &unused);
+    }
+    case kFixed64:
+      if (input->size() < 8) return false;
+      input->remove_prefix(8);
+      return true;
+    case kLengthDelimited: {
+      StringPiece unused;
+      return ReadLengthDelimited(input, &unused);
+    }
+    case kFixed32:
+      if (input->size() < 4) return false;
+      input->remove_prefix(4);
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace proto_wire
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_PROTO_WIRE_FORMAT_H_
@@ -15,9 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 
+#include "tensorflow/core/util/saved_tensor_slice.pb.h"
+
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/ordered_code.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/util/proto_wire_format.h"
 
 namespace tensorflow {
 
@@ -122,6 +125,47 @@ Status ParseShapeAndSlice(const string& shape_and_slice, TensorShape* shape,
   return slice->SliceTensorShape(*shape, shape_slice);
 }
 
+namespace {
+
+using proto_wire::kLengthDelimited;
+using proto_wire::ReadLengthDelimited;
+using proto_wire::ReadTag;
+using proto_wire::SkipField;
+
+// Finds the value of the field numbered "field" of "message", which
+// must occur once, as a length-delimited value. Sets "*value" to the
+// empty string if the field does not occur.
+bool FindUniqueField(StringPiece message, uint32 field, StringPiece* value) {
+  bool found = false;
+  *value = StringPiece();
+  while (!message.empty()) {
+    uint32 f, wire_type;
+    if (!ReadTag(&message, &f, &wire_type)) return false;
+    if (f == field) {
+      if (found || wire_type != kLengthDelimited ||
+          !ReadLengthDelimited(&message, value)) {
+        return false;
+      }
+      found = true;
+    } else if (!SkipField(&message, wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool FindPackedTensorSliceData(StringPiece record, int field,
+                               StringPiece* values) {
+  StringPiece saved_slice, tensor_proto;
+  return FindUniqueField(record, SavedTensorSlices::kDataFieldNumber,
+                         &saved_slice) &&
+         FindUniqueField(saved_slice, SavedSlice::kDataFieldNumber,
+                         &tensor_proto) &&
+         FindUniqueField(tensor_proto, field, values);
+}
+
 }  // namespace checkpoint
 
 }  // namespace tensorflow
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/status.h"  // for Status
+#include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/platform/protobuf.h"
 
 namespace tensorflow {
@@ -199,6 +200,37 @@ inline protobuf::RepeatedPtrField<string>* MutableTensorProtoData<string>(
   return t->mutable_string_val();
 }
 
+// The number of the packed TensorProto field whose bytes are the values
+// of type T as saved by Fill() on a little-endian host, or 0 if the
+// values of type T are encoded some other way.
+template <typename T>
+struct RawTensorProtoField {
+  static constexpr int value = 0;
+};
+
+#define RAW_TENSOR_PROTO_FIELD(TYPE, FIELD)                          \
+  template <>                                                        \
+  struct RawTensorProtoField<TYPE> {                                 \
+    static constexpr int value = TensorProto::k##FIELD##FieldNumber; \
+  };
+
+RAW_TENSOR_PROTO_FIELD(float, FloatVal);
+RAW_TENSOR_PROTO_FIELD(double, DoubleVal);
+RAW_TENSOR_PROTO_FIELD(complex64, ScomplexVal);
+RAW_TENSOR_PROTO_FIELD(complex128, DcomplexVal);
+
+#undef RAW_TENSOR_PROTO_FIELD
+
+// Finds the values of the slice in "record", a serialized
+// SavedTensorSlices, when they are the payload of a single occurrence of
+// the packed TensorProto field numbered "field".  Sets "*values" to that
+// payload (empty if the field is absent) and returns true, without
+// parsing the rest of the record.  Returns false if the record must be
+// parsed as a proto instead, e.g. because the values are split over
+// several occurrences of the field.
+bool FindPackedTensorSliceData(StringPiece record, int field,
+                               StringPiece* values);
+
 template <>
 inline void Fill(const string* data, size_t n, TensorProto* t) {
   typename protobuf::RepeatedPtrField<string> copy(data, data + n);
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/saved_tensor_slice.pb.h"
 
 namespace tensorflow {
 
@@ -40,6 +41,74 @@ TEST(TensorShapeUtilTest, TensorNameSliceToOrderedCode) {
   }
 }
 
+// Returns the serialized SavedTensorSlices of a slice of "values".
+string SavedSliceRecord(const TensorProto& values) {
+  SavedTensorSlices sts;
+  SavedSlice* ss = sts.mutable_data();
+  ss->set_name("foo");
+  *ss->mutable_data() = values;
+  string record;
+  sts.SerializeToString(&record);
+  return record;
+}
+
+TEST(FindPackedTensorSliceDataTest, Float) {
+  TensorProto values;
+  const float data[] = {1.5, -2, 3.25};
+  Fill(data, 3, &values);
+  const string record = SavedSliceRecord(values);
+  StringPiece raw;
+  EXPECT_TRUE(FindPackedTensorSliceData(
+      record, RawTensorProtoField<float>::value, &raw));
+  ASSERT_EQ(sizeof(data), raw.size());
+  float found[3];
+  memcpy(found, raw.data(), raw.size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(data[i], found[i]);
+  }
+}
+
+TEST(FindPackedTensorSliceDataTest, Absent) {
+  TensorProto values;
+  const double data[] = {1, 2};
+  Fill(data, 2, &values);
+  StringPiece raw("not empty");
+  EXPECT_TRUE(FindPackedTensorSliceData(SavedSliceRecord(values),
+                                        RawTensorProtoField<float>::value,
+                                        &raw));
+  EXPECT_TRUE(raw.empty());
+}
+
+TEST(FindPackedTensorSliceDataTest, SplitField) {
+  // Values split across two occurrences of the field must be parsed.
+  TensorProto values;
+  const float data[] = {1, 2};
+  Fill(data, 2, &values);
+  string record = SavedSliceRecord(values);
+  record.append(SavedSliceRecord(values));
+  StringPiece raw;
+  EXPECT_FALSE(FindPackedTensorSliceData(
+      record, RawTensorProtoField<float>::value, &raw));
+}
+
+TEST(FindPackedTensorSliceDataTest, Malformed) {
+  TensorProto values;
+  const float data[] = {1, 2};
+  Fill(data, 2, &values);
+  const string record = SavedSliceRecord(values);
+  StringPiece raw;
+  EXPECT_FALSE(FindPackedTensorSliceData(record.substr(0, record.size() - 1),
+                                         RawTensorProtoField<float>::value,
+                                         &raw));
+}
+
+TEST(FindPackedTensorSliceDataTest, NotRaw) {
+  EXPECT_TRUE(RawTensorProtoField<int32>::value == 0);
+  EXPECT_TRUE(RawTensorProtoField<string>::value == 0);
+  EXPECT_TRUE(RawTensorProtoField<double>::value ==
+              TensorProto::kDoubleValFieldNumber);
+}
+
 }  // namespace
 
 }  // namespace checkpoint
@@ -15,13 +15,18 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_slice_reader.h"
 
+#include <algorithm>
+#include <unordered_set>
 #include <vector>
 #include "tensorflow/core/framework/types.pb_text.h"
 #include "tensorflow/core/framework/versions.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
+#include "tensorflow/core/lib/io/cache.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/iterator.h"
 #include "tensorflow/core/lib/io/match.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table.h"
 #include "tensorflow/core/lib/io/table_options.h"
 #include "tensorflow/core/platform/env.h"
@@ -50,21 +55,70 @@ class TensorSliceReaderTable : public TensorSliceReader::Table {
   }
 
   bool Get(const string& key, string* value) override {
-    std::unique_ptr<table::Iterator> iter(table_->NewIterator());
-    iter->Seek(key);
-    if (iter->Valid() && iter->key() == key) {
-      StringPiece v = iter->value();
-      value->assign(v.data(), v.size());
-      return true;
-    } else {
-      return false;
-    }
+    return table_->Get(key, value).ok();
   }
 
  private:
   RandomAccessFile* file_;  // Owns.
   table::Table* table_;
 };
+
+// A RandomAccessFile that reads a file mapped in memory.  The blocks
+// read from it point into the mapping rather than being copied.
+class MemoryRegionRandomAccessFile : public RandomAccessFile {
+ public:
+  explicit MemoryRegionRandomAccessFile(
+      std::unique_ptr<ReadOnlyMemoryRegion> region)
+      : region_(std::move(region)) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    const uint64 length = region_->length();
+    if (offset >= length) {
+      *result = StringPiece();
+      return errors::OutOfRange("Read after file end");
+    }
+    const uint64 available = std::min(static_cast<uint64>(n), length - offset);
+    *result = StringPiece(
+        static_cast<const char*>(region_->data()) + offset, available);
+    if (available < n) {
+      return errors::OutOfRange("Read less bytes than requested");
+    }
+    return Status::OK();
+  }
+
+ private:
+  std::unique_ptr<ReadOnlyMemoryRegion> region_;
+};
+
+// Opens "fname" for reading, mapped in memory if the file system
+// supports it, and sets "*file_size" to its size.
+Status OpenCheckpointFile(Env* env, const string& fname,
+                          std::unique_ptr<RandomAccessFile>* file,
+                          uint64* file_size) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  if (env->NewReadOnlyMemoryRegionFromFile(fname, &region).ok()) {
+    *file_size = region->length();
+    file->reset(new MemoryRegionRandomAccessFile(std::move(region)));
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(fname, file));
+  return env->GetFileSize(fname, file_size);
+}
+
+// The options of the tables of all readers.  The blocks recently read
+// are shared in a bounded cache, so that the slices of the many small
+// tensors stored in a block are not each read and checksummed with the
+// whole block.
+const table::Options& ReaderTableOptions() {
+  static const table::Options* options = []() {
+    table::Options* options = new table::Options;
+    options->block_cache = table::NewLRUCache(64 << 20);
+    options->filter_policy = table::NewBloomFilterPolicy(10);
+    return options;
+  }();
+  return *options;
+}
 }  // namespace
 
 Status OpenTableTensorSliceReader(const string& fname,
@@ -72,24 +126,20 @@ Status OpenTableTensorSliceReader(const string& fname,
   *result = nullptr;
   Env* env = Env::Default();
   std::unique_ptr<RandomAccessFile> f;
-  Status s = env->NewRandomAccessFile(fname, &f);
+  uint64 file_size;
+  Status s = OpenCheckpointFile(env, fname, &f, &file_size);
   if (s.ok()) {
-    uint64 file_size;
-    s = env->GetFileSize(fname, &file_size);
+    table::Table* table;
+    s = table::Table::Open(ReaderTableOptions(), f.get(), file_size, &table);
     if (s.ok()) {
-      table::Options options;
-      table::Table* table;
-      s = table::Table::Open(options, f.get(), file_size, &table);
-      if (s.ok()) {
-        *result = new TensorSliceReaderTable(f.release(), table);
-        return Status::OK();
-      } else {
-        s = Status(s.code(),
-                   strings::StrCat(s.error_message(),
-                                   ": perhaps your file is in a different "
-                                   "file format and you need to use a "
-                                   "different restore operator?"));
-      }
+      *result = new TensorSliceReaderTable(f.release(), table);
+      return Status::OK();
+    } else {
+      s = Status(s.code(),
+                 strings::StrCat(s.error_message(),
+                                 ": perhaps your file is in a different "
+                                 "file format and you need to use a "
+                                 "different restore operator?"));
     }
   }
   LOG(WARNING) << "Could not open " << fname << ": " << s;
@@ -142,7 +192,6 @@ void TensorSliceReader::LoadShard(int shard) const {
   if (sss_[shard] || !status_.ok()) {
     return;  // Already loaded, or invalid.
   }
-  string value;
   SavedTensorSlices sts;
   const string fname = fnames_[shard];
   VLOG(1) << "Reading meta data from file " << fname << "...";
@@ -154,27 +203,91 @@ void TensorSliceReader::LoadShard(int shard) const {
     return;
   }
   sss_[shard].reset(table);
+  status_ = ReadMeta(table, fname, &sts);
+  if (!status_.ok()) return;
+  for (const SavedSliceMeta& ssm : sts.meta().tensor()) {
+    TensorShape ssm_shape(ssm.shape());
+    for (const TensorSliceProto& tsp : ssm.slice()) {
+      TensorSlice ss_slice(tsp);
+      status_ = RegisterTensorSlice(ssm.name(), ssm_shape, ssm.type(), fname,
+                                    ss_slice, &tensors_);
+      if (!status_.ok()) return;
+    }
+  }
+  if (!sts.meta().base().empty()) {
+    status_ = LoadBase(fname, sts);
+  }
+}
+
+Status TensorSliceReader::ReadMeta(Table* table, const string& fname,
+                                   SavedTensorSlices* sts) {
+  string value;
   if (!(table->Get(kSavedTensorSlicesKey, &value) &&
-        ParseProtoUnlimited(&sts, value))) {
-    status_ = errors::Internal(
+        ParseProtoUnlimited(sts, value))) {
+    return errors::Internal(
         "Failed to find the saved tensor slices at the beginning of the "
         "checkpoint file: ",
         fname);
-    return;
   }
-  status_ = CheckVersions(sts.meta().versions(), TF_CHECKPOINT_VERSION,
-                          TF_CHECKPOINT_VERSION_MIN_PRODUCER, "Checkpoint",
-                          "checkpoint");
-  if (!status_.ok()) return;
+  return CheckVersions(sts->meta().versions(), TF_CHECKPOINT_VERSION,
+                       TF_CHECKPOINT_VERSION_MIN_PRODUCER, "Checkpoint",
+                       "checkpoint");
+}
+
+Status TensorSliceReader::LoadBase(const string& fname,
+                                   const SavedTensorSlices& delta) const {
+  string base = delta.meta().base();
+  if (io::Dirname(base).empty()) {
+    base = io::JoinPath(io::Dirname(fname), base);
+  }
+  if (bases_.count(base) > 0 || fname_to_index_.count(base) > 0) {
+    return errors::InvalidArgument("The base ", base, " of checkpoint file ",
+                                   fname, " is read more than once");
+  }
+  VLOG(1) << "Reading meta data from base file " << base << "...";
+  Table* table;
+  Status s = open_function_(base, &table);
+  if (!s.ok()) {
+    return errors::DataLoss("Unable to open table file ", base,
+                            ", the base of ", fname, ": ", s.ToString());
+  }
+  bases_[base].reset(table);
+  SavedTensorSlices sts;
+  TF_RETURN_IF_ERROR(ReadMeta(table, base, &sts));
+  if (!sts.meta().base().empty()) {
+    return errors::DataLoss("The base ", base, " of checkpoint file ", fname,
+                            " is itself a delta checkpoint");
+  }
+  // The slices saved in the delta replace those of the base.
+  std::unordered_set<string> saved;
+  for (const SavedSliceMeta& ssm : delta.meta().tensor()) {
+    for (const TensorSliceProto& tsp : ssm.slice()) {
+      saved.insert(EncodeTensorNameSlice(ssm.name(), TensorSlice(tsp)));
+    }
+  }
   for (const SavedSliceMeta& ssm : sts.meta().tensor()) {
     TensorShape ssm_shape(ssm.shape());
     for (const TensorSliceProto& tsp : ssm.slice()) {
       TensorSlice ss_slice(tsp);
-      status_ = RegisterTensorSlice(ssm.name(), ssm_shape, ssm.type(), fname,
-                                    ss_slice, &tensors_);
-      if (!status_.ok()) return;
+      if (saved.count(EncodeTensorNameSlice(ssm.name(), ss_slice)) > 0) {
+        continue;
+      }
+      TF_RETURN_IF_ERROR(RegisterTensorSlice(ssm.name(), ssm_shape, ssm.type(),
+                                             base, ss_slice, &tensors_));
     }
   }
+  return Status::OK();
+}
+
+TensorSliceReader::Table* TensorSliceReader::FindTable(
+    const string& fname) const {
+  const int idx = gtl::FindWithDefault(fname_to_index_, fname, -1);
+  if (idx >= 0) {
+    return sss_[idx].get();
+  }
+  auto it = bases_.find(fname);
+  CHECK(it != bases_.end()) << "Failed to find the table of file " << fname;
+  return it->second.get();
 }
 
 void TensorSliceReader::LoadAllShards() const {
@@ -185,6 +298,32 @@ void TensorSliceReader::LoadAllShards() const {
   all_shards_loaded_ = true;
 }
 
+void TensorSliceReader::CopyBytes(const char* src, size_t n, char* dst,
+                                  thread::ThreadPool* pool) {
+  static const size_t kChunkSize = 1 << 20;
+  if (pool == nullptr || n <= kChunkSize) {
+    memcpy(dst, src, n);
+    return;
+  }
+  Shard(pool->NumThreads(), pool, (n + kChunkSize - 1) / kChunkSize,
+        kChunkSize, [src, n, dst](int64 start, int64 limit) {
+          const size_t begin = start * kChunkSize;
+          const size_t end = std::min<size_t>(n, limit * kChunkSize);
+          memcpy(dst + begin, src + begin, end - begin);
+        });
+}
+
+bool TensorSliceReader::SameSlice(const TensorShape& shape,
+                                  const TensorSlice& a, const TensorSlice& b) {
+  if (a.dims() != b.dims()) return false;
+  for (int d = 0; d < a.dims(); ++d) {
+    const int64 a_length = a.IsFullAt(d) ? shape.dim_size(d) : a.length(d);
+    const int64 b_length = b.IsFullAt(d) ? shape.dim_size(d) : b.length(d);
+    if (a.start(d) != b.start(d) || a_length != b_length) return false;
+  }
+  return true;
+}
+
 const TensorSliceSet* TensorSliceReader::FindTensorSlice(
     const string& name, const TensorSlice& slice,
     std::vector<std::pair<TensorSlice, string>>* details) const {
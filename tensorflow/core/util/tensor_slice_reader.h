@@ -20,6 +20,7 @@ limitations under the License.
 #ifndef TENSORFLOW_UTIL_TENSOR_SLICE_READER_H_
 #define TENSORFLOW_UTIL_TENSOR_SLICE_READER_H_
 
+#include <type_traits>
 #include <unordered_map>
 
 #include <vector>
@@ -29,7 +30,9 @@ limitations under the License.
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -39,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_slice_set.h"
 #include "tensorflow/core/util/tensor_slice_util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -88,9 +92,12 @@ class TensorSliceReader {
   // yes, copies the data of the slice to "data". The caller needs to make sure
   // that "data" points to a buffer that holds enough data.
   // This is a slow function since it needs to read sstables.
+  //
+  // If "pool" is not nullptr, the saved slices are read and copied in
+  // parallel on it, and so must be the Table::Get() of the tables.
   template <typename T>
-  bool CopySliceData(const string& name, const TensorSlice& slice,
-                     T* data) const;
+  bool CopySliceData(const string& name, const TensorSlice& slice, T* data,
+                     thread::ThreadPool* pool = nullptr) const;
 
   // Get the tensors.
   const std::unordered_map<string, TensorSliceSet*>& Tensors() const {
@@ -115,10 +122,55 @@ class TensorSliceReader {
   void LoadShard(int shard) const;
   void LoadAllShards() const;
 
+  // Reads the metadata at the beginning of "table", the checkpoint file
+  // "fname", to "*sts".
+  static Status ReadMeta(Table* table, const string& fname,
+                         SavedTensorSlices* sts);
+
+  // Loads the base of "delta", the metadata of the delta checkpoint file
+  // "fname".
+  Status LoadBase(const string& fname, const SavedTensorSlices& delta) const;
+
+  // Returns the table of the checkpoint file "fname".
+  Table* FindTable(const string& fname) const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   const TensorSliceSet* FindTensorSlice(
       const string& name, const TensorSlice& slice,
       std::vector<std::pair<TensorSlice, string>>* details) const;
 
+  // Copies the data of the saved slice "slice_s" of tensor "name" in
+  // "table" that belongs to "slice" to "data".
+  template <typename T>
+  static void CopySavedSliceData(const string& name, const TensorShape& shape,
+                                 const TensorSlice& slice_s, Table* table,
+                                 const TensorSlice& slice, T* data,
+                                 thread::ThreadPool* pool);
+
+  // Copies the data of "slice_s" that belongs to "slice" from "record",
+  // the saved slice, to "data" if the values are stored raw in it.
+  // Returns false if the record must be parsed instead.
+  template <typename T>
+  static bool CopyRawSliceData(StringPiece record, const TensorShape& shape,
+                               const TensorSlice& slice_s,
+                               const TensorSlice& slice, T* data,
+                               thread::ThreadPool* pool, std::true_type);
+  template <typename T>
+  static bool CopyRawSliceData(StringPiece record, const TensorShape& shape,
+                               const TensorSlice& slice_s,
+                               const TensorSlice& slice, T* data,
+                               thread::ThreadPool* pool, std::false_type) {
+    return false;
+  }
+
+  // Copies "n" bytes from "src" to "dst", in parallel on "pool" if it
+  // is not nullptr.
+  static void CopyBytes(const char* src, size_t n, char* dst,
+                        thread::ThreadPool* pool);
+
+  // Returns true iff "a" and "b" are the same slice of "shape".
+  static bool SameSlice(const TensorShape& shape, const TensorSlice& a,
+                        const TensorSlice& b);
+
   const string filepattern_;
   const OpenTableFunction open_function_;
   std::vector<string> fnames_;
@@ -128,6 +180,8 @@ class TensorSliceReader {
   mutable mutex mu_;
   mutable bool all_shards_loaded_ = false;
   mutable std::vector<std::unique_ptr<Table>> sss_;
+  // The bases of the delta checkpoint files, by file name.
+  mutable std::unordered_map<string, std::unique_ptr<Table>> bases_;
   mutable std::unordered_map<string, TensorSliceSet*> tensors_;
   mutable Status status_;
 
@@ -139,8 +193,10 @@ Status OpenTableTensorSliceReader(const string& fname,
 
 template <typename T>
 bool TensorSliceReader::CopySliceData(const string& name,
-                                      const TensorSlice& slice, T* data) const {
+                                      const TensorSlice& slice, T* data,
+                                      thread::ThreadPool* pool) const {
   std::vector<std::pair<TensorSlice, string>> details;
+  std::vector<Table*> tables;
   const TensorSliceSet* tss;
   {
     mutex_lock l(mu_);
@@ -155,26 +211,88 @@ bool TensorSliceReader::CopySliceData(const string& name,
       // No such tensor
       return false;
     }
+    for (const auto& x : details) {
+      tables.push_back(FindTable(x.second));
+    }
   }
   // We have the data -- copy it over.
+  const TensorShape& shape = tss->shape();
+  if (pool != nullptr && details.size() > 1) {
+    // The saved slices do not overlap, so each is copied on its own.
+    const int64 cost_per_slice =
+        shape.num_elements() * sizeof(T) / details.size();
+    Shard(pool->NumThreads(), pool, details.size(), cost_per_slice,
+          [&](int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              CopySavedSliceData(name, shape, details[i].first, tables[i],
+                                 slice, data, nullptr);
+            }
+          });
+  } else {
+    for (size_t i = 0; i < details.size(); ++i) {
+      CopySavedSliceData(name, shape, details[i].first, tables[i], slice, data,
+                         pool);
+    }
+  }
+  return true;
+}
+
+template <typename T>
+void TensorSliceReader::CopySavedSliceData(const string& name,
+                                           const TensorShape& shape,
+                                           const TensorSlice& slice_s,
+                                           Table* table,
+                                           const TensorSlice& slice, T* data,
+                                           thread::ThreadPool* pool) {
+  // We read a record in the corresponding sstable
+  const string key = EncodeTensorNameSlice(name, slice_s);
   string value;
-  for (const auto& x : details) {
-    const TensorSlice& slice_s = x.first;
-    const string& fname = x.second;
-    int idx = gtl::FindWithDefault(fname_to_index_, fname, -1);
-    CHECK_GE(idx, 0) << "Failed to find the index for filename " << fname;
-    // We read a record in the corresponding sstable
-    const string key = EncodeTensorNameSlice(name, slice_s);
-    CHECK(sss_[idx]->Get(key, &value))
-        << "Failed to seek to the record for tensor " << name << ", slice "
-        << slice_s.DebugString() << ": computed key = " << key;
-    SavedTensorSlices sts;
-    CHECK(ParseProtoUnlimited(&sts, value))
-        << "Failed to parse the record for tensor " << name << ", slice "
-        << slice_s.DebugString() << ": computed key = " << key;
-    CopyDataFromTensorSliceToTensorSlice(
-        tss->shape(), slice_s, slice,
-        checkpoint::TensorProtoData<T>(sts.data().data()), data);
+  CHECK(table->Get(key, &value))
+      << "Failed to seek to the record for tensor " << name << ", slice "
+      << slice_s.DebugString() << ": computed key = " << key;
+  typedef std::integral_constant<bool, RawTensorProtoField<T>::value != 0>
+      StoredRaw;
+  if (CopyRawSliceData(value, shape, slice_s, slice, data, pool,
+                       StoredRaw())) {
+    return;
+  }
+  SavedTensorSlices sts;
+  CHECK(ParseProtoUnlimited(&sts, value))
+      << "Failed to parse the record for tensor " << name << ", slice "
+      << slice_s.DebugString() << ": computed key = " << key;
+  CopyDataFromTensorSliceToTensorSlice(
+      shape, slice_s, slice, checkpoint::TensorProtoData<T>(sts.data().data()),
+      data);
+}
+
+template <typename T>
+bool TensorSliceReader::CopyRawSliceData(StringPiece record,
+                                         const TensorShape& shape,
+                                         const TensorSlice& slice_s,
+                                         const TensorSlice& slice, T* data,
+                                         thread::ThreadPool* pool,
+                                         std::true_type) {
+  // The values of these types are stored as a packed array, which has
+  // the layout of the values in memory on little-endian hosts.  They are
+  // copied from the record without parsing it.
+  StringPiece raw;
+  if (!port::kLittleEndian ||
+      !FindPackedTensorSliceData(record, RawTensorProtoField<T>::value, &raw)) {
+    return false;
+  }
+  TensorShape shape_s;
+  if (!slice_s.SliceTensorShape(shape, &shape_s).ok() ||
+      raw.size() != shape_s.num_elements() * sizeof(T)) {
+    return false;
+  }
+  if (SameSlice(shape, slice_s, slice)) {
+    CopyBytes(raw.data(), raw.size(), reinterpret_cast<char*>(data), pool);
+  } else {
+    // Copied first, since the values in the record may not be aligned.
+    std::vector<T> values(shape_s.num_elements());
+    memcpy(values.data(), raw.data(), raw.size());
+    CopyDataFromTensorSliceToTensorSlice(shape, slice_s, slice, values.data(),
+                                         data);
   }
   return true;
 }
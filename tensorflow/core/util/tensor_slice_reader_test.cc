@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -395,6 +396,110 @@ TEST(CachedTensorSliceReaderTest, SimpleFloat) {
                                       OpenTableTensorSliceReader);
 }
 
+// Reads the slices of tensors with several saved slices, or one large
+// one, in parallel on a pool, and checks they match the serial reads.
+TEST(TensorSliceReaderTest, ParallelCopy) {
+  const string fname = io::JoinPath(testing::TmpDir(), "parallel_checkpoint");
+  const int kRows = 8;
+  const int kCols = 1 << 16;
+  const TensorShape shape({kRows, kCols});
+  std::vector<float> floats(kRows * kCols);
+  std::vector<double> doubles(kRows * kCols);
+  std::vector<int32> ints(kRows * kCols);
+  for (int i = 0; i < kRows * kCols; ++i) {
+    floats[i] = i;
+    doubles[i] = -i;
+    ints[i] = i % 1000;
+  }
+  {
+    TensorSliceWriter writer(fname, CreateTableTensorSliceBuilder);
+    TF_CHECK_OK(writer.Add("floats", shape, TensorSlice(2), floats.data()));
+    for (int r = 0; r < kRows; r += 2) {
+      const TensorSlice slice =
+          TensorSlice::ParseOrDie(strings::StrCat(r, ",2:-"));
+      TF_CHECK_OK(writer.Add("doubles", shape, slice, &doubles[r * kCols]));
+      TF_CHECK_OK(writer.Add("ints", shape, slice, &ints[r * kCols]));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+
+  TensorSliceReader reader(fname);
+  TF_ASSERT_OK(reader.status());
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  const TensorSlice full(2);
+  const TensorSlice part = TensorSlice::ParseOrDie("1,6:1,10");
+  {
+    std::vector<float> results(kRows * kCols);
+    EXPECT_TRUE(reader.CopySliceData("floats", full, results.data(), &pool));
+    EXPECT_EQ(floats, results);
+  }
+  {
+    std::vector<double> results(kRows * kCols);
+    EXPECT_TRUE(reader.CopySliceData("doubles", full, results.data(), &pool));
+    EXPECT_EQ(doubles, results);
+  }
+  {
+    std::vector<int32> results(kRows * kCols);
+    EXPECT_TRUE(reader.CopySliceData("ints", full, results.data(), &pool));
+    EXPECT_EQ(ints, results);
+  }
+  {
+    double serial[60], parallel[60];
+    EXPECT_TRUE(reader.CopySliceData("doubles", part, serial));
+    EXPECT_TRUE(reader.CopySliceData("doubles", part, parallel, &pool));
+    for (int i = 0; i < 60; ++i) {
+      EXPECT_EQ(doubles[(1 + i / 10) * kCols + 1 + i % 10], serial[i]);
+      EXPECT_EQ(serial[i], parallel[i]);
+    }
+  }
+}
+
+TEST(TensorSliceReaderTest, DeltaCheckpoint) {
+  const string base = io::JoinPath(testing::TmpDir(), "delta_base");
+  const string delta = io::JoinPath(testing::TmpDir(), "delta_delta");
+  const TensorShape shape({2, 2});
+  const TensorSlice top = TensorSlice::ParseOrDie("0,1:-");
+  const TensorSlice bottom = TensorSlice::ParseOrDie("1,1:-");
+  {
+    TensorSliceWriter writer(base, CreateTableTensorSliceBuilder);
+    const float a_top[] = {0, 1};
+    const float a_bottom[] = {2, 3};
+    const int32 b[] = {4, 5};
+    TF_CHECK_OK(writer.Add("a", shape, top, a_top));
+    TF_CHECK_OK(writer.Add("a", shape, bottom, a_bottom));
+    TF_CHECK_OK(writer.Add("b", TensorShape({2}), TensorSlice(1), b));
+    TF_CHECK_OK(writer.Finish());
+  }
+  {
+    // Only the bottom of "a" changed.
+    TensorSliceWriter writer(delta, CreateTableTensorSliceBuilder);
+    writer.SetBase("delta_base");
+    const float a_bottom[] = {12, 13};
+    TF_CHECK_OK(writer.Add("a", shape, bottom, a_bottom));
+    TF_CHECK_OK(writer.Finish());
+  }
+
+  TensorSliceReader reader(delta);
+  TF_ASSERT_OK(reader.status());
+  float a[4];
+  EXPECT_TRUE(reader.CopySliceData("a", TensorSlice(2), a));
+  EXPECT_EQ(0, a[0]);
+  EXPECT_EQ(1, a[1]);
+  EXPECT_EQ(12, a[2]);
+  EXPECT_EQ(13, a[3]);
+  int32 b[2];
+  EXPECT_TRUE(reader.CopySliceData("b", TensorSlice(1), b));
+  EXPECT_EQ(4, b[0]);
+  EXPECT_EQ(5, b[1]);
+
+  // The base must exist, and not be read as a file of its own too.
+  TensorSliceReader both(io::JoinPath(testing::TmpDir(), "delta_*"));
+  EXPECT_FALSE(both.status().ok());
+  TF_ASSERT_OK(Env::Default()->DeleteFile(base));
+  TensorSliceReader missing(delta);
+  EXPECT_EQ(error::DATA_LOSS, missing.status().code()) << missing.status();
+}
+
 static void VersionTest(const VersionDef& versions, const string& error) {
   const string path = io::JoinPath(testing::TmpDir(), "checkpoint");
 
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/util/tensor_slice_writer.h"
 
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/filter_policy.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -30,11 +31,18 @@ namespace checkpoint {
 
 namespace {
 
+// The first checkpoint version that reads delta checkpoints.
+const int kDeltaCheckpointVersion = 2;
+
 class TableBuilder : public TensorSliceWriter::Builder {
  public:
   TableBuilder(const string& name, WritableFile* f) : name_(name), file_(f) {
+    // Lets readers skip the data blocks of tensors not in this file.
+    static const table::FilterPolicy* filter_policy =
+        table::NewBloomFilterPolicy(10);
     table::Options option;
     option.compression = table::kNoCompression;
+    option.filter_policy = filter_policy;
     builder_.reset(new table::TableBuilder(option, f));
   }
   void Add(StringPiece key, StringPiece val) override {
@@ -89,6 +97,13 @@ TensorSliceWriter::TensorSliceWriter(const string& filename,
   versions->set_min_consumer(TF_CHECKPOINT_VERSION_MIN_CONSUMER);
 }
 
+void TensorSliceWriter::SetBase(const string& base) {
+  sts_.mutable_meta()->set_base(base);
+  // Readers that do not know of bases would not find the slices in it.
+  sts_.mutable_meta()->mutable_versions()->set_min_consumer(
+      kDeltaCheckpointVersion);
+}
+
 Status TensorSliceWriter::Finish() {
   Builder* b;
   Status s = create_builder_(tmpname_, &b);
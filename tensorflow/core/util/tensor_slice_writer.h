@@ -62,6 +62,11 @@ class TensorSliceWriter {
              const TensorSlice& slice, const T* data);
   Status Finish();
 
+  // Makes the checkpoint a delta of the checkpoint file "base": readers
+  // read the slices not added to this one from "base".  "base" is in the
+  // same directory as this checkpoint unless it has a directory part.
+  void SetBase(const string& base);
+
   // Allocate "num_elements" elements in "ss" and save the data in "data"
   // there.
   template <typename T>
@@ -15,11 +15,31 @@ limitations under the License.
 
 #include "tensorflow/core/util/work_sharder.h"
 
+#include <set>
+
 #include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 
 namespace tensorflow {
 
+namespace {
+
+// If total * cost_per_unit is small, it is not worth shard too
+// much. Let us assume each cost unit is 1ns, kMinCostPerShard=10000
+// is 10us.
+const int64 kMinCostPerShard = 10000;
+
+// The number of shards worth splitting "total" units of "cost_per_unit"
+// into.
+int NumShards(int max_parallelism, int64 total, int64 cost_per_unit) {
+  return std::max<int>(1, std::min(static_cast<int64>(max_parallelism),
+                                   total * cost_per_unit / kMinCostPerShard));
+}
+
+}  // namespace
+
 void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
            int64 cost_per_unit, std::function<void(int64, int64)> work) {
   CHECK_GE(total, 0);
@@ -40,14 +60,7 @@ void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
   cost_per_unit = std::max(1LL, cost_per_unit);
   // We shard [0, total) into "num_shards" shards.
   //   1 <= num_shards <= num worker threads
-  //
-  // If total * cost_per_unit is small, it is not worth shard too
-  // much. Let us assume each cost unit is 1ns, kMinCostPerShard=10000
-  // is 10us.
-  static const int64 kMinCostPerShard = 10000;
-  const int num_shards =
-      std::max<int>(1, std::min(static_cast<int64>(max_parallelism),
-                                total * cost_per_unit / kMinCostPerShard));
+  const int num_shards = NumShards(max_parallelism, total, cost_per_unit);
 
   // Each shard contains up to "block_size" units. [0, total) is sharded
   // into:
@@ -76,4 +89,149 @@ void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
   counter.Wait();
 }
 
+namespace {
+
+// The live AdaptiveShardCosts, for GetShardingStats().
+mutex* RegistryMutex() {
+  static mutex* mu = new mutex;
+  return mu;
+}
+
+std::set<AdaptiveShardCost*>* Registry() {
+  static std::set<AdaptiveShardCost*>* registry =
+      new std::set<AdaptiveShardCost*>;
+  return registry;
+}
+
+// Shards recorded since the last update of an estimate are folded into
+// it once they took this long, so that the resolution of the clock does
+// not skew it.
+const int64 kMinMeasuredMicros = 1000;
+
+}  // namespace
+
+AdaptiveShardCost::AdaptiveShardCost(const string& name,
+                                     int64 initial_cost_per_unit,
+                                     Schedule schedule)
+    : name_(name),
+      initial_cost_per_unit_(initial_cost_per_unit),
+      schedule_(schedule),
+      cost_per_unit_(initial_cost_per_unit),
+      num_calls_(0),
+      num_units_(0),
+      num_shards_(0) {
+  mutex_lock l(*RegistryMutex());
+  Registry()->insert(this);
+}
+
+AdaptiveShardCost::~AdaptiveShardCost() {
+  mutex_lock l(*RegistryMutex());
+  Registry()->erase(this);
+}
+
+void AdaptiveShardCost::RecordShard(int64 units, int64 micros) {
+  ++num_shards_;
+  mutex_lock l(mu_);
+  pending_units_ += units;
+  pending_micros_ += micros;
+}
+
+void AdaptiveShardCost::RecordCall(int64 units) {
+  ++num_calls_;
+  num_units_ += units;
+  mutex_lock l(mu_);
+  if (pending_micros_ < kMinMeasuredMicros || pending_units_ == 0) return;
+  const int64 measured =
+      std::max<int64>(1, pending_micros_ * 1000 / pending_units_);
+  pending_units_ = 0;
+  pending_micros_ = 0;
+  if (!measured_) {
+    // The first measurement replaces the caller's estimate.
+    measured_ = true;
+    cost_per_unit_ = measured;
+  } else {
+    // An exponential moving average, so that the estimate follows changes
+    // of the input without jumping on outliers.
+    cost_per_unit_ = (3 * cost_per_unit_.load() + measured) / 4;
+  }
+}
+
+ShardingStats AdaptiveShardCost::GetStats() const {
+  ShardingStats stats;
+  stats.name = name_;
+  stats.num_calls = num_calls_.load();
+  stats.num_units = num_units_.load();
+  stats.num_shards = num_shards_.load();
+  stats.initial_cost_per_unit = initial_cost_per_unit_;
+  stats.cost_per_unit = cost_per_unit_.load();
+  return stats;
+}
+
+string ShardingStats::DebugString() const {
+  return strings::StrCat(name, ": ", num_calls, " calls, ", num_units,
+                         " units in ", num_shards, " shards, cost per unit ",
+                         cost_per_unit, " (initially ", initial_cost_per_unit,
+                         ")");
+}
+
+void GetShardingStats(std::vector<ShardingStats>* stats) {
+  mutex_lock l(*RegistryMutex());
+  for (const AdaptiveShardCost* cost : *Registry()) {
+    stats->push_back(cost->GetStats());
+  }
+}
+
+void AdaptiveShard(int max_parallelism, thread::ThreadPool* workers,
+                   int64 total, AdaptiveShardCost* cost,
+                   std::function<void(int64, int64)> work) {
+  CHECK_GE(total, 0);
+  if (total == 0) {
+    return;
+  }
+  Env* env = Env::Default();
+  auto timed_work = [env, cost, &work](int64 start, int64 limit) {
+    const uint64 start_micros = env->NowMicros();
+    work(start, limit);
+    cost->RecordShard(limit - start, env->NowMicros() - start_micros);
+  };
+  const int64 cost_per_unit = std::max<int64>(1, cost->cost_per_unit());
+  const int num_threads = NumShards(max_parallelism, total, cost_per_unit);
+  if (cost->schedule() == AdaptiveShardCost::kStatic || num_threads <= 1) {
+    Shard(max_parallelism, workers, total, cost_per_unit, timed_work);
+    cost->RecordCall(total);
+    return;
+  }
+
+  // The calling thread and "num_threads - 1" workers take chunks of the
+  // work from the front until none is left.
+  const int64 min_chunk = std::max<int64>(1, kMinCostPerShard / cost_per_unit);
+  const bool guided = cost->schedule() == AdaptiveShardCost::kGuided;
+  std::atomic<int64> next(0);
+  auto run_chunks = [total, num_threads, min_chunk, guided, &next,
+                     &timed_work]() {
+    int64 start = next.load();
+    while (start < total) {
+      int64 chunk = min_chunk;
+      if (guided) {
+        chunk = std::max(chunk, (total - start) / (2 * num_threads));
+      }
+      const int64 limit = std::min(start + chunk, total);
+      if (next.compare_exchange_weak(start, limit)) {
+        timed_work(start, limit);
+        start = next.load();
+      }
+    }
+  };
+  BlockingCounter counter(num_threads - 1);
+  for (int i = 1; i < num_threads; ++i) {
+    workers->Schedule([&run_chunks, &counter]() {
+      run_chunks();
+      counter.DecrementCount();
+    });
+  }
+  run_chunks();
+  counter.Wait();
+  cost->RecordCall(total);
+}
+
 }  // end namespace tensorflow
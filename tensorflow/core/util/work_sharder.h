@@ -16,9 +16,15 @@ limitations under the License.
 #ifndef TENSORFLOW_UTIL_WORK_SHARDER_H_
 #define TENSORFLOW_UTIL_WORK_SHARDER_H_
 
+#include <atomic>
 #include <functional>
+#include <string>
+#include <vector>
 
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -42,6 +48,86 @@ namespace tensorflow {
 void Shard(int max_parallelism, thread::ThreadPool* workers, int64 total,
            int64 cost_per_unit, std::function<void(int64, int64)> work);
 
+// How the work of a call site of AdaptiveShard() has been sharded.
+struct ShardingStats {
+  string name;
+  int64 num_calls = 0;
+  int64 num_units = 0;
+  int64 num_shards = 0;
+  int64 initial_cost_per_unit = 0;
+  int64 cost_per_unit = 0;
+
+  string DebugString() const;
+};
+
+// The cost model of a call site of AdaptiveShard(), typically owned by a
+// kernel. It starts from the caller's estimate of the cost per unit of
+// work, and then follows the measured cost, in nanoseconds per unit, of
+// the shards run for it. Thread-safe.
+class AdaptiveShardCost {
+ public:
+  // How AdaptiveShard() splits the work.
+  enum Schedule {
+    // Into equal blocks, one per thread, like Shard().
+    kStatic,
+    // Into chunks handed out on demand, each half of the remaining work
+    // per thread, which suits units of uneven cost.
+    kGuided,
+    // Into chunks of the minimum profitable size handed out on demand.
+    kDynamic,
+  };
+
+  // "name" identifies the call site in GetShardingStats().
+  AdaptiveShardCost(const string& name, int64 initial_cost_per_unit,
+                    Schedule schedule);
+  ~AdaptiveShardCost();
+
+  const string& name() const { return name_; }
+  Schedule schedule() const { return schedule_; }
+
+  // The current estimate of the cost of a unit of work.
+  int64 cost_per_unit() const { return cost_per_unit_.load(); }
+
+  // Records that a shard of "units" units of work took "micros".
+  void RecordShard(int64 units, int64 micros);
+
+  // Records the end of a call of "units" units of work, and folds the
+  // shards recorded since the last update into the estimate once they
+  // took long enough to be measured accurately.
+  void RecordCall(int64 units);
+
+  ShardingStats GetStats() const;
+
+ private:
+  const string name_;
+  const int64 initial_cost_per_unit_;
+  const Schedule schedule_;
+  std::atomic<int64> cost_per_unit_;
+
+  std::atomic<int64> num_calls_;
+  std::atomic<int64> num_units_;
+  std::atomic<int64> num_shards_;
+
+  // The shards recorded since the estimate was last updated.
+  mutex mu_;
+  int64 pending_units_ GUARDED_BY(mu_) = 0;
+  int64 pending_micros_ GUARDED_BY(mu_) = 0;
+  bool measured_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AdaptiveShardCost);
+};
+
+// Like Shard(), except that the cost per unit of work comes from, and is
+// measured for, "cost", whose schedule decides how the work is split.
+//
+// REQUIRES: cost != nullptr
+void AdaptiveShard(int max_parallelism, thread::ThreadPool* workers,
+                   int64 total, AdaptiveShardCost* cost,
+                   std::function<void(int64, int64)> work);
+
+// Appends the stats of all the live AdaptiveShardCosts to "*stats".
+void GetShardingStats(std::vector<ShardingStats>* stats);
+
 }  // end namespace tensorflow
 
 #endif  // TENSORFLOW_UTIL_WORK_SHARDER_H_
@@ -76,6 +76,80 @@ TEST(Shard, OverflowTest) {
   }
 }
 
+void RunAdaptiveSharding(int64 num_workers, int64 total,
+                         AdaptiveShardCost* cost,
+                         thread::ThreadPool* threads) {
+  mutex mu;
+  int64 num_done_work = 0;
+  std::vector<bool> work(total, false);
+  AdaptiveShard(num_workers, threads, total, cost,
+                [=, &mu, &num_done_work, &work](int64 start, int64 limit) {
+                  EXPECT_GE(start, 0);
+                  EXPECT_LT(start, limit);
+                  EXPECT_LE(limit, total);
+                  mutex_lock l(mu);
+                  for (; start < limit; ++start) {
+                    EXPECT_FALSE(work[start]);  // No duplicate
+                    ++num_done_work;
+                    work[start] = true;
+                  }
+                });
+  EXPECT_EQ(num_done_work, total);
+}
+
+TEST(AdaptiveShard, Basic) {
+  thread::ThreadPool threads(Env::Default(), "test", 16);
+  for (auto schedule :
+       {AdaptiveShardCost::kStatic, AdaptiveShardCost::kGuided,
+        AdaptiveShardCost::kDynamic}) {
+    for (auto workers : {0, 1, 2, 3, 7, 16, 100}) {
+      for (auto total : {0, 1, 7, 64, 1000, 9999}) {
+        for (auto cost_per_unit : {0, 1, 102, 10005, 1000007}) {
+          AdaptiveShardCost cost("test", cost_per_unit, schedule);
+          RunAdaptiveSharding(workers, total, &cost, &threads);
+          ShardingStats stats = cost.GetStats();
+          EXPECT_EQ(total > 0 ? 1 : 0, stats.num_calls);
+          EXPECT_EQ(total, stats.num_units);
+          EXPECT_LE(stats.num_shards, total);
+        }
+      }
+    }
+  }
+}
+
+TEST(AdaptiveShard, LearnsCost) {
+  thread::ThreadPool threads(Env::Default(), "test", 4);
+  // Each unit takes about 100us, far more than estimated.
+  AdaptiveShardCost cost("sleep", 1, AdaptiveShardCost::kDynamic);
+  auto work = [](int64 start, int64 limit) {
+    Env::Default()->SleepForMicroseconds((limit - start) * 100);
+  };
+  for (int i = 0; i < 4; ++i) {
+    AdaptiveShard(4, &threads, 100, &cost, work);
+  }
+  EXPECT_GE(cost.cost_per_unit(), 100 * 1000);
+  // With the learned cost, the units are worth a shard each.
+  const int64 num_shards = cost.GetStats().num_shards;
+  AdaptiveShard(4, &threads, 100, &cost, work);
+  EXPECT_EQ(100, cost.GetStats().num_shards - num_shards);
+}
+
+TEST(AdaptiveShard, Stats) {
+  AdaptiveShardCost cost("MyOp/my_node", 42, AdaptiveShardCost::kGuided);
+  std::vector<ShardingStats> all_stats;
+  GetShardingStats(&all_stats);
+  bool found = false;
+  for (const ShardingStats& stats : all_stats) {
+    if (stats.name == "MyOp/my_node") {
+      found = true;
+      EXPECT_EQ(42, stats.initial_cost_per_unit);
+      EXPECT_EQ(42, stats.cost_per_unit);
+      EXPECT_EQ(0, stats.num_calls);
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
 void BM_Sharding(int iters, int arg) {
   thread::ThreadPool threads(Env::Default(), "test", 16);
   const int64 total = 1LL << 30;
@@ -87,5 +161,32 @@ void BM_Sharding(int iters, int arg) {
 }
 BENCHMARK(BM_Sharding)->Range(1, 128);
 
+// Shards work whose units cost 10x more at the end of the range than at
+// the start, with the given schedule.
+void BM_AdaptiveSharding(int iters, int schedule) {
+  testing::StopTiming();
+  thread::ThreadPool threads(Env::Default(), "test", 16);
+  AdaptiveShardCost cost("bm", 100,
+                         static_cast<AdaptiveShardCost::Schedule>(schedule));
+  const int64 total = 1 << 12;
+  auto work = [total](int64 start, int64 limit) {
+    volatile int64 sink = 0;
+    for (int64 i = start; i < limit; ++i) {
+      for (int64 j = 0; j < 10 + i * 100 / total; ++j) sink += j;
+    }
+  };
+  testing::ItemsProcessed(static_cast<int64>(iters) * total);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    AdaptiveShard(16, &threads, total, &cost, work);
+  }
+  testing::StopTiming();
+  VLOG(1) << cost.GetStats().DebugString();
+}
+BENCHMARK(BM_AdaptiveSharding)
+    ->Arg(AdaptiveShardCost::kStatic)
+    ->Arg(AdaptiveShardCost::kGuided)
+    ->Arg(AdaptiveShardCost::kDynamic);
+
 }  // namespace
 }  // namespace tensorflow
@@ -337,6 +337,21 @@ class FIFOQueueTest(tf.test.TestCase):
       self.assertAllEqual(elems[0:4], dequeued_t.eval())
       self.assertAllEqual(elems[4:8], dequeued_t.eval())
 
+  def testEnqueueManyVariableThenAssign(self):
+    with self.test_session():
+      v = tf.Variable([10.0, 20.0, 30.0, 40.0])
+      q = tf.FIFOQueue(10, tf.float32, ())
+      enqueue_op = q.enqueue_many((v,))
+      assign_op = v.assign([1.0, 2.0, 3.0, 4.0])
+      dequeued_t = q.dequeue_many(2)
+
+      tf.initialize_all_variables().run()
+      enqueue_op.run()
+      # The queue holds the values of the variable when they were enqueued.
+      assign_op.run()
+      self.assertAllEqual([10.0, 20.0], dequeued_t.eval())
+      self.assertAllEqual([30.0, 40.0], dequeued_t.eval())
+
   def testDequeueUpToNoBlocking(self):
     with self.test_session():
       q = tf.FIFOQueue(10, tf.float32, ())
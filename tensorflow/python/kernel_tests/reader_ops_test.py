@@ -412,6 +412,35 @@ class TFRecordReaderTest(tf.test.TestCase):
       self.assertEqual(self._num_files * self._num_records, num_k)
       self.assertEqual(self._num_files * self._num_records, num_v)
 
+  def testReadUpToSmallChunks(self):
+    files = self._CreateFiles()
+    for readahead_depth in [0, 3]:
+      with self.test_session() as sess:
+        reader = tf.TFRecordReader(name="test_reader", buffer_size=5,
+                                   readahead_depth=readahead_depth)
+        queue = tf.FIFOQueue(99, [tf.string], shapes=())
+        key, value = reader.read_up_to(queue, 4)
+
+        queue.enqueue_many([files]).run()
+        queue.close().run()
+        keys = []
+        values = []
+        while True:
+          try:
+            k, v = sess.run([key, value])
+            keys.extend(tf.compat.as_text(x) for x in k)
+            values.extend(v)
+          except tf.errors.OutOfRangeError:
+            break
+
+        self.assertAllEqual(
+            [self._Record(i, j) for i in range(self._num_files)
+             for j in range(self._num_records)], values)
+        # Each record takes 16 bytes of framing and 18 of data.
+        self.assertEqual(["%s:%d" % (files[i], 34 * j)
+                          for i in range(self._num_files)
+                          for j in range(self._num_records)], keys)
+
 
 class TFRecordWriterZlibTest(tf.test.TestCase):
 
@@ -333,6 +333,91 @@ class UnsortedSegmentSumGpuTest(UnsortedSegmentSumTest):
   use_gpu = True
 
 
+class UnsortedSegmentMaxAndMeanTest(SegmentReductionHelper):
+
+  def testValues(self):
+    dtypes = [tf.float32,
+              tf.float64,
+              tf.int64,
+              tf.int32]
+    indices_flat = np.array([0, 4, 0, 8, 3, 8, 4, 7, 7, 3])
+    num_segments = 12
+    for indices in indices_flat, indices_flat.reshape(5, 2):
+      shape = indices.shape + (2,)
+      for dtype in dtypes:
+        with self.test_session():
+          tf_x, np_x = self._input(shape, dtype=dtype)
+          for tf_op, np_op1, np_op2, empty in [
+              (tf.unsorted_segment_max, np.maximum, None,
+               dtype.as_numpy_dtype(dtype.min)),
+              (tf.unsorted_segment_mean, self._mean_cum_op,
+               self._mean_reduce_op, 0)]:
+            np_ans = self._segmentReduce(indices,
+                                         np_x,
+                                         np_op1,
+                                         op2=np_op2,
+                                         num_out_rows=num_segments)
+            s = tf_op(data=tf_x, segment_ids=indices,
+                      num_segments=num_segments)
+            tf_ans = s.eval()
+            self._assertAllClose(indices, np_ans, tf_ans)
+            self.assertShapeEqual(np_ans, s)
+            for i in set(range(num_segments)) - set(indices_flat):
+              self.assertAllEqual([empty, empty], tf_ans[i])
+
+  def testLargeInput(self):
+    # Large enough for the rows to be reduced on several threads.
+    num_rows, num_cols, num_segments = 4000, 16, 300
+    np.random.seed(0)
+    indices = np.random.randint(0, num_segments, size=num_rows)
+    np_x = np.random.rand(num_rows, num_cols).astype(np.float32)
+    np_sum = np.zeros((num_segments, num_cols), dtype=np.float32)
+    np_max = np.full((num_segments, num_cols), np.finfo(np.float32).min,
+                     dtype=np.float32)
+    for i, index in enumerate(indices):
+      np_sum[index] += np_x[i]
+      np_max[index] = np.maximum(np_max[index], np_x[i])
+    counts = np.bincount(indices, minlength=num_segments).reshape(-1, 1)
+    np_mean = np_sum / np.maximum(counts, 1)
+    with self.test_session():
+      self.assertAllClose(
+          np_sum, tf.unsorted_segment_sum(np_x, indices, num_segments).eval())
+      self.assertAllEqual(
+          np_max, tf.unsorted_segment_max(np_x, indices, num_segments).eval())
+      self.assertAllClose(
+          np_mean,
+          tf.unsorted_segment_mean(np_x, indices, num_segments).eval())
+
+  def testGradient(self):
+    num_cols = 2
+    indices_flat = np.array([0, 4, 0, 8, 3, 8, 4, 7, 7, 3])
+    num_segments = max(indices_flat) + 3
+    for tf_op in tf.unsorted_segment_max, tf.unsorted_segment_mean:
+      for indices in indices_flat, indices_flat.reshape(5, 2):
+        shape = indices.shape + (num_cols,)
+        with self.test_session():
+          tf_x, np_x = self._input(shape, dtype=tf.float64)
+          s = tf_op(data=tf_x, segment_ids=indices, num_segments=num_segments)
+          jacob_t, jacob_n = tf.test.compute_gradient(
+              tf_x,
+              shape,
+              s,
+              [num_segments, num_cols],
+              x_init_value=np_x.astype(np.double),
+              delta=1)
+        self.assertAllClose(jacob_t, jacob_n, rtol=1e-3, atol=1e-3)
+
+  def testBadIndices(self):
+    with self.test_session():
+      for bad in [[-1]], [[7]]:
+        for tf_op in tf.unsorted_segment_max, tf.unsorted_segment_mean:
+          unsorted = tf_op([[17]], bad, num_segments=2)
+          with self.assertRaisesOpError(
+              r"segment_ids\[0,0\] = %d is out of range \[0, 2\)" %
+              bad[0][0]):
+            unsorted.eval()
+
+
 class SparseSegmentReductionHelper(SegmentReductionHelper):
 
   def _sparse_input(self, input_shape, num_indices,
@@ -526,12 +526,17 @@ class TFRecordReader(ReaderBase):
   """
   # TODO(josh11b): Support serializing and restoring state.
 
-  def __init__(self, name=None, options=None):
+  def __init__(self, name=None, options=None, buffer_size=None,
+               readahead_depth=None):
     """Create a TFRecordReader.
 
     Args:
       name: A name for the operation (optional).
       options: A TFRecordOptions object (optional).
+      buffer_size: The size in bytes of the chunks in which uncompressed
+        files are read (optional).
+      readahead_depth: The number of chunks read ahead on background
+        threads, or 0 to read each chunk when it is needed (optional).
     """
     compression_type_string = ""
     if (options and
@@ -539,7 +544,9 @@ class TFRecordReader(ReaderBase):
       compression_type_string = "ZLIB"
 
     rr = gen_io_ops._tf_record_reader(name=name,
-                                      compression_type=compression_type_string)
+                                      compression_type=compression_type_string,
+                                      buffer_size=buffer_size,
+                                      readahead_depth=readahead_depth)
     super(TFRecordReader, self).__init__(rr)
 
 
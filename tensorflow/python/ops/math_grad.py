@@ -233,6 +233,41 @@ def _UnsortedSegmentSumGrad(op, grad):
   return array_ops.gather(grad, op.inputs[1]), None, None
 
 
+@ops.RegisterGradient("UnsortedSegmentMean")
+def _UnsortedSegmentMeanGrad(op, grad):
+  """Gradient for UnsortedSegmentMean."""
+  ones_shape = array_ops.concat(
+      0, [array_ops.shape(op.inputs[1]),
+          array_ops.fill(array_ops.expand_dims(
+              array_ops.rank(op.inputs[0]) - array_ops.rank(op.inputs[1]), 0),
+                         1)])
+  ones = array_ops.fill(ones_shape,
+                        constant_op.constant(1, dtype=grad.dtype))
+  scaled_grad = math_ops.div(
+      grad, math_ops.unsorted_segment_sum(ones, op.inputs[1], op.inputs[2]))
+  return array_ops.gather(scaled_grad, op.inputs[1]), None, None
+
+
+@ops.RegisterGradient("UnsortedSegmentMax")
+def _UnsortedSegmentMaxGrad(op, grad):
+  """Gradient for UnsortedSegmentMax."""
+  zeros = array_ops.zeros(array_ops.shape(op.inputs[0]),
+                          dtype=op.inputs[0].dtype)
+
+  # Get the number of selected (maximum) elements in each segment.
+  gathered_outputs = array_ops.gather(op.outputs[0], op.inputs[1])
+  is_selected = math_ops.equal(op.inputs[0], gathered_outputs)
+  num_selected = math_ops.unsorted_segment_sum(
+      math_ops.cast(is_selected, grad.dtype), op.inputs[1], op.inputs[2])
+
+  # Compute the gradient for each segment. The gradient for the ith segment is
+  # divided evenly among the selected elements in that segment.
+  weighted_grads = math_ops.div(grad, num_selected)
+  gathered_grads = array_ops.gather(weighted_grads, op.inputs[1])
+
+  return math_ops.select(is_selected, gathered_grads, zeros), None, None
+
+
 @ops.RegisterGradient("Abs")
 def _AbsGrad(op, grad):
   x = op.inputs[0]
@@ -189,6 +189,8 @@ tf.segment_sum(c, tf.constant([0, 0, 1]))
 @@segment_mean
 
 @@unsorted_segment_sum
+@@unsorted_segment_max
+@@unsorted_segment_mean
 
 @@sparse_segment_sum
 @@sparse_segment_mean
@@ -1924,9 +1926,11 @@ def _SparseSegmentReductionGradShape(op):
 # pylint: enable=invalid-name
 
 
+@ops.RegisterShape("UnsortedSegmentMax")
+@ops.RegisterShape("UnsortedSegmentMean")
 @ops.RegisterShape("UnsortedSegmentSum")
-def _UnsortedSegmentSumShape(op):
-  """Shape function for UnsortedSegmentSum."""
+def _UnsortedSegmentReductionShape(op):
+  """Common shape function for unsorted segment reduction ops."""
   data_shape = op.inputs[0].get_shape()
   segment_ids_shape = op.inputs[1].get_shape()
   mid = segment_ids_shape.ndims
@@ -206,6 +206,84 @@ class TrainingOpsTest(TensorFlowTestCase):
       indices = np.array([0, 2]).astype(index_type)
       self._testTypesForSparseAdagrad(x, y, lr, grad, indices)
 
+  def testSparseApplyAdagradRepeatedIndices(self):
+    # Enough updates to be partitioned among threads.
+    np.random.seed(1)
+    x = np.random.rand(100, 8)
+    y = np.random.rand(100, 8) + 1.0
+    lr = np.array(0.5)
+    grad = np.random.rand(20000, 8)
+    indices = np.random.randint(0, 100, size=20000)
+    expected_x = x.copy()
+    expected_y = y.copy()
+    for (i, index) in enumerate(indices):
+      expected_y[index] += grad[i] * grad[i]
+      expected_x[index] -= lr * grad[i] / np.sqrt(expected_y[index])
+    with self.test_session(use_gpu=False):
+      var = variables.Variable(x)
+      accum = variables.Variable(y)
+      variables.initialize_all_variables().run()
+      training_ops.sparse_apply_adagrad(
+          var, accum, lr, grad, constant_op.constant(indices)).eval()
+      self.assertAllClose(expected_x, var.eval())
+      self.assertAllClose(expected_y, accum.eval())
+
+  def testSparseApplyAdadeltaRepeatedIndices(self):
+    np.random.seed(1)
+    x = np.random.rand(100, 8)
+    y = np.random.rand(100, 8)
+    z = np.random.rand(100, 8)
+    lr = np.array(0.5)
+    rho = np.array(0.9)
+    epsilon = np.array(1e-6)
+    grad = np.random.rand(20000, 8)
+    indices = np.random.randint(0, 100, size=20000)
+    expected_x = x.copy()
+    expected_y = y.copy()
+    expected_z = z.copy()
+    for (i, index) in enumerate(indices):
+      expected_y[index] = rho * expected_y[index] + (1 - rho) * grad[i] ** 2
+      update = (np.sqrt(expected_z[index] + epsilon) /
+                np.sqrt(expected_y[index] + epsilon) * grad[i])
+      expected_z[index] = rho * expected_z[index] + (1 - rho) * update ** 2
+      expected_x[index] -= lr * update
+    with self.test_session(use_gpu=False):
+      var = variables.Variable(x)
+      accum = variables.Variable(y)
+      accum_update = variables.Variable(z)
+      variables.initialize_all_variables().run()
+      training_ops.sparse_apply_adadelta(
+          var, accum, accum_update, lr, rho, epsilon, grad,
+          constant_op.constant(indices)).eval()
+      self.assertAllClose(expected_x, var.eval())
+      self.assertAllClose(expected_y, accum.eval())
+      self.assertAllClose(expected_z, accum_update.eval())
+
+  def testSparseApplyProximalAdagradRepeatedIndices(self):
+    np.random.seed(1)
+    x = np.random.rand(100, 8)
+    y = np.random.rand(100, 8) + 1.0
+    lr = np.array(0.5)
+    l1 = np.array(0.0)
+    l2 = np.array(0.1)
+    grad = np.random.rand(20000, 8)
+    indices = np.random.randint(0, 100, size=20000)
+    expected_x = x.copy()
+    expected_y = y.copy()
+    for (i, index) in enumerate(indices):
+      expected_y[index] += grad[i] * grad[i]
+      learning_rate = lr / np.sqrt(expected_y[index])
+      expected_x[index] = ((expected_x[index] - learning_rate * grad[i]) /
+                           (1.0 + l2 * learning_rate))
+    with self.test_session(use_gpu=False):
+      var = variables.Variable(x)
+      accum = variables.Variable(y)
+      variables.initialize_all_variables().run()
+      training_ops.sparse_apply_proximal_adagrad(
+          var, accum, lr, l1, l2, grad, constant_op.constant(indices)).eval()
+      self.assertAllClose(expected_x, var.eval())
+      self.assertAllClose(expected_y, accum.eval())
+
   def testSparseApplyFtrlDim1(self):
     for (dtype, index_type) in itertools.product(
         [np.float16, np.float32, np.float64], [np.int32, np.int64]):